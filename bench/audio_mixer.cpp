@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <audio_mixer.h>
+
+namespace {
+
+// 2 BGM and 31 SE channels of GenericAudio, all playing
+constexpr int channel_count = 33;
+// frames per Decode call of a typical SDL audio buffer
+constexpr int frames = 1024;
+
+}
+
+// Mixes a block like GenericAudio::Decode does when every channel is active.
+// The argument is the AudioMixer::Kernel, unsupported ones are skipped
+static void BM_MixChannels(benchmark::State& state) {
+	auto kernel = static_cast<AudioMixer::Kernel>(state.range(0));
+	if (!AudioMixer::IsSupported(kernel)) {
+		state.SkipWithError("kernel not supported");
+		return;
+	}
+	auto prev = AudioMixer::GetKernel();
+	AudioMixer::SetKernel(kernel);
+
+	std::vector<std::vector<int16_t>> channels(channel_count, std::vector<int16_t>(frames * 2));
+	for (int c = 0; c < channel_count; ++c) {
+		for (int i = 0; i < frames * 2; ++i) {
+			channels[c][i] = static_cast<int16_t>((i * 331 + c * 7919) % 65536 - 32768);
+		}
+	}
+	std::vector<float> channel_buffer(frames * 2);
+	std::vector<float> mixer_buffer(frames * 2);
+	std::vector<int16_t> out(frames * 2);
+
+	for (auto _: state) {
+		std::fill(mixer_buffer.begin(), mixer_buffer.end(), 0.0f);
+		for (auto& channel: channels) {
+			AudioMixer::ToFloat(channel.data(), AudioDecoderBase::Format::S16, frames * 2, channel_buffer.data());
+			AudioMixer::Accumulate(mixer_buffer.data(), channel_buffer.data(), frames, 2, 0.7f);
+		}
+		AudioMixer::ToS16(mixer_buffer.data(), frames * 2, channel_count * 0.7f, out.data());
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetItemsProcessed(state.iterations() * channel_count * frames);
+
+	AudioMixer::SetKernel(prev);
+}
+
+BENCHMARK(BM_MixChannels)->DenseRange(0, 3);
+
+BENCHMARK_MAIN();
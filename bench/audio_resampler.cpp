@@ -0,0 +1,109 @@
+#include <cmath>
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <audio_mixer.h>
+#include <audio_polyphase.h>
+#if defined(HAVE_LIBSPEEXDSP)
+#  include <speex/speex_resampler.h>
+#endif
+#if defined(HAVE_LIBSAMPLERATE)
+#  include <samplerate.h>
+#endif
+
+namespace {
+
+// A 44100 Hz stereo stream resampled to the 48000 Hz output
+constexpr int input_rate = 44100;
+constexpr int output_rate = 48000;
+constexpr int channels = 2;
+// input frames per call, like the internal buffer of AudioResampler
+constexpr int frames = 1024;
+
+std::vector<float> MakeInput() {
+	std::vector<float> input(frames * channels);
+	for (int i = 0; i < frames * channels; ++i) {
+		input[i] = static_cast<float>(0.5 * std::sin(i * 0.05));
+	}
+	return input;
+}
+
+}
+
+// The argument is the AudioPolyphase::Quality, the second the AudioMixer::Kernel
+static void BM_Polyphase(benchmark::State& state) {
+	auto kernel = static_cast<AudioMixer::Kernel>(state.range(1));
+	if (!AudioMixer::IsSupported(kernel)) {
+		state.SkipWithError("kernel not supported");
+		return;
+	}
+	auto prev = AudioMixer::GetKernel();
+	AudioMixer::SetKernel(kernel);
+
+	AudioPolyphase resampler(channels, static_cast<AudioPolyphase::Quality>(state.range(0)));
+	resampler.Prepare(input_rate, output_rate);
+	resampler.SetRate(input_rate, output_rate);
+	auto input = MakeInput();
+	std::vector<float> output(frames * 2 * channels);
+
+	for (auto _: state) {
+		int in = frames;
+		int out = frames * 2;
+		resampler.Process(input.data(), in, output.data(), out);
+		benchmark::DoNotOptimize(output.data());
+	}
+	state.SetItemsProcessed(state.iterations() * frames);
+
+	AudioMixer::SetKernel(prev);
+}
+
+BENCHMARK(BM_Polyphase)->ArgsProduct({{0, 1, 2}, {0, 1, 2, 3}});
+
+#if defined(HAVE_LIBSPEEXDSP)
+// The argument is the speexdsp quality, AudioResampler uses 0, 3 and 5
+static void BM_Speexdsp(benchmark::State& state) {
+	int error = 0;
+	auto* resampler = speex_resampler_init(channels, input_rate, output_rate, state.range(0), &error);
+	auto input = MakeInput();
+	std::vector<float> output(frames * 2 * channels);
+
+	for (auto _: state) {
+		spx_uint32_t in = frames;
+		spx_uint32_t out = frames * 2;
+		speex_resampler_process_interleaved_float(resampler, input.data(), &in, output.data(), &out);
+		benchmark::DoNotOptimize(output.data());
+	}
+	state.SetItemsProcessed(state.iterations() * frames);
+
+	speex_resampler_destroy(resampler);
+}
+
+BENCHMARK(BM_Speexdsp)->Arg(0)->Arg(3)->Arg(5);
+#endif
+
+#if defined(HAVE_LIBSAMPLERATE)
+// The argument is the libsamplerate converter, AudioResampler uses the sinc ones
+static void BM_Samplerate(benchmark::State& state) {
+	int error = 0;
+	auto* resampler = src_new(state.range(0), channels, &error);
+	auto input = MakeInput();
+	std::vector<float> output(frames * 2 * channels);
+
+	SRC_DATA data = {};
+	data.src_ratio = static_cast<double>(output_rate) / input_rate;
+	for (auto _: state) {
+		data.data_in = input.data();
+		data.data_out = output.data();
+		data.input_frames = frames;
+		data.output_frames = frames * 2;
+		src_process(resampler, &data);
+		benchmark::DoNotOptimize(output.data());
+	}
+	state.SetItemsProcessed(state.iterations() * frames);
+
+	src_delete(resampler);
+}
+
+BENCHMARK(BM_Samplerate)->Arg(SRC_SINC_FASTEST)->Arg(SRC_SINC_MEDIUM_QUALITY)->Arg(SRC_SINC_BEST_QUALITY);
+#endif
+
+BENCHMARK_MAIN();
@@ -5,6 +5,7 @@
 #include <bitmap.h>
 #include <pixel_format.h>
 #include <transform.h>
+#include <bitmap_kernels.h>
 
 constexpr auto opacity_100 = Opacity::Opaque();
 constexpr auto opacity_0 = Opacity(0);
@@ -73,6 +74,41 @@ static void BM_ComputeImageOpacityChipset(benchmark::State& state) {
 
 BENCHMARK(BM_ComputeImageOpacityChipset);
 
+static void BM_ComputeTileOpacityChipset(benchmark::State& state) {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	auto bm = Bitmap::Create(480, 256);
+	for (auto _: state) {
+		auto op = bm->ComputeTileOpacity(16);
+		benchmark::DoNotOptimize(op);
+	}
+}
+
+BENCHMARK(BM_ComputeTileOpacityChipset);
+
+// the argument is the BitmapKernels::Kernel, unsupported ones are skipped
+static void BM_ComputeImageOpacityKernel(benchmark::State& state) {
+	auto kernel = static_cast<BitmapKernels::Kernel>(state.range(0));
+	if (!BitmapKernels::IsSupported(kernel)) {
+		state.SkipWithError("kernel not supported");
+		return;
+	}
+	auto prev = BitmapKernels::GetKernel();
+	BitmapKernels::SetKernel(kernel);
+
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	// opaque images are the worst case, every pixel is read
+	auto bm = Bitmap::Create(320, 240);
+	bm->Fill(Color(0, 0, 0, 255));
+	for (auto _: state) {
+		bm->ComputeImageOpacity();
+	}
+	state.SetItemsProcessed(state.iterations() * 320 * 240);
+
+	BitmapKernels::SetKernel(prev);
+}
+
+BENCHMARK(BM_ComputeImageOpacityKernel)->DenseRange(0, 3);
+
 static void BM_Create(benchmark::State& state) {
 	Bitmap::SetFormat(format);
 	for (auto _: state) {
@@ -278,6 +314,71 @@ static void BM_ToneBlit(benchmark::State& state) {
 
 BENCHMARK(BM_ToneBlit);
 
+static void ToneWithKernel(benchmark::State& state, BitmapKernels::Kernel kernel, const Tone& tone) {
+	if (!BitmapKernels::IsSupported(kernel)) {
+		state.SkipWithError("kernel not supported");
+		return;
+	}
+	auto prev = BitmapKernels::GetKernel();
+	BitmapKernels::SetKernel(kernel);
+
+	Bitmap::SetFormat(format);
+	auto dest = Bitmap::Create(320, 240);
+	auto src = Bitmap::Create(320, 240);
+	auto rect = src->GetRect();
+	for (auto _: state) {
+		dest->ToneBlit(0, 0, *src, rect, tone, opacity, false);
+	}
+	state.SetItemsProcessed(state.iterations() * rect.width * rect.height);
+
+	BitmapKernels::SetKernel(prev);
+}
+
+static void HueWithKernel(benchmark::State& state, BitmapKernels::Kernel kernel) {
+	if (!BitmapKernels::IsSupported(kernel)) {
+		state.SkipWithError("kernel not supported");
+		return;
+	}
+	auto prev = BitmapKernels::GetKernel();
+	BitmapKernels::SetKernel(kernel);
+
+	Bitmap::SetFormat(format);
+	auto dest = Bitmap::Create(320, 240);
+	auto src = Bitmap::Create(320, 240);
+	src->Fill(Color(200, 100, 50, 255));
+	auto rect = src->GetRect();
+	for (auto _: state) {
+		dest->HueChangeBlit(0, 0, *src, rect, 90.0);
+	}
+	state.SetItemsProcessed(state.iterations() * rect.width * rect.height);
+
+	BitmapKernels::SetKernel(prev);
+}
+
+static void BM_ToneBlitColorKernel(benchmark::State& state) {
+	ToneWithKernel(state, static_cast<BitmapKernels::Kernel>(state.range(0)), Tone(255, 64, 128, 128));
+}
+
+BENCHMARK(BM_ToneBlitColorKernel)->DenseRange(0, 3);
+
+static void BM_ToneBlitGrayKernel(benchmark::State& state) {
+	ToneWithKernel(state, static_cast<BitmapKernels::Kernel>(state.range(0)), Tone(128, 128, 128, 0));
+}
+
+BENCHMARK(BM_ToneBlitGrayKernel)->DenseRange(0, 3);
+
+static void BM_ToneBlitFullKernel(benchmark::State& state) {
+	ToneWithKernel(state, static_cast<BitmapKernels::Kernel>(state.range(0)), Tone(255, 255, 255, 64));
+}
+
+BENCHMARK(BM_ToneBlitFullKernel)->DenseRange(0, 3);
+
+static void BM_HueChangeBlitKernel(benchmark::State& state) {
+	HueWithKernel(state, static_cast<BitmapKernels::Kernel>(state.range(0)));
+}
+
+BENCHMARK(BM_HueChangeBlitKernel)->DenseRange(0, 3);
+
 static void BM_BlendBlit(benchmark::State& state) {
 	Bitmap::SetFormat(format);
 	auto dest = Bitmap::Create(320, 240);
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <cache.h>
+#include <bitmap.h>
+#include <pixel_format.h>
+#include <rect.h>
+#include <tone.h>
+#include <color.h>
+
+namespace {
+// One 12 frame charset per character, like a busy map with a screen tone
+struct TonedMap {
+	std::vector<BitmapRef> charsets;
+	std::vector<BitmapRef> effects;
+
+	explicit TonedMap(int characters) {
+		Bitmap::SetFormat(format_R8G8B8A8_a().format());
+		for (int i = 0; i < characters; ++i) {
+			charsets.push_back(Bitmap::Create(72, 128));
+		}
+	}
+
+	~TonedMap() {
+		effects.clear();
+		Cache::Clear();
+	}
+
+	Rect Frame(size_t c, int n) const {
+		int i = static_cast<int>(c) + n;
+		return Rect(i % 3 * 24, i % 4 * 32, 24, 32);
+	}
+
+	void Refresh(int n, const Tone& tone) {
+		effects.clear();
+		for (size_t c = 0; c < charsets.size(); ++c) {
+			effects.push_back(Cache::SpriteEffect(charsets[c], Frame(c, n), c % 2, false, tone, Color()));
+		}
+	}
+};
+}
+
+static void BM_SpriteEffectHit(benchmark::State& state) {
+	TonedMap map(state.range(0));
+	const Tone tone(68, 68, 136, 0);
+
+	// Keep every frame alive, so all lookups hit
+	std::vector<BitmapRef> keep;
+	for (int n = 0; n < 12; ++n) {
+		map.Refresh(n, tone);
+		keep.insert(keep.end(), map.effects.begin(), map.effects.end());
+	}
+
+	int n = 0;
+	for (auto _: state) {
+		for (size_t c = 0; c < map.charsets.size(); ++c) {
+			benchmark::DoNotOptimize(Cache::SpriteEffect(map.charsets[c], map.Frame(c, n), c % 2, false, tone, Color()));
+		}
+		n = (n + 1) % 12;
+	}
+	state.SetItemsProcessed(state.iterations() * map.charsets.size());
+}
+
+BENCHMARK(BM_SpriteEffectHit)->Arg(16)->Arg(64)->Arg(256);
+
+// Tone fades create new effect bitmaps every frame, the old ones expire
+static void BM_SpriteEffectFade(benchmark::State& state) {
+	TonedMap map(state.range(0));
+
+	int n = 0;
+	for (auto _: state) {
+		int v = 128 - n % 128;
+		map.Refresh(n, Tone(v, v, v, 0));
+		++n;
+	}
+	state.SetItemsProcessed(state.iterations() * map.charsets.size());
+}
+
+BENCHMARK(BM_SpriteEffectFade)->Arg(16)->Arg(64);
+
+BENCHMARK_MAIN();
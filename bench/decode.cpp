@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <bitmap.h>
+#include <decode_pool.h>
+#include <filesystem_stream.h>
+#include <game_clock.h>
+
+namespace {
+
+// A teleport to a map with 24 new images of chipset size
+constexpr int num_images = 24;
+// Main loop work besides decoding, the workers run meanwhile
+constexpr auto frame_work = std::chrono::milliseconds(2);
+
+std::vector<uint8_t> MakePng(int seed) {
+	auto bitmap = Bitmap::Create(480, 256, true);
+	auto* pixels = static_cast<uint32_t*>(bitmap->pixels());
+	uint32_t value = seed * 2654435761u;
+	for (int i = 0; i < 480 * 256; ++i) {
+		// runs of similar pixels, compresses like real tiles
+		if (i % 7 == 0) {
+			value = value * 1664525u + 1013904223u;
+		}
+		pixels[i] = value | 0xFF000000u;
+	}
+
+	auto* buf = new std::stringbuf();
+	Filesystem_Stream::OutputStream os(buf, FilesystemView(), "bench.png");
+	bitmap->WritePNG(os);
+	os.flush();
+	auto str = buf->str();
+	return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+}
+
+// Main thread time of every frame from requesting the images until all are
+// decoded. Reported as a frame time histogram, run with --benchmark_counters_tabular=true
+static void BM_DecodeFrameTimes(benchmark::State& state) {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+
+	std::vector<std::vector<uint8_t>> files;
+	for (int i = 0; i < num_images; ++i) {
+		files.push_back(MakePng(i));
+	}
+
+	DecodePool::SetThreads(state.range(0));
+
+	std::vector<double> frame_ms;
+	for (auto _: state) {
+		std::vector<BitmapRef> images(num_images);
+		int done = 0;
+
+		for (int frame = 0; done < num_images; ++frame) {
+			const auto begin = Game_Clock::now();
+			if (frame == 0) {
+				for (int i = 0; i < num_images; ++i) {
+					auto* data = &files[i];
+					auto* image = &images[i];
+					DecodePool::Submit([data, image]() {
+							*image = Bitmap::Create(data->data(), data->size(), true, Bitmap::Flag_ReadOnly);
+						}, [&done]() { ++done; });
+				}
+			}
+			DecodePool::Update();
+			const auto end = Game_Clock::now();
+			frame_ms.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+
+			std::this_thread::sleep_for(frame_work);
+		}
+		benchmark::DoNotOptimize(images);
+	}
+
+	DecodePool::SetThreads(0);
+
+	std::sort(frame_ms.begin(), frame_ms.end());
+	auto count_below = [&](double ms) {
+		return double(std::lower_bound(frame_ms.begin(), frame_ms.end(), ms) - frame_ms.begin());
+	};
+
+	state.counters["frames"] = double(frame_ms.size()) / state.iterations();
+	state.counters["p50_ms"] = frame_ms[frame_ms.size() / 2];
+	state.counters["p99_ms"] = frame_ms[frame_ms.size() * 99 / 100];
+	state.counters["max_ms"] = frame_ms.back();
+	state.counters["lt1ms"] = count_below(1.0);
+	state.counters["lt4ms"] = count_below(4.0) - count_below(1.0);
+	state.counters["lt16ms"] = count_below(16.0) - count_below(4.0);
+	state.counters["ge16ms"] = double(frame_ms.size()) - count_below(16.0);
+}
+
+BENCHMARK(BM_DecodeFrameTimes)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -6,13 +6,14 @@
 #include <graphics.h>
 #include <drawable_list.h>
 #include <drawable_mgr.h>
+#include <band_renderer.h>
 #include <iostream>
 
 constexpr int num_sprites = 5000;
 
 class TestSprite : public Drawable {
 	public:
-		TestSprite() : Drawable(0) { DrawableMgr::Register(this); }
+		TestSprite(int z = 0) : Drawable(z) { DrawableMgr::Register(this); }
 		void Draw(Bitmap&) override {}
 };
 
@@ -45,4 +46,89 @@ static void BM_DrawSortLocality(benchmark::State& state) {
 
 BENCHMARK(BM_DrawSortLocality);
 
+// 1500 map drawables, n characters walking down a tile each frame
+static void BM_DrawSortMoving(benchmark::State& state) {
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	constexpr int count = 1500;
+	std::vector<std::unique_ptr<TestSprite>> sprites;
+	for (int i = 0; i < count; ++i) {
+		sprites.push_back(std::make_unique<TestSprite>(Priority_Player + (i * 7 % 240) * 16));
+	}
+	list.Sort();
+
+	const int moving = state.range(0);
+	int step = 0;
+	for (auto _: state) {
+		for (int i = 0; i < moving; ++i) {
+			auto& sprite = sprites[(i * 97 + step) % count];
+			sprite->SetZ(sprite->GetZ() + (step % 2 ? 16 : -16));
+		}
+		++step;
+		list.Sort();
+	}
+}
+
+BENCHMARK(BM_DrawSortMoving)->Arg(1)->Arg(16)->Arg(64)->Arg(1500);
+
+// Events erased and created again on a map with 1500 drawables
+static void BM_DrawTakeAppend(benchmark::State& state) {
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	constexpr int count = 1500;
+	std::vector<std::unique_ptr<TestSprite>> sprites;
+	for (int i = 0; i < count; ++i) {
+		sprites.push_back(std::make_unique<TestSprite>(Priority_Player + i));
+	}
+
+	int step = 0;
+	for (auto _: state) {
+		auto* sprite = sprites[step * 37 % count].get();
+		list.Take(sprite);
+		list.Append(sprite);
+		list.Sort();
+		++step;
+	}
+}
+
+BENCHMARK(BM_DrawTakeAppend);
+
+// 50 zoomed and rotated pictures on a 640x480 screen, drawn in 1 to 8 bands
+static void BM_DrawBands(benchmark::State& state) {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+
+	auto dst = Bitmap::Create(640, 480, false);
+	auto picture = Bitmap::Create(160, 120, Color(255, 128, 64, 192));
+
+	std::vector<std::unique_ptr<Sprite>> sprites;
+	for (int i = 0; i < 50; ++i) {
+		auto sprite = std::make_unique<Sprite>();
+		sprite->SetBitmap(picture);
+		sprite->SetX(i * 37 % 640);
+		sprite->SetY(i * 53 % 480);
+		sprite->SetZ(i);
+		sprite->SetZoomX(2.0);
+		sprite->SetZoomY(2.0);
+		sprite->SetAngle(i % 2 ? 0.5 : 0.0);
+		sprites.push_back(std::move(sprite));
+	}
+
+	const int bands = state.range(0);
+	BandRenderer renderer(bands);
+	for (auto _: state) {
+		if (bands > 1) {
+			renderer.Draw(*dst, list, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+		} else {
+			list.Draw(*dst);
+		}
+	}
+}
+
+BENCHMARK(BM_DrawBands)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,381 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "multiplayer_connection.h"
+#include "multiplayer_sha1.h"
+#include "yno_message_signer.h"
+#include "yno_messages.h"
+#include "TinySHA1.hpp"
+
+namespace {
+
+class NullConnection : public Multiplayer::Connection {
+public:
+	void Open(std::string_view) override {}
+	void Send(std::string_view) override {}
+};
+
+std::string Msg(std::initializer_list<std::string> fields) {
+	std::string r;
+	for (auto& f : fields) {
+		if (!r.empty())
+			r += Multiplayer::Packet::PARAM_DELIM;
+		r += f;
+	}
+	return r;
+}
+
+std::string PictureFields(int id, int pic) {
+	std::string r = Msg({std::to_string(id), std::to_string(pic), "160", "120",
+		"2560", "1920", "0", "0", "100", "0", "0", "100", "100", "100", "100", "0", "0"});
+	return r;
+}
+
+/**
+ * Message mix modelled after a crowded hub room: 40 players walking around,
+ * turning and playing footstep sounds, a few of them animating pictures.
+ */
+std::vector<std::string> MakeStream() {
+	std::vector<std::string> stream;
+	constexpr int players = 40;
+	for (int frame = 0; frame < 60; ++frame) {
+		for (int id = 0; id < players; ++id) {
+			auto sid = std::to_string(id);
+			stream.push_back(Msg({"m", sid, std::to_string(10 + frame % 20), std::to_string(20 + id % 15)}));
+			if ((frame + id) % 3 == 0)
+				stream.push_back(Msg({"f", sid, std::to_string(frame % 4)}));
+			if ((frame + id) % 4 == 0)
+				stream.push_back(Msg({"se", sid, "Foot_Step", "70", "100", "50"}));
+			if (id < 4) {
+				auto pic = PictureFields(id, 1);
+				stream.push_back(Msg({"mp", pic, "4"}));
+			}
+			if (id < 4 && frame % 15 == 0) {
+				auto pic = PictureFields(id, 2);
+				stream.push_back(Msg({"ap", pic, "Picture_Name", "1", "0"}));
+			}
+		}
+		if (frame % 10 == 0) {
+			stream.push_back(Msg({"spd", "3", "4"}));
+			stream.push_back(Msg({"spr", "5", "Charset_1", "3"}));
+			stream.push_back(Msg({"say", "7", "hello everybody"}));
+		}
+	}
+	return stream;
+}
+
+void RegisterHandlers(NullConnection& conn) {
+	using namespace YNO_Messages::S2C;
+	conn.RegisterHandler<MovePacket>("m", [] (MovePacket& p) {
+		benchmark::DoNotOptimize(p.x + p.y);
+	});
+	conn.RegisterHandler<FacingPacket>("f", [] (FacingPacket& p) {
+		benchmark::DoNotOptimize(p.facing);
+	});
+	conn.RegisterHandler<SpeedPacket>("spd", [] (SpeedPacket& p) {
+		benchmark::DoNotOptimize(p.speed);
+	});
+	conn.RegisterHandler<SpritePacket>("spr", [] (SpritePacket& p) {
+		benchmark::DoNotOptimize(p.name.data());
+	});
+	conn.RegisterHandler<ChatPacket>("say", [] (ChatPacket& p) {
+		benchmark::DoNotOptimize(p.msg.data());
+	});
+	conn.RegisterHandler<SEPacket>("se", [] (SEPacket& p) {
+		benchmark::DoNotOptimize(p.volume);
+	});
+	conn.RegisterHandler<ShowPicturePacket>("ap", [] (ShowPicturePacket& p) {
+		benchmark::DoNotOptimize(p.params.position_x);
+	});
+	conn.RegisterHandler<MovePicturePacket>("mp", [] (MovePicturePacket& p) {
+		benchmark::DoNotOptimize(p.params.position_x);
+	});
+	conn.RegisterHandler<ErasePicturePacket>("rp", [] (ErasePicturePacket& p) {
+		benchmark::DoNotOptimize(p.pic_id);
+	});
+	conn.RegisterHandler<NamePacket>("name", [] (NamePacket& p) {
+		benchmark::DoNotOptimize(p.name.data());
+	});
+	conn.RegisterHandler<DisconnectPacket>("d", [] (DisconnectPacket& p) {
+		benchmark::DoNotOptimize(p.id);
+	});
+	conn.RegisterHandler<ConnectPacket>("c", [] (ConnectPacket& p) {
+		benchmark::DoNotOptimize(p.uuid.data());
+	});
+}
+
+}
+
+static void BM_Split(benchmark::State& state) {
+	auto msg = PictureFields(1, 1);
+	for (auto _: state) {
+		auto params = Multiplayer::Connection::Split(msg);
+		benchmark::DoNotOptimize(params.size());
+	}
+}
+
+BENCHMARK(BM_Split);
+
+static void BM_DispatchStream(benchmark::State& state) {
+	NullConnection conn;
+	RegisterHandlers(conn);
+	auto stream = MakeStream();
+	size_t bytes = 0;
+	for (auto& m : stream)
+		bytes += m.size();
+
+	for (auto _: state) {
+		for (auto& m : stream) {
+			conn.DispatchMessage(m);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * stream.size());
+	state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+BENCHMARK(BM_DispatchStream);
+
+static void BM_DispatchStreamBinary(benchmark::State& state) {
+	NullConnection conn;
+	RegisterHandlers(conn);
+	std::vector<std::string> stream;
+	size_t bytes = 0;
+	for (auto& m : MakeStream()) {
+		std::string b(1, Multiplayer::Packet::BINARY_MARKER);
+		b += Multiplayer::C2SPacket::TextToBinary(m);
+		bytes += b.size();
+		stream.push_back(std::move(b));
+	}
+
+	for (auto _: state) {
+		for (auto& m : stream) {
+			conn.DispatchBinary(m);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * stream.size());
+	state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+BENCHMARK(BM_DispatchStreamBinary);
+
+namespace {
+
+/** Outbound packets of a player walking around and animating a picture. */
+std::vector<std::unique_ptr<Multiplayer::C2SPacket>> MakeOutbound() {
+	namespace C = YNO_Messages::C2S;
+	std::vector<std::unique_ptr<Multiplayer::C2SPacket>> r;
+	lcf::rpg::Sound snd;
+	snd.name = "Foot_Step";
+	snd.volume = 70;
+	Game_Pictures::MoveParams mp;
+	mp.position_x = 160;
+	mp.position_y = 120;
+	mp.duration = 4;
+	for (int i = 0; i < 100; ++i) {
+		r.emplace_back(new C::MainPlayerPosPacket(40 + i % 20, 30 + i % 7));
+		r.emplace_back(new C::FacingPacket(i % 4));
+		if (i % 4 == 0)
+			r.emplace_back(new C::SEPacket(snd));
+		if (i % 10 == 0)
+			r.emplace_back(new C::SpeedPacket(4));
+		r.emplace_back(new C::MovePicturePacket(1, mp, 2560, 1920, 0, 0));
+	}
+	return r;
+}
+
+template <Multiplayer::WireFormat F>
+void EncodeOutbound(benchmark::State& state) {
+	auto packets = MakeOutbound();
+	size_t bytes = 0;
+	for (auto _: state) {
+		bytes = 0;
+		for (auto& p : packets) {
+			auto s = p->Encode(F);
+			bytes += s.size();
+			benchmark::DoNotOptimize(s.data());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * packets.size());
+	state.counters["bytes_per_packet"] = double(bytes) / packets.size();
+}
+
+}
+
+static void BM_EncodeText(benchmark::State& state) {
+	EncodeOutbound<Multiplayer::WireFormat::Text>(state);
+}
+
+BENCHMARK(BM_EncodeText);
+
+static void BM_EncodeBinary(benchmark::State& state) {
+	EncodeOutbound<Multiplayer::WireFormat::Binary>(state);
+}
+
+BENCHMARK(BM_EncodeBinary);
+
+static void BM_QueueFlush(benchmark::State& state) {
+	namespace C = YNO_Messages::C2S;
+	NullConnection conn;
+	lcf::rpg::Sound snd;
+	snd.name = "Foot_Step";
+	Game_Pictures::MoveParams mp;
+	size_t queued = 0;
+	for (auto _: state) {
+		// one frame: a few state updates around a sound and a picture move
+		for (int i = 0; i < 4; ++i) {
+			conn.SendPacketAsync<C::MainPlayerPosPacket>(40 + i, 30);
+			conn.SendPacketAsync<C::FacingPacket>(i % 4);
+		}
+		conn.SendPacketAsync<C::SEPacket>(snd);
+		conn.SendPacketAsync<C::SpeedPacket>(4);
+		conn.SendPacketAsync<C::MovePicturePacket>(1, mp, 2560, 1920, 0, 0);
+		queued += 11;
+		conn.FlushQueue();
+	}
+	state.SetItemsProcessed(queued);
+}
+
+BENCHMARK(BM_QueueFlush);
+
+namespace {
+
+class CountingConnection : public Multiplayer::Connection {
+public:
+	void Open(std::string_view) override {}
+	void Send(std::string_view data) override {
+		++packets;
+		bytes += data.size();
+	}
+
+	size_t packets = 0;
+	size_t bytes = 0;
+};
+
+}
+
+/**
+ * Synthetic load of a picture heavy game: every frame the player walks and
+ * every picture is moved, a footstep plays every 8th frame. One iteration
+ * is one simulated second at 60 fps.
+ *
+ * Args: animated pictures, picture budget per second (0 = unlimited)
+ */
+static void BM_PictureLoad(benchmark::State& state) {
+	namespace C = YNO_Messages::C2S;
+	const int pictures = state.range(0);
+	CountingConnection conn;
+	conn.SetBudget(Multiplayer::PacketLane::Picture, state.range(1));
+	conn.SetBudget(Multiplayer::PacketLane::Sound, 4);
+
+	lcf::rpg::Sound snd;
+	snd.name = "Foot_Step";
+	Game_Pictures::MoveParams mp;
+	mp.duration = 1;
+	auto t = Game_Clock::time_point();
+	int frame = 0;
+	size_t produced = 0;
+	for (auto _: state) {
+		for (int i = 0; i < Game_Clock::GetTargetGameFps(); ++i, ++frame) {
+			Game_Clock::ResetFrame(t);
+			conn.SendPacketAsync<C::MainPlayerPosPacket>(40 + frame % 20, 30);
+			if (frame % 8 == 0)
+				conn.SendPacketAsync<C::SEPacket>(snd);
+			for (int pic = 1; pic <= pictures; ++pic) {
+				mp.position_x = (frame * 3 + pic * 7) % 320;
+				mp.position_y = (frame + pic * 11) % 240;
+				conn.SendPacketAsync<C::MovePicturePacket>(pic, mp, 2560, 1920, 0, 0);
+			}
+			produced += 1 + (frame % 8 == 0) + pictures;
+			conn.FlushQueue();
+			t += Game_Clock::GetTargetGameTimeStep();
+		}
+	}
+	const double seconds = state.iterations();
+	state.SetItemsProcessed(produced);
+	state.counters["produced_per_s"] = produced / seconds;
+	state.counters["sent_per_s"] = conn.packets / seconds;
+	state.counters["bytes_per_s"] = conn.bytes / seconds;
+	state.counters["coalesced_per_s"] = conn.GetOutboundStats().coalesced / seconds;
+	state.counters["se_dropped_per_s"] = conn.GetOutboundStats().dropped / seconds;
+}
+
+BENCHMARK(BM_PictureLoad)->ArgsProduct({{4, 16, 64}, {0, 120, 30}});
+
+namespace {
+
+/** Message header as built before YNO::MessageSigner */
+std::string TinySha1Header(std::string_view key, size_t count, std::string_view msg) {
+	char counter[7];
+	snprintf(counter, 7, "%06zu", count);
+
+	std::string hashmsg{key};
+	hashmsg += counter;
+	hashmsg += msg;
+
+	sha1::SHA1 digest;
+	uint32_t digest_result[5];
+	digest.processBytes(hashmsg.data(), hashmsg.size());
+	digest.getDigest(digest_result);
+
+	char signature[9];
+	snprintf(signature, 9, "%08x", digest_result[0]);
+
+	std::string r{signature};
+	r += counter;
+	return r;
+}
+
+constexpr std::string_view sign_key = "0123456789abcdef0123456789abcdef";
+
+}
+
+/** Arg: message size */
+static void BM_SignTinySHA1(benchmark::State& state) {
+	std::string msg(state.range(0), 'x');
+	size_t count = 0;
+	for (auto _: state) {
+		auto h = TinySha1Header(sign_key, ++count, msg);
+		benchmark::DoNotOptimize(h.data());
+	}
+	state.SetBytesProcessed(state.iterations() * msg.size());
+}
+
+BENCHMARK(BM_SignTinySHA1)->Arg(64)->Arg(512)->Arg(4096);
+
+static void SignWithKernel(benchmark::State& state, Multiplayer::Sha1::Kernel kernel) {
+	if (!Multiplayer::Sha1::IsSupported(kernel)) {
+		state.SkipWithError("kernel not supported");
+		return;
+	}
+	auto prev = Multiplayer::Sha1::GetKernel();
+	Multiplayer::Sha1::SetKernel(kernel);
+
+	YNO::MessageSigner signer;
+	signer.SetKey(sign_key, "");
+	std::string msg(state.range(0), 'x');
+	std::string out;
+	size_t count = 0;
+	for (auto _: state) {
+		out.clear();
+		signer.AppendHeader(out, ++count, msg);
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetBytesProcessed(state.iterations() * msg.size());
+
+	Multiplayer::Sha1::SetKernel(prev);
+}
+
+static void BM_SignScalar(benchmark::State& state) {
+	SignWithKernel(state, Multiplayer::Sha1::Kernel::Scalar);
+}
+
+BENCHMARK(BM_SignScalar)->Arg(64)->Arg(512)->Arg(4096);
+
+static void BM_SignShaNi(benchmark::State& state) {
+	SignWithKernel(state, Multiplayer::Sha1::Kernel::ShaNi);
+}
+
+BENCHMARK(BM_SignShaNi)->Arg(64)->Arg(512)->Arg(4096);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+#include <bitmap.h>
+#include <color.h>
+#include <drawable.h>
+#include <drawable_list.h>
+#include <drawable_mgr.h>
+#include <map_data.h>
+#include <pixel_format.h>
+#include <tilemap_layer.h>
+
+namespace {
+constexpr int map_w = 40;
+constexpr int map_h = 30;
+
+// 320x240 screen showing 20x15 tiles of a map with water, walls and floor
+struct TilemapFixture {
+	DrawableList list;
+	std::unique_ptr<TilemapLayer> layer;
+	BitmapRef screen;
+
+	TilemapFixture() {
+		Bitmap::SetFormat(format_R8G8B8A8_a().format());
+		DrawableMgr::SetLocalList(&list);
+
+		// Opaque, transparent and partially transparent tiles, so every
+		// opacity class of the chipset is drawn
+		auto chipset = Bitmap::Create(480, 256, true);
+		chipset->Clear();
+		for (int ty = 0; ty < 16; ++ty) {
+			for (int tx = 0; tx < 30; ++tx) {
+				const Color color(tx * 8, ty * 16, (tx + ty) * 4, 255);
+				switch ((tx * 7 + ty * 3) % 3) {
+					case 0:
+						chipset->FillRect(Rect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE), color);
+						break;
+					case 1:
+						for (int y = 0; y < TILE_SIZE; y += 4) {
+							chipset->FillRect(Rect(tx * TILE_SIZE + (y / 4 % 2) * 4, ty * TILE_SIZE + y, 8, 4), color);
+						}
+						break;
+					default:
+						break;
+				}
+			}
+		}
+		chipset->CheckPixels(Bitmap::Flag_Chipset | Bitmap::Flag_ReadOnly);
+
+		std::vector<short> data(map_w * map_h);
+		for (int y = 0; y < map_h; ++y) {
+			for (int x = 0; x < map_w; ++x) {
+				short id;
+				switch ((x / 5 + y / 3) % 4) {
+					case 0: id = (x + y) % 47; break; // A1 water
+					case 1: id = BLOCK_C + (x % 3) * 50; break;
+					default: id = BLOCK_D + ((x + y) % 12) * 50 + (x * y) % 47; break;
+				}
+				data[x + y * map_w] = id;
+			}
+		}
+
+		layer = std::make_unique<TilemapLayer>(0);
+		layer->SetWidth(map_w);
+		layer->SetHeight(map_h);
+		layer->SetChipset(chipset);
+		layer->SetMapData(std::move(data));
+
+		screen = Bitmap::Create(320, 240, false);
+	}
+
+	void Draw() {
+		layer->Draw(*screen, Priority_TilesetBelow);
+	}
+};
+}
+
+static void BM_TilemapFullRedraw(benchmark::State& state) {
+	TilemapFixture f;
+	f.layer->SetRetained(false);
+	for (auto _: state) {
+		f.Draw();
+	}
+}
+
+BENCHMARK(BM_TilemapFullRedraw);
+
+static void BM_TilemapRetainedInvalidate(benchmark::State& state) {
+	TilemapFixture f;
+	for (auto _: state) {
+		f.layer->Invalidate();
+		f.Draw();
+	}
+}
+
+BENCHMARK(BM_TilemapRetainedInvalidate);
+
+static void BM_TilemapRetainedStatic(benchmark::State& state) {
+	TilemapFixture f;
+	f.Draw();
+	for (auto _: state) {
+		f.Draw();
+	}
+}
+
+BENCHMARK(BM_TilemapRetainedStatic);
+
+// Scrolls state.range(0) pixels per frame back and forth over the map
+static void BM_TilemapRetainedScroll(benchmark::State& state) {
+	TilemapFixture f;
+	const int speed = state.range(0);
+	const int max_ox = (map_w - 20) * TILE_SIZE;
+	int ox = 0;
+	int dir = speed;
+	f.Draw();
+	for (auto _: state) {
+		ox += dir;
+		if (ox <= 0 || ox >= max_ox) {
+			dir = -dir;
+		}
+		f.layer->SetOx(ox);
+		f.layer->SetOy(ox * 3 / 4);
+		f.Draw();
+	}
+}
+
+BENCHMARK(BM_TilemapRetainedScroll)->Arg(1)->Arg(4)->Arg(16);
+
+BENCHMARK_MAIN();
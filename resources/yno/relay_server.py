@@ -0,0 +1,388 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for the YNO multiplayer server.
+
+Speaks the same WebSocket protocol as the real server closely enough to
+exercise the client packet handlers on a native build:
+
+  * the room id is taken from the request path (ws://host:port/<room>)
+  * every client gets a "s" sync packet with its id, signing key and uuid
+  * "c"/"d" are broadcast when clients join or leave a room
+  * player state and event packets are relayed to the other clients of the
+    room, prefixed with the id of the sender
+  * signed bulk messages are split on the message delimiter and the header
+    signature is verified
+
+With --echo every relayed packet is also sent back to its sender under a
+ghost player id, so a single client sees a mirror of itself.
+
+With --binary the server offers the compact binary wire format (see
+WireFormat in multiplayer_packet.h) in the sync packet. Clients that accept
+it with a "wire" packet send and receive binary messages afterwards.
+
+Only the Python standard library is required.
+
+Usage:
+  relay_server.py [--host 127.0.0.1] [--port 8028] [--echo] [--binary] [--stats N]
+
+Point the player at it with YNO_SOCKET_URL=ws://127.0.0.1:8028/
+"""
+
+import argparse
+import asyncio
+import base64
+import collections
+import hashlib
+import os
+import struct
+import sys
+import uuid as uuidlib
+
+PARAM_DELIM = "\uffff"
+MSG_DELIM = "\ufffe"
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+# must match get_secret() in yno_connection.cpp
+SECRET = ""
+# packets that are forwarded to the other players of the room
+RELAYED = {"m", "f", "spd", "spr", "sys", "se", "ap", "mp", "rp", "name", "say"}
+# latest state replayed to players joining later
+STATEFUL = {"m", "f", "spd", "spr", "sys", "name"}
+GHOST_OFFSET = 10000
+# must match the opcode table in multiplayer_packet.cpp
+OPCODES = ["", "s", "c", "d", "m", "f", "spd", "spr", "sys", "se",
+           "ap", "mp", "rp", "name", "say", "gsay", "ploc", "ban", "wire"]
+OPCODE_EXTENDED = 0xFF
+BINARY_MARKER = b"\x00"
+
+OP_CONT, OP_TEXT, OP_BINARY, OP_CLOSE, OP_PING, OP_PONG = 0x0, 0x1, 0x2, 0x8, 0x9, 0xA
+
+
+def is_canonical_int(s):
+    if not s or len(s) > 11:
+        return False
+    digits = s[1:] if s[0] == "-" else s
+    if not digits.isdigit() or not digits.isascii():
+        return False
+    if digits[0] == "0" and len(s) > 1:
+        return False
+    return -2**31 <= int(s) < 2**31
+
+
+def write_varint(out, v):
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+
+
+def read_varint(data, pos):
+    result = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        result |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return result, pos
+        shift += 7
+
+
+def encode_binary(name, args):
+    out = bytearray()
+    op = OPCODES.index(name) if name in OPCODES else OPCODE_EXTENDED
+    out.append(op)
+    if op == OPCODE_EXTENDED:
+        raw = name.encode("utf-8")
+        write_varint(out, len(raw))
+        out += raw
+    write_varint(out, len(args))
+    for a in args:
+        a = str(a)
+        if is_canonical_int(a):
+            v = int(a)
+            write_varint(out, (((v << 1) ^ (v >> 31)) & 0xFFFFFFFF) << 1)
+        else:
+            raw = a.encode("utf-8")
+            write_varint(out, (len(raw) << 1) | 1)
+            out += raw
+    return bytes(out)
+
+
+def decode_binary(data):
+    """Yields (name, args) for every packet of a binary message body."""
+    pos = 1  # skip marker
+    while pos < len(data):
+        op = data[pos]
+        pos += 1
+        if op == OPCODE_EXTENDED:
+            n, pos = read_varint(data, pos)
+            name = data[pos:pos + n].decode("utf-8")
+            pos += n
+        else:
+            name = OPCODES[op]
+        count, pos = read_varint(data, pos)
+        args = []
+        for _ in range(count):
+            h, pos = read_varint(data, pos)
+            if h & 1:
+                n = h >> 1
+                args.append(data[pos:pos + n].decode("utf-8", errors="replace"))
+                pos += n
+            else:
+                zz = h >> 1
+                args.append(str((zz >> 1) ^ -(zz & 1)))
+        yield name, args
+
+
+class Stats:
+    def __init__(self):
+        self.packets_in = collections.Counter()
+        self.packets_out = 0
+        self.bytes_in = 0
+        self.bytes_out = 0
+        self.bad_signatures = 0
+
+    def dump(self):
+        top = ", ".join(f"{k}={v}" for k, v in self.packets_in.most_common())
+        print(f"[stats] in={self.bytes_in}B out={self.bytes_out}B "
+              f"sent={self.packets_out} badsig={self.bad_signatures} | {top}",
+              flush=True)
+
+
+class Client:
+    def __init__(self, server, reader, writer, room, pid):
+        self.server = server
+        self.reader = reader
+        self.writer = writer
+        self.room = room
+        self.id = pid
+        self.key = os.urandom(8).hex()
+        self.uuid = uuidlib.uuid4().hex[:16]
+        self.state = {}
+        self.binary = False
+        self.name = ""
+        self.sys = ""
+
+    def send_frame(self, opcode, payload):
+        n = len(payload)
+        if n < 126:
+            header = struct.pack("!BB", 0x80 | opcode, n)
+        elif n <= 0xFFFF:
+            header = struct.pack("!BBH", 0x80 | opcode, 126, n)
+        else:
+            header = struct.pack("!BBQ", 0x80 | opcode, 127, n)
+        self.writer.write(header + payload)
+        self.server.stats.packets_out += 1
+        self.server.stats.bytes_out += len(header) + n
+
+    def send_packet(self, name, *args):
+        if self.binary:
+            self.send_frame(OP_BINARY, BINARY_MARKER + encode_binary(name, args))
+        else:
+            text = PARAM_DELIM.join([name] + [str(a) for a in args])
+            self.send_frame(OP_TEXT, text.encode("utf-8"))
+
+
+class RelayServer:
+    def __init__(self, echo, binary):
+        self.echo = echo
+        self.binary = binary
+        self.rooms = collections.defaultdict(dict)
+        self.next_id = 0
+        self.stats = Stats()
+
+    async def handshake(self, reader, writer):
+        request = await reader.readuntil(b"\r\n\r\n")
+        lines = request.decode("latin-1").split("\r\n")
+        method, path, _ = lines[0].split(" ", 2)
+        headers = {}
+        for line in lines[1:]:
+            if ":" in line:
+                k, v = line.split(":", 1)
+                headers[k.strip().lower()] = v.strip()
+        key = headers.get("sec-websocket-key")
+        if method != "GET" or not key:
+            writer.write(b"HTTP/1.1 400 Bad Request\r\n\r\n")
+            await writer.drain()
+            return None
+        accept = base64.b64encode(
+            hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+        response = ("HTTP/1.1 101 Switching Protocols\r\n"
+                    "Upgrade: websocket\r\n"
+                    "Connection: Upgrade\r\n"
+                    f"Sec-WebSocket-Accept: {accept}\r\n")
+        if "sec-websocket-protocol" in headers:
+            proto = headers["sec-websocket-protocol"].split(",")[0].strip()
+            response += f"Sec-WebSocket-Protocol: {proto}\r\n"
+        writer.write((response + "\r\n").encode())
+        await writer.drain()
+        return path.strip("/") or "0"
+
+    async def read_message(self, client):
+        """Returns (opcode, payload) of the next complete message."""
+        fragments = []
+        first_op = None
+        while True:
+            b0, b1 = await client.reader.readexactly(2)
+            fin, op = b0 & 0x80, b0 & 0x0F
+            n = b1 & 0x7F
+            if n == 126:
+                n, = struct.unpack("!H", await client.reader.readexactly(2))
+            elif n == 127:
+                n, = struct.unpack("!Q", await client.reader.readexactly(8))
+            mask = await client.reader.readexactly(4) if b1 & 0x80 else None
+            data = await client.reader.readexactly(n)
+            self.stats.bytes_in += n
+            if mask:
+                data = bytes(c ^ mask[i & 3] for i, c in enumerate(data))
+            if op == OP_PING:
+                client.writer.write(struct.pack("!BB", 0x80 | OP_PONG, len(data)) + data)
+                continue
+            if op == OP_PONG:
+                continue
+            if op == OP_CLOSE:
+                return OP_CLOSE, data
+            if op != OP_CONT:
+                first_op = op
+            fragments.append(data)
+            if fin:
+                return first_op, b"".join(fragments)
+
+    def verify(self, client, header, body):
+        signature, counter = header[:8], header[8:14]
+        digest = hashlib.sha1(
+            (client.key + SECRET).encode() + counter + body).hexdigest()
+        if digest[:8].encode() != signature:
+            self.stats.bad_signatures += 1
+            print(f"[{client.room}] bad signature from {client.id}", flush=True)
+            return False
+        return True
+
+    def broadcast(self, client, name, args, include_self=False):
+        for other in list(self.rooms[client.room].values()):
+            if other is client and not include_self:
+                continue
+            other.send_packet(name, client.id, *args)
+        if self.echo and name != "say":
+            client.send_packet(name, client.id + GHOST_OFFSET, *args)
+
+    def handle_packet(self, client, name, args):
+        self.stats.packets_in[name] += 1
+        if name in STATEFUL:
+            client.state[name] = args
+        if name == "name" and args:
+            client.name = args[0]
+        if name == "sys" and args:
+            client.sys = args[0]
+        if name == "wire" and args:
+            client.binary = self.binary and args[0] == "1"
+
+        if name in RELAYED:
+            self.broadcast(client, name, args, include_self=(name == "say"))
+        elif name == "gsay" and args:
+            for room in self.rooms.values():
+                for other in room.values():
+                    other.send_packet("gsay", client.uuid, client.name, client.sys,
+                                      0, client.room, "", "", args[0])
+
+    def join(self, client):
+        room = self.rooms[client.room]
+        if self.binary:
+            client.send_packet("s", client.id, client.key, client.uuid, 0, 1)
+        else:
+            client.send_packet("s", client.id, client.key, client.uuid, 0)
+        for other in room.values():
+            other.send_packet("c", client.id, client.uuid, 0)
+            client.send_packet("c", other.id, other.uuid, 0)
+            for name, args in other.state.items():
+                client.send_packet(name, other.id, *args)
+        if self.echo:
+            client.send_packet("c", client.id + GHOST_OFFSET, client.uuid, 0)
+        room[client.id] = client
+        print(f"[{client.room}] player {client.id} joined ({len(room)} in room)", flush=True)
+
+    def leave(self, client):
+        room = self.rooms[client.room]
+        room.pop(client.id, None)
+        for other in room.values():
+            other.send_packet("d", client.id)
+        print(f"[{client.room}] player {client.id} left ({len(room)} in room)", flush=True)
+
+    async def serve_client(self, reader, writer):
+        try:
+            room = await self.handshake(reader, writer)
+        except (asyncio.IncompleteReadError, ValueError, ConnectionError):
+            writer.close()
+            return
+        if room is None:
+            writer.close()
+            return
+
+        client = Client(self, reader, writer, room, self.next_id)
+        self.next_id += 1
+        self.join(client)
+        await writer.drain()
+
+        try:
+            while True:
+                op, data = await self.read_message(client)
+                if op == OP_CLOSE:
+                    break
+                if len(data) < 14:
+                    continue
+                header, body = data[:14], data[14:]
+                if not self.verify(client, header, body):
+                    continue
+                if body[:1] == BINARY_MARKER:
+                    try:
+                        packets = list(decode_binary(body))
+                    except (IndexError, UnicodeDecodeError):
+                        print(f"[{client.room}] malformed binary message from {client.id}", flush=True)
+                        continue
+                else:
+                    packets = []
+                    for msg in body.decode("utf-8", errors="replace").split(MSG_DELIM):
+                        parts = msg.split(PARAM_DELIM)
+                        packets.append((parts[0], parts[1:]))
+                for name, args in packets:
+                    self.handle_packet(client, name, args)
+                await writer.drain()
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            self.leave(client)
+            writer.close()
+
+
+async def main():
+    parser = argparse.ArgumentParser(description="YNO relay stand-in server")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8028)
+    parser.add_argument("--echo", action="store_true",
+                        help="mirror every packet back to its sender as a ghost player")
+    parser.add_argument("--binary", action="store_true",
+                        help="offer the binary wire format to clients")
+    parser.add_argument("--stats", type=float, default=0,
+                        help="print traffic statistics every N seconds")
+    args = parser.parse_args()
+
+    relay = RelayServer(args.echo, args.binary)
+    server = await asyncio.start_server(relay.serve_client, args.host, args.port)
+    print(f"Listening on ws://{args.host}:{args.port}/", flush=True)
+
+    async def stats_loop():
+        while True:
+            await asyncio.sleep(args.stats)
+            relay.stats.dump()
+
+    if args.stats > 0:
+        asyncio.ensure_future(stats_loop())
+
+    async with server:
+        await server.serve_forever()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        sys.exit(0)
@@ -29,6 +29,7 @@
 
 #include "async_handler.h"
 #include "cache.h"
+#include "decode_pool.h"
 #include "filefinder.h"
 #include "memory_management.h"
 #include "output.h"
@@ -452,6 +453,22 @@ void FileRequestAsync::DownloadDone(bool success) {
 		}
 #endif
 
+		if (graphic && state == State_Pending && DecodePool::GetThreads() > 0) {
+			// Stays pending until the image is decoded, the listeners then
+			// find it in the cache. The request can be gone by then.
+			auto done = [path = path]() {
+				if (auto* request = GetRequest(path)) {
+					request->DecodeDone();
+				}
+			};
+			if (transparent_set) {
+				Cache::Preload(directory, file, transparent, std::move(done));
+			} else {
+				Cache::Preload(directory, file, std::move(done));
+			}
+			return;
+		}
+
 		state = State_DoneSuccess;
 
 		CallListeners(true);
@@ -462,3 +479,9 @@ void FileRequestAsync::DownloadDone(bool success) {
 		CallListeners(false);
 	}
 }
+
+void FileRequestAsync::DecodeDone() {
+	state = State_DoneSuccess;
+
+	CallListeners(true);
+}
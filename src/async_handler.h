@@ -153,6 +153,16 @@ public:
 	 */
 	void SetGraphicFile(bool graphic);
 
+	/**
+	 * Sets the transparency a graphic is decoded with in the background.
+	 * It must match the transparent argument the image is requested with
+	 * from the cache, otherwise the decoded image is not found there.
+	 * Without it the transparency of the material is used.
+	 *
+	 * @param transparent value of the transparent argument.
+	 */
+	void SetTransparent(bool transparent);
+
 	/**
 	 * @return If while has necessary flag.
 	 */
@@ -218,6 +228,7 @@ public:
 
 	// don't call these directly
 	void DownloadDone(bool success);
+	void DecodeDone();
 	void UpdateProgress();
 private:
 	void CallListeners(bool success);
@@ -230,6 +241,9 @@ private:
 	bool important = false;
 	bool graphic = false;
 	bool necessary = true;
+	bool transparent = false;
+	/** transparent was set, otherwise the material decides */
+	bool transparent_set = false;
 };
 
 /**
@@ -274,6 +288,11 @@ inline void FileRequestAsync::SetNecessary(bool necessary) {
 	this->necessary = necessary;
 }
 
+inline void FileRequestAsync::SetTransparent(bool transparent) {
+	this->transparent = transparent;
+	transparent_set = true;
+}
+
 inline const std::string& FileRequestAsync::GetPath() const {
 	return path;
 }
@@ -106,6 +106,14 @@ struct AudioInterface {
 	 */
 	virtual void SE_Play(Filesystem_Stream::InputStream stream, int volume, int pitch) = 0;
 
+	/**
+	 * Prepares a sound effect that is likely to be played soon, so that
+	 * playing it does not decode. Does nothing by default.
+	 *
+	 * @param stream file to prepare.
+	 */
+	virtual void SE_Preload(Filesystem_Stream::InputStream) {}
+
 	/**
 	 * Stops the currently playing sound effect.
 	 */
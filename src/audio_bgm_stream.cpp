@@ -0,0 +1,196 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#include <algorithm>
+#include <cstring>
+#include "audio_bgm_stream.h"
+#include "audio_decoder.h"
+
+AudioBgmStream::AudioBgmStream(std::unique_ptr<AudioDecoderBase> decoder, std::chrono::milliseconds read_ahead) :
+		decoder(std::move(decoder)),
+		blocks(std::max<size_t>(2, read_ahead / block_duration)),
+		filled(blocks.size()),
+		available(blocks.size()),
+		controls(64) {
+	this->decoder->GetFormat(frequency, format, channels);
+	pitch = this->decoder->GetPitch();
+	volume = this->decoder->GetVolume();
+	ticks = this->decoder->GetTicks();
+	loop_count = this->decoder->GetLoopCount();
+
+	int frames = std::max<int>(frequency * block_duration.count() / 1000, 1);
+	size_t block_size = frames * channels * AudioDecoder::GetSamplesizeForFormat(format);
+	block_time = std::chrono::microseconds(std::chrono::seconds(frames)) / frequency;
+	for (auto& block : blocks) {
+		block.data.resize(block_size);
+		available.Push(&block);
+	}
+
+	thread = std::thread(&AudioBgmStream::Run, this);
+}
+
+AudioBgmStream::~AudioBgmStream() {
+	quit.store(true, std::memory_order_release);
+	thread.join();
+}
+
+bool AudioBgmStream::Open(Filesystem_Stream::InputStream) {
+	return false;
+}
+
+int AudioBgmStream::GetVolume() const {
+	return volume;
+}
+
+void AudioBgmStream::SetVolume(int new_volume) {
+	controls.Push(Control(Control::Type::Volume, new_volume));
+}
+
+void AudioBgmStream::SetFade(int end, std::chrono::milliseconds duration) {
+	controls.Push(Control(Control::Type::Fade, end, duration.count()));
+}
+
+bool AudioBgmStream::Seek(std::streamoff, std::ios_base::seekdir) {
+	return false;
+}
+
+bool AudioBgmStream::IsFinished() const {
+	// The last block was taken and played completely
+	return finished && !current;
+}
+
+void AudioBgmStream::GetFormat(int& out_frequency, Format& out_format, int& out_channels) const {
+	out_frequency = frequency;
+	out_format = format;
+	out_channels = channels;
+}
+
+int AudioBgmStream::GetPitch() const {
+	return pitch;
+}
+
+bool AudioBgmStream::SetPitch(int new_pitch) {
+	pitch = new_pitch;
+	controls.Push(Control(Control::Type::Pitch, new_pitch));
+	return true;
+}
+
+int AudioBgmStream::GetTicks() const {
+	return ticks;
+}
+
+unsigned AudioBgmStream::GetUnderruns() const {
+	return underruns.load(std::memory_order_relaxed);
+}
+
+int AudioBgmStream::GetBlockCount() const {
+	return static_cast<int>(blocks.size());
+}
+
+int AudioBgmStream::FillBuffer(uint8_t* buffer, int size) {
+	int written = 0;
+
+	while (written < size) {
+		if (!current) {
+			if (finished || failed) {
+				break;
+			}
+			if (!filled.Pop(current)) {
+				// The decode thread fell behind, the rest of the buffer stays silent
+				underruns.fetch_add(1, std::memory_order_relaxed);
+				break;
+			}
+			current_offset = 0;
+			volume = current->volume;
+			ticks = current->ticks;
+			loop_count = current->loop_count;
+			finished = current->finished;
+			if (current->size < 0) {
+				failed = true;
+				ReleaseBlock();
+				break;
+			}
+		}
+
+		int bytes = std::min(size - written, current->size - current_offset);
+		memcpy(buffer + written, current->data.data() + current_offset, bytes);
+		written += bytes;
+		current_offset += bytes;
+
+		if (current_offset >= current->size) {
+			ReleaseBlock();
+		}
+	}
+
+	if (failed && written == 0) {
+		return -1;
+	}
+	return written;
+}
+
+void AudioBgmStream::ReleaseBlock() {
+	available.Push(std::move(current));
+	current = nullptr;
+}
+
+void AudioBgmStream::Run() {
+	bool decoding = true;
+	Block* block = nullptr;
+
+	while (!quit.load(std::memory_order_acquire)) {
+		ApplyControls();
+
+		if (!decoding || !available.Pop(block)) {
+			// All blocks are decoded, wait until the audio thread played some of them
+			std::this_thread::sleep_for(block_duration / 2);
+			continue;
+		}
+
+		decoding = DecodeBlock(*block);
+		filled.Push(std::move(block));
+	}
+}
+
+void AudioBgmStream::ApplyControls() {
+	Control control;
+	while (controls.Pop(control)) {
+		switch (control.type) {
+			case Control::Type::Volume:
+				decoder->SetVolume(control.value);
+				break;
+			case Control::Type::Fade:
+				decoder->SetFade(control.value, std::chrono::milliseconds(control.duration));
+				break;
+			case Control::Type::Pitch:
+				decoder->SetPitch(control.value);
+				break;
+		}
+	}
+}
+
+bool AudioBgmStream::DecodeBlock(Block& block) {
+	// Same order as the audio thread uses for decoders without read-ahead
+	decoder->Update(block_time);
+	block.volume = decoder->GetVolume();
+	block.size = decoder->Decode(block.data.data(), static_cast<int>(block.data.size()));
+	block.ticks = decoder->GetTicks();
+	block.loop_count = decoder->GetLoopCount();
+	block.finished = block.size >= 0 && decoder->IsFinished();
+
+	return block.size >= 0 && !block.finished;
+}
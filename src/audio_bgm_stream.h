@@ -0,0 +1,174 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_AUDIO_BGM_STREAM_H
+#define EP_AUDIO_BGM_STREAM_H
+
+// Headers
+#include "audio_decoder_base.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Decodes a BGM on its own thread ahead of playback.
+ * Wraps another decoder, which is only used by the decode thread after
+ * construction. The decoded data reaches the audio thread through a
+ * lock-free ring of blocks, each tagged with the volume, ticks and loop
+ * count the decoder had when the block was decoded.
+ *
+ * The audio thread is the only caller besides constructor and destructor.
+ * Volume, fade and pitch changes are applied by the decode thread, so they
+ * become audible after the data that was already decoded.
+ */
+class AudioBgmStream : public AudioDecoderBase {
+public:
+	/**
+	 * Takes the decoder and starts the decode thread.
+	 *
+	 * @param decoder opened decoder, format and pitch are already set
+	 * @param read_ahead amount of audio decoded ahead of playback
+	 */
+	AudioBgmStream(std::unique_ptr<AudioDecoderBase> decoder, std::chrono::milliseconds read_ahead);
+
+	/** Stops the decode thread */
+	~AudioBgmStream() override;
+
+	/**
+	 * The wrapped decoder is already open.
+	 *
+	 * @return false
+	 */
+	bool Open(Filesystem_Stream::InputStream) override;
+
+	void Pause() override {}
+	void Resume() override {}
+
+	/** @return volume of the block that is being played */
+	int GetVolume() const override;
+
+	/** Forwarded to the decode thread */
+	void SetVolume(int volume) override;
+
+	/** Forwarded to the decode thread */
+	void SetFade(int end, std::chrono::milliseconds duration) override;
+
+	/**
+	 * Seeking is not supported, the stream does not loop itself.
+	 *
+	 * @return false
+	 */
+	bool Seek(std::streamoff, std::ios_base::seekdir) override;
+
+	/** @return whether the decoder finished and all blocks were played */
+	bool IsFinished() const override;
+
+	/** Fades are updated by the decode thread by the duration of each block */
+	void Update(std::chrono::microseconds) override {}
+
+	void GetFormat(int& frequency, Format& format, int& channels) const override;
+
+	int GetPitch() const override;
+
+	/**
+	 * Forwarded to the decode thread.
+	 *
+	 * @return true
+	 */
+	bool SetPitch(int pitch) override;
+
+	/** @return ticks of the block that is being played */
+	int GetTicks() const override;
+
+	/** @return how often the audio thread asked for more data than was decoded */
+	unsigned GetUnderruns() const;
+
+	/** @return amount of blocks the decoded audio is split into */
+	int GetBlockCount() const;
+
+	/** Duration of a block */
+	static constexpr std::chrono::milliseconds block_duration = std::chrono::milliseconds(10);
+
+protected:
+	int FillBuffer(uint8_t* buffer, int size) override;
+
+private:
+	struct Block {
+		std::vector<uint8_t> data;
+		/** bytes decoded, -1 on error */
+		int size = 0;
+		int volume = 0;
+		int ticks = 0;
+		int loop_count = 0;
+		/** last block of a decoder that does not loop */
+		bool finished = false;
+	};
+	struct Control {
+		enum class Type {
+			Volume,
+			Fade,
+			Pitch
+		};
+		Control(Type type = Type::Volume, int value = 0, int duration = 0) : type(type), value(value), duration(duration) {}
+
+		Type type;
+		int value;
+		/** fade time in ms */
+		int duration;
+	};
+
+	/** Decode thread: decodes blocks until stopped */
+	void Run();
+	/** Decode thread: applies the queued volume, fade and pitch changes */
+	void ApplyControls();
+	/** Decode thread: decodes the next block, returns false when nothing more follows */
+	bool DecodeBlock(Block& block);
+	/** Audio thread: releases the block that is being played */
+	void ReleaseBlock();
+
+	std::unique_ptr<AudioDecoderBase> decoder;
+	std::vector<Block> blocks;
+
+	/** Decoded blocks, decode thread to audio thread */
+	SpscQueue<Block*> filled;
+	/** Played blocks, audio thread to decode thread */
+	SpscQueue<Block*> available;
+	SpscQueue<Control> controls;
+
+	int frequency = 0;
+	Format format = Format::S16;
+	int channels = 0;
+	std::chrono::microseconds block_time;
+
+	// Audio thread state
+	Block* current = nullptr;
+	int current_offset = 0;
+	int volume = 0;
+	int ticks = 0;
+	int pitch = 100;
+	bool finished = false;
+	bool failed = false;
+
+	std::atomic<unsigned> underruns = { 0 };
+	std::atomic<bool> quit = { false };
+	std::thread thread;
+};
+
+#endif
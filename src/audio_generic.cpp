@@ -17,27 +17,36 @@
 
 #include "system.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <memory>
+#include "audio_bgm_stream.h"
 #include "audio_decoder_midi.h"
 #include "audio_generic.h"
 #include "audio_generic_midiout.h"
+#include "audio_mixer.h"
 #include "filefinder.h"
+#include "game_config.h"
 #include "output.h"
 
 GenericAudio::BgmChannel GenericAudio::BGM_Channels[nr_of_bgm_channels];
 GenericAudio::SeChannel GenericAudio::SE_Channels[nr_of_se_channels];
-bool GenericAudio::BGM_PlayedOnceIndicator;
 
 std::vector<int16_t> GenericAudio::sample_buffer = {};
 std::vector<uint8_t> GenericAudio::scrap_buffer = {};
 unsigned GenericAudio::scrap_buffer_size = 0;
 std::vector<float> GenericAudio::mixer_buffer = {};
+std::vector<float> GenericAudio::channel_buffer = {};
 
 std::unique_ptr<GenericAudioMidiOut> GenericAudio::midi_thread;
 
-GenericAudio::GenericAudio() {
+std::chrono::milliseconds GenericAudio::bgm_read_ahead = std::chrono::milliseconds(200);
+bool GenericAudio::bgm_crossfade = false;
+
+GenericAudio::GenericAudio() :
+	commands(nr_of_commands),
+	retired(nr_of_commands + nr_of_bgm_channels + nr_of_se_channels) {
 	int i = 0;
 	for (auto& BGM_Channel : BGM_Channels) {
 		BGM_Channel.id = i++;
@@ -48,7 +57,6 @@ GenericAudio::GenericAudio() {
 		SE_Channel.id = i++;
 		SE_Channel.decoder.reset();
 	}
-	BGM_PlayedOnceIndicator = false;
 	midi_thread.reset();
 
 	// Initialize to some arbitrary (low-quality) format to prevent crashes
@@ -56,220 +64,345 @@ GenericAudio::GenericAudio() {
 	SetFormat(12345, AudioDecoder::Format::S8, 1);
 }
 
+GenericAudio::~GenericAudio() {
+	FreeRetired();
+}
+
 void GenericAudio::BGM_Play(Filesystem_Stream::InputStream stream, int volume, int pitch, int fadein) {
-	bool bgm_set = false;
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.stopped = true; //Stop all running background music
-		if (!BGM_Channel.IsUsed() && !bgm_set) {
-			// If there is an unused bgm channel
-			bgm_set = true;
-			LockMutex();
-			BGM_PlayedOnceIndicator = false;
-			UnlockMutex();
-			PlayOnChannel(BGM_Channel, std::move(stream), volume, pitch, fadein);
+	++bgm_serial;
+	bgm_playing = true;
+
+	if (!stream) {
+		Output::Warning("BGM file not readable: {}", stream.GetName());
+		StopMidiOut();
+		Post({ Command::Type::BgmStop });
+		return;
+	}
+
+	if (GenericAudioMidiOut::IsSupported(stream) && PlayMidiOut(stream, volume, pitch, fadein)) {
+		Post({ Command::Type::BgmStop });
+		return;
+	}
+	StopMidiOut();
+
+	// Opening reads the headers, this is done here to keep the audio thread free of file access
+	auto decoder = AudioDecoder::Create(stream);
+	if (decoder && decoder->Open(std::move(stream))) {
+		decoder->SetPitch(pitch);
+		decoder->SetFormat(output_format.frequency, output_format.format, output_format.channels);
+		decoder->SetVolume(0);
+		decoder->SetFade(volume, std::chrono::milliseconds(fadein));
+		decoder->SetLooping(true);
+
+		Command command(Command::Type::BgmPlay, bgm_crossfade ? fadein : 0);
+		command.serial = bgm_serial;
+		if (bgm_read_ahead > std::chrono::milliseconds(0)) {
+			command.decoder = std::make_unique<AudioBgmStream>(std::move(decoder), bgm_read_ahead);
+		} else {
+			command.decoder = std::move(decoder);
 		}
+		Post(std::move(command));
+	} else {
+		Output::Warning("Couldn't play BGM {}. Format not supported", stream.GetName());
+		Post({ Command::Type::BgmStop });
 	}
 }
 
 void GenericAudio::BGM_Pause() {
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (BGM_Channel.IsUsed()) {
-			BGM_Channel.SetPaused(true);
-		}
+	if (midi_out_used) {
+		midi_thread->GetMidiOut().Pause();
 	}
+	Post({ Command::Type::BgmPause });
 }
 
 void GenericAudio::BGM_Resume() {
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (BGM_Channel.IsUsed()) {
-			BGM_Channel.SetPaused(false);
-		}
+	if (midi_out_used) {
+		midi_thread->GetMidiOut().Resume();
 	}
+	Post({ Command::Type::BgmResume });
 }
 
 void GenericAudio::BGM_Stop() {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.Stop();
-	}
-	UnlockMutex();
+	bgm_playing = false;
+	StopMidiOut();
+	Post({ Command::Type::BgmStop });
 }
 
 bool GenericAudio::BGM_PlayedOnce() const {
-	if (BGM_PlayedOnceIndicator) {
-		return BGM_PlayedOnceIndicator;
+	if (midi_out_used) {
+		return midi_thread->GetMidiOut().GetLoopCount() > 0;
 	}
 
-	LockMutex();
 	// Audio Decoders set this in the Decoding thread
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (BGM_Channel.midi_out_used) {
-			BGM_PlayedOnceIndicator = midi_thread->GetMidiOut().GetLoopCount() > 0;
-		}
-	}
-	UnlockMutex();
-
-	return BGM_PlayedOnceIndicator;
+	return bgm_serial != 0 && bgm_played_serial.load(std::memory_order_relaxed) == bgm_serial;
 }
 
 bool GenericAudio::BGM_IsPlaying() const {
-	for (auto& BGM_Channel : BGM_Channels) {
-		if (!BGM_Channel.stopped) {
-			return true;
-		};
-	}
-	return false;
+	return bgm_playing;
 }
 
 int GenericAudio::BGM_GetTicks() const {
-	unsigned ticks = 0;
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		int cur_ticks = BGM_Channel.GetTicks();
-		if (cur_ticks >= 0) {
-			ticks = static_cast<unsigned>(cur_ticks);
-		}
+	if (midi_out_used) {
+		return std::max(midi_thread->GetMidiOut().GetTicks(), 0);
+	}
+
+	// Until the audio thread started the current BGM the ticks belong to the previous one
+	if (bgm_ticks_serial.load(std::memory_order_acquire) != bgm_serial) {
+		return 0;
 	}
-	UnlockMutex();
-	return ticks;
+	return bgm_ticks.load(std::memory_order_relaxed);
 }
 
 void GenericAudio::BGM_Fade(int fade) {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.SetFade(fade);
+	if (midi_out_used) {
+		midi_thread->GetMidiOut().SetFade(0, std::chrono::milliseconds(fade));
 	}
-	UnlockMutex();
+	Post({ Command::Type::BgmFade, fade });
 }
 
 void GenericAudio::BGM_Volume(int volume) {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.SetVolume(volume);
+	if (midi_out_used) {
+		midi_thread->GetMidiOut().SetVolume(volume);
 	}
-	UnlockMutex();
+	Post({ Command::Type::BgmVolume, volume });
 }
 
 void GenericAudio::BGM_Pitch(int pitch) {
-	LockMutex();
-	for (auto& BGM_Channel : BGM_Channels) {
-		BGM_Channel.SetPitch(pitch);
+	if (midi_out_used) {
+		midi_thread->GetMidiOut().SetPitch(pitch);
 	}
-	UnlockMutex();
+	Post({ Command::Type::BgmPitch, pitch });
 }
 
 void GenericAudio::SE_Play(Filesystem_Stream::InputStream stream, int volume, int pitch) {
-	for (auto& SE_Channel : SE_Channels) {
-		if (!SE_Channel.decoder) {
-			//If there is an unused se channel
-			PlayOnChannel(SE_Channel, std::move(stream), volume, pitch);
-			return;
-		}
+	std::unique_ptr<AudioSeCache> cache = AudioSeCache::Create(std::move(stream));
+	if (!cache) {
+		Output::Warning("Couldn't play SE {}. Format not supported", stream.GetName());
+		return;
 	}
-	// FIXME Not displaying as warning because multiple games exhaust free channels available, see #1356
-	Output::Debug("Couldn't play {} SE. No free channel available", stream.GetName());
+
+	Command command(Command::Type::SePlay);
+	command.decoder = cache->CreateSeDecoder(pitch);
+	command.decoder->SetPitch(pitch);
+	command.decoder->SetFormat(output_format.frequency, output_format.format, output_format.channels);
+	command.decoder->SetVolume(volume);
+	Post(std::move(command));
+}
+
+void GenericAudio::SE_Preload(Filesystem_Stream::InputStream stream) {
+	AudioSeCache::Preload(std::move(stream));
 }
 
 void GenericAudio::SE_Stop() {
-	for (auto& SE_Channel : SE_Channels) {
-		SE_Channel.stopped = true; //Stop all running sound effects
-	}
+	Post({ Command::Type::SeStop });
 }
 
 void GenericAudio::Update() {
-	// no-op, handled by the Decode function called through a thread
+	// Playback is handled by the Decode function called through a thread
+	FreeRetired();
+
+	unsigned dropped = se_dropped.load(std::memory_order_relaxed);
+	if (dropped != se_dropped_reported) {
+		// FIXME Not displaying as warning because multiple games exhaust free channels available, see #1356
+		Output::Debug("Couldn't play {} SE. No free channel available", dropped - se_dropped_reported);
+		se_dropped_reported = dropped;
+	}
+
+	unsigned underruns = GetBgmUnderruns();
+	if (underruns != bgm_underruns_reported) {
+		Output::Debug("BGM decoding fell behind {} times", underruns - bgm_underruns_reported);
+		bgm_underruns_reported = underruns;
+	}
 }
 
 void GenericAudio::SetFormat(int frequency, AudioDecoder::Format format, int channels) {
 	output_format.frequency = frequency;
 	output_format.format = format;
 	output_format.channels = channels;
+
+	AudioSeCache::SetTargetFormat(frequency, format);
+}
+
+void GenericAudio::SetOptions(const Game_ConfigAudio& cfg) {
+	bgm_read_ahead = std::chrono::milliseconds(cfg.bgm_read_ahead.Get());
+#if defined(EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+	// Not built with thread support, decode on the audio thread
+	bgm_read_ahead = std::chrono::milliseconds(0);
+#endif
+	bgm_crossfade = cfg.bgm_crossfade.Get();
 }
 
-bool GenericAudio::PlayOnChannel(BgmChannel& chan, Filesystem_Stream::InputStream filestream, int volume, int pitch, int fadein) {
-	chan.paused = true; // Pause channel so the audio thread doesn't work on it
-	chan.stopped = false; // Unstop channel so the audio thread doesn't delete it
+unsigned GenericAudio::GetBgmUnderruns() const {
+	return bgm_underruns.load(std::memory_order_relaxed);
+}
 
-	if (!filestream) {
-		Output::Warning("BGM file not readable: {}", filestream.GetName());
+bool GenericAudio::PlayMidiOut(Filesystem_Stream::InputStream& filestream, int volume, int pitch, int fadein) {
+	// FIXME: Try Fluidsynth and WildMidi first
+	// If they work fallback to the normal AudioDecoder handler below
+	// There should be a way to configure the order
+	if (MidiDecoder::CreateFluidsynth(filestream, true) || MidiDecoder::CreateWildMidi(filestream, true)) {
 		return false;
 	}
 
-	// Midiout is only supported on channel 0 because this is an exclusive resource
-	if (chan.id == 0 && GenericAudioMidiOut::IsSupported(filestream)) {
-		chan.decoder.reset();
-
-		// FIXME: Try Fluidsynth and WildMidi first
-		// If they work fallback to the normal AudioDecoder handler below
-		// There should be a way to configure the order
-		if (!MidiDecoder::CreateFluidsynth(filestream, true) && !MidiDecoder::CreateWildMidi(filestream, true)) {
-			if (!midi_thread) {
-				midi_thread = std::make_unique<GenericAudioMidiOut>();
-				if (midi_thread->IsInitialized()) {
-					midi_thread->StartThread();
-				} else {
-					midi_thread.reset();
-				}
-			}
-
-			if (midi_thread) {
-				midi_thread->LockMutex();
-				auto &midi_out = midi_thread->GetMidiOut();
-				if (midi_out.Open(std::move(filestream))) {
-					midi_out.SetPitch(pitch);
-					midi_out.SetVolume(0);
-					midi_out.SetFade(volume, std::chrono::milliseconds(fadein));
-					midi_out.SetLooping(true);
-					midi_out.Resume();
-					chan.paused = false;
-					chan.midi_out_used = true;
-					midi_thread->UnlockMutex();
-					return true;
-				}
-				midi_thread->UnlockMutex();
-			}
+	if (!midi_thread) {
+		midi_thread = std::make_unique<GenericAudioMidiOut>();
+		if (midi_thread->IsInitialized()) {
+			midi_thread->StartThread();
+		} else {
+			midi_thread.reset();
 		}
 	}
 
+	if (!midi_thread) {
+		return false;
+	}
+
+	midi_thread->LockMutex();
+	auto &midi_out = midi_thread->GetMidiOut();
+	if (midi_out.Open(std::move(filestream))) {
+		midi_out.SetPitch(pitch);
+		midi_out.SetVolume(0);
+		midi_out.SetFade(volume, std::chrono::milliseconds(fadein));
+		midi_out.SetLooping(true);
+		midi_out.Resume();
+		midi_out_used = true;
+		midi_thread->UnlockMutex();
+		return true;
+	}
+	midi_thread->UnlockMutex();
+	return false;
+}
+
+void GenericAudio::StopMidiOut() {
 	if (midi_thread) {
 		midi_thread->GetMidiOut().Reset();
+		if (midi_out_used) {
+			midi_thread->GetMidiOut().Pause();
+		}
 	}
+	midi_out_used = false;
+}
 
-	chan.decoder = AudioDecoder::Create(filestream);
-	chan.midi_out_used = false;
-	if (chan.decoder && chan.decoder->Open(std::move(filestream))) {
-		chan.decoder->SetPitch(pitch);
-		chan.decoder->SetFormat(output_format.frequency, output_format.format, output_format.channels);
-		chan.decoder->SetVolume(0);
-		chan.decoder->SetFade(volume, std::chrono::milliseconds(fadein));
-		chan.decoder->SetLooping(true);
-		chan.paused = false; // Unpause channel -> Play it.
+void GenericAudio::Post(Command command) {
+	FreeRetired();
 
-		return true;
-	} else {
-		Output::Warning("Couldn't play BGM {}. Format not supported", filestream.GetName());
+	if (!commands.Push(std::move(command))) {
+		// Decode is not draining the queue, apply the commands here instead
+		LockMutex();
+		ProcessCommands();
+		UnlockMutex();
+		commands.Push(std::move(command));
 	}
+}
 
-	return false;
+void GenericAudio::FreeRetired() {
+	std::unique_ptr<AudioDecoderBase> decoder;
+	while (retired.Pop(decoder)) {
+		decoder.reset();
+	}
 }
 
-bool GenericAudio::PlayOnChannel(SeChannel& chan, Filesystem_Stream::InputStream filestream, int volume, int pitch) {
-	chan.paused = true; // Pause channel so the audio thread doesn't work on it
-	chan.stopped = false; // Unstop channel so the audio thread doesn't delete it
-
-	std::unique_ptr<AudioSeCache> cache = AudioSeCache::Create(std::move(filestream));
-	if (cache) {
-		chan.decoder = cache->CreateSeDecoder();
-		chan.decoder->SetPitch(pitch);
-		chan.decoder->SetFormat(output_format.frequency, output_format.format, output_format.channels);
-		chan.decoder->SetVolume(volume);
-		chan.paused = false; // Unpause channel -> Play it.
-		return true;
-	} else {
-		Output::Warning("Couldn't play SE {}. Format not supported", filestream.GetName());
+void GenericAudio::Retire(std::unique_ptr<AudioDecoderBase>& decoder) {
+	// Destroying a decoder can free large buffers or join the thread of a
+	// BGM stream, keep that out of the audio thread
+	if (decoder) {
+		bool queued = retired.Push(std::move(decoder));
+		assert(queued);
+		(void)queued;
 	}
+}
 
-	return false;
+void GenericAudio::Retire(BgmChannel& channel) {
+	Retire(channel.decoder);
+	channel.stream = nullptr;
+	channel.underruns = 0;
+	channel.fade_out = 1.0f;
+	channel.fade_out_step = 0.0f;
+}
+
+void GenericAudio::ProcessCommands() {
+	Command command;
+	while (commands.Pop(command)) {
+		switch (command.type) {
+			case Command::Type::BgmPlay: {
+				// With a crossfade the playing BGM keeps its channel and fades out
+				BgmChannel* previous = nullptr;
+				if (command.value > 0) {
+					for (auto& BGM_Channel : BGM_Channels) {
+						if (BGM_Channel.decoder && !BGM_Channel.paused && BGM_Channel.fade_out_step == 0.0f) {
+							previous = &BGM_Channel;
+						}
+					}
+				}
+				for (auto& BGM_Channel : BGM_Channels) {
+					if (&BGM_Channel != previous) {
+						Retire(BGM_Channel);
+					}
+				}
+				if (previous) {
+					previous->fade_out_step = 1000.0f / (static_cast<float>(output_format.frequency) * command.value);
+				}
+
+				BgmChannel& channel = BGM_Channels[previous == &BGM_Channels[0] ? 1 : 0];
+				channel.decoder = std::move(command.decoder);
+				channel.stream = dynamic_cast<AudioBgmStream*>(channel.decoder.get());
+				channel.paused = false;
+				channel.serial = command.serial;
+				break;
+			}
+			case Command::Type::BgmStop:
+				for (auto& BGM_Channel : BGM_Channels) {
+					Retire(BGM_Channel);
+				}
+				break;
+			case Command::Type::BgmPause:
+			case Command::Type::BgmResume:
+				for (auto& BGM_Channel : BGM_Channels) {
+					BGM_Channel.paused = command.type == Command::Type::BgmPause;
+				}
+				break;
+			case Command::Type::BgmFade:
+				for (auto& BGM_Channel : BGM_Channels) {
+					// A BGM that is crossfading out is left alone
+					if (BGM_Channel.decoder && BGM_Channel.fade_out_step == 0.0f) {
+						BGM_Channel.decoder->SetFade(0, std::chrono::milliseconds(command.value));
+					}
+				}
+				break;
+			case Command::Type::BgmVolume:
+				for (auto& BGM_Channel : BGM_Channels) {
+					// A BGM that is crossfading out is left alone
+					if (BGM_Channel.decoder && BGM_Channel.fade_out_step == 0.0f) {
+						BGM_Channel.decoder->SetVolume(command.value);
+					}
+				}
+				break;
+			case Command::Type::BgmPitch:
+				for (auto& BGM_Channel : BGM_Channels) {
+					// A BGM that is crossfading out is left alone
+					if (BGM_Channel.decoder && BGM_Channel.fade_out_step == 0.0f) {
+						BGM_Channel.decoder->SetPitch(command.value);
+					}
+				}
+				break;
+			case Command::Type::SePlay: {
+				auto free_channel = std::find_if(std::begin(SE_Channels), std::end(SE_Channels),
+					[](const SeChannel& chan) { return !chan.decoder; });
+				if (free_channel != std::end(SE_Channels)) {
+					free_channel->decoder = std::move(command.decoder);
+				} else {
+					se_dropped.fetch_add(1, std::memory_order_relaxed);
+					Retire(command.decoder);
+				}
+				break;
+			}
+			case Command::Type::SeStop:
+				for (auto& SE_Channel : SE_Channels) {
+					Retire(SE_Channel.decoder);
+				}
+				break;
+		}
+	}
 }
 
 void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
@@ -282,14 +415,18 @@ void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
 	if (sample_buffer.size() != (size_t)buffer_length) {
 		sample_buffer.resize(buffer_length);
 	}
-	if (mixer_buffer.size() != (size_t)buffer_length) {
-		mixer_buffer.resize(buffer_length);
+	if (mixer_buffer.size() != (size_t)(samples_per_frame * 2)) {
+		mixer_buffer.resize(samples_per_frame * 2);
 	}
 	scrap_buffer_size = samples_per_frame * output_format.channels * sizeof(uint32_t);
 	if (scrap_buffer.size() != scrap_buffer_size) {
 		scrap_buffer.resize(scrap_buffer_size);
+		// one float per byte covers the smallest sample size
+		channel_buffer.resize(scrap_buffer_size);
 	}
-	memset(mixer_buffer.data(), '\0', mixer_buffer.size());
+	std::fill(mixer_buffer.begin(), mixer_buffer.end(), 0.0f);
+
+	ProcessCommands();
 
 	for (unsigned i = 0; i < nr_of_bgm_channels + nr_of_se_channels; i++) {
 		int read_bytes = 0;
@@ -308,69 +445,78 @@ void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
 			float current_master_volume = 1.0;
 
 			if (currently_mixed_channel.decoder && !currently_mixed_channel.paused) {
-				if (currently_mixed_channel.stopped) {
-					currently_mixed_channel.decoder.reset();
-				} else {
-					currently_mixed_channel.decoder->Update(std::chrono::microseconds(1000 * 1000 / 60));
-					volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0);
-					currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
-					samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
+				currently_mixed_channel.decoder->Update(std::chrono::microseconds(1000 * 1000 / 60));
+				volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0) * currently_mixed_channel.fade_out;
+				currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
+				samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
 
-					total_volume += volume;
+				total_volume += volume;
 
-					// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
-					unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
-					bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
+				// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
+				unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
+				bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
 
-					read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
+				read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
 
-					if (read_bytes < 0) {
-						// An error occured when reading - the channel is faulty - discard
-						currently_mixed_channel.decoder.reset();
-						continue; // skip this loop run - there is nothing to mix
-					}
+				if (currently_mixed_channel.stream) {
+					unsigned underruns = currently_mixed_channel.stream->GetUnderruns();
+					bgm_underruns.fetch_add(underruns - currently_mixed_channel.underruns, std::memory_order_relaxed);
+					currently_mixed_channel.underruns = underruns;
+				}
 
-					if (!currently_mixed_channel.stopped) {
-						BGM_PlayedOnceIndicator = currently_mixed_channel.decoder->GetLoopCount() > 0;
-					}
+				if (read_bytes < 0) {
+					// An error occured when reading - the channel is faulty - discard
+					Retire(currently_mixed_channel);
+					continue; // skip this loop run - there is nothing to mix
+				}
 
-					channel_used = true;
+				if (currently_mixed_channel.fade_out_step > 0.0f) {
+					// Replaced BGM, stopped once the crossfade is over
+					currently_mixed_channel.fade_out -= currently_mixed_channel.fade_out_step * samples_per_frame;
+					if (currently_mixed_channel.fade_out <= 0.0f) {
+						Retire(currently_mixed_channel);
+					}
+				} else {
+					// Published for BGM_PlayedOnce and BGM_GetTicks of the game thread
+					if (currently_mixed_channel.decoder->GetLoopCount() > 0) {
+						bgm_played_serial.store(currently_mixed_channel.serial, std::memory_order_relaxed);
+					}
+					bgm_ticks.store(std::max(currently_mixed_channel.decoder->GetTicks(), 0), std::memory_order_relaxed);
+					bgm_ticks_serial.store(currently_mixed_channel.serial, std::memory_order_release);
 				}
+
+				channel_used = true;
 			}
 		} else {
 			SeChannel& currently_mixed_channel = SE_Channels[i - nr_of_bgm_channels];
 			float current_master_volume = 1.0;
 
-			if (currently_mixed_channel.decoder && !currently_mixed_channel.paused) {
-				if (currently_mixed_channel.stopped) {
-					currently_mixed_channel.decoder.reset();
-				} else {
-					volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0);
-					currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
-					samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
+			if (currently_mixed_channel.decoder) {
+				volume = current_master_volume * (currently_mixed_channel.decoder->GetVolume() / 100.0);
+				currently_mixed_channel.decoder->GetFormat(frequency, sampleformat, channels);
+				samplesize = AudioDecoder::GetSamplesizeForFormat(sampleformat);
 
-					total_volume += volume;
+				total_volume += volume;
 
-					// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
-					unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
-					bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
+				// determine how much data has to be read from this channel (but cap at the bounds of the scrap buffer)
+				unsigned bytes_to_read = (samplesize * channels * samples_per_frame);
+				bytes_to_read = (bytes_to_read < scrap_buffer_size) ? bytes_to_read : scrap_buffer_size;
 
-					read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
-
-					if (read_bytes < 0) {
-						// An error occured when reading - the channel is faulty - discard
-						currently_mixed_channel.decoder.reset();
-						continue; // skip this loop run - there is nothing to mix
-					}
+				read_bytes = currently_mixed_channel.decoder->Decode(scrap_buffer.data(), bytes_to_read);
 
-					// Now decide what to do when a channel has reached its end
-					if (currently_mixed_channel.decoder->IsFinished()) {
-						// SE are only played once so free the se if finished
-						currently_mixed_channel.decoder.reset();
-					}
+				if (read_bytes < 0) {
+					// An error occured when reading - the channel is faulty - discard
+					Retire(currently_mixed_channel.decoder);
+					continue; // skip this loop run - there is nothing to mix
+				}
 
-					channel_used = true;
+				// Now decide what to do when a channel has reached its end
+				if (currently_mixed_channel.decoder->IsFinished()) {
+					// SE are only played once so free the se if finished
+					Retire(currently_mixed_channel.decoder);
 				}
+
+				channel_used = true;
 			}
 		}
 
@@ -379,147 +525,18 @@ void GenericAudio::Decode(uint8_t* output_buffer, int buffer_length) {
 		//--------------------------------------------------------------------------------------------------------------------//
 
 		if (channel_used) {
-			for (unsigned ii = 0; ii < (unsigned)(read_bytes / (samplesize * channels)); ii++) {
-
-				float vall = volume;
-				float valr = vall;
-
-				// Convert to floating point
-				switch (sampleformat) {
-					case AudioDecoder::Format::S8:
-						vall *= (((int8_t *) scrap_buffer.data())[ii * channels] / 128.0);
-						valr *= (((int8_t *) scrap_buffer.data())[ii * channels + 1] / 128.0);
-						break;
-					case AudioDecoder::Format::U8:
-						vall *= (((uint8_t *) scrap_buffer.data())[ii * channels] / 128.0 - 1.0);
-						valr *= (((uint8_t *) scrap_buffer.data())[ii * channels + 1] / 128.0 - 1.0);
-						break;
-					case AudioDecoder::Format::S16:
-						vall *= (((int16_t *) scrap_buffer.data())[ii * channels] / 32768.0);
-						valr *= (((int16_t *) scrap_buffer.data())[ii * channels + 1] / 32768.0);
-						break;
-					case AudioDecoder::Format::U16:
-						vall *= (((uint16_t *) scrap_buffer.data())[ii * channels] / 32768.0 - 1.0);
-						valr *= (((uint16_t *) scrap_buffer.data())[ii * channels + 1] / 32768.0 - 1.0);
-						break;
-					case AudioDecoder::Format::S32:
-						vall *= (((int32_t *) scrap_buffer.data())[ii * channels] / 2147483648.0);
-						valr *= (((int32_t *) scrap_buffer.data())[ii * channels + 1] / 2147483648.0);
-						break;
-					case AudioDecoder::Format::U32:
-						vall *= (((uint32_t *) scrap_buffer.data())[ii * channels] / 2147483648.0 - 1.0);
-						valr *= (((uint32_t *) scrap_buffer.data())[ii * channels + 1] / 2147483648.0 - 1.0);
-						break;
-					case AudioDecoder::Format::F32:
-						vall *= (((float *) scrap_buffer.data())[ii * channels]);
-						valr *= (((float *) scrap_buffer.data())[ii * channels + 1]);
-						break;
-				}
-
-				if (!channel_active) {
-					// first channel
-					mixer_buffer[ii * output_format.channels] = vall;
-					if (channels > 1) {
-						mixer_buffer[ii * output_format.channels + 1] = valr;
-					} else {
-						mixer_buffer[ii * output_format.channels + 1] = mixer_buffer[ii * output_format.channels];
-					}
-				} else {
-					mixer_buffer[ii * output_format.channels] += vall;
-					if (channels > 1) {
-						mixer_buffer[ii * output_format.channels + 1] += valr;
-					} else {
-						mixer_buffer[ii * output_format.channels + 1] = mixer_buffer[ii * output_format.channels];
-					}
-				}
-
-			}
+			int frames = read_bytes / (samplesize * channels);
+			AudioMixer::ToFloat(scrap_buffer.data(), sampleformat, frames * channels, channel_buffer.data());
+			AudioMixer::Accumulate(mixer_buffer.data(), channel_buffer.data(), frames, channels, volume);
 			channel_active = true;
 		}
 	}
 
 	if (channel_active) {
-		if (total_volume > 1.0) {
-			float threshold = 0.8;
-			for (unsigned i = 0; i < (unsigned)(samples_per_frame * 2); i++) {
-				float sample = mixer_buffer[i];
-				float sign = (sample < 0) ? -1.0 : 1.0;
-				sample /= sign;
-				//dynamic range compression
-				if (sample > threshold) {
-					sample_buffer[i] = sign * 32768.0 * (threshold + (1.0 - threshold) * (sample - threshold) / (total_volume - threshold));
-				} else {
-					sample_buffer[i] = sign * sample * 32768.0;
-				}
-			}
-		} else {
-			//No dynamic range compression necessary
-			for (unsigned i = 0; i < (unsigned)(samples_per_frame * 2); i++) {
-				sample_buffer[i] = mixer_buffer[i] * 32768.0;
-			}
-		}
-
+		// Compresses the peaks when the channels exceed full volume
+		AudioMixer::ToS16(mixer_buffer.data(), samples_per_frame * 2, total_volume, sample_buffer.data());
 		memcpy(output_buffer, sample_buffer.data(), buffer_length);
 	} else {
 		memset(output_buffer, '\0', buffer_length);
 	}
 }
-
-void GenericAudio::BgmChannel::Stop() {
-	stopped = true;
-	if (midi_out_used) {
-		midi_out_used = false;
-		midi_thread->GetMidiOut().Reset();
-		midi_thread->GetMidiOut().Pause();
-	} else if (decoder) {
-		decoder.reset();
-	}
-}
-
-void GenericAudio::BgmChannel::SetPaused(bool newPaused) {
-	paused = newPaused;
-	if (midi_out_used) {
-		if (newPaused) {
-			midi_thread->GetMidiOut().Pause();
-		} else {
-			midi_thread->GetMidiOut().Resume();
-		}
-	}
-}
-
-int GenericAudio::BgmChannel::GetTicks() const {
-	if (midi_out_used) {
-		return midi_thread->GetMidiOut().GetTicks();
-	} else if (decoder) {
-		return decoder->GetTicks();
-	}
-	return -1;
-}
-
-void GenericAudio::BgmChannel::SetFade(int fade) {
-	if (midi_out_used) {
-		midi_thread->GetMidiOut().SetFade(0, std::chrono::milliseconds(fade));
-	} else if (decoder) {
-		decoder->SetFade(0, std::chrono::milliseconds(fade));
-	}
-}
-
-void GenericAudio::BgmChannel::SetVolume(int volume) {
-	if (midi_out_used) {
-		midi_thread->GetMidiOut().SetVolume(volume);
-	} else if (decoder) {
-		decoder->SetVolume(volume);
-	}
-}
-
-void GenericAudio::BgmChannel::SetPitch(int pitch) {
-	if (midi_out_used) {
-		midi_thread->GetMidiOut().SetPitch(pitch);
-	} else if (decoder) {
-		decoder->SetPitch(pitch);
-	}
-}
-
-bool GenericAudio::BgmChannel::IsUsed() const {
-	return decoder || midi_out_used;
-}
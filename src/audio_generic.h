@@ -21,9 +21,14 @@
 #include "audio.h"
 #include "audio_secache.h"
 #include "audio_decoder_base.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
 #include <memory>
 
+class AudioBgmStream;
 class GenericAudioMidiOut;
+struct Game_ConfigAudio;
 
 /**
  * A software implementation for handling EasyRPG Audio utilizing the
@@ -38,11 +43,19 @@ class GenericAudioMidiOut;
  * 4. Implement LockMutex and UnlockMutex. Locking and Unlocking when
  *    calling Decode must be done manually.
  * 5. Implement update function (optional)
+ *
+ * The BGM and SE functions never wait for the audio thread: They prepare
+ * the decoder and post a command that Decode applies before mixing.
+ * The mutex is only taken when the command queue is full, which happens
+ * when Decode is not called (e.g. the audio device is paused).
+ *
+ * With read-ahead enabled every BGM is decoded on its own thread (see
+ * AudioBgmStream), Decode then only copies the decoded data.
  */
 class GenericAudio : public AudioInterface {
 public:
 	GenericAudio();
-	virtual ~GenericAudio() = default;
+	virtual ~GenericAudio();
 
 	void BGM_Play(Filesystem_Stream::InputStream stream, int volume, int pitch, int fadein) override;
 	void BGM_Pause() override;
@@ -55,36 +68,70 @@ public:
 	void BGM_Volume(int volume) override;
 	void BGM_Pitch(int pitch) override;
 	void SE_Play(Filesystem_Stream::InputStream stream, int volume, int pitch) override;
+	void SE_Preload(Filesystem_Stream::InputStream stream) override;
 	void SE_Stop() override;
 	virtual void Update() override;
 
 	void SetFormat(int frequency, AudioDecoder::Format format, int channels);
 
+	/**
+	 * Applies the BGM read-ahead and crossfade options.
+	 * Takes effect with the next BGM_Play.
+	 *
+	 * @param cfg audio options
+	 */
+	static void SetOptions(const Game_ConfigAudio& cfg);
+
+	/** @return how often a BGM ran out of decoded data since startup */
+	unsigned GetBgmUnderruns() const;
+
 	virtual void LockMutex() const = 0;
 	virtual void UnlockMutex() const = 0;
 
 	void Decode(uint8_t* output_buffer, int buffer_length);
 
 private:
+	/** Owned by the audio thread, the game thread only talks to it through commands */
 	struct BgmChannel {
 		int id;
 		std::unique_ptr<AudioDecoderBase> decoder;
-		bool paused;
-		bool stopped;
-		bool midi_out_used = false;
-		void Stop();
-		void SetPaused(bool newPaused);
-		int GetTicks() const;
-		void SetFade(int fade);
-		void SetVolume(int volume);
-		void SetPitch(int pitch);
-		bool IsUsed() const;
+		bool paused = false;
+		/** BGM_Play call that started the decoder */
+		unsigned serial = 0;
+		/** decoder when it is an AudioBgmStream */
+		AudioBgmStream* stream = nullptr;
+		/** underruns of the stream already added to bgm_underruns */
+		unsigned underruns = 0;
+		/** gain of a BGM replaced during a crossfade */
+		float fade_out = 1.0f;
+		/** gain decrease per frame, not 0 while crossfading */
+		float fade_out_step = 0.0f;
 	};
 	struct SeChannel {
 		int id;
 		std::unique_ptr<AudioDecoderBase> decoder;
-		bool paused;
-		bool stopped;
+	};
+	struct Command {
+		enum class Type {
+			BgmPlay,
+			BgmStop,
+			BgmPause,
+			BgmResume,
+			BgmFade,
+			BgmVolume,
+			BgmPitch,
+			SePlay,
+			SeStop
+		};
+		Command(Type type = Type::BgmStop, int value = 0) : type(type), value(value) {}
+
+		Type type;
+		/** fade time, volume or pitch, for BgmPlay the crossfade time */
+		int value;
+		/** BGM_Play call of a BgmPlay command */
+		unsigned serial = 0;
+		/** decoder of a BgmPlay or SePlay command, ready to play */
+		std::unique_ptr<AudioDecoderBase> decoder;
 	};
 	struct Format {
 		int frequency;
@@ -93,21 +140,58 @@ private:
 	};
 	Format output_format = {};
 
-	bool PlayOnChannel(BgmChannel& chan, Filesystem_Stream::InputStream stream, int volume, int pitch, int fadein);
-	bool PlayOnChannel(SeChannel& chan, Filesystem_Stream::InputStream stream, int volume, int pitch);
+	bool PlayMidiOut(Filesystem_Stream::InputStream& stream, int volume, int pitch, int fadein);
+	void StopMidiOut();
+
+	/** Game thread: queues a command for the audio thread */
+	void Post(Command command);
+	/** Game thread: frees the decoders the audio thread is done with */
+	void FreeRetired();
+	/** Audio thread: applies the queued commands */
+	void ProcessCommands();
+	/** Audio thread: hands a decoder to the game thread for destruction */
+	void Retire(std::unique_ptr<AudioDecoderBase>& decoder);
+	/** Audio thread: stops the BGM of a channel */
+	void Retire(BgmChannel& channel);
 
 	static constexpr unsigned nr_of_se_channels = 31;
 	static constexpr unsigned nr_of_bgm_channels = 2;
+	static constexpr unsigned nr_of_commands = 256;
 
 	static BgmChannel BGM_Channels[nr_of_bgm_channels];
 	static SeChannel SE_Channels[nr_of_se_channels];
-	static bool BGM_PlayedOnceIndicator;
 	static bool Muted;
 
+	static std::chrono::milliseconds bgm_read_ahead;
+	static bool bgm_crossfade;
+
+	SpscQueue<Command> commands;
+	/**
+	 * Post drains it before every command, so it holds at most the decoders
+	 * of all channels and queued commands and never overflows
+	 */
+	SpscQueue<std::unique_ptr<AudioDecoderBase>> retired;
+
+	// Game thread state
+	unsigned bgm_serial = 0;
+	bool bgm_playing = false;
+	bool midi_out_used = false;
+	unsigned se_dropped_reported = 0;
+	unsigned bgm_underruns_reported = 0;
+
+	// Published by the audio thread
+	std::atomic<unsigned> bgm_played_serial = { 0 };
+	std::atomic<int> bgm_ticks = { 0 };
+	std::atomic<unsigned> bgm_ticks_serial = { 0 };
+	std::atomic<unsigned> se_dropped = { 0 };
+	std::atomic<unsigned> bgm_underruns = { 0 };
+
 	static std::vector<int16_t> sample_buffer;
 	static std::vector<uint8_t> scrap_buffer;
 	static unsigned scrap_buffer_size;
 	static std::vector<float> mixer_buffer;
+	/** Samples of the channel being mixed, converted to float */
+	static std::vector<float> channel_buffer;
 
 	static std::unique_ptr<GenericAudioMidiOut> midi_thread;
 };
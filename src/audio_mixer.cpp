@@ -0,0 +1,442 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Headers
+#include "audio_mixer.h"
+#include "compiler.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef EP_SIMD_X86
+#  include <immintrin.h>
+#endif
+#ifdef EP_SIMD_NEON
+#  include <arm_neon.h>
+#endif
+
+using namespace AudioMixer;
+
+namespace {
+	/** Level above which peaks are compressed when the channels exceed full volume */
+	constexpr float compress_threshold = 0.8f;
+
+	/** Parameters of ToS16 shared by all kernels */
+	struct S16Setup {
+		/** level above which the knee applies, infinity disables compression */
+		float threshold;
+		/** slope above the threshold */
+		float knee;
+	};
+
+	S16Setup MakeS16Setup(float total_volume) {
+		if (total_volume > 1.0f) {
+			return { compress_threshold, (1.0f - compress_threshold) / (total_volume - compress_threshold) };
+		}
+		return { std::numeric_limits<float>::infinity(), 1.0f };
+	}
+
+	template <typename T>
+	void ConvertScalar(const T* src, int count, float* dst, float scale, float offset) {
+		for (int i = 0; i < count; ++i) {
+			dst[i] = static_cast<float>(src[i]) * scale + offset;
+		}
+	}
+
+	void S16ToFloatScalar(const int16_t* src, int count, float* dst) {
+		for (int i = 0; i < count; ++i) {
+			dst[i] = static_cast<float>(src[i]) * (1.0f / 32768.0f);
+		}
+	}
+
+	void AccumulateStereoScalar(float* dst, const float* src, int frames, float volume) {
+		for (int i = 0; i < frames * 2; ++i) {
+			dst[i] += src[i] * volume;
+		}
+	}
+
+	void AccumulateMonoScalar(float* dst, const float* src, int frames, float volume) {
+		for (int i = 0; i < frames; ++i) {
+			float v = src[i] * volume;
+			dst[i * 2] += v;
+			dst[i * 2 + 1] += v;
+		}
+	}
+
+	void ToS16Scalar(const float* src, int count, const S16Setup& s, int16_t* dst) {
+		for (int i = 0; i < count; ++i) {
+			float a = std::fabs(src[i]);
+			if (a > s.threshold) {
+				a = s.threshold + s.knee * (a - s.threshold);
+			}
+			float v = std::copysign(a * 32768.0f, src[i]);
+			// written like the vector min/max so that NaN ends up the same
+			v = v > -32768.0f ? v : -32768.0f;
+			v = v < 32767.0f ? v : 32767.0f;
+			dst[i] = static_cast<int16_t>(v);
+		}
+	}
+
+#ifdef EP_SIMD_X86
+	EP_TARGET("sse4.1")
+	void S16ToFloatSse41(const int16_t* src, int count, float* dst) {
+		const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i lo = _mm_cvtepi16_epi32(v);
+			__m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(v, 8));
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+			_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+		}
+		S16ToFloatScalar(src + i, count - i, dst + i);
+	}
+
+	EP_TARGET("sse4.1")
+	void AccumulateStereoSse41(float* dst, const float* src, int frames, float volume) {
+		const __m128 vol = _mm_set1_ps(volume);
+		const int count = frames * 2;
+		int i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), vol);
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), v));
+		}
+		AccumulateStereoScalar(dst + i, src + i, (count - i) / 2, volume);
+	}
+
+	EP_TARGET("sse4.1")
+	void AccumulateMonoSse41(float* dst, const float* src, int frames, float volume) {
+		const __m128 vol = _mm_set1_ps(volume);
+		int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			__m128 v = _mm_mul_ps(_mm_loadu_ps(src + i), vol);
+			float* d = dst + i * 2;
+			_mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), _mm_unpacklo_ps(v, v)));
+			_mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_unpackhi_ps(v, v)));
+		}
+		AccumulateMonoScalar(dst + i * 2, src + i, frames - i, volume);
+	}
+
+	EP_TARGET("sse4.1") EP_ALWAYS_INLINE
+	__m128i ScaleSse41(__m128 x, __m128 threshold, __m128 knee) {
+		const __m128 sign_mask = _mm_set1_ps(-0.0f);
+		__m128 sign = _mm_and_ps(x, sign_mask);
+		__m128 a = _mm_andnot_ps(sign_mask, x);
+		__m128 c = _mm_add_ps(threshold, _mm_mul_ps(knee, _mm_sub_ps(a, threshold)));
+		a = _mm_blendv_ps(a, c, _mm_cmpgt_ps(a, threshold));
+		__m128 v = _mm_or_ps(_mm_mul_ps(a, _mm_set1_ps(32768.0f)), sign);
+		v = _mm_max_ps(v, _mm_set1_ps(-32768.0f));
+		v = _mm_min_ps(v, _mm_set1_ps(32767.0f));
+		return _mm_cvttps_epi32(v);
+	}
+
+	EP_TARGET("sse4.1")
+	void ToS16Sse41(const float* src, int count, const S16Setup& s, int16_t* dst) {
+		const __m128 threshold = _mm_set1_ps(s.threshold);
+		const __m128 knee = _mm_set1_ps(s.knee);
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m128i lo = ScaleSse41(_mm_loadu_ps(src + i), threshold, knee);
+			__m128i hi = ScaleSse41(_mm_loadu_ps(src + i + 4), threshold, knee);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+		}
+		ToS16Scalar(src + i, count - i, s, dst + i);
+	}
+
+	EP_TARGET("avx2")
+	void S16ToFloatAvx2(const int16_t* src, int count, float* dst) {
+		const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+		}
+		S16ToFloatScalar(src + i, count - i, dst + i);
+	}
+
+	EP_TARGET("avx2")
+	void AccumulateStereoAvx2(float* dst, const float* src, int frames, float volume) {
+		const __m256 vol = _mm256_set1_ps(volume);
+		const int count = frames * 2;
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + i), vol);
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), v));
+		}
+		AccumulateStereoScalar(dst + i, src + i, (count - i) / 2, volume);
+	}
+
+	EP_TARGET("avx2")
+	void AccumulateMonoAvx2(float* dst, const float* src, int frames, float volume) {
+		const __m256 vol = _mm256_set1_ps(volume);
+		int i = 0;
+		for (; i + 8 <= frames; i += 8) {
+			__m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + i), vol);
+			// unpack works within 128 bit lanes, the permutes restore the order
+			__m256 lo = _mm256_unpacklo_ps(v, v);
+			__m256 hi = _mm256_unpackhi_ps(v, v);
+			float* d = dst + i * 2;
+			_mm256_storeu_ps(d, _mm256_add_ps(_mm256_loadu_ps(d), _mm256_permute2f128_ps(lo, hi, 0x20)));
+			_mm256_storeu_ps(d + 8, _mm256_add_ps(_mm256_loadu_ps(d + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+		}
+		AccumulateMonoScalar(dst + i * 2, src + i, frames - i, volume);
+	}
+
+	EP_TARGET("avx2") EP_ALWAYS_INLINE
+	__m256i ScaleAvx2(__m256 x, __m256 threshold, __m256 knee) {
+		const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+		__m256 sign = _mm256_and_ps(x, sign_mask);
+		__m256 a = _mm256_andnot_ps(sign_mask, x);
+		__m256 c = _mm256_add_ps(threshold, _mm256_mul_ps(knee, _mm256_sub_ps(a, threshold)));
+		a = _mm256_blendv_ps(a, c, _mm256_cmp_ps(a, threshold, _CMP_GT_OQ));
+		__m256 v = _mm256_or_ps(_mm256_mul_ps(a, _mm256_set1_ps(32768.0f)), sign);
+		v = _mm256_max_ps(v, _mm256_set1_ps(-32768.0f));
+		v = _mm256_min_ps(v, _mm256_set1_ps(32767.0f));
+		return _mm256_cvttps_epi32(v);
+	}
+
+	EP_TARGET("avx2")
+	void ToS16Avx2(const float* src, int count, const S16Setup& s, int16_t* dst) {
+		const __m256 threshold = _mm256_set1_ps(s.threshold);
+		const __m256 knee = _mm256_set1_ps(s.knee);
+		int i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m256i lo = ScaleAvx2(_mm256_loadu_ps(src + i), threshold, knee);
+			__m256i hi = ScaleAvx2(_mm256_loadu_ps(src + i + 8), threshold, knee);
+			// pack works within 128 bit lanes, the permute restores the order
+			__m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+		}
+		ToS16Scalar(src + i, count - i, s, dst + i);
+	}
+#endif
+
+#ifdef EP_SIMD_NEON
+	void S16ToFloatNeon(const int16_t* src, int count, float* dst) {
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			int16x8_t v = vld1q_s16(src + i);
+			float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+			float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+			vst1q_f32(dst + i, vmulq_n_f32(lo, 1.0f / 32768.0f));
+			vst1q_f32(dst + i + 4, vmulq_n_f32(hi, 1.0f / 32768.0f));
+		}
+		S16ToFloatScalar(src + i, count - i, dst + i);
+	}
+
+	void AccumulateStereoNeon(float* dst, const float* src, int frames, float volume) {
+		const int count = frames * 2;
+		int i = 0;
+		for (; i + 4 <= count; i += 4) {
+			float32x4_t v = vmulq_n_f32(vld1q_f32(src + i), volume);
+			vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), v));
+		}
+		AccumulateStereoScalar(dst + i, src + i, (count - i) / 2, volume);
+	}
+
+	void AccumulateMonoNeon(float* dst, const float* src, int frames, float volume) {
+		int i = 0;
+		for (; i + 4 <= frames; i += 4) {
+			float32x4_t v = vmulq_n_f32(vld1q_f32(src + i), volume);
+			float32x4x2_t z = vzipq_f32(v, v);
+			float* d = dst + i * 2;
+			vst1q_f32(d, vaddq_f32(vld1q_f32(d), z.val[0]));
+			vst1q_f32(d + 4, vaddq_f32(vld1q_f32(d + 4), z.val[1]));
+		}
+		AccumulateMonoScalar(dst + i * 2, src + i, frames - i, volume);
+	}
+
+	inline int32x4_t ScaleNeon(float32x4_t x, float32x4_t threshold, float32x4_t knee) {
+		uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u));
+		float32x4_t a = vabsq_f32(x);
+		float32x4_t c = vaddq_f32(threshold, vmulq_f32(knee, vsubq_f32(a, threshold)));
+		a = vbslq_f32(vcgtq_f32(a, threshold), c, a);
+		float32x4_t v = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(vmulq_n_f32(a, 32768.0f)), sign));
+		// vmaxq/vminq propagate NaN, select like the scalar code instead
+		const float32x4_t lo = vdupq_n_f32(-32768.0f);
+		const float32x4_t hi = vdupq_n_f32(32767.0f);
+		v = vbslq_f32(vcgtq_f32(v, lo), v, lo);
+		v = vbslq_f32(vcltq_f32(v, hi), v, hi);
+		return vcvtq_s32_f32(v);
+	}
+
+	void ToS16Neon(const float* src, int count, const S16Setup& s, int16_t* dst) {
+		const float32x4_t threshold = vdupq_n_f32(s.threshold);
+		const float32x4_t knee = vdupq_n_f32(s.knee);
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			int16x4_t lo = vqmovn_s32(ScaleNeon(vld1q_f32(src + i), threshold, knee));
+			int16x4_t hi = vqmovn_s32(ScaleNeon(vld1q_f32(src + i + 4), threshold, knee));
+			vst1q_s16(dst + i, vcombine_s16(lo, hi));
+		}
+		ToS16Scalar(src + i, count - i, s, dst + i);
+	}
+#endif
+
+	using S16ToFloatFn = void (*)(const int16_t* src, int count, float* dst);
+	using AccumulateFn = void (*)(float* dst, const float* src, int frames, float volume);
+	using ToS16Fn = void (*)(const float* src, int count, const S16Setup& s, int16_t* dst);
+
+	struct Functions {
+		S16ToFloatFn s16_to_float;
+		AccumulateFn stereo;
+		AccumulateFn mono;
+		ToS16Fn to_s16;
+	};
+
+	Functions GetFunctions(Kernel k) {
+		switch (k) {
+			case Kernel::Scalar:
+				break;
+			case Kernel::Sse41:
+#ifdef EP_SIMD_X86
+				return { S16ToFloatSse41, AccumulateStereoSse41, AccumulateMonoSse41, ToS16Sse41 };
+#else
+				break;
+#endif
+			case Kernel::Avx2:
+#ifdef EP_SIMD_X86
+				return { S16ToFloatAvx2, AccumulateStereoAvx2, AccumulateMonoAvx2, ToS16Avx2 };
+#else
+				break;
+#endif
+			case Kernel::Neon:
+#ifdef EP_SIMD_NEON
+				return { S16ToFloatNeon, AccumulateStereoNeon, AccumulateMonoNeon, ToS16Neon };
+#else
+				break;
+#endif
+		}
+		return { S16ToFloatScalar, AccumulateStereoScalar, AccumulateMonoScalar, ToS16Scalar };
+	}
+
+	Kernel DefaultKernel() {
+		for (auto k: { Kernel::Avx2, Kernel::Sse41, Kernel::Neon }) {
+			if (IsSupported(k))
+				return k;
+		}
+		return Kernel::Scalar;
+	}
+
+	Kernel kernel = DefaultKernel();
+	Functions functions = GetFunctions(kernel);
+}
+
+bool AudioMixer::IsSupported(Kernel k) {
+	switch (k) {
+		case Kernel::Scalar:
+			return true;
+		case Kernel::Sse41:
+#ifdef EP_SIMD_X86
+			return CpuFeatures::HasSse41();
+#else
+			return false;
+#endif
+		case Kernel::Avx2:
+#ifdef EP_SIMD_X86
+			return CpuFeatures::HasAvx2();
+#else
+			return false;
+#endif
+		case Kernel::Neon:
+#ifdef EP_SIMD_NEON
+			return CpuFeatures::HasNeon();
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+void AudioMixer::SetKernel(Kernel k) {
+	kernel = k;
+	functions = GetFunctions(k);
+}
+
+AudioMixer::Kernel AudioMixer::GetKernel() {
+	return kernel;
+}
+
+const char* AudioMixer::GetKernelName(Kernel k) {
+	switch (k) {
+		case Kernel::Scalar:
+			return "Scalar";
+		case Kernel::Sse41:
+			return "SSE4.1";
+		case Kernel::Avx2:
+			return "AVX2";
+		case Kernel::Neon:
+			return "NEON";
+	}
+	return "";
+}
+
+void AudioMixer::ToFloat(const void* src, AudioDecoderBase::Format format, int count, float* dst) {
+	if (count <= 0)
+		return;
+
+	// The decoders are set to the output format, so only S16 and F32 are common
+	using Format = AudioDecoderBase::Format;
+	switch (format) {
+		case Format::S8:
+			ConvertScalar(static_cast<const int8_t*>(src), count, dst, 1.0f / 128.0f, 0.0f);
+			break;
+		case Format::U8:
+			ConvertScalar(static_cast<const uint8_t*>(src), count, dst, 1.0f / 128.0f, -1.0f);
+			break;
+		case Format::S16:
+			functions.s16_to_float(static_cast<const int16_t*>(src), count, dst);
+			break;
+		case Format::U16:
+			ConvertScalar(static_cast<const uint16_t*>(src), count, dst, 1.0f / 32768.0f, -1.0f);
+			break;
+		case Format::S32:
+			ConvertScalar(static_cast<const int32_t*>(src), count, dst, 1.0f / 2147483648.0f, 0.0f);
+			break;
+		case Format::U32:
+			ConvertScalar(static_cast<const uint32_t*>(src), count, dst, 1.0f / 2147483648.0f, -1.0f);
+			break;
+		case Format::F32:
+			std::copy_n(static_cast<const float*>(src), count, dst);
+			break;
+	}
+}
+
+void AudioMixer::Accumulate(float* dst, const float* src, int frames, int channels, float volume) {
+	if (frames <= 0)
+		return;
+
+	if (channels == 2) {
+		functions.stereo(dst, src, frames, volume);
+	} else if (channels == 1) {
+		functions.mono(dst, src, frames, volume);
+	} else if (channels > 2) {
+		for (int i = 0; i < frames; ++i) {
+			dst[i * 2] += src[i * channels] * volume;
+			dst[i * 2 + 1] += src[i * channels + 1] * volume;
+		}
+	}
+}
+
+void AudioMixer::ToS16(const float* src, int count, float total_volume, int16_t* dst) {
+	if (count <= 0)
+		return;
+
+	functions.to_s16(src, count, MakeS16Setup(total_volume), dst);
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EP_AUDIO_MIXER_H
+#define EP_AUDIO_MIXER_H
+
+#include <cstdint>
+#include "audio_decoder_base.h"
+
+/**
+ * Block operations used by GenericAudio to mix its channels.
+ *
+ * A channel is converted to float, scaled by its volume and added to a
+ * stereo accumulator. The accumulator is converted to S16 at the end.
+ * Every kernel produces the output of the scalar code, apart from the
+ * rounding of multiply-adds the compiler fuses. The fastest kernel supported
+ * by the CPU is selected at startup.
+ */
+namespace AudioMixer {
+	enum class Kernel {
+		Scalar,
+		/** x86 SSE4.1, 4 samples per step */
+		Sse41,
+		/** x86 AVX2, 8 samples per step */
+		Avx2,
+		/** ARM NEON, 4 samples per step */
+		Neon,
+	};
+
+	/** @return whether the kernel can run on this CPU */
+	bool IsSupported(Kernel k);
+
+	/** Selects the kernel used by the mixer, it must be supported. */
+	void SetKernel(Kernel k);
+	Kernel GetKernel();
+
+	/** @return name of the kernel for the log */
+	const char* GetKernelName(Kernel k);
+
+	/**
+	 * Converts samples to float in the range [-1, 1).
+	 *
+	 * @param src samples in the given format
+	 * @param format sample format of src
+	 * @param count number of samples (not frames)
+	 * @param dst receives count floats
+	 */
+	void ToFloat(const void* src, AudioDecoderBase::Format format, int count, float* dst);
+
+	/**
+	 * Adds a channel to a stereo accumulator.
+	 * Mono channels are added to both sides. Of channels with more than two
+	 * samples per frame only the first two are used.
+	 *
+	 * @param dst stereo accumulator of at least frames * 2 floats
+	 * @param src float samples of the channel
+	 * @param frames number of frames in src
+	 * @param channels samples per frame in src
+	 * @param volume linear gain
+	 */
+	void Accumulate(float* dst, const float* src, int frames, int channels, float volume);
+
+	/**
+	 * Converts the accumulator to S16, clamping to the range of S16.
+	 * When the channels add up to more than full volume the peaks above 0.8
+	 * are compressed so that total_volume maps to full scale.
+	 *
+	 * @param src accumulated samples
+	 * @param count number of samples (not frames)
+	 * @param total_volume sum of the volumes of all mixed channels
+	 * @param dst receives count samples
+	 */
+	void ToS16(const float* src, int count, float total_volume, int16_t* dst);
+}
+
+#endif
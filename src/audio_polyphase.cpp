@@ -0,0 +1,370 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headers
+#define _USE_MATH_DEFINES
+#include "audio_polyphase.h"
+#include "audio_mixer.h"
+#include "compiler.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#ifdef EP_SIMD_X86
+#  include <immintrin.h>
+#endif
+#ifdef EP_SIMD_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace {
+	/** Phases of the table for ratios that do not reduce to fewer */
+	constexpr int max_phases = 1024;
+
+	/** Input frames buffered besides the filter history */
+	constexpr int chunk_frames = 512;
+
+	struct Filter {
+		int taps;
+		/** cutoff relative to the Nyquist frequency */
+		float passband;
+		/** Kaiser window shape */
+		float beta;
+	};
+
+	// The passband ends where the transition band of the window reaches the
+	// Nyquist frequency. The taps are a multiple of 8 for the vector kernels.
+	Filter GetFilter(AudioPolyphase::Quality quality) {
+		switch (quality) {
+			case AudioPolyphase::Quality::High:
+				return { 64, 0.905f, 9.5f };
+			case AudioPolyphase::Quality::Medium:
+				return { 32, 0.854f, 7.3f };
+			case AudioPolyphase::Quality::Low:
+				break;
+		}
+		return { 16, 0.817f, 4.5f };
+	}
+
+	/** Modified Bessel function of the first kind, order 0 */
+	double BesselI0(double x) {
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 64 && term > sum * 1e-12; ++k) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	float DotScalar(const float* a, const float* b, int count) {
+		float sum = 0.0f;
+		for (int i = 0; i < count; ++i) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+
+#ifdef EP_SIMD_X86
+	EP_TARGET("sse4.1")
+	float DotSse41(const float* a, const float* b, int count) {
+		__m128 s0 = _mm_setzero_ps();
+		__m128 s1 = _mm_setzero_ps();
+		for (int i = 0; i < count; i += 8) {
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		__m128 s = _mm_add_ps(s0, s1);
+		s = _mm_hadd_ps(s, s);
+		s = _mm_hadd_ps(s, s);
+		return _mm_cvtss_f32(s);
+	}
+
+	EP_TARGET("avx2")
+	float DotAvx2(const float* a, const float* b, int count) {
+		__m256 s = _mm256_setzero_ps();
+		for (int i = 0; i < count; i += 8) {
+			s = _mm256_add_ps(s, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		}
+		__m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+		h = _mm_hadd_ps(h, h);
+		h = _mm_hadd_ps(h, h);
+		return _mm_cvtss_f32(h);
+	}
+#endif
+
+#ifdef EP_SIMD_NEON
+	float DotNeon(const float* a, const float* b, int count) {
+		float32x4_t s0 = vdupq_n_f32(0.0f);
+		float32x4_t s1 = vdupq_n_f32(0.0f);
+		for (int i = 0; i < count; i += 8) {
+			s0 = vmlaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+			s1 = vmlaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+		}
+		float32x4_t s = vaddq_f32(s0, s1);
+		float32x2_t r = vadd_f32(vget_low_f32(s), vget_high_f32(s));
+		r = vpadd_f32(r, r);
+		return vget_lane_f32(r, 0);
+	}
+#endif
+
+	using DotFn = float (*)(const float* a, const float* b, int count);
+
+	DotFn GetDot(AudioMixer::Kernel k) {
+		switch (k) {
+			case AudioMixer::Kernel::Scalar:
+				break;
+			case AudioMixer::Kernel::Sse41:
+#ifdef EP_SIMD_X86
+				return DotSse41;
+#else
+				break;
+#endif
+			case AudioMixer::Kernel::Avx2:
+#ifdef EP_SIMD_X86
+				return DotAvx2;
+#else
+				break;
+#endif
+			case AudioMixer::Kernel::Neon:
+#ifdef EP_SIMD_NEON
+				return DotNeon;
+#else
+				break;
+#endif
+		}
+		return DotScalar;
+	}
+
+	using TableKey = std::tuple<int, int, float, float>;
+
+	// Resamplers are created by the game thread and change their rate on the audio threads
+	std::mutex tables_mutex;
+	std::map<TableKey, std::weak_ptr<const std::vector<float>>> tables;
+}
+
+AudioPolyphase::AudioPolyphase(int channels, Quality quality) : channels(channels) {
+	Filter filter = GetFilter(quality);
+	taps = filter.taps;
+	passband = filter.passband;
+	beta = filter.beta;
+	dot = GetDot(AudioMixer::GetKernel());
+
+	capacity = taps + chunk_frames;
+	planes.resize(channels * capacity);
+
+	fallback = GetTable(taps, max_phases, passband, beta);
+	table = fallback.get();
+	phases = max_phases;
+	Reset();
+}
+
+void AudioPolyphase::Prepare(int input_rate, int output_rate) {
+	int64_t num, den;
+	Reduce(input_rate, output_rate, num, den);
+	if (num == prepared_num && den == prepared_den) {
+		return;
+	}
+
+	int prepared_phases = static_cast<int>(std::min<int64_t>(den, max_phases));
+	// Lower the cutoff below the output Nyquist frequency when downsampling
+	float cutoff = passband * std::min(1.0f, static_cast<float>(den) / num);
+	prepared = GetTable(taps, prepared_phases, cutoff, beta);
+	prepared_num = num;
+	prepared_den = den;
+
+	// The previous table may be the current one
+	SelectTable();
+}
+
+void AudioPolyphase::SetRate(int input_rate, int output_rate) {
+	int64_t num, den;
+	Reduce(input_rate, output_rate, num, den);
+	if (num == step_int * step_den + step_frac && den == step_den) {
+		return;
+	}
+
+	// Keep the position between the input frames
+	frac = frac * den / step_den;
+	step_int = static_cast<int>(num / den);
+	step_frac = num % den;
+	step_den = den;
+
+	SelectTable();
+}
+
+void AudioPolyphase::Reset() {
+	std::fill(planes.begin(), planes.end(), 0.0f);
+	// Zeros before the first frame, so that the first output is at the first frame
+	filled = taps / 2 - 1;
+	position = 0;
+	frac = 0;
+	flush_frames = 0;
+	flushed = false;
+}
+
+void AudioPolyphase::Flush() {
+	if (flushed) {
+		return;
+	}
+	// The last input frame is the center of the filter of the last output
+	flush_frames = taps / 2;
+	flushed = true;
+}
+
+void AudioPolyphase::Process(const float* src, int& src_frames, float* dst, int& dst_frames) {
+	int consumed = 0;
+	int produced = 0;
+	const float* coefficients = table->data();
+
+	while (produced < dst_frames) {
+		if (position + taps > filled) {
+			Compact();
+			int count = std::min(capacity - filled, src_frames - consumed);
+			if (count <= 0) {
+				count = std::min(capacity - filled, flush_frames);
+				if (count <= 0) {
+					break;
+				}
+				for (int c = 0; c < channels; ++c) {
+					std::fill_n(&planes[c * capacity + filled], count, 0.0f);
+				}
+				filled += count;
+				flush_frames -= count;
+				continue;
+			}
+			for (int c = 0; c < channels; ++c) {
+				float* plane = &planes[c * capacity + filled];
+				const float* in = src + consumed * channels + c;
+				for (int i = 0; i < count; ++i) {
+					plane[i] = in[i * channels];
+				}
+			}
+			filled += count;
+			consumed += count;
+			continue;
+		}
+
+		// Exact phase when the table has one for every position, else the nearest
+		int64_t phase = phases == step_den ? frac : (frac * phases + step_den / 2) / step_den;
+		const float* h = coefficients + phase * taps;
+		for (int c = 0; c < channels; ++c) {
+			*dst++ = dot(&planes[c * capacity + position], h, taps);
+		}
+		++produced;
+
+		position += step_int;
+		frac += step_frac;
+		if (frac >= step_den) {
+			frac -= step_den;
+			++position;
+		}
+	}
+
+	src_frames = consumed;
+	dst_frames = produced;
+}
+
+int AudioPolyphase::GetChannels() const {
+	return channels;
+}
+
+int AudioPolyphase::GetTaps() const {
+	return taps;
+}
+
+int AudioPolyphase::GetPhases() const {
+	return phases;
+}
+
+void AudioPolyphase::Reduce(int input_rate, int output_rate, int64_t& num, int64_t& den) {
+	assert(input_rate > 0 && output_rate > 0);
+
+	int gcd = std::gcd(input_rate, output_rate);
+	num = input_rate / gcd;
+	den = output_rate / gcd;
+}
+
+void AudioPolyphase::SelectTable() {
+	if (step_int * step_den + step_frac == prepared_num && step_den == prepared_den) {
+		table = prepared.get();
+		phases = static_cast<int>(std::min<int64_t>(step_den, max_phases));
+	} else {
+		table = fallback.get();
+		phases = max_phases;
+	}
+}
+
+void AudioPolyphase::Compact() {
+	int drop = std::min(position, filled);
+	if (drop == 0) {
+		return;
+	}
+	for (int c = 0; c < channels; ++c) {
+		float* plane = &planes[c * capacity];
+		memmove(plane, plane + drop, (filled - drop) * sizeof(float));
+	}
+	filled -= drop;
+	position -= drop;
+}
+
+std::shared_ptr<const AudioPolyphase::Table> AudioPolyphase::GetTable(int taps, int phases, float cutoff, float beta) {
+	std::lock_guard<std::mutex> lock(tables_mutex);
+
+	TableKey key { taps, phases, cutoff, beta };
+	auto it = tables.find(key);
+	if (it != tables.end()) {
+		if (auto table = it->second.lock()) {
+			return table;
+		}
+	}
+
+	// One phase more than needed, the nearest phase of a position can be the next frame
+	auto table = std::make_shared<Table>((phases + 1) * taps);
+	const double half = taps / 2;
+	const double norm = BesselI0(beta);
+	for (int p = 0; p <= phases; ++p) {
+		float* h = table->data() + p * taps;
+		double sum = 0.0;
+		for (int k = 0; k < taps; ++k) {
+			// Distance of the input frame to the output position
+			double t = k - (half - 1) - static_cast<double>(p) / phases;
+			double x = cutoff * t;
+			double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+			double r = t / half;
+			double window = r * r < 1.0 ? BesselI0(beta * std::sqrt(1.0 - r * r)) / norm : 0.0;
+			h[k] = static_cast<float>(sinc * window);
+			sum += h[k];
+		}
+		// Unity gain at 0 Hz for every phase
+		for (int k = 0; k < taps; ++k) {
+			h[k] = static_cast<float>(h[k] / sum);
+		}
+	}
+
+	// Forget the tables of ratios that are no longer used
+	for (auto i = tables.begin(); i != tables.end();) {
+		i = i->second.expired() ? tables.erase(i) : std::next(i);
+	}
+	tables[key] = table;
+	return table;
+}
@@ -0,0 +1,161 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_AUDIO_POLYPHASE_H
+#define EP_AUDIO_POLYPHASE_H
+
+// Headers
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Built-in resampler for interleaved float frames.
+ *
+ * The filter is a Kaiser windowed sinc, stored as a table of phases that
+ * each hold the taps for one fractional position between two input frames.
+ * The table of a ratio is created by Prepare, outside of the audio thread.
+ * When the ratio reduces to a fraction with few enough phases (which covers
+ * all pairs of 22050, 32000, 44100 and 48000 Hz) every output frame uses
+ * the exact phase. Ratios without a prepared table (pitch changes on the
+ * audio thread) use the nearest of 1024 phases of a table that is not
+ * adjusted for downsampling. The position is tracked exactly, so the rate
+ * does not drift. Tables are shared between resamplers with the same filter.
+ *
+ * The dot products use the kernel selected by AudioMixer when the
+ * resampler is created.
+ */
+class AudioPolyphase {
+public:
+	/** Filter quality, higher quality uses more taps */
+	enum class Quality {
+		/** 64 taps, > 100 dB stopband */
+		High,
+		/** 32 taps, > 75 dB stopband */
+		Medium,
+		/** 16 taps, > 50 dB stopband */
+		Low
+	};
+
+	/**
+	 * Creates a resampler that keeps the rate until SetRate is called.
+	 *
+	 * @param channels samples per frame
+	 * @param quality filter quality
+	 */
+	AudioPolyphase(int channels, Quality quality);
+
+	/**
+	 * Creates the filter table of a ratio for SetRate.
+	 * This allocates and locks, so it must not run on the audio thread.
+	 *
+	 * @param input_rate frequency of the input
+	 * @param output_rate frequency of the output
+	 */
+	void Prepare(int input_rate, int output_rate);
+
+	/**
+	 * Sets the conversion ratio, keeping the frames already buffered.
+	 * The rates only need the right ratio, e.g. a pitch can be applied by
+	 * multiplying both with the pitch and the standard pitch.
+	 * Does not allocate, the table of the last Prepare is used when the
+	 * ratio matches, otherwise the shared 1024 phase table.
+	 *
+	 * @param input_rate frequency of the input
+	 * @param output_rate frequency of the output
+	 */
+	void SetRate(int input_rate, int output_rate);
+
+	/** Discards the buffered frames, e.g. after a seek */
+	void Reset();
+
+	/**
+	 * Marks the end of the input. Once the input passed to Process is used
+	 * up, the filter is fed with zeros to produce the remaining frames.
+	 * Has no effect when called again before Reset.
+	 */
+	void Flush();
+
+	/**
+	 * Resamples as many frames as fit into the output.
+	 * Input that is not consumed must be passed again with the next call.
+	 *
+	 * @param src interleaved input frames
+	 * @param src_frames frames in src, receives the frames consumed
+	 * @param dst interleaved output frames
+	 * @param dst_frames frames that fit into dst, receives the frames written
+	 */
+	void Process(const float* src, int& src_frames, float* dst, int& dst_frames);
+
+	/** @return samples per frame */
+	int GetChannels() const;
+
+	/** @return taps of the filter */
+	int GetTaps() const;
+
+	/** @return phases of the current filter table */
+	int GetPhases() const;
+
+private:
+	using Table = std::vector<float>;
+	using DotFn = float (*)(const float* a, const float* b, int count);
+
+	/** @return shared table for the filter, created when no resampler uses it yet */
+	static std::shared_ptr<const Table> GetTable(int taps, int phases, float cutoff, float beta);
+
+	/** Drops the frames before the current position */
+	void Compact();
+
+	/** Uses the prepared table when it matches the current ratio */
+	void SelectTable();
+
+	/** Reduces the ratio of the rates to a fraction */
+	static void Reduce(int input_rate, int output_rate, int64_t& num, int64_t& den);
+
+	int channels;
+	int taps;
+	float passband;
+	float beta;
+	DotFn dot;
+
+	/** Table of the ratio of the last Prepare */
+	std::shared_ptr<const Table> prepared;
+	int64_t prepared_num = 0;
+	int64_t prepared_den = 0;
+	/** Table with 1024 phases for all other ratios */
+	std::shared_ptr<const Table> fallback;
+	/** One of the above, selected for the current ratio */
+	const Table* table = nullptr;
+	int phases = 1;
+	/** Ratio input / output as whole frames and a fraction with denominator step_den */
+	int step_int = 1;
+	int64_t step_frac = 0;
+	int64_t step_den = 1;
+
+	/** Input frames, one plane per channel */
+	std::vector<float> planes;
+	int capacity = 0;
+	int filled = 0;
+	/** First frame of the next output and its fractional position */
+	int position = 0;
+	int64_t frac = 0;
+	/** Zero frames still to feed after the input */
+	int flush_frames = 0;
+	bool flushed = false;
+};
+
+#endif
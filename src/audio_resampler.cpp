@@ -183,7 +183,7 @@ inline static int DecodeAndConvertInt16(AudioDecoderBase* wrapped_decoder,
 #endif
 
 AudioResampler::AudioResampler(std::unique_ptr<AudioDecoderBase> wrapped, AudioResampler::Quality quality)
-	: wrapped_decoder(std::move(wrapped))
+	: wrapped_decoder(std::move(wrapped)), quality(quality)
 {
 	//There is no need for a standalone resampler decoder
 	assert(wrapped_decoder != 0);
@@ -217,17 +217,25 @@ AudioResampler::AudioResampler(std::unique_ptr<AudioDecoderBase> wrapped, AudioR
 		}
 	#endif
 
+	#if defined(HAVE_LIBSPEEXDSP) || defined(HAVE_LIBSAMPLERATE)
+		use_polyphase = quality == Quality::Low;
+	#else
+		use_polyphase = true;
+	#endif
+
 	finished = false;
 }
 
 AudioResampler::~AudioResampler() {
-	if (conversion_state) {
 	#if defined(HAVE_LIBSPEEXDSP)
+		if (conversion_state) {
 			speex_resampler_destroy(conversion_state);
+		}
 	#elif defined(HAVE_LIBSAMPLERATE)
+		if (conversion_state) {
 			src_delete(conversion_state);
+		}
 	#endif
-	}
 }
 
 bool AudioResampler::WasInited() const {
@@ -242,7 +250,7 @@ bool AudioResampler::Open(Filesystem_Stream::InputStream stream) {
 		switch (input_format) {
 			case Format::F32: output_format = input_format; break;
 		#ifdef HAVE_LIBSPEEXDSP
-			case Format::S16: output_format = input_format; break;
+			case Format::S16: output_format = use_polyphase ? Format::F32 : input_format; break;
 		#endif
 			default: output_format = Format::F32; break;
 		}
@@ -253,6 +261,9 @@ bool AudioResampler::Open(Filesystem_Stream::InputStream stream) {
 		wrapped_decoder->GetFormat(input_rate, input_format, nr_of_channels);
 		output_rate = input_rate;
 
+		if (use_polyphase) {
+			polyphase.reset(new AudioPolyphase(nr_of_channels, quality));
+		} else {
 		#if defined(HAVE_LIBSPEEXDSP)
 			conversion_state = speex_resampler_init(nr_of_channels, input_rate, output_rate, sampling_quality, &lasterror);
 			conversion_data.ratio_num = input_rate;
@@ -261,17 +272,21 @@ bool AudioResampler::Open(Filesystem_Stream::InputStream stream) {
 		#elif defined(HAVE_LIBSAMPLERATE)
 			conversion_state = src_new(sampling_quality, nr_of_channels, &lasterror);
 		#endif
+		}
 
 		//Init the conversion data structure
 		conversion_data.input_frames = 0;
 		conversion_data.input_frames_used = 0;
 		finished = false;
 
-		if (conversion_state)
+		if (HasConversionState())
 			return true;
 	}
 
-	conversion_state = nullptr;
+	polyphase.reset();
+	#if defined(HAVE_LIBSPEEXDSP) || defined(HAVE_LIBSAMPLERATE)
+		conversion_state = nullptr;
+	#endif
 	return false;
 }
 
@@ -301,11 +316,15 @@ bool AudioResampler::Seek(std::streamoff offset, std::ios_base::seekdir origin)
 		conversion_data.input_frames = 0;
 		conversion_data.input_frames_used = 0;
 		finished = wrapped_decoder->IsFinished();
+		if (polyphase) {
+			polyphase->Reset();
+		} else {
 		#if defined(HAVE_LIBSPEEXDSP)
 			speex_resampler_reset_mem(conversion_state);
 		#elif defined(HAVE_LIBSAMPLERATE)
 			src_reset(conversion_state);
 		#endif
+		}
 		return true;
 	}
 	return false;
@@ -342,7 +361,9 @@ bool AudioResampler::SetFormat(int freq, AudioDecoder::Format fmt, int channels)
 			break;
 	#ifdef HAVE_LIBSPEEXDSP
 		case Format::S16:
-			output_format = fmt;
+			if (!use_polyphase) {
+				output_format = fmt;
+			}
 			break;
 	#endif
 		default:
@@ -352,6 +373,16 @@ bool AudioResampler::SetFormat(int freq, AudioDecoder::Format fmt, int channels)
 	wrapped_decoder->GetFormat(input_rate, input_format, nr_of_channels);
 	output_rate = freq;
 
+	if (polyphase) {
+		if (polyphase->GetChannels() != nr_of_channels) {
+			polyphase.reset(new AudioPolyphase(nr_of_channels, quality));
+		}
+		// Creating the filter table is too slow for the audio thread
+		int numerator, denominator;
+		GetRatio(numerator, denominator);
+		polyphase->Prepare(numerator, denominator);
+	}
+
 	mono_to_stereo_resample = false;
 	if (channels == 2 && nr_of_channels == 1) {
 		mono_to_stereo_resample = true;
@@ -382,7 +413,7 @@ int AudioResampler::FillBuffer(uint8_t* buffer, int length) {
 		// Do only format conversion
 		amount_filled = FillBufferSameRate(buffer, bytes_to_read);
 	} else {
-		if (!conversion_state) {
+		if (!HasConversionState()) {
 			error_message = "internal error: state pointer is a nullptr";
 			amount_filled = ERROR;
 		} else {
@@ -409,6 +440,25 @@ int AudioResampler::FillBuffer(uint8_t* buffer, int length) {
 	return amount_filled * 2;
 }
 
+void AudioResampler::GetRatio(int& numerator, int& denominator) const {
+	if (pitch_handled_by_decoder) {
+		numerator = input_rate;
+		denominator = output_rate;
+	} else {
+		numerator = input_rate * pitch;
+		denominator = output_rate * STANDARD_PITCH;
+	}
+}
+
+bool AudioResampler::HasConversionState() const {
+	#if defined(HAVE_LIBSPEEXDSP) || defined(HAVE_LIBSAMPLERATE)
+		if (conversion_state) {
+			return true;
+		}
+	#endif
+	return polyphase != nullptr;
+}
+
 int AudioResampler::FillBufferSameRate(uint8_t* buffer, int length) {
 	const int input_samplesize = AudioDecoder::GetSamplesizeForFormat(input_format);
 	const int output_samplesize = AudioDecoder::GetSamplesizeForFormat(output_format);
@@ -497,7 +547,9 @@ int AudioResampler::FillBufferDifferentRate(uint8_t* buffer, int length) {
 	uint8_t * advanced_input_buffer = internal_buffer;
 	int unused_frames = 0;
 	int empty_buffer_space = 0;
-	int error = 0;
+	#if defined(HAVE_LIBSPEEXDSP) || defined(HAVE_LIBSAMPLERATE)
+		int error = 0;
+	#endif
 
 	#ifdef HAVE_LIBSPEEXDSP
 		spx_uint32_t numerator = 0;
@@ -541,6 +593,25 @@ int AudioResampler::FillBufferDifferentRate(uint8_t* buffer, int length) {
 		conversion_data.input_frames = amount_of_samples_read / nr_of_channels + unused_frames;
 		conversion_data.output_frames = total_output_frames;
 
+		if (polyphase) {
+			int numerator, denominator;
+			GetRatio(numerator, denominator);
+			polyphase->SetRate(numerator, denominator);
+			if (wrapped_decoder->IsFinished()) {
+				polyphase->Flush();
+			}
+
+			int input_frames = conversion_data.input_frames;
+			int output_frames = conversion_data.output_frames;
+			polyphase->Process((float*)internal_buffer, input_frames, (float*)buffer, output_frames);
+			conversion_data.input_frames_used = input_frames;
+			conversion_data.output_frames_gen = output_frames;
+
+			//The input was too short for one output frame, this is not the end
+			if (output_frames == 0 && input_frames > 0) {
+				continue;
+			}
+		} else {
 		#if defined(HAVE_LIBSPEEXDSP)
 			conversion_data.input_frames_used = conversion_data.input_frames;
 			conversion_data.output_frames_gen = conversion_data.output_frames;
@@ -594,11 +665,12 @@ int AudioResampler::FillBufferDifferentRate(uint8_t* buffer, int length) {
 				return ERROR;
 			}
 		#endif
+		}
 
 		total_output_frames -= conversion_data.output_frames_gen;
 		buffer += conversion_data.output_frames_gen*nr_of_channels*output_samplesize;
 
-		if ((conversion_data.input_frames == 0 && conversion_data.output_frames_gen <= conversion_data.output_frames) || conversion_data.output_frames_gen == 0) {
+		if ((conversion_data.input_frames == 0 && conversion_data.output_frames_gen < conversion_data.output_frames) || conversion_data.output_frames_gen == 0) {
 			finished = true;
 			//There is nothing left to convert - return how much samples (in bytes) are converted!
 			return length - total_output_frames*(output_samplesize*nr_of_channels);
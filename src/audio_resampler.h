@@ -21,6 +21,7 @@
 // Headers
 // Don't remove the system.h include, prevents heap corruption for automake (preprocessor defines)
 #include "audio_decoder.h"
+#include "audio_polyphase.h"
 #include "system.h"
 #include <string>
 #include <memory>
@@ -32,17 +33,16 @@
 #endif
 
 /**
- * Audio resampler powered by Libspeexdsp or Libsamplerate
+ * Audio resampler powered by Libspeexdsp, Libsamplerate or AudioPolyphase
  * Wraps another decoder and provides resampling.
+ * Low quality, used for streams, always uses the built-in AudioPolyphase
+ * because it is the cheapest. The other qualities use a library when one
+ * is available.
  */
 class AudioResampler : public AudioDecoderBase {
 public:
 	/** Resampling quality */
-	enum class Quality {
-		High,
-		Medium,
-		Low
-	};
+	using Quality = AudioPolyphase::Quality;
 
 	/**
 	 * Constructs a resampler
@@ -161,7 +161,7 @@ public:
 	 * Requests a certain frame format from the resampler.
 	 * Supported formats are:
 	 *  * float,int16_t for libspeexdsp
-	 *  * float for libsamplerate
+	 *  * float for libsamplerate and AudioPolyphase
 	 * The channel setting is redirected to the wrapped decoder.
 	 * The frequency setting controls the resampler.
 	 *
@@ -210,9 +210,24 @@ private:
 	 */
 	int FillBufferDifferentRate(uint8_t* buffer, int length);
 
+	/**
+	 * Returns the conversion ratio, including the pitch when the wrapped
+	 * decoder does not handle it.
+	 *
+	 * @param[out] numerator rate of the input
+	 * @param[out] denominator rate of the output
+	 */
+	void GetRatio(int& numerator, int& denominator) const;
+
+	/**
+	 * @return whether the resampler of the selected backend exists
+	 */
+	bool HasConversionState() const;
+
 	std::unique_ptr<AudioDecoderBase> wrapped_decoder;
 	bool pitch_handled_by_decoder = false;
 	int pitch = 100;
+	Quality quality;
 	int sampling_quality;
 	int lasterror;
 	bool finished;
@@ -233,7 +248,15 @@ private:
 	#elif defined(HAVE_LIBSAMPLERATE)
 		SRC_DATA conversion_data;
 		SRC_STATE * conversion_state = nullptr;
+	#else
+		struct {
+			int input_frames, output_frames;
+			int input_frames_used, output_frames_gen;
+		} conversion_data;
 	#endif
+	/** Used instead of the library for Low quality or when there is none */
+	bool use_polyphase;
+	std::unique_ptr<AudioPolyphase> polyphase;
 
 	/**
 	 * A buffer needed for operations which can't be performed in place (e.g resampling)
@@ -18,48 +18,60 @@
 // Headers
 #include <cassert>
 #include <cstring>
-#include <map>
+#include <list>
 #include <memory>
-#include <set>
+#include <unordered_map>
 #include "audio_resampler.h"
 #include "audio_secache.h"
-#include "game_clock.h"
 #include "filefinder.h"
 #include "output.h"
 
-using namespace std::chrono_literals;
-
 namespace {
-	typedef std::map<std::string, AudioSeRef> cache_type;
+	struct CacheEntry {
+		std::string filename;
+		AudioSeRef se;
+	};
 
-	cache_type cache;
+	/** Cached samples, most recently used first */
+	std::list<CacheEntry> lru;
+	std::unordered_map<std::string, std::list<CacheEntry>::iterator> cache;
 
-	constexpr int cache_limit = 3 * 1024 * 1024;
-	int cache_size = 0;
+	constexpr size_t MB = 1024 * 1024;
+	size_t cache_limit = 8 * MB;
+	size_t cache_size = 0;
 
-	void FreeCacheMemory() {
-		auto cur_time = Game_Clock::GetFrameTime();
+	int target_frequency = 0;
+	AudioDecoder::Format target_format = AudioDecoder::Format::S16;
 
-		for (auto it = cache.begin(); it != cache.end(); ) {
-			if (it->second.use_count() > 1) {
-				// SE is currently playing
-				++it;
-				continue;
-			}
+	AudioSeRef Find(const std::string& filename) {
+		auto it = cache.find(filename);
+		return it != cache.end() ? it->second->se : AudioSeRef();
+	}
+
+	AudioSeRef Touch(const std::string& filename) {
+		auto it = cache.find(filename);
+		if (it == cache.end()) {
+			return {};
+		}
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->se;
+	}
 
-			if (cache_size <= cache_limit && cur_time - it->second->last_access < 3s) {
-				// Below memory limit and last access < 3s
-				++it;
+	void FreeCacheMemory() {
+		// Oldest first, samples that are playing stay
+		for (auto it = lru.end(); it != lru.begin() && cache_size > cache_limit; ) {
+			--it;
+			if (it->se.use_count() > 1) {
 				continue;
 			}
 
 #ifdef CACHE_DEBUG
-			Output::Debug("SE: Freeing memory of {}", it->first);
+			Output::Debug("SE: Freeing memory of {}", it->filename);
 #endif
 
-			cache_size -= it->second->buffer.size();
-
-			it = cache.erase(it);
+			cache_size -= it->se->buffer.size();
+			cache.erase(it->filename);
+			it = lru.erase(it);
 		}
 
 #ifdef CACHE_DEBUG
@@ -71,12 +83,10 @@ namespace {
 std::unique_ptr<AudioSeCache> AudioSeCache::Create(Filesystem_Stream::InputStream stream) {
 	std::unique_ptr<AudioSeCache> se;
 
-	auto const it = cache.find(ToString(stream.GetName()));
-
 	se = std::make_unique<AudioSeCache>();
 	se->filename = ToString(stream.GetName());
 
-	if (it == cache.end()) {
+	if (!se->IsCached()) {
 		// Not in cache
 		if (!stream) {
 			se.reset();
@@ -117,12 +127,12 @@ bool AudioSeCache::IsCached() const {
 }
 
 bool AudioSeCache::GetCachedFormat(int& frequency, AudioDecoder::Format& format, int& channels) const {
-	cache_type::const_iterator it = cache.find(filename);
+	AudioSeRef se = Find(filename);
 
-	if (it != cache.end()) {
-		frequency = (*it).second->frequency;
-		format = (*it).second->format;
-		channels = (*it).second->channels;
+	if (se) {
+		frequency = se->frequency;
+		format = se->format;
+		channels = se->channels;
 
 		return true;
 	}
@@ -130,35 +140,37 @@ bool AudioSeCache::GetCachedFormat(int& frequency, AudioDecoder::Format& format,
 	return false;
 }
 
-std::unique_ptr<AudioDecoderBase> AudioSeCache::CreateSeDecoder() {
-	AudioSeRef se;
+AudioSeRef AudioSeCache::Load(bool evict) {
+	assert(audio_decoder);
 
-	if (IsCached()) {
-		se = cache.find(filename)->second;
-		se->last_access = Game_Clock::GetFrameTime();
+	// Not cached yet: Decode the sample
+	AudioSeRef se = std::make_shared<AudioSeData>();
+	audio_decoder->GetFormat(se->frequency, se->format, se->channels);
+	se->buffer = audio_decoder->DecodeAll();
+	audio_decoder.reset();
 
-		std::unique_ptr<AudioDecoderBase> dec = std::make_unique<AudioSeDecoder>(se);
 #ifdef USE_AUDIO_RESAMPLER
-		dec = std::make_unique<AudioResampler>(std::move(dec));
-#endif
+	if (target_frequency > 0 && se->frequency != target_frequency) {
+		// Resample once here instead of on every playback. This is only done
+		// once per sample, so a better quality than for streams is affordable.
+		AudioResampler resampler(std::make_unique<AudioSeDecoder>(se), AudioResampler::Quality::Medium);
 		Filesystem_Stream::InputStream is;
-		dec->Open(std::move(is));
-		return dec;
-	}
-
-	// Not cached yet: Decode the sample without any resampling
+		resampler.Open(std::move(is));
+		resampler.SetFormat(target_frequency, target_format, se->channels);
 
-	if (!se) {
-		se.reset(new AudioSeData());
+		AudioSeRef resampled = std::make_shared<AudioSeData>();
+		resampler.GetFormat(resampled->frequency, resampled->format, resampled->channels);
+		resampled->buffer = resampler.DecodeAll();
+		se = resampled;
 	}
+#endif
 
-	assert(audio_decoder);
-
-	audio_decoder->GetFormat(se->frequency, se->format, se->channels);
-	se->buffer = audio_decoder->DecodeAll();
-
-	cache.insert(std::make_pair(filename, se));
+	if (!evict && cache_size + se->buffer.size() > cache_limit) {
+		return se;
+	}
 
+	lru.push_front({ filename, se });
+	cache[filename] = lru.begin();
 	cache_size += se->buffer.size();
 
 #ifdef CACHE_DEBUG
@@ -167,9 +179,22 @@ std::unique_ptr<AudioDecoderBase> AudioSeCache::CreateSeDecoder() {
 
 	FreeCacheMemory();
 
-	std::unique_ptr<AudioDecoderBase> dec = std::unique_ptr<AudioDecoderBase>(new AudioSeDecoder(se));
+	return se;
+}
+
+std::unique_ptr<AudioDecoderBase> AudioSeCache::CreateSeDecoder(int pitch) {
+	AudioSeRef se = Touch(filename);
+	if (!se) {
+		se = Load();
+	}
+
+	std::unique_ptr<AudioDecoderBase> dec = std::make_unique<AudioSeDecoder>(se);
 #ifdef USE_AUDIO_RESAMPLER
-	dec = std::unique_ptr<AudioDecoderBase>(new AudioResampler(std::move(dec)));
+	if (pitch != 100 || target_frequency <= 0 || se->frequency != target_frequency) {
+		dec = std::make_unique<AudioResampler>(std::move(dec));
+	}
+#else
+	(void)pitch;
 #endif
 	Filesystem_Stream::InputStream is;
 	dec->Open(std::move(is));
@@ -177,19 +202,53 @@ std::unique_ptr<AudioDecoderBase> AudioSeCache::CreateSeDecoder() {
 }
 
 AudioSeRef AudioSeCache::GetSeData() const {
-    assert(IsCached());
+	assert(IsCached());
+
+	return Find(filename);
+}
+
+bool AudioSeCache::Preload(Filesystem_Stream::InputStream stream) {
+	std::unique_ptr<AudioSeCache> se = Create(std::move(stream));
+	if (!se) {
+		return false;
+	}
+
+	if (se->IsCached()) {
+		return true;
+	}
+
+	// Preloading must not push out samples that are already cached
+	if (cache_size >= cache_limit) {
+		return false;
+	}
 
-    return cache.find(filename)->second;
-};
+	se->Load(false);
+	return se->IsCached();
+}
+
+void AudioSeCache::SetTargetFormat(int frequency, AudioDecoder::Format format) {
+	if (frequency == target_frequency && format == target_format) {
+		return;
+	}
+
+	target_frequency = frequency;
+	target_format = format;
+	Clear();
+}
+
+void AudioSeCache::SetBudget(size_t bytes) {
+	cache_limit = bytes;
+	FreeCacheMemory();
+}
 
 void AudioSeCache::Clear() {
 	cache_size = 0;
 	cache.clear();
+	lru.clear();
 }
 
 AudioSeDecoder::AudioSeDecoder(AudioSeRef se) :
 	se(se) {
-	se->last_access = Game_Clock::GetFrameTime();
 }
 
 bool AudioSeDecoder::IsFinished() const {
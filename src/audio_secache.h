@@ -26,7 +26,6 @@
 #include <map>
 
 #include "audio_decoder.h"
-#include "game_clock.h"
 
 class AudioSeCache;
 
@@ -36,7 +35,6 @@ class AudioSeCache;
 class AudioSeData {
 public:
 	std::vector<uint8_t> buffer;
-	Game_Clock::time_point last_access;
 	int frequency;
 	AudioDecoder::Format format;
 	int channels;
@@ -70,8 +68,10 @@ private:
  * AudioSeCache provides an interface for accessing sound effects.
  * It also provides an automatic cache management, any SE is only decoded
  * once, otherwise returned from the cache.
- * The cache is flushed from recently (>10 seconds by default) unused
- * samples when it reaches the memory limit (5 MB by default).
+ * Samples are resampled to the output frequency when they are decoded, so
+ * playing them at normal pitch needs no resampler.
+ * When the cache exceeds its memory budget the least recently used samples
+ * that are not playing are freed.
  * Uses an internal AudioDecoder for handling the decoding.
  */
 class AudioSeCache {
@@ -116,13 +116,15 @@ public:
 	bool GetCachedFormat(int& frequency, AudioDecoder::Format& format, int& channels) const;
 
 	/**
-	 * Decodes the whole sample without doing any resampling and caches it.
-	 * When cached the decoding step is skipped.
+	 * Decodes the whole sample, resamples it to the target format and caches
+	 * it. When cached the decoding step is skipped.
 	 * The returned AudioDecoder contains the SE sample.
 	 *
+	 * @param pitch pitch the SE will be played at, a resampler is only
+	 * added when it is not 100 or the sample is not in the target format
 	 * @return Decoded sound effect
 	 */
-	std::unique_ptr<AudioDecoderBase> CreateSeDecoder();
+	std::unique_ptr<AudioDecoderBase> CreateSeDecoder(int pitch = 100);
 
 	/**
 	 * Returns the SE sample data handled by this SeCache.
@@ -131,8 +133,45 @@ public:
 	 */
 	AudioSeRef GetSeData() const;
 
+	/**
+	 * Decodes a SE into the cache so that playing it later does not decode.
+	 * Does nothing when the SE is cached or does not fit into the budget,
+	 * cached samples are never freed for a preloaded one.
+	 *
+	 * @param stream Stream to the audio file
+	 * @return whether the SE is cached now
+	 */
+	static bool Preload(Filesystem_Stream::InputStream stream);
+
+	/**
+	 * Sets the format of the audio output. Samples are resampled to its
+	 * frequency when they are cached. The channels are kept, mono samples
+	 * are mixed to both sides.
+	 * Clears the cache when the format changes.
+	 *
+	 * @param frequency output frequency, 0 disables resampling in the cache
+	 * @param format preferred sample format
+	 */
+	static void SetTargetFormat(int frequency, AudioDecoder::Format format);
+
+	/**
+	 * Sets the memory budget of the cache.
+	 *
+	 * @param bytes budget in bytes
+	 */
+	static void SetBudget(size_t bytes);
+
 	static void Clear();
 private:
+	/**
+	 * Decodes the sample and adds it to the cache.
+	 *
+	 * @param evict whether older samples are freed when the budget is
+	 * exceeded, otherwise the sample is not cached when it does not fit
+	 * @return the sample
+	 */
+	AudioSeRef Load(bool evict = true);
+
 	std::unique_ptr<AudioDecoderBase> audio_decoder;
 
 	std::string filename;
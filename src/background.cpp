@@ -64,6 +64,7 @@ Background::Background(int terrain_id) : Drawable(Priority_Background)
 	if (!terrain->background_a_name.empty()) {
 		FileRequestAsync* request = AsyncHandler::RequestFile("Frame", terrain->background_a_name);
 		request->SetGraphicFile(true);
+		request->SetTransparent(false);
 		request_id = request->Bind(&Background::OnBackgroundGraphicReady, this);
 		request->Start();
 
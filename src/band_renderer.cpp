@@ -0,0 +1,147 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Headers
+#include "band_renderer.h"
+#include "bitmap.h"
+#include "drawable_list.h"
+#include <algorithm>
+#include <cassert>
+
+BandRenderer::BandRenderer(int bands) : bands(std::max(bands, 1)) {
+	workers.reserve(this->bands - 1);
+	for (int band = 1; band < this->bands; ++band) {
+		workers.emplace_back(&BandRenderer::WorkerLoop, this, band);
+	}
+}
+
+BandRenderer::~BandRenderer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	start_cv.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void BandRenderer::Draw(Bitmap& dst, DrawableList& list, int min_z, int max_z) {
+	if (list.IsDirty()) {
+		list.Sort();
+	}
+
+	SetTarget(dst);
+
+	for (auto* drawable : list) {
+		auto z = drawable->GetZ();
+		if (z < min_z) {
+			continue;
+		}
+		if (z > max_z) {
+			break;
+		}
+		if (!drawable->IsVisible()) {
+			continue;
+		}
+
+		if (drawable->PrepareBands(dst)) {
+			pending.push_back(drawable);
+		} else {
+			Flush();
+			drawable->Draw(dst);
+		}
+	}
+
+	Flush();
+}
+
+void BandRenderer::SetTarget(Bitmap& dst) {
+	if (dst.pixels() == target_pixels && dst.width() == target_width && dst.height() == target_height) {
+		return;
+	}
+
+	target_pixels = dst.pixels();
+	target_width = dst.width();
+	target_height = dst.height();
+
+	// Split in rows of equal height, the last band gets the remainder
+	const int band_height = (target_height + bands - 1) / bands;
+	band_views.clear();
+	for (int band = 0; band < bands; ++band) {
+		const int y = std::min(band * band_height, target_height);
+		const int h = std::min(band_height, target_height - y);
+		band_views.push_back(dst.CreateClippedView(Rect(0, y, target_width, h)));
+	}
+}
+
+void BandRenderer::Flush() {
+	if (pending.empty()) {
+		return;
+	}
+
+	if (!workers.empty()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		++generation;
+		running = static_cast<int>(workers.size());
+	}
+	start_cv.notify_all();
+
+	DrawPending(0);
+
+	if (!workers.empty()) {
+		std::unique_lock<std::mutex> lock(mutex);
+		done_cv.wait(lock, [this]() { return running == 0; });
+	}
+
+	pending.clear();
+}
+
+void BandRenderer::DrawPending(int band) {
+	auto& dst = *band_views[band];
+	for (auto* drawable : pending) {
+		drawable->DrawBand(dst);
+	}
+}
+
+void BandRenderer::WorkerLoop(int band) {
+	unsigned done_generation = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start_cv.wait(lock, [&]() { return quit || generation != done_generation; });
+			if (quit) {
+				return;
+			}
+			done_generation = generation;
+		}
+
+		DrawPending(band);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = --running == 0;
+		}
+		if (last) {
+			done_cv.notify_one();
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EP_BAND_RENDERER_H
+#define EP_BAND_RENDERER_H
+
+// Headers
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "memory_management.h"
+
+class Bitmap;
+class Drawable;
+class DrawableList;
+
+/**
+ * Draws a DrawableList with the frame split into horizontal bands, every band
+ * is drawn by its own thread. The main thread draws the first band.
+ *
+ * Drawables are prepared in draw order on the main thread (PrepareBands),
+ * consecutive drawables that support bands are then drawn together with
+ * DrawBand on every band. A drawable that does not support bands waits for
+ * the ones before it and is drawn with Draw on the whole frame.
+ *
+ * Every band only writes to its own rows and every drawable is drawn in the
+ * same order as by DrawableList::Draw, so the result is identical.
+ */
+class BandRenderer {
+public:
+	/**
+	 * @param bands number of bands, one thread less is started
+	 */
+	explicit BandRenderer(int bands);
+	~BandRenderer();
+
+	BandRenderer(const BandRenderer&) = delete;
+	BandRenderer& operator=(const BandRenderer&) = delete;
+
+	/** @return number of bands */
+	int GetBands() const;
+
+	/**
+	 * Banded version of DrawableList::Draw.
+	 *
+	 * @param dst The bitmap to draw onto
+	 * @param list drawables to draw, sorted when dirty
+	 * @param min_z Skip any drawables with z < min_z
+	 * @param max_z Skip any drawables with z > max_z
+	 */
+	void Draw(Bitmap& dst, DrawableList& list, int min_z, int max_z);
+
+private:
+	void SetTarget(Bitmap& dst);
+	/** Draws the pending drawables on all bands and waits for them */
+	void Flush();
+	void DrawPending(int band);
+	void WorkerLoop(int band);
+
+	const int bands;
+	std::vector<std::thread> workers;
+
+	/** dst clipped to every band, reused while dst does not change */
+	std::vector<BitmapRef> band_views;
+	const void* target_pixels = nullptr;
+	int target_width = 0;
+	int target_height = 0;
+
+	std::vector<const Drawable*> pending;
+
+	std::mutex mutex;
+	std::condition_variable start_cv;
+	std::condition_variable done_cv;
+	unsigned generation = 0;
+	int running = 0;
+	bool quit = false;
+};
+
+inline int BandRenderer::GetBands() const {
+	return bands;
+}
+
+#endif
@@ -37,6 +37,9 @@ public:
 	/** Update the animation to the next animation **/
 	void Update();
 
+	/** Animations draw several cells from Draw, so they are never banded **/
+	bool PrepareBands(const Bitmap&) override { return false; }
+
 	/** @return the current timing frame (2x the number of frames in the underlying animation **/
 	int GetFrame() const;
 
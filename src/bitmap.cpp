@@ -38,7 +38,7 @@
 #include "font.h"
 #include "output.h"
 #include "util_macro.h"
-#include "bitmap_hslrgb.h"
+#include "bitmap_kernels.h"
 #include <iostream>
 
 BitmapRef Bitmap::Create(int width, int height, const Color& color) {
@@ -79,6 +79,27 @@ BitmapRef Bitmap::Create(void *pixels, int width, int height, int pitch, const D
 	return std::make_shared<Bitmap>(pixels, width, height, pitch, format);
 }
 
+BitmapRef Bitmap::CreateClippedView(Rect const& clip) {
+	auto view = std::make_shared<Bitmap>(pixels(), width(), height(), pitch(), format);
+
+	pixman_region32_t region;
+	pixman_region32_init_rect(&region, clip.x, clip.y, clip.width, clip.height);
+	pixman_image_set_clip_region32(view->bitmap.get(), &region);
+	pixman_region32_fini(&region);
+
+	return view;
+}
+
+void Bitmap::Validate() const {
+	// The images are validated before the composite checks its size
+	pixman_image_composite32(PIXMAN_OP_SRC,
+							 bitmap.get(), nullptr, bitmap.get(),
+							 0, 0,
+							 0, 0,
+							 0, 0,
+							 0, 0);
+}
+
 Bitmap::Bitmap(int width, int height, bool transparent) {
 	format = (transparent ? pixel_format : opaque_pixel_format);
 	pixman_format = find_format(format);
@@ -196,29 +217,14 @@ size_t Bitmap::GetSize() const {
 }
 
 ImageOpacity Bitmap::ComputeImageOpacity() const {
-	bool all_opaque = true;
-	bool all_transp = true;
-
 	auto* p = reinterpret_cast<const uint32_t*>(pixels());
+	const int stride = pitch() / sizeof(uint32_t);
 	const auto mask = pixel_format.rgba_to_uint32_t(0, 0, 0, 0xFF);
 
-	int n = GetSize() / sizeof(uint32_t);
-	for (int i = 0; i < n; ++i ) {
-		auto px = p[i] & mask;
-		all_opaque &= (px == mask);
-		all_transp &= (px == 0);
-	}
-
-	return
-		all_transp ? ImageOpacity::Transparent :
-		all_opaque ? ImageOpacity::Opaque :
-		ImageOpacity::Partial;
+	return BitmapKernels::ComputeOpacity(p, width(), height(), stride, mask);
 }
 
 ImageOpacity Bitmap::ComputeImageOpacity(Rect rect) const {
-	bool all_opaque = true;
-	bool all_transp = true;
-
 	const auto full_rect = GetRect();
 	rect = full_rect.GetSubRect(rect);
 
@@ -226,20 +232,26 @@ ImageOpacity Bitmap::ComputeImageOpacity(Rect rect) const {
 	const int stride = pitch() / sizeof(uint32_t);
 	const auto mask = pixel_format.rgba_to_uint32_t(0, 0, 0, 0xFF);
 
-	int xend = (rect.x + rect.width);
-	int yend = (rect.y + rect.height);
-	for (int y = rect.y * stride; y < yend * stride; y += stride) {
-		for (int x = rect.x; x < xend; ++x) {
-			auto px = p[x + y] & mask;
-			all_transp &= (px == 0);
-			all_opaque &= (px == mask);
+	return BitmapKernels::ComputeOpacity(p + rect.y * stride + rect.x, rect.width, rect.height, stride, mask);
+}
+
+TileOpacity Bitmap::ComputeTileOpacity(int tile_size) const {
+	const int h = height() / tile_size;
+	const int w = width() / tile_size;
+	TileOpacity opacity(w, h);
+
+	std::vector<ImageOpacity> ops(w * h);
+	auto* p = reinterpret_cast<const uint32_t*>(pixels());
+	const int stride = pitch() / sizeof(uint32_t);
+	const auto mask = pixel_format.rgba_to_uint32_t(0, 0, 0, 0xFF);
+	BitmapKernels::ComputeTileOpacity(p, w, h, tile_size, stride, mask, ops.data());
+
+	for (int ty = 0; ty < h; ++ty) {
+		for (int tx = 0; tx < w; ++tx) {
+			opacity.Set(tx, ty, ops[tx + ty * w]);
 		}
 	}
-
-	return
-		all_transp ? ImageOpacity::Transparent :
-		all_opaque ? ImageOpacity::Opaque :
-		ImageOpacity::Partial;
+	return opacity;
 }
 
 void Bitmap::CheckPixels(uint32_t flags) {
@@ -256,17 +268,7 @@ void Bitmap::CheckPixels(uint32_t flags) {
 	}
 
 	if (flags & Flag_Chipset) {
-		const int h = height() / TILE_SIZE;
-		const int w = width() / TILE_SIZE;
-		tile_opacity = TileOpacity(w, h);
-
-		for (int ty = 0; ty < h; ++ty) {
-			for (int tx = 0; tx < w; ++tx) {
-				Rect rect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE);
-				auto op = ComputeImageOpacity(rect);
-				tile_opacity.Set(tx, ty, op);
-			}
-		}
+		tile_opacity = ComputeTileOpacity(TILE_SIZE);
 	}
 
 	if (flags & Flag_ReadOnly) {
@@ -296,16 +298,7 @@ void Bitmap::HueChangeBlit(int x, int y, Bitmap const& src, Rect const& src_rect
 	Bitmap bmp(reinterpret_cast<void*>(&pixels.front()), src_rect.width, src_rect.height, src_rect.width * 4, format);
 	bmp.Blit(0, 0, src, src_rect, Opacity::Opaque());
 
-	for (std::vector<uint32_t>::iterator p = pixels.begin(); p != pixels.end(); ++p) {
-		uint32_t pixel = *p;
-		uint8_t r = (pixel>>24) & 0xFF;
-		uint8_t g = (pixel>>16) & 0xFF;
-		uint8_t b = (pixel>> 8) & 0xFF;
-		uint8_t a = pixel & 0xFF;
-		if (a > 0)
-			RGB_adjust_HSL(r, g, b, hue);
-		*p = ((uint32_t) r << 24) | ((uint32_t) g << 16) | ((uint32_t) b << 8) | (uint32_t) a;
-	}
+	BitmapKernels::HueRow(pixels.data(), pixels.size(), hue);
 
 	Blit(dst_rect.x, dst_rect.y, bmp, bmp.GetRect(), Opacity::Opaque());
 }
@@ -649,18 +642,19 @@ void Bitmap::StretchBlit(Rect const& dst_rect, Bitmap const& src, Rect const& sr
 
 	Transform xform = Transform::Scale(zoom_x, zoom_y);
 
-	pixman_image_set_transform(src.bitmap.get(), &xform.matrix);
+	// The transform goes on a private image, so src is never modified and
+	// can be drawn from several threads
+	auto src_img = GetSubimage(src, src.GetRect());
+	pixman_image_set_transform(src_img.get(), &xform.matrix);
 
 	auto mask = CreateMask(opacity, src_rect, &xform);
 
 	pixman_image_composite32(src.GetOperator(mask.get(), blend_mode),
-							 src.bitmap.get(), mask.get(), bitmap.get(),
+							 src_img.get(), mask.get(), bitmap.get(),
 							 src_rect.x / zoom_x, src_rect.y / zoom_y,
 							 0, 0,
 							 dst_rect.x, dst_rect.y,
 							 dst_rect.width, dst_rect.height);
-
-	pixman_image_set_transform(src.bitmap.get(), nullptr);
 }
 
 void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const& src, Rect const& src_rect, int depth, double phase, Opacity const& opacity, Bitmap::BlendMode blend_mode) {
@@ -670,7 +664,8 @@ void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const&
 
 	Transform xform = Transform::Scale(1.0 / zoom_x, 1.0 / zoom_y);
 
-	pixman_image_set_transform(src.bitmap.get(), &xform.matrix);
+	auto src_img = GetSubimage(src, src.GetRect());
+	pixman_image_set_transform(src_img.get(), &xform.matrix);
 
 	auto mask = CreateMask(opacity, src_rect, &xform);
 
@@ -689,14 +684,12 @@ void Bitmap::WaverBlit(int x, int y, double zoom_x, double zoom_y, Bitmap const&
 		const int offset = 2 * zoom_x * depth * std::sin(phase + sy);
 
 		pixman_image_composite32(src.GetOperator(mask.get(), blend_mode),
-								 src.bitmap.get(), mask.get(), bitmap.get(),
+								 src_img.get(), mask.get(), bitmap.get(),
 								 xoff, yoff + i,
 								 0, i,
 								 x + offset, dy,
 								 width, 1);
 	}
-
-	pixman_image_set_transform(src.bitmap.get(), nullptr);
 }
 
 static pixman_color_t PixmanColor(const Color &color) {
@@ -750,60 +743,6 @@ void Bitmap::ClearRect(Rect const& dst_rect) {
 	pixman_image_fill_boxes(PIXMAN_OP_CLEAR, bitmap.get(), &pcolor, 1, &box);
 }
 
-// Hard light lookup table mapping source color to destination color
-// FIXME: Replace this with std::array<std::array<uint8_t,256>,256> when we have C++17
-struct HardLightTable {
-	uint8_t table[256][256] = {};
-};
-
-static constexpr HardLightTable make_hard_light_lookup() {
-	HardLightTable hl;
-	for (int i = 0; i < 256; ++i) {
-		for (int j = 0; j < 256; ++j) {
-			int res = 0;
-			if (i <= 128)
-				res = (2 * i * j) / 255;
-			else
-				res = 255 - 2 * (255 - i) * (255 - j) / 255;
-			hl.table[i][j] = res > 255 ? 255 : res < 0 ? 0 : res;
-		}
-	}
-	return hl;
-}
-
-constexpr auto hard_light = make_hard_light_lookup();
-
-// Saturation Tone Inline: Changes a pixel saturation
-static inline void saturation_tone(uint32_t &src_pixel, int saturation, int rs, int gs, int bs, int as) {
-	// Algorithm from OpenPDN (MIT license)
-	// Transformation in Y'CbCr color space
-	uint8_t r = (src_pixel >> rs) & 0xFF;
-	uint8_t g = (src_pixel >> gs) & 0xFF;
-	uint8_t b = (src_pixel >> bs) & 0xFF;
-	uint8_t a = (src_pixel >> as) & 0xFF;
-
-	// Y' = 0.299 R' + 0.587 G' + 0.114 B'
-	uint8_t lum = (7471 * b + 38470 * g + 19595 * r) >> 16;
-
-	// Scale Cb/Cr by scale factor "sat"
-	int red = ((lum * 1024 + (r - lum) * saturation) >> 10);
-	red = red > 255 ? 255 : red < 0 ? 0 : red;
-	int green = ((lum * 1024 + (g - lum) * saturation) >> 10);
-	green = green > 255 ? 255 : green < 0 ? 0 : green;
-	int blue = ((lum * 1024 + (b - lum) * saturation) >> 10);
-	blue = blue > 255 ? 255 : blue < 0 ? 0 : blue;
-
-	src_pixel = ((uint32_t)red << rs) | ((uint32_t)green << gs) | ((uint32_t)blue << bs) | ((uint32_t)a << as);
-}
-
-// Color Tone Inline: Changes color of a pixel by hard light table
-static inline void color_tone(uint32_t &src_pixel, Tone tone, int rs, int gs, int bs, int as) {
-	src_pixel = ((uint32_t)hard_light.table[tone.red][(src_pixel >> rs) & 0xFF] << rs)
-		| ((uint32_t)hard_light.table[tone.green][(src_pixel >> gs) & 0xFF] << gs)
-		| ((uint32_t)hard_light.table[tone.blue][(src_pixel >> bs) & 0xFF] << bs)
-		| ((uint32_t)((src_pixel >> as) & 0xFF) << as);
-}
-
 void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, const Tone &tone, Opacity const& opacity, bool check_alpha) {
 	if (opacity.IsTransparent()) {
 		return;
@@ -829,93 +768,20 @@ void Bitmap::ToneBlit(int x, int y, Bitmap const& src, Rect const& src_rect, con
 		x, y,
 		src_rect.width, src_rect.height);
 
-	int as = pixel_format.a.shift;
-	int rs = pixel_format.r.shift;
-	int gs = pixel_format.g.shift;
-	int bs = pixel_format.b.shift;
+	const BitmapKernels::PixelShifts shifts = {
+		pixel_format.r.shift,
+		pixel_format.g.shift,
+		pixel_format.b.shift,
+		pixel_format.a.shift
+	};
 	int next_row = pitch() / sizeof(uint32_t);
 	uint32_t* pixels = (uint32_t*)this->pixels();
-	pixels = pixels + (y - 1) * next_row + x;
+	pixels = pixels + y * next_row + x;
 
 	uint16_t limit_height = std::min<uint16_t>(src_rect.height, height());
 	uint16_t limit_width = std::min<uint16_t>(src_rect.width, width());
 
-	// If Saturation + Color:
-	if (tone.gray != 128 && (tone.red != 128 || tone.green != 128 || tone.blue != 128)) {
-		int sat = tone.gray > 128 ? 1024 + (tone.gray - 128) * 16 : tone.gray * 8;
-
-		if (&src != this || check_alpha) {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					if ((uint8_t)((pixels[j] >> as) & 0xFF) == 0)
-						continue;
-
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
-		}
-		else {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
-		}
-	}
-
-	// If Only Saturation:
-	else if (tone.gray != 128) {
-		int sat = tone.gray > 128 ? 1024 + (tone.gray - 128) * 16 : tone.gray * 8;
-
-		if (&src != this || check_alpha) {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					if ((uint8_t)((pixels[j] >> as) & 0xFF) == 0)
-						continue;
-
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-				}
-			}
-		}
-		else {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					saturation_tone(pixels[j], sat, rs, gs, bs, as);
-				}
-			}
-		}
-	}
-
-	// If Only Color:
-	else if (tone.red != 128 || tone.green != 128 || tone.blue != 128) {
-		if (&src != this || check_alpha) {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					if ((uint8_t)((pixels[j] >> as) & 0xFF) == 0)
-						continue;
-
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
-		}
-		else {
-			for (uint16_t i = 0; i < limit_height; ++i) {
-				pixels += next_row;
-				for (uint16_t j = 0; j < limit_width; ++j) {
-					color_tone(pixels[j], tone, rs, gs, bs, as);
-				}
-			}
-		}
-
-	}
-
+	BitmapKernels::ToneRows(pixels, limit_width, limit_height, next_row, tone, shifts, &src != this || check_alpha);
 }
 
 void Bitmap::BlendBlit(int x, int y, Bitmap const& src, Rect const& src_rect, const Color& color, Opacity const& opacity) {
@@ -1077,8 +943,6 @@ void Bitmap::RotateZoomOpacityBlit(int x, int y, int ox, int oy,
 		return;
 	}
 
-	auto* src_img = src.bitmap.get();
-
 	Transform fwd = Transform::Translation(x, y);
 	fwd *= Transform::Rotation(angle);
 	if (zoom_x != 1.0 || zoom_y != 1.0) {
@@ -1093,11 +957,8 @@ void Bitmap::RotateZoomOpacityBlit(int x, int y, int ox, int oy,
 
 	auto inv = fwd.Inverse();
 
-	PixmanImagePtr temp;
-	if (src_rect != src.GetRect()) {
-		temp = GetSubimage(src, src_rect);
-		src_img = temp.get();
-	}
+	auto temp = GetSubimage(src, src_rect);
+	auto* src_img = temp.get();
 
 	pixman_image_set_transform(src_img, &inv.matrix);
 
@@ -1111,8 +972,6 @@ void Bitmap::RotateZoomOpacityBlit(int x, int y, int ox, int oy,
 							 dst_rect.x, dst_rect.y,
 							 dst_rect.x, dst_rect.y,
 							 dst_rect.width, dst_rect.height);
-
-	pixman_image_set_transform(src_img, nullptr);
 }
 
 void Bitmap::ZoomOpacityBlit(int x, int y, int ox, int oy,
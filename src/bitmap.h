@@ -101,6 +101,23 @@ public:
 	 */
 	static BitmapRef Create(void *pixels, int width, int height, int pitch, const DynamicFormat& format);
 
+	/**
+	 * Creates a surface that shares the pixels of this bitmap and only
+	 * draws inside of clip. Views with clip rects that do not overlap can
+	 * be drawn on from different threads.
+	 *
+	 * @param clip the rect that is drawn to
+	 */
+	BitmapRef CreateClippedView(Rect const& clip);
+
+	/**
+	 * Prepares the bitmap to be drawn from by several threads at once.
+	 * pixman sets up an image lazily when it is first drawn with and after
+	 * its properties changed, which writes to the image. This does it now,
+	 * call it on the thread that owns the bitmap before sharing it.
+	 */
+	void Validate() const;
+
 	Bitmap(int width, int height, bool transparent);
 	Bitmap(Filesystem_Stream::InputStream stream, bool transparent, uint32_t flags);
 	Bitmap(const uint8_t* data, unsigned bytes, bool transparent, uint32_t flags);
@@ -579,6 +596,15 @@ public:
 	ImageOpacity ComputeImageOpacity() const;
 	ImageOpacity ComputeImageOpacity(Rect rect) const;
 
+	/**
+	 * Computes the opacity of every tile in one pass over the pixels.
+	 * Partial tiles at the right and bottom border are not included.
+	 *
+	 * @param tile_size width and height of a tile
+	 * @return opacity of the tiles
+	 */
+	TileOpacity ComputeTileOpacity(int tile_size) const;
+
 protected:
 	DynamicFormat format;
 
@@ -0,0 +1,816 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "bitmap_kernels.h"
+#include "bitmap_hslrgb.h"
+#include "compiler.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <vector>
+
+#ifdef EP_SIMD_X86
+#  include <immintrin.h>
+#endif
+#ifdef EP_SIMD_NEON
+#  include <arm_neon.h>
+#endif
+
+using namespace BitmapKernels;
+
+namespace {
+	// Hard light lookup table mapping source color to destination color
+	// FIXME: Replace this with std::array<std::array<uint8_t,256>,256> when we have C++17
+	struct HardLightTable {
+		uint8_t table[256][256] = {};
+	};
+
+	constexpr HardLightTable make_hard_light_lookup() {
+		HardLightTable hl;
+		for (int i = 0; i < 256; ++i) {
+			for (int j = 0; j < 256; ++j) {
+				int res = 0;
+				if (i <= 128)
+					res = (2 * i * j) / 255;
+				else
+					res = 255 - 2 * (255 - i) * (255 - j) / 255;
+				hl.table[i][j] = res > 255 ? 255 : res < 0 ? 0 : res;
+			}
+		}
+		return hl;
+	}
+
+	constexpr auto hard_light = make_hard_light_lookup();
+
+	// Saturation Tone Inline: Changes a pixel saturation
+	inline void saturation_tone(uint32_t &src_pixel, int saturation, int rs, int gs, int bs, int as) {
+		// Algorithm from OpenPDN (MIT license)
+		// Transformation in Y'CbCr color space
+		uint8_t r = (src_pixel >> rs) & 0xFF;
+		uint8_t g = (src_pixel >> gs) & 0xFF;
+		uint8_t b = (src_pixel >> bs) & 0xFF;
+		uint8_t a = (src_pixel >> as) & 0xFF;
+
+		// Y' = 0.299 R' + 0.587 G' + 0.114 B'
+		uint8_t lum = (7471 * b + 38470 * g + 19595 * r) >> 16;
+
+		// Scale Cb/Cr by scale factor "sat"
+		int red = ((lum * 1024 + (r - lum) * saturation) >> 10);
+		red = red > 255 ? 255 : red < 0 ? 0 : red;
+		int green = ((lum * 1024 + (g - lum) * saturation) >> 10);
+		green = green > 255 ? 255 : green < 0 ? 0 : green;
+		int blue = ((lum * 1024 + (b - lum) * saturation) >> 10);
+		blue = blue > 255 ? 255 : blue < 0 ? 0 : blue;
+
+		src_pixel = ((uint32_t)red << rs) | ((uint32_t)green << gs) | ((uint32_t)blue << bs) | ((uint32_t)a << as);
+	}
+
+	// Color Tone Inline: Changes color of a pixel by hard light table
+	inline void color_tone(uint32_t &src_pixel, Tone tone, int rs, int gs, int bs, int as) {
+		src_pixel = ((uint32_t)hard_light.table[tone.red][(src_pixel >> rs) & 0xFF] << rs)
+			| ((uint32_t)hard_light.table[tone.green][(src_pixel >> gs) & 0xFF] << gs)
+			| ((uint32_t)hard_light.table[tone.blue][(src_pixel >> bs) & 0xFF] << bs)
+			| ((uint32_t)((src_pixel >> as) & 0xFF) << as);
+	}
+
+	/**
+	 * Tone prepared for the kernels.
+	 *
+	 * The vector kernels evaluate the hard light table as
+	 * min(255, k * (c ^ f) / 255 ^ f), with f = 0 for the multiply half and
+	 * f = 255 for the screen half, and divide by 255 as x * 0x8081 >> 23,
+	 * which is exact for all x < 65536.
+	 */
+	struct ToneSetup {
+		Tone tone;
+		PixelShifts shifts;
+		bool skip_transparent;
+		bool saturation;
+		bool color;
+		int sat;
+		int k[3];
+		int f[3];
+	};
+
+	ToneSetup MakeToneSetup(const Tone& tone, const PixelShifts& shifts, bool skip_transparent) {
+		ToneSetup ts;
+		ts.tone = tone;
+		ts.shifts = shifts;
+		ts.skip_transparent = skip_transparent;
+		ts.saturation = tone.gray != 128;
+		ts.color = tone.red != 128 || tone.green != 128 || tone.blue != 128;
+		ts.sat = tone.gray > 128 ? 1024 + (tone.gray - 128) * 16 : tone.gray * 8;
+		const int channels[3] = { tone.red, tone.green, tone.blue };
+		for (int i = 0; i < 3; ++i) {
+			const int t = channels[i];
+			ts.k[i] = t <= 128 ? 2 * t : 2 * (255 - t);
+			ts.f[i] = t <= 128 ? 0 : 255;
+		}
+		return ts;
+	}
+
+	void ToneScalar(uint32_t* pixels, int width, int height, int stride, const ToneSetup& ts) {
+		const int rs = ts.shifts.r;
+		const int gs = ts.shifts.g;
+		const int bs = ts.shifts.b;
+		const int as = ts.shifts.a;
+
+		for (int i = 0; i < height; ++i, pixels += stride) {
+			for (int j = 0; j < width; ++j) {
+				if (ts.skip_transparent && (uint8_t)((pixels[j] >> as) & 0xFF) == 0)
+					continue;
+
+				if (ts.saturation)
+					saturation_tone(pixels[j], ts.sat, rs, gs, bs, as);
+				if (ts.color)
+					color_tone(pixels[j], ts.tone, rs, gs, bs, as);
+			}
+		}
+	}
+
+	void HueScalar(uint32_t* pixels, int count, int hue) {
+		for (int i = 0; i < count; ++i) {
+			uint32_t pixel = pixels[i];
+			uint8_t r = (pixel>>24) & 0xFF;
+			uint8_t g = (pixel>>16) & 0xFF;
+			uint8_t b = (pixel>> 8) & 0xFF;
+			uint8_t a = pixel & 0xFF;
+			if (a > 0)
+				RGB_adjust_HSL(r, g, b, hue);
+			pixels[i] = ((uint32_t) r << 24) | ((uint32_t) g << 16) | ((uint32_t) b << 8) | (uint32_t) a;
+		}
+	}
+
+	// Accumulated opacity of a run of pixels, both set means partial
+	constexpr int Opacity_Visible = 1;
+	constexpr int Opacity_Translucent = 2;
+	constexpr int Opacity_Partial = Opacity_Visible | Opacity_Translucent;
+
+	// pixels between the early exit checks of the scalar loop
+	constexpr int opacity_chunk = 16;
+
+	inline int OpacityFlagsScalar(const uint32_t* p, int n, uint32_t mask, int flags) {
+		for (int i = 0; i < n && flags != Opacity_Partial; i += opacity_chunk) {
+			const int end = std::min(n, i + opacity_chunk);
+			uint32_t any = 0;
+			uint32_t all = mask;
+			for (int j = i; j < end; ++j) {
+				any |= p[j];
+				all &= p[j];
+			}
+			if ((any & mask) != 0)
+				flags |= Opacity_Visible;
+			if ((all & mask) != mask)
+				flags |= Opacity_Translucent;
+		}
+		return flags;
+	}
+
+	void OpacityScalar(const uint32_t* pixels, int segments, int length, uint32_t mask, int* flags) {
+		for (int s = 0; s < segments; ++s, pixels += length) {
+			if (flags[s] != Opacity_Partial)
+				flags[s] = OpacityFlagsScalar(pixels, length, mask, flags[s]);
+		}
+	}
+
+	ImageOpacity ToImageOpacity(int flags) {
+		return
+			(flags & Opacity_Visible) == 0 ? ImageOpacity::Transparent :
+			(flags & Opacity_Translucent) == 0 ? ImageOpacity::Opaque :
+			ImageOpacity::Partial;
+	}
+
+#ifdef EP_SIMD_X86
+	EP_TARGET("sse4.1") EP_ALWAYS_INLINE
+	__m128i SaturateSse41(__m128i c, __m128i lum, __m128i base, __m128i sat) {
+		__m128i v = _mm_srai_epi32(_mm_add_epi32(base, _mm_mullo_epi32(_mm_sub_epi32(c, lum), sat)), 10);
+		return _mm_min_epi32(_mm_max_epi32(v, _mm_setzero_si128()), _mm_set1_epi32(255));
+	}
+
+	EP_TARGET("sse4.1") EP_ALWAYS_INLINE
+	__m128i HardLightSse41(__m128i c, __m128i k, __m128i f) {
+		__m128i v = _mm_mullo_epi32(_mm_mullo_epi32(k, _mm_xor_si128(c, f)), _mm_set1_epi32(0x8081));
+		return _mm_min_epi32(_mm_xor_si128(_mm_srli_epi32(v, 23), f), _mm_set1_epi32(255));
+	}
+
+	EP_TARGET("sse4.1")
+	void ToneSse41(uint32_t* pixels, int width, int height, int stride, const ToneSetup& ts) {
+		const __m128i rs = _mm_cvtsi32_si128(ts.shifts.r);
+		const __m128i gs = _mm_cvtsi32_si128(ts.shifts.g);
+		const __m128i bs = _mm_cvtsi32_si128(ts.shifts.b);
+		const __m128i as = _mm_cvtsi32_si128(ts.shifts.a);
+		const __m128i mask = _mm_set1_epi32(0xFF);
+		const __m128i sat = _mm_set1_epi32(ts.sat);
+		const __m128i kr = _mm_set1_epi32(ts.k[0]);
+		const __m128i kg = _mm_set1_epi32(ts.k[1]);
+		const __m128i kb = _mm_set1_epi32(ts.k[2]);
+		const __m128i fr = _mm_set1_epi32(ts.f[0]);
+		const __m128i fg = _mm_set1_epi32(ts.f[1]);
+		const __m128i fb = _mm_set1_epi32(ts.f[2]);
+
+		for (int i = 0; i < height; ++i, pixels += stride) {
+			int j = 0;
+			for (; j + 4 <= width; j += 4) {
+				__m128i* p = reinterpret_cast<__m128i*>(pixels + j);
+				const __m128i v = _mm_loadu_si128(p);
+				__m128i r = _mm_and_si128(_mm_srl_epi32(v, rs), mask);
+				__m128i g = _mm_and_si128(_mm_srl_epi32(v, gs), mask);
+				__m128i b = _mm_and_si128(_mm_srl_epi32(v, bs), mask);
+				const __m128i a = _mm_and_si128(_mm_srl_epi32(v, as), mask);
+
+				if (ts.saturation) {
+					__m128i lum = _mm_add_epi32(_mm_mullo_epi32(b, _mm_set1_epi32(7471)),
+						_mm_add_epi32(_mm_mullo_epi32(g, _mm_set1_epi32(38470)), _mm_mullo_epi32(r, _mm_set1_epi32(19595))));
+					lum = _mm_srli_epi32(lum, 16);
+					const __m128i base = _mm_slli_epi32(lum, 10);
+					r = SaturateSse41(r, lum, base, sat);
+					g = SaturateSse41(g, lum, base, sat);
+					b = SaturateSse41(b, lum, base, sat);
+				}
+				if (ts.color) {
+					r = HardLightSse41(r, kr, fr);
+					g = HardLightSse41(g, kg, fg);
+					b = HardLightSse41(b, kb, fb);
+				}
+
+				__m128i out = _mm_or_si128(
+					_mm_or_si128(_mm_sll_epi32(r, rs), _mm_sll_epi32(g, gs)),
+					_mm_or_si128(_mm_sll_epi32(b, bs), _mm_sll_epi32(a, as)));
+				if (ts.skip_transparent)
+					out = _mm_blendv_epi8(out, v, _mm_cmpeq_epi32(a, _mm_setzero_si128()));
+				_mm_storeu_si128(p, out);
+			}
+			ToneScalar(pixels + j, width - j, 1, 0, ts);
+		}
+	}
+
+	/** Signed division truncating towards zero, exact for |n| < 2^17 */
+	EP_TARGET("sse4.1") EP_ALWAYS_INLINE
+	__m128i DivSse41(__m128i n, __m128i d) {
+		return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(n), _mm_cvtepi32_ps(d)));
+	}
+
+	EP_TARGET("sse4.1")
+	void HueSse41(uint32_t* pixels, int count, int hue) {
+		const __m128i mask = _mm_set1_epi32(0xFF);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i c_255 = _mm_set1_epi32(0xFF);
+		const __m128i c_511 = _mm_set1_epi32(0x1FF);
+		const __m128i c_600 = _mm_set1_epi32(0x600);
+		const __m128i vhue = _mm_set1_epi32(hue);
+
+		int i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128i* p = reinterpret_cast<__m128i*>(pixels + i);
+			const __m128i v = _mm_loadu_si128(p);
+			__m128i r = _mm_srli_epi32(v, 24);
+			__m128i g = _mm_and_si128(_mm_srli_epi32(v, 16), mask);
+			__m128i b = _mm_and_si128(_mm_srli_epi32(v, 8), mask);
+			const __m128i a = _mm_and_si128(v, mask);
+
+			// RGB_to_HSL, ties resolve to the same sector as the scalar code
+			const __m128i r_gt_g = _mm_cmpgt_epi32(r, g);
+			const __m128i r_gt_b = _mm_cmpgt_epi32(r, b);
+			const __m128i g_gt_b = _mm_cmpgt_epi32(g, b);
+			const __m128i b_gt_r = _mm_cmpgt_epi32(b, r);
+			const __m128i b_gt_g = _mm_cmpgt_epi32(b, g);
+			const __m128i r_max = _mm_and_si128(r_gt_g, r_gt_b);
+			const __m128i b_max = _mm_andnot_si128(r_max, _mm_or_si128(r_gt_g, _mm_andnot_si128(g_gt_b, b_gt_r)));
+
+			const __m128i hi = _mm_max_epi32(_mm_max_epi32(r, g), b);
+			const __m128i lo = _mm_min_epi32(_mm_min_epi32(r, g), b);
+			const __m128i c = _mm_sub_epi32(hi, lo);
+			const __m128i l2 = _mm_add_epi32(hi, lo);
+
+			__m128i num = _mm_blendv_epi8(_mm_sub_epi32(b, r), _mm_sub_epi32(r, g), b_max);
+			num = _mm_blendv_epi8(num, _mm_sub_epi32(g, b), r_max);
+			__m128i off = _mm_blendv_epi8(_mm_set1_epi32(0x200), _mm_set1_epi32(0x400), b_max);
+			off = _mm_blendv_epi8(off, _mm_and_si128(b_gt_g, c_600), r_max);
+			__m128i h = _mm_add_epi32(DivSse41(_mm_slli_epi32(num, 8), c), off);
+			h = _mm_andnot_si128(_mm_cmpeq_epi32(c, zero), h);
+
+			const __m128i d = _mm_blendv_epi8(l2, _mm_sub_epi32(c_511, l2), _mm_cmpgt_epi32(l2, c_255));
+			__m128i s = _mm_min_epi32(DivSse41(_mm_slli_epi32(c, 8), d), c_255);
+			s = _mm_andnot_si128(_mm_cmpeq_epi32(l2, zero), s);
+
+			// HSL_adjust, l is always in range
+			h = _mm_add_epi32(h, vhue);
+			h = _mm_sub_epi32(h, _mm_andnot_si128(_mm_cmpgt_epi32(c_600, h), c_600));
+
+			// HSL_to_RGB
+			const __m128i l2e = _mm_slli_epi32(_mm_srli_epi32(l2, 1), 1);
+			const __m128i d2 = _mm_blendv_epi8(l2e, _mm_sub_epi32(c_511, l2e), _mm_cmpgt_epi32(l2e, c_255));
+			const __m128i cc = _mm_srli_epi32(_mm_mullo_epi32(s, d2), 8);
+			const __m128i m = _mm_srli_epi32(_mm_sub_epi32(l2e, cc), 1);
+			const __m128i h0 = _mm_and_si128(h, mask);
+			const __m128i h1 = _mm_sub_epi32(c_255, h0);
+			const __m128i x = _mm_add_epi32(m, cc);
+			const __m128i up = _mm_add_epi32(m, _mm_srli_epi32(_mm_mullo_epi32(h0, cc), 8));
+			const __m128i dn = _mm_add_epi32(m, _mm_srli_epi32(_mm_mullo_epi32(h1, cc), 8));
+			const __m128i sector = _mm_srli_epi32(h, 8);
+			const __m128i s0 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(0));
+			const __m128i s1 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(1));
+			const __m128i s2 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(2));
+			const __m128i s3 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(3));
+			const __m128i s4 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(4));
+			const __m128i s5 = _mm_cmpeq_epi32(sector, _mm_set1_epi32(5));
+
+			r = _mm_blendv_epi8(m, x, _mm_or_si128(s0, s5));
+			r = _mm_blendv_epi8(r, dn, s1);
+			r = _mm_blendv_epi8(r, up, s4);
+			g = _mm_blendv_epi8(m, x, _mm_or_si128(s1, s2));
+			g = _mm_blendv_epi8(g, up, s0);
+			g = _mm_blendv_epi8(g, dn, s3);
+			b = _mm_blendv_epi8(m, x, _mm_or_si128(s3, s4));
+			b = _mm_blendv_epi8(b, up, s2);
+			b = _mm_blendv_epi8(b, dn, s5);
+
+			__m128i out = _mm_or_si128(
+				_mm_or_si128(_mm_slli_epi32(r, 24), _mm_slli_epi32(g, 16)),
+				_mm_or_si128(_mm_slli_epi32(b, 8), a));
+			out = _mm_blendv_epi8(out, v, _mm_cmpeq_epi32(a, zero));
+			_mm_storeu_si128(p, out);
+		}
+		HueScalar(pixels + i, count - i, hue);
+	}
+
+	EP_TARGET("avx2") EP_ALWAYS_INLINE
+	__m256i SaturateAvx2(__m256i c, __m256i lum, __m256i base, __m256i sat) {
+		__m256i v = _mm256_srai_epi32(_mm256_add_epi32(base, _mm256_mullo_epi32(_mm256_sub_epi32(c, lum), sat)), 10);
+		return _mm256_min_epi32(_mm256_max_epi32(v, _mm256_setzero_si256()), _mm256_set1_epi32(255));
+	}
+
+	EP_TARGET("avx2") EP_ALWAYS_INLINE
+	__m256i HardLightAvx2(__m256i c, __m256i k, __m256i f) {
+		__m256i v = _mm256_mullo_epi32(_mm256_mullo_epi32(k, _mm256_xor_si256(c, f)), _mm256_set1_epi32(0x8081));
+		return _mm256_min_epi32(_mm256_xor_si256(_mm256_srli_epi32(v, 23), f), _mm256_set1_epi32(255));
+	}
+
+	EP_TARGET("avx2")
+	void ToneAvx2(uint32_t* pixels, int width, int height, int stride, const ToneSetup& ts) {
+		const __m128i rs = _mm_cvtsi32_si128(ts.shifts.r);
+		const __m128i gs = _mm_cvtsi32_si128(ts.shifts.g);
+		const __m128i bs = _mm_cvtsi32_si128(ts.shifts.b);
+		const __m128i as = _mm_cvtsi32_si128(ts.shifts.a);
+		const __m256i mask = _mm256_set1_epi32(0xFF);
+		const __m256i sat = _mm256_set1_epi32(ts.sat);
+		const __m256i kr = _mm256_set1_epi32(ts.k[0]);
+		const __m256i kg = _mm256_set1_epi32(ts.k[1]);
+		const __m256i kb = _mm256_set1_epi32(ts.k[2]);
+		const __m256i fr = _mm256_set1_epi32(ts.f[0]);
+		const __m256i fg = _mm256_set1_epi32(ts.f[1]);
+		const __m256i fb = _mm256_set1_epi32(ts.f[2]);
+
+		for (int i = 0; i < height; ++i, pixels += stride) {
+			int j = 0;
+			for (; j + 8 <= width; j += 8) {
+				__m256i* p = reinterpret_cast<__m256i*>(pixels + j);
+				const __m256i v = _mm256_loadu_si256(p);
+				__m256i r = _mm256_and_si256(_mm256_srl_epi32(v, rs), mask);
+				__m256i g = _mm256_and_si256(_mm256_srl_epi32(v, gs), mask);
+				__m256i b = _mm256_and_si256(_mm256_srl_epi32(v, bs), mask);
+				const __m256i a = _mm256_and_si256(_mm256_srl_epi32(v, as), mask);
+
+				if (ts.saturation) {
+					__m256i lum = _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(7471)),
+						_mm256_add_epi32(_mm256_mullo_epi32(g, _mm256_set1_epi32(38470)), _mm256_mullo_epi32(r, _mm256_set1_epi32(19595))));
+					lum = _mm256_srli_epi32(lum, 16);
+					const __m256i base = _mm256_slli_epi32(lum, 10);
+					r = SaturateAvx2(r, lum, base, sat);
+					g = SaturateAvx2(g, lum, base, sat);
+					b = SaturateAvx2(b, lum, base, sat);
+				}
+				if (ts.color) {
+					r = HardLightAvx2(r, kr, fr);
+					g = HardLightAvx2(g, kg, fg);
+					b = HardLightAvx2(b, kb, fb);
+				}
+
+				__m256i out = _mm256_or_si256(
+					_mm256_or_si256(_mm256_sll_epi32(r, rs), _mm256_sll_epi32(g, gs)),
+					_mm256_or_si256(_mm256_sll_epi32(b, bs), _mm256_sll_epi32(a, as)));
+				if (ts.skip_transparent)
+					out = _mm256_blendv_epi8(out, v, _mm256_cmpeq_epi32(a, _mm256_setzero_si256()));
+				_mm256_storeu_si256(p, out);
+			}
+			ToneScalar(pixels + j, width - j, 1, 0, ts);
+		}
+	}
+
+	EP_TARGET("avx2") EP_ALWAYS_INLINE
+	__m256i DivAvx2(__m256i n, __m256i d) {
+		return _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(n), _mm256_cvtepi32_ps(d)));
+	}
+
+	EP_TARGET("avx2")
+	void HueAvx2(uint32_t* pixels, int count, int hue) {
+		const __m256i mask = _mm256_set1_epi32(0xFF);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i c_255 = _mm256_set1_epi32(0xFF);
+		const __m256i c_511 = _mm256_set1_epi32(0x1FF);
+		const __m256i c_600 = _mm256_set1_epi32(0x600);
+		const __m256i vhue = _mm256_set1_epi32(hue);
+
+		int i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m256i* p = reinterpret_cast<__m256i*>(pixels + i);
+			const __m256i v = _mm256_loadu_si256(p);
+			__m256i r = _mm256_srli_epi32(v, 24);
+			__m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 16), mask);
+			__m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 8), mask);
+			const __m256i a = _mm256_and_si256(v, mask);
+
+			const __m256i r_gt_g = _mm256_cmpgt_epi32(r, g);
+			const __m256i r_gt_b = _mm256_cmpgt_epi32(r, b);
+			const __m256i g_gt_b = _mm256_cmpgt_epi32(g, b);
+			const __m256i b_gt_r = _mm256_cmpgt_epi32(b, r);
+			const __m256i b_gt_g = _mm256_cmpgt_epi32(b, g);
+			const __m256i r_max = _mm256_and_si256(r_gt_g, r_gt_b);
+			const __m256i b_max = _mm256_andnot_si256(r_max, _mm256_or_si256(r_gt_g, _mm256_andnot_si256(g_gt_b, b_gt_r)));
+
+			const __m256i hi = _mm256_max_epi32(_mm256_max_epi32(r, g), b);
+			const __m256i lo = _mm256_min_epi32(_mm256_min_epi32(r, g), b);
+			const __m256i c = _mm256_sub_epi32(hi, lo);
+			const __m256i l2 = _mm256_add_epi32(hi, lo);
+
+			__m256i num = _mm256_blendv_epi8(_mm256_sub_epi32(b, r), _mm256_sub_epi32(r, g), b_max);
+			num = _mm256_blendv_epi8(num, _mm256_sub_epi32(g, b), r_max);
+			__m256i off = _mm256_blendv_epi8(_mm256_set1_epi32(0x200), _mm256_set1_epi32(0x400), b_max);
+			off = _mm256_blendv_epi8(off, _mm256_and_si256(b_gt_g, c_600), r_max);
+			__m256i h = _mm256_add_epi32(DivAvx2(_mm256_slli_epi32(num, 8), c), off);
+			h = _mm256_andnot_si256(_mm256_cmpeq_epi32(c, zero), h);
+
+			const __m256i d = _mm256_blendv_epi8(l2, _mm256_sub_epi32(c_511, l2), _mm256_cmpgt_epi32(l2, c_255));
+			__m256i s = _mm256_min_epi32(DivAvx2(_mm256_slli_epi32(c, 8), d), c_255);
+			s = _mm256_andnot_si256(_mm256_cmpeq_epi32(l2, zero), s);
+
+			h = _mm256_add_epi32(h, vhue);
+			h = _mm256_sub_epi32(h, _mm256_andnot_si256(_mm256_cmpgt_epi32(c_600, h), c_600));
+
+			const __m256i l2e = _mm256_slli_epi32(_mm256_srli_epi32(l2, 1), 1);
+			const __m256i d2 = _mm256_blendv_epi8(l2e, _mm256_sub_epi32(c_511, l2e), _mm256_cmpgt_epi32(l2e, c_255));
+			const __m256i cc = _mm256_srli_epi32(_mm256_mullo_epi32(s, d2), 8);
+			const __m256i m = _mm256_srli_epi32(_mm256_sub_epi32(l2e, cc), 1);
+			const __m256i h0 = _mm256_and_si256(h, mask);
+			const __m256i h1 = _mm256_sub_epi32(c_255, h0);
+			const __m256i x = _mm256_add_epi32(m, cc);
+			const __m256i up = _mm256_add_epi32(m, _mm256_srli_epi32(_mm256_mullo_epi32(h0, cc), 8));
+			const __m256i dn = _mm256_add_epi32(m, _mm256_srli_epi32(_mm256_mullo_epi32(h1, cc), 8));
+			const __m256i sector = _mm256_srli_epi32(h, 8);
+			const __m256i s0 = _mm256_cmpeq_epi32(sector, _mm256_set1_epi32(0));
+			const __m256i s1 = _mm256_cmpeq_epi32(sector, _mm256_set1_epi32(1));
+			const __m256i s2 = _mm256_cmpeq_epi32(sector, _mm256_set1_epi32(2));
+			const __m256i s3 = _mm256_cmpeq_epi32(sector, _mm256_set1_epi32(3));
+			const __m256i s4 = _mm256_cmpeq_epi32(sector, _mm256_set1_epi32(4));
+			const __m256i s5 = _mm256_cmpeq_epi32(sector, _mm256_set1_epi32(5));
+
+			r = _mm256_blendv_epi8(m, x, _mm256_or_si256(s0, s5));
+			r = _mm256_blendv_epi8(r, dn, s1);
+			r = _mm256_blendv_epi8(r, up, s4);
+			g = _mm256_blendv_epi8(m, x, _mm256_or_si256(s1, s2));
+			g = _mm256_blendv_epi8(g, up, s0);
+			g = _mm256_blendv_epi8(g, dn, s3);
+			b = _mm256_blendv_epi8(m, x, _mm256_or_si256(s3, s4));
+			b = _mm256_blendv_epi8(b, up, s2);
+			b = _mm256_blendv_epi8(b, dn, s5);
+
+			__m256i out = _mm256_or_si256(
+				_mm256_or_si256(_mm256_slli_epi32(r, 24), _mm256_slli_epi32(g, 16)),
+				_mm256_or_si256(_mm256_slli_epi32(b, 8), a));
+			out = _mm256_blendv_epi8(out, v, _mm256_cmpeq_epi32(a, zero));
+			_mm256_storeu_si256(p, out);
+		}
+		HueScalar(pixels + i, count - i, hue);
+	}
+	EP_TARGET("sse4.1") EP_ALWAYS_INLINE
+	int OpacityFlagsSse41(const uint32_t* p, int n, __m128i mask_v, uint32_t mask, int flags) {
+		const __m128i* v = reinterpret_cast<const __m128i*>(p);
+		int i = 0;
+		// 16 pixels between the early exit checks
+		for (; i + 16 <= n && flags != Opacity_Partial; i += 16, v += 4) {
+			const __m128i v0 = _mm_loadu_si128(v);
+			const __m128i v1 = _mm_loadu_si128(v + 1);
+			const __m128i v2 = _mm_loadu_si128(v + 2);
+			const __m128i v3 = _mm_loadu_si128(v + 3);
+			const __m128i any = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+			const __m128i all = _mm_and_si128(_mm_and_si128(v0, v1), _mm_and_si128(v2, v3));
+			flags |= (_mm_testz_si128(any, mask_v) ? 0 : Opacity_Visible)
+				| (_mm_testc_si128(all, mask_v) ? 0 : Opacity_Translucent);
+		}
+		// the rest is shorter than a check interval
+		if (i + 4 <= n && flags != Opacity_Partial) {
+			__m128i any = _mm_setzero_si128();
+			__m128i all = mask_v;
+			for (; i + 4 <= n; i += 4, ++v) {
+				const __m128i v0 = _mm_loadu_si128(v);
+				any = _mm_or_si128(any, v0);
+				all = _mm_and_si128(all, v0);
+			}
+			flags |= (_mm_testz_si128(any, mask_v) ? 0 : Opacity_Visible)
+				| (_mm_testc_si128(all, mask_v) ? 0 : Opacity_Translucent);
+		}
+		if (i < n && flags != Opacity_Partial)
+			flags = OpacityFlagsScalar(p + i, n - i, mask, flags);
+		return flags;
+	}
+
+	EP_TARGET("sse4.1")
+	void OpacitySse41(const uint32_t* pixels, int segments, int length, uint32_t mask, int* flags) {
+		const __m128i m = _mm_set1_epi32(static_cast<int>(mask));
+		for (int s = 0; s < segments; ++s, pixels += length) {
+			if (flags[s] != Opacity_Partial)
+				flags[s] = OpacityFlagsSse41(pixels, length, m, mask, flags[s]);
+		}
+	}
+
+	EP_TARGET("avx2") EP_ALWAYS_INLINE
+	int OpacityFlagsAvx2(const uint32_t* p, int n, __m256i mask_v, uint32_t mask, int flags) {
+		const __m256i* v = reinterpret_cast<const __m256i*>(p);
+		int i = 0;
+		// 32 pixels between the early exit checks
+		for (; i + 32 <= n && flags != Opacity_Partial; i += 32, v += 4) {
+			const __m256i v0 = _mm256_loadu_si256(v);
+			const __m256i v1 = _mm256_loadu_si256(v + 1);
+			const __m256i v2 = _mm256_loadu_si256(v + 2);
+			const __m256i v3 = _mm256_loadu_si256(v + 3);
+			const __m256i any = _mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3));
+			const __m256i all = _mm256_and_si256(_mm256_and_si256(v0, v1), _mm256_and_si256(v2, v3));
+			flags |= (_mm256_testz_si256(any, mask_v) ? 0 : Opacity_Visible)
+				| (_mm256_testc_si256(all, mask_v) ? 0 : Opacity_Translucent);
+		}
+		// tile rows of 16 pixels end up here
+		if (i + 16 <= n && flags != Opacity_Partial) {
+			const __m256i v0 = _mm256_loadu_si256(v);
+			const __m256i v1 = _mm256_loadu_si256(v + 1);
+			flags |= (_mm256_testz_si256(_mm256_or_si256(v0, v1), mask_v) ? 0 : Opacity_Visible)
+				| (_mm256_testc_si256(_mm256_and_si256(v0, v1), mask_v) ? 0 : Opacity_Translucent);
+			i += 16;
+			v += 2;
+		}
+		if (i + 8 <= n && flags != Opacity_Partial) {
+			__m256i any = _mm256_setzero_si256();
+			__m256i all = mask_v;
+			for (; i + 8 <= n; i += 8, ++v) {
+				const __m256i v0 = _mm256_loadu_si256(v);
+				any = _mm256_or_si256(any, v0);
+				all = _mm256_and_si256(all, v0);
+			}
+			flags |= (_mm256_testz_si256(any, mask_v) ? 0 : Opacity_Visible)
+				| (_mm256_testc_si256(all, mask_v) ? 0 : Opacity_Translucent);
+		}
+		if (i < n && flags != Opacity_Partial)
+			flags = OpacityFlagsScalar(p + i, n - i, mask, flags);
+		return flags;
+	}
+
+	EP_TARGET("avx2")
+	void OpacityAvx2(const uint32_t* pixels, int segments, int length, uint32_t mask, int* flags) {
+		const __m256i m = _mm256_set1_epi32(static_cast<int>(mask));
+		for (int s = 0; s < segments; ++s, pixels += length) {
+			if (flags[s] != Opacity_Partial)
+				flags[s] = OpacityFlagsAvx2(pixels, length, m, mask, flags[s]);
+		}
+	}
+#endif
+
+#ifdef EP_SIMD_NEON
+	inline int32x4_t SaturateNeon(int32x4_t c, int32x4_t lum, int32x4_t base, int32x4_t sat) {
+		int32x4_t v = vshrq_n_s32(vmlaq_s32(base, vsubq_s32(c, lum), sat), 10);
+		return vminq_s32(vmaxq_s32(v, vdupq_n_s32(0)), vdupq_n_s32(255));
+	}
+
+	inline uint32x4_t HardLightNeon(uint32x4_t c, uint32x4_t k, uint32x4_t f) {
+		uint32x4_t v = vmulq_n_u32(vmulq_u32(k, veorq_u32(c, f)), 0x8081);
+		return vminq_u32(veorq_u32(vshrq_n_u32(v, 23), f), vdupq_n_u32(255));
+	}
+
+	void ToneNeon(uint32_t* pixels, int width, int height, int stride, const ToneSetup& ts) {
+		const int32x4_t rs = vdupq_n_s32(ts.shifts.r);
+		const int32x4_t gs = vdupq_n_s32(ts.shifts.g);
+		const int32x4_t bs = vdupq_n_s32(ts.shifts.b);
+		const int32x4_t as = vdupq_n_s32(ts.shifts.a);
+		// vshlq shifts right for negative counts
+		const int32x4_t rs_right = vnegq_s32(rs);
+		const int32x4_t gs_right = vnegq_s32(gs);
+		const int32x4_t bs_right = vnegq_s32(bs);
+		const int32x4_t as_right = vnegq_s32(as);
+		const uint32x4_t mask = vdupq_n_u32(0xFF);
+		const int32x4_t sat = vdupq_n_s32(ts.sat);
+		const uint32x4_t kr = vdupq_n_u32(ts.k[0]);
+		const uint32x4_t kg = vdupq_n_u32(ts.k[1]);
+		const uint32x4_t kb = vdupq_n_u32(ts.k[2]);
+		const uint32x4_t fr = vdupq_n_u32(ts.f[0]);
+		const uint32x4_t fg = vdupq_n_u32(ts.f[1]);
+		const uint32x4_t fb = vdupq_n_u32(ts.f[2]);
+
+		for (int i = 0; i < height; ++i, pixels += stride) {
+			int j = 0;
+			for (; j + 4 <= width; j += 4) {
+				const uint32x4_t v = vld1q_u32(pixels + j);
+				uint32x4_t r = vandq_u32(vshlq_u32(v, rs_right), mask);
+				uint32x4_t g = vandq_u32(vshlq_u32(v, gs_right), mask);
+				uint32x4_t b = vandq_u32(vshlq_u32(v, bs_right), mask);
+				const uint32x4_t a = vandq_u32(vshlq_u32(v, as_right), mask);
+
+				if (ts.saturation) {
+					uint32x4_t lum = vmulq_n_u32(b, 7471);
+					lum = vmlaq_n_u32(lum, g, 38470);
+					lum = vmlaq_n_u32(lum, r, 19595);
+					const int32x4_t lum_s = vreinterpretq_s32_u32(vshrq_n_u32(lum, 16));
+					const int32x4_t base = vshlq_n_s32(lum_s, 10);
+					r = vreinterpretq_u32_s32(SaturateNeon(vreinterpretq_s32_u32(r), lum_s, base, sat));
+					g = vreinterpretq_u32_s32(SaturateNeon(vreinterpretq_s32_u32(g), lum_s, base, sat));
+					b = vreinterpretq_u32_s32(SaturateNeon(vreinterpretq_s32_u32(b), lum_s, base, sat));
+				}
+				if (ts.color) {
+					r = HardLightNeon(r, kr, fr);
+					g = HardLightNeon(g, kg, fg);
+					b = HardLightNeon(b, kb, fb);
+				}
+
+				uint32x4_t out = vorrq_u32(
+					vorrq_u32(vshlq_u32(r, rs), vshlq_u32(g, gs)),
+					vorrq_u32(vshlq_u32(b, bs), vshlq_u32(a, as)));
+				if (ts.skip_transparent)
+					out = vbslq_u32(vceqq_u32(a, vdupq_n_u32(0)), v, out);
+				vst1q_u32(pixels + j, out);
+			}
+			ToneScalar(pixels + j, width - j, 1, 0, ts);
+		}
+	}
+	inline bool AnyBitSet(uint32x4_t v) {
+		const uint32x2_t r = vorr_u32(vget_low_u32(v), vget_high_u32(v));
+		return (vget_lane_u32(r, 0) | vget_lane_u32(r, 1)) != 0;
+	}
+
+	void OpacityNeon(const uint32_t* pixels, int segments, int length, uint32_t mask, int* flags) {
+		const uint32x4_t m = vdupq_n_u32(mask);
+		for (int s = 0; s < segments; ++s, pixels += length) {
+			int f = flags[s];
+			int i = 0;
+			for (; i + 16 <= length && f != Opacity_Partial; i += 16) {
+				const uint32x4_t v0 = vld1q_u32(pixels + i);
+				const uint32x4_t v1 = vld1q_u32(pixels + i + 4);
+				const uint32x4_t v2 = vld1q_u32(pixels + i + 8);
+				const uint32x4_t v3 = vld1q_u32(pixels + i + 12);
+				const uint32x4_t any = vorrq_u32(vorrq_u32(v0, v1), vorrq_u32(v2, v3));
+				const uint32x4_t all = vandq_u32(vandq_u32(v0, v1), vandq_u32(v2, v3));
+				if (AnyBitSet(vandq_u32(any, m)))
+					f |= Opacity_Visible;
+				if (AnyBitSet(vbicq_u32(m, all)))
+					f |= Opacity_Translucent;
+			}
+			if (i < length && f != Opacity_Partial)
+				f = OpacityFlagsScalar(pixels + i, length - i, mask, f);
+			flags[s] = f;
+		}
+	}
+#endif
+
+	using ToneFn = void (*)(uint32_t* pixels, int width, int height, int stride, const ToneSetup& ts);
+	using HueFn = void (*)(uint32_t* pixels, int count, int hue);
+	/** Updates the opacity flags of consecutive segments of length pixels */
+	using OpacityFn = void (*)(const uint32_t* pixels, int segments, int length, uint32_t mask, int* flags);
+
+	struct Functions {
+		ToneFn tone;
+		HueFn hue;
+		OpacityFn opacity;
+	};
+
+	Functions GetFunctions(Kernel k) {
+		switch (k) {
+			case Kernel::Scalar:
+				break;
+			case Kernel::Sse41:
+#ifdef EP_SIMD_X86
+				return { ToneSse41, HueSse41, OpacitySse41 };
+#else
+				break;
+#endif
+			case Kernel::Avx2:
+#ifdef EP_SIMD_X86
+				return { ToneAvx2, HueAvx2, OpacityAvx2 };
+#else
+				break;
+#endif
+			case Kernel::Neon:
+#ifdef EP_SIMD_NEON
+				// hue rotation is rare enough to stay scalar here
+				return { ToneNeon, HueScalar, OpacityNeon };
+#else
+				break;
+#endif
+		}
+		return { ToneScalar, HueScalar, OpacityScalar };
+	}
+
+	Kernel DefaultKernel() {
+		for (auto k: { Kernel::Avx2, Kernel::Sse41, Kernel::Neon }) {
+			if (IsSupported(k))
+				return k;
+		}
+		return Kernel::Scalar;
+	}
+
+	Kernel kernel = DefaultKernel();
+	Functions functions = GetFunctions(kernel);
+}
+
+bool BitmapKernels::IsSupported(Kernel k) {
+	switch (k) {
+		case Kernel::Scalar:
+			return true;
+		case Kernel::Sse41:
+#ifdef EP_SIMD_X86
+			return CpuFeatures::HasSse41();
+#else
+			return false;
+#endif
+		case Kernel::Avx2:
+#ifdef EP_SIMD_X86
+			return CpuFeatures::HasAvx2();
+#else
+			return false;
+#endif
+		case Kernel::Neon:
+#ifdef EP_SIMD_NEON
+			return CpuFeatures::HasNeon();
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+void BitmapKernels::SetKernel(Kernel k) {
+	kernel = k;
+	functions = GetFunctions(k);
+}
+
+BitmapKernels::Kernel BitmapKernels::GetKernel() {
+	return kernel;
+}
+
+const char* BitmapKernels::GetKernelName(Kernel k) {
+	switch (k) {
+		case Kernel::Scalar:
+			return "Scalar";
+		case Kernel::Sse41:
+			return "SSE4.1";
+		case Kernel::Avx2:
+			return "AVX2";
+		case Kernel::Neon:
+			return "NEON";
+	}
+	return "";
+}
+
+void BitmapKernels::ToneRows(uint32_t* pixels, int width, int height, int stride,
+		const Tone& tone, const PixelShifts& shifts, bool skip_transparent) {
+	if (width <= 0 || height <= 0)
+		return;
+
+	functions.tone(pixels, width, height, stride, MakeToneSetup(tone, shifts, skip_transparent));
+}
+
+void BitmapKernels::HueRow(uint32_t* pixels, int count, int hue) {
+	if (count <= 0)
+		return;
+
+	functions.hue(pixels, count, hue);
+}
+
+ImageOpacity BitmapKernels::ComputeOpacity(const uint32_t* pixels, int width, int height, int stride, uint32_t alpha_mask) {
+	int flags = 0;
+	for (int y = 0; y < height && flags != Opacity_Partial; ++y, pixels += stride)
+		functions.opacity(pixels, 1, std::max(width, 0), alpha_mask, &flags);
+
+	return ToImageOpacity(flags);
+}
+
+void BitmapKernels::ComputeTileOpacity(const uint32_t* pixels, int tiles_w, int tiles_h, int tile_size, int stride, uint32_t alpha_mask, ImageOpacity* out) {
+	std::vector<int> flags(tiles_w);
+	for (int ty = 0; ty < tiles_h; ++ty) {
+		std::fill(flags.begin(), flags.end(), 0);
+		for (int y = 0; y < tile_size; ++y, pixels += stride)
+			functions.opacity(pixels, tiles_w, tile_size, alpha_mask, flags.data());
+
+		for (int tx = 0; tx < tiles_w; ++tx)
+			*out++ = ToImageOpacity(flags[tx]);
+	}
+}
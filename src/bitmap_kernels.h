@@ -0,0 +1,113 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EP_BITMAP_KERNELS_H
+#define EP_BITMAP_KERNELS_H
+
+#include <cstdint>
+#include "opacity.h"
+#include "tone.h"
+
+/**
+ * Per-pixel work of Bitmap that is not covered by pixman.
+ *
+ * Every kernel produces exactly the output of the scalar code. The fastest
+ * kernel supported by the CPU is selected at startup.
+ */
+namespace BitmapKernels {
+	enum class Kernel {
+		Scalar,
+		/** x86 SSE4.1, 4 pixels per step */
+		Sse41,
+		/** x86 AVX2, 8 pixels per step */
+		Avx2,
+		/** ARM NEON, 4 pixels per step */
+		Neon,
+	};
+
+	/** @return whether the kernel can run on this CPU */
+	bool IsSupported(Kernel k);
+
+	/** Selects the kernel used by all bitmaps, it must be supported. */
+	void SetKernel(Kernel k);
+	Kernel GetKernel();
+
+	/** @return name of the kernel for the log */
+	const char* GetKernelName(Kernel k);
+
+	/** Bit positions of the channels in a 32 bit pixel */
+	struct PixelShifts {
+		int r;
+		int g;
+		int b;
+		int a;
+	};
+
+	/**
+	 * Applies a tone to a block of pixels in place, saturation first and
+	 * then the color by hard light.
+	 *
+	 * @param pixels first pixel of the first row
+	 * @param width pixels per row
+	 * @param height number of rows
+	 * @param stride distance between rows in pixels
+	 * @param tone tone to apply, must not be the neutral tone
+	 * @param shifts channel positions
+	 * @param skip_transparent leave pixels with alpha 0 untouched
+	 */
+	void ToneRows(uint32_t* pixels, int width, int height, int stride,
+			const Tone& tone, const PixelShifts& shifts, bool skip_transparent);
+
+	/**
+	 * Rotates the hue of pixels in the r << 24 | g << 16 | b << 8 | a format.
+	 * Pixels with alpha 0 are untouched.
+	 *
+	 * @param pixels pixels to change in place
+	 * @param count number of pixels
+	 * @param hue rotation in 1/256 of a sector, 0 to 0x600
+	 */
+	void HueRow(uint32_t* pixels, int count, int hue);
+
+	/**
+	 * Classifies a block of pixels by alpha. Stops reading at the first
+	 * evidence of partial opacity.
+	 *
+	 * @param pixels first pixel of the first row
+	 * @param width pixels per row
+	 * @param height number of rows
+	 * @param stride distance between rows in pixels
+	 * @param alpha_mask bits of the alpha channel
+	 * @return opacity, Transparent when there are no pixels
+	 */
+	ImageOpacity ComputeOpacity(const uint32_t* pixels, int width, int height, int stride, uint32_t alpha_mask);
+
+	/**
+	 * Classifies all tiles of a tileset in a single pass over its rows.
+	 *
+	 * @param pixels first pixel of the top left tile
+	 * @param tiles_w tiles per row
+	 * @param tiles_h number of tile rows
+	 * @param tile_size width and height of a tile in pixels
+	 * @param stride distance between rows in pixels
+	 * @param alpha_mask bits of the alpha channel
+	 * @param out receives tiles_w * tiles_h values in row major order
+	 */
+	void ComputeTileOpacity(const uint32_t* pixels, int tiles_w, int tiles_h, int tile_size, int stride, uint32_t alpha_mask, ImageOpacity* out);
+}
+
+#endif
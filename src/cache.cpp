@@ -20,10 +20,11 @@
 #  pragma warning(disable: 4003)
 #endif
 
-#include <map>
-#include <tuple>
+#include <array>
+#include <bitset>
 #include <chrono>
 #include <cassert>
+#include <cstdint>
 
 #include "async_handler.h"
 #include "cache.h"
@@ -31,96 +32,321 @@
 #include "exfont.h"
 #include "default_graphics.h"
 #include "bitmap.h"
+#include "decode_pool.h"
 #include "output.h"
 #include "player.h"
 #include <lcf/data.h>
 #include "game_clock.h"
-
-using namespace std::chrono_literals;
+#include "game_config.h"
+#include "open_hash_map.h"
+#include "utils.h"
 
 namespace {
 	std::string MakeHashKey(StringView folder_name, StringView filename, bool transparent) {
 		return ToString(folder_name) + ":" + ToString(filename) + ":" + (transparent ? "T" : " ");
 	}
 
-	std::string MakeTileHashKey(StringView chipset_name, int id) {
-		std::string key;
-		key.reserve(chipset_name.size() + sizeof(int) + 2);
-		key.append(reinterpret_cast<char*>(&id), sizeof(id));
-		key.append(1, ':');
-		key.append(chipset_name.begin(), chipset_name.end());
-
-		return key;
+	uint64_t HashMix(uint64_t h, uint64_t v) {
+		h ^= v + UINT64_C(0x9E3779B97F4A7C15) + (h << 6) + (h >> 2);
+		return h;
 	}
 
-	int IdFromTileHash(StringView key) {
-		int id = 0;
-		if (key.size() > sizeof(id)) {
-			std::memcpy(&id, key.data(), sizeof(id));
+	struct TileKey {
+		/** index into tile_chipsets */
+		uint32_t chipset;
+		int32_t id;
+
+		bool operator==(const TileKey& o) const {
+			return chipset == o.chipset && id == o.id;
 		}
-		return id;
-	}
+	};
 
-	const char* NameFromTileHash(StringView key) {
-		int offset = sizeof(int) + 1;
-		if (static_cast<int>(key.size()) < offset) {
-			return "";
+	struct TileKeyHash {
+		size_t operator()(const TileKey& k) const {
+			return static_cast<size_t>((static_cast<uint64_t>(k.chipset) << 32) | static_cast<uint32_t>(k.id));
 		}
-		return key.data() + offset;
-	}
+	};
+
+	struct EffectKey {
+		const Bitmap* src;
+		int32_t x, y, width, height;
+		int32_t red, green, blue, gray;
+		uint32_t blend;
+		uint32_t flip;
+
+		bool operator==(const EffectKey& o) const {
+			return src == o.src && x == o.x && y == o.y && width == o.width && height == o.height
+				&& red == o.red && green == o.green && blue == o.blue && gray == o.gray
+				&& blend == o.blend && flip == o.flip;
+		}
+	};
+
+	struct EffectKeyHash {
+		size_t operator()(const EffectKey& k) const {
+			uint64_t h = reinterpret_cast<uintptr_t>(k.src);
+			h = HashMix(h, (static_cast<uint64_t>(k.x) << 32) | static_cast<uint32_t>(k.y));
+			h = HashMix(h, (static_cast<uint64_t>(k.width) << 32) | static_cast<uint32_t>(k.height));
+			h = HashMix(h, (static_cast<uint64_t>(k.red) << 32) | static_cast<uint32_t>(k.green));
+			h = HashMix(h, (static_cast<uint64_t>(k.blue) << 32) | static_cast<uint32_t>(k.gray));
+			h = HashMix(h, (static_cast<uint64_t>(k.blend) << 32) | k.flip);
+			return static_cast<size_t>(h);
+		}
+	};
+
+	struct EffectEntry {
+		/** the source of the effect, the key only holds its address */
+		std::weak_ptr<Bitmap> src;
+		std::weak_ptr<Bitmap> bitmap;
+	};
+
+	struct Material {
+		enum Type {
+			REND = -1,
+			Backdrop,
+			Battle,
+			Charset,
+			Chipset,
+			Faceset,
+			Gameover,
+			Monster,
+			Panorama,
+			Picture,
+			System,
+			Title,
+			System2,
+			Battle2,
+			Battlecharset,
+			Battleweapon,
+			Frame,
+			END
+		};
+
+	}; // struct Material
 
 	struct CacheItem {
 		BitmapRef bitmap;
 		Game_Clock::time_point last_access;
+		size_t size = 0;
+		int tier = 0;
+		/** key of the entry in the cache map, node keys never move */
+		const std::string* key = nullptr;
+		/** LRU list of the tier, prev is more recently used */
+		CacheItem* prev = nullptr;
+		CacheItem* next = nullptr;
 	};
 
 	using key_type = std::string;
 	std::unordered_map<key_type, CacheItem> cache;
 
-	using tile_key_type = std::string;
-	std::unordered_map<tile_key_type, std::weak_ptr<Bitmap>> cache_tiles;
+	/**
+	 * Entries of one material, most recently used first. Bitmaps are freed
+	 * from the tail when the budget group of the tier or the whole cache
+	 * exceeds its budget.
+	 */
+	struct Tier {
+		CacheItem* head = nullptr;
+		CacheItem* tail = nullptr;
+		size_t size = 0;
+		size_t entries = 0;
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+	};
 
-	// rect, flip_x, flip_y, tone, blend
-	using effect_key_type = std::tuple<BitmapRef, Rect, bool, bool, Tone, Color>;
-	std::map<effect_key_type, std::weak_ptr<Bitmap>> cache_effects;
+	// one tier per material and one for the ExFont
+	constexpr int tier_exfont = Material::END;
+	constexpr int tier_count = Material::END + 1;
+	std::array<Tier, tier_count> tiers;
+
+	/** Materials sharing one budget of Game_ConfigCache */
+	enum BudgetGroup {
+		Group_Picture,
+		Group_Panorama,
+		Group_Charset,
+		Group_Chipset,
+		Group_Battle,
+		Group_Other,
+		Group_Count
+	};
 
-	std::string system_name;
+	constexpr int TierGroup(int tier) {
+		switch (tier) {
+			case Material::Picture:
+				return Group_Picture;
+			case Material::Panorama:
+				return Group_Panorama;
+			case Material::Charset:
+				return Group_Charset;
+			case Material::Chipset:
+				return Group_Chipset;
+			case Material::Backdrop:
+			case Material::Battle:
+			case Material::Battle2:
+			case Material::Battlecharset:
+			case Material::Battleweapon:
+			case Material::Monster:
+				return Group_Battle;
+			default:
+				return Group_Other;
+		}
+	}
 
-	std::string system2_name;
+	struct Group {
+		size_t size = 0;
+		/** 0 when only the total budget applies */
+		size_t budget = 0;
+	};
+	std::array<Group, Group_Count> groups;
 
-	constexpr int cache_limit = 10 * 1024 * 1024;
+	constexpr size_t MB = 1024 * 1024;
+	size_t cache_limit = 64 * MB;
 	size_t cache_size = 0;
 
-	void FreeBitmapMemory() {
-		auto cur_ticks = Game_Clock::GetFrameTime();
+	// Chipset names seen by Cache::Tile, tile keys store the index
+	std::vector<std::string> tile_chipsets;
+	OpenHashMap<TileKey, std::weak_ptr<Bitmap>, TileKeyHash> cache_tiles;
 
-		for (auto it = cache.begin(); it != cache.end();) {
-			if (it->second.bitmap.use_count() != 1) {
-				// Bitmap is referenced
-				++it;
-				continue;
+	OpenHashMap<EffectKey, EffectEntry, EffectKeyHash> cache_effects;
+
+	/**
+	 * Drops the entries whose bitmaps were freed before the table grows,
+	 * so it only grows when the live entries need the room.
+	 */
+	template <typename M, typename F>
+	void CompactBeforeGrow(M& map, F expired) {
+		if (!map.IsFull()) {
+			return;
+		}
+		size_t n = map.EraseIf(expired);
+		(void)n;
+#ifdef CACHE_DEBUG
+		Output::Debug("Purged {} expired entries, {} left", n, map.size());
+#endif
+	}
+
+	uint32_t TileChipsetIndex(StringView chipset_name) {
+		// Almost always the chipset of the current map
+		static size_t last = 0;
+		if (last < tile_chipsets.size() && tile_chipsets[last] == chipset_name) {
+			return static_cast<uint32_t>(last);
+		}
+		for (size_t i = 0; i < tile_chipsets.size(); ++i) {
+			if (tile_chipsets[i] == chipset_name) {
+				last = i;
+				return static_cast<uint32_t>(i);
 			}
+		}
+		tile_chipsets.push_back(ToString(chipset_name));
+		last = tile_chipsets.size() - 1;
+		return static_cast<uint32_t>(last);
+	}
 
-			auto last_access = cur_ticks - it->second.last_access;
-			bool cache_exhausted = cache_size > cache_limit;
-			if (cache_exhausted) {
-				if (last_access <= 50ms) {
-					// Used during the last 3 frames, must be important, keep it.
-					++it;
-					continue;
-				}
-			} else if (last_access <= 3s) {
-				++it;
+	/** Callbacks of images that are decoded on the decode pool */
+	std::unordered_map<std::string, std::vector<std::function<void()>>> preloading;
+
+	std::string system_name;
+
+	std::string system2_name;
+
+	void Unlink(CacheItem& item) {
+		auto& tier = tiers[item.tier];
+		(item.prev ? item.prev->next : tier.head) = item.next;
+		(item.next ? item.next->prev : tier.tail) = item.prev;
+		item.prev = item.next = nullptr;
+	}
+
+	void PushFront(CacheItem& item) {
+		auto& tier = tiers[item.tier];
+		item.prev = nullptr;
+		item.next = tier.head;
+		(tier.head ? tier.head->prev : tier.tail) = &item;
+		tier.head = &item;
+	}
+
+	BitmapRef Touch(CacheItem& item) {
+		auto& tier = tiers[item.tier];
+		item.last_access = Game_Clock::GetFrameTime();
+		++tier.hits;
+		if (tier.head != &item) {
+			Unlink(item);
+			PushFront(item);
+		}
+		return item.bitmap;
+	}
+
+	void Remove(CacheItem& item) {
+		auto& tier = tiers[item.tier];
+		Unlink(item);
+		tier.size -= item.size;
+		--tier.entries;
+		groups[TierGroup(item.tier)].size -= item.size;
+		cache_size -= item.size;
+	}
+
+	/**
+	 * Frees the least recently used bitmap of a tier that is not referenced
+	 * anymore. Referenced bitmaps passed on the way are in use, so they
+	 * count as used and move to the front.
+	 *
+	 * @return false when every bitmap of the tier is in use
+	 */
+	bool EvictOne(Tier& tier) {
+		for (size_t n = tier.entries; n > 0; --n) {
+			CacheItem& item = *tier.tail;
+			if (item.bitmap.use_count() != 1) {
+				Unlink(item);
+				PushFront(item);
 				continue;
 			}
 
 #ifdef CACHE_DEBUG
-			Output::Debug("Freeing memory of {}/{}", std::get<0>(i.first), std::get<1>(i.first));
+			Output::Debug("Freeing memory of {}", *item.key);
 #endif
+			++tier.evictions;
+			Remove(item);
+			cache.erase(*item.key);
+			return true;
+		}
+		return false;
+	}
 
-			cache_size -= it->second.bitmap->GetSize();
+	/**
+	 * Frees the oldest unreferenced bitmap of the selected tiers.
+	 *
+	 * @param group budget group of the tiers, Group_Count selects all tiers
+	 * @return false when every bitmap of the tiers is in use
+	 */
+	bool EvictOldest(int group) {
+		std::bitset<tier_count> exhausted;
+		for (;;) {
+			int oldest = -1;
+			for (int i = 0; i < tier_count; ++i) {
+				auto* tail = tiers[i].tail;
+				if (exhausted[i] || !tail || (group != Group_Count && TierGroup(i) != group))
+					continue;
+				if (oldest < 0 || tail->last_access < tiers[oldest].tail->last_access)
+					oldest = i;
+			}
+			if (oldest < 0)
+				return false;
+			if (EvictOne(tiers[oldest]))
+				return true;
+			exhausted[oldest] = true;
+		}
+	}
+
+	void FreeBitmapMemory(int tier_id) {
+		const int group_id = TierGroup(tier_id);
+		auto& group = groups[group_id];
+		while (group.budget > 0 && group.size > group.budget) {
+			if (!EvictOldest(group_id))
+				break;
+		}
 
-			it = cache.erase(it);
+		// over the total budget the oldest bitmap of all tiers goes first
+		while (cache_size > cache_limit) {
+			if (!EvictOldest(Group_Count))
+				break;
 		}
 
 #ifdef CACHE_DEBUG
@@ -128,40 +354,35 @@ namespace {
 #endif
 	}
 
-	BitmapRef AddToCache(const std::string& key, BitmapRef bmp) {
-		if (bmp) {
-			cache_size += bmp->GetSize();
-#ifdef CACHE_DEBUG
-			Output::Debug("Bitmap cache size (Add): {}", cache_size / 1024.0 / 1024.0);
-#endif
+	BitmapRef AddToCache(const std::string& key, BitmapRef bmp, int tier_id) {
+		auto ins = cache.try_emplace(key);
+		auto& item = ins.first->second;
+		if (!ins.second) {
+			Remove(item);
 		}
 
-		return (cache[key] = {bmp, Game_Clock::GetFrameTime()}).bitmap;
-	}
+		auto& tier = tiers[tier_id];
+		item.bitmap = bmp;
+		item.last_access = Game_Clock::GetFrameTime();
+		item.size = bmp ? bmp->GetSize() : 0;
+		item.tier = tier_id;
+		item.key = &ins.first->first;
+		PushFront(item);
+		tier.size += item.size;
+		++tier.entries;
+		++tier.misses;
+		groups[TierGroup(tier_id)].size += item.size;
+		cache_size += item.size;
 
-	struct Material {
-		enum Type {
-			REND = -1,
-			Backdrop,
-			Battle,
-			Charset,
-			Chipset,
-			Faceset,
-			Gameover,
-			Monster,
-			Panorama,
-			Picture,
-			System,
-			Title,
-			System2,
-			Battle2,
-			Battlecharset,
-			Battleweapon,
-			Frame,
-			END
-		};
+#ifdef CACHE_DEBUG
+		Output::Debug("Bitmap cache size (Add): {}", cache_size / 1024.0 / 1024.0);
+#endif
 
-	}; // struct Material
+		// bmp holds a reference, so the new entry itself is never freed here
+		FreeBitmapMemory(tier_id);
+
+		return bmp;
+	}
 
 	using DummyRenderer = BitmapRef(*)();
 
@@ -256,8 +477,6 @@ namespace {
 			if (!bmp) {
 				auto is = FileFinder::OpenImage(s.directory, filename);
 
-				FreeBitmapMemory();
-
 				if (!is) {
 					if (s.warn_missing) {
 						Output::Warning("Image not found: {}/{}", s.directory, filename);
@@ -281,10 +500,9 @@ namespace {
 				bmp = LoadDummyBitmap<T>(s.directory, filename, transparent);
 			}
 
-			bmp = AddToCache(key, bmp);
+			bmp = AddToCache(key, bmp, T);
 		} else {
-			it->second.last_access = Game_Clock::GetFrameTime();
-			bmp = it->second.bitmap;
+			bmp = Touch(it->second);
 		}
 
 		assert(bmp);
@@ -385,6 +603,76 @@ BitmapRef Cache::System(StringView file) {
 	return LoadBitmap<Material::System>(file);
 }
 
+namespace {
+	/** @return material of the directory, Material::END when there is none */
+	int FindMaterial(StringView folder_name) {
+		for (int i = 0; i < Material::END; ++i) {
+			if (folder_name == spec[i].directory) {
+				return i;
+			}
+		}
+		return Material::END;
+	}
+}
+
+void Cache::Preload(StringView folder_name, StringView filename, std::function<void()> done) {
+	const int material = FindMaterial(folder_name);
+	const bool transparent = material != Material::END && spec[material].transparent;
+	Preload(folder_name, filename, transparent, std::move(done));
+}
+
+void Cache::Preload(StringView folder_name, StringView filename, bool transparent, std::function<void()> done) {
+	const int material = FindMaterial(folder_name);
+	if (material == Material::END || filename == CACHE_DEFAULT_BITMAP) {
+		done();
+		return;
+	}
+
+	const Spec& s = spec[material];
+	auto key = MakeHashKey(s.directory, filename, transparent);
+	if (cache.find(key) != cache.end()) {
+		done();
+		return;
+	}
+
+	auto it = preloading.find(key);
+	if (it != preloading.end()) {
+		it->second.push_back(std::move(done));
+		return;
+	}
+
+	// Missing images are reported when they are loaded
+	auto is = FileFinder::OpenImage(s.directory, filename);
+	if (!is) {
+		done();
+		return;
+	}
+
+	// The file is read here, filesystems are not thread safe
+	auto data = std::make_shared<std::vector<uint8_t>>(Utils::ReadStream(is));
+	auto bmp = std::make_shared<BitmapRef>();
+	const uint32_t flags = Bitmap::Flag_ReadOnly | (
+			material == Material::Chipset ? Bitmap::Flag_Chipset :
+			material == Material::System ? Bitmap::Flag_System : 0);
+
+	preloading[key].push_back(std::move(done));
+
+	DecodePool::Submit([data, bmp, transparent, flags]() {
+			*bmp = Bitmap::Create(data->data(), data->size(), transparent, flags);
+		}, [key, bmp, material]() {
+			// Invalid images are reported when they are loaded
+			if (*bmp && cache.find(key) == cache.end()) {
+				AddToCache(key, *bmp, material);
+			}
+
+			auto callbacks = std::move(preloading[key]);
+			preloading.erase(key);
+			for (auto& callback : callbacks) {
+				callback();
+			}
+		});
+}
+
 BitmapRef Cache::Exfont() {
 	const auto key = MakeHashKey("ExFont", "ExFont", false);
 
@@ -402,18 +690,20 @@ BitmapRef Cache::Exfont() {
 			exfont_img = Bitmap::Create(exfont_h, sizeof(exfont_h), true);
 		}
 
-		return AddToCache(key, exfont_img);
+		return AddToCache(key, exfont_img, tier_exfont);
 	} else {
-		it->second.last_access = Game_Clock::GetFrameTime();
-		return it->second.bitmap;
+		return Touch(it->second);
 	}
 }
 
 BitmapRef Cache::Tile(StringView filename, int tile_id) {
-	const auto key = MakeTileHashKey(filename, tile_id);
-	auto it = cache_tiles.find(key);
+	const TileKey key { TileChipsetIndex(filename), tile_id };
+	BitmapRef tile;
+	if (auto* cached = cache_tiles.Find(key)) {
+		tile = cached->lock();
+	}
 
-	if (it == cache_tiles.end() || it->second.expired()) {
+	if (!tile) {
 		BitmapRef chipset = Cache::Chipset(filename);
 		Rect rect = Rect(0, 0, 16, 16);
 
@@ -438,24 +728,34 @@ BitmapRef Cache::Tile(StringView filename, int tile_id) {
 		rect.x += sub_tile_id % 6 * 16;
 		rect.y += sub_tile_id / 6 * 16;
 
-		return(cache_tiles[key] = Bitmap::Create(*chipset, rect)).lock();
-	} else { return it->second.lock(); }
+		tile = Bitmap::Create(*chipset, rect);
+		CompactBeforeGrow(cache_tiles, [](const TileKey&, const std::weak_ptr<Bitmap>& bmp) {
+			return bmp.expired();
+		});
+		cache_tiles[key] = tile;
+	}
+	return tile;
 }
 
 BitmapRef Cache::SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, bool flip_x, bool flip_y, const Tone& tone, const Color& blend) {
-	const effect_key_type key {
-		src_bitmap,
-		rect,
-		flip_x,
-		flip_y,
-		tone,
-		blend
+	const EffectKey key {
+		src_bitmap.get(),
+		rect.x, rect.y, rect.width, rect.height,
+		tone.red, tone.green, tone.blue, tone.gray,
+		static_cast<uint32_t>(blend.red) << 24 | static_cast<uint32_t>(blend.green) << 16
+			| static_cast<uint32_t>(blend.blue) << 8 | blend.alpha,
+		static_cast<uint32_t>(flip_x) | static_cast<uint32_t>(flip_y) << 1
 	};
 
-	const auto it = cache_effects.find(key);
+	BitmapRef bitmap_effects;
+	if (auto* cached = cache_effects.Find(key)) {
+		// A live source proves the address was not reused by another bitmap
+		if (!cached->src.expired()) {
+			bitmap_effects = cached->bitmap.lock();
+		}
+	}
 
-	if (it == cache_effects.end() || it->second.expired()) {
-		BitmapRef bitmap_effects;
+	if (!bitmap_effects) {
 
 		auto create = [&rect] () -> BitmapRef {
 			return Bitmap::Create(rect.width, rect.height, true);
@@ -488,25 +788,37 @@ BitmapRef Cache::SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, boo
 
 		assert(bitmap_effects && "Effect cache used but no effect applied!");
 
-		return(cache_effects[key] = bitmap_effects).lock();
-	} else { return it->second.lock(); }
+		CompactBeforeGrow(cache_effects, [](const EffectKey&, const EffectEntry& e) {
+			return e.src.expired() || e.bitmap.expired();
+		});
+		cache_effects[key] = { src_bitmap, bitmap_effects };
+	}
+	return bitmap_effects;
 }
 
 void Cache::Clear() {
 	cache_effects.clear();
 	cache.clear();
 	cache_size = 0;
+	for (auto& tier : tiers) {
+		tier.head = tier.tail = nullptr;
+		tier.size = 0;
+		tier.entries = 0;
+	}
+	for (auto& group : groups) {
+		group.size = 0;
+	}
 
-	for (auto& kv : cache_tiles) {
-		auto& key = kv.first;
-		if (kv.second.expired()) {
-			continue;
+	cache_tiles.ForEach([](const TileKey& key, const std::weak_ptr<Bitmap>& bmp) {
+		if (bmp.expired()) {
+			return;
 		}
 		Output::Debug("possible leak in cached tilemap {}/{}",
-				NameFromTileHash(key), IdFromTileHash(key));
-	}
+				tile_chipsets[key.chipset], key.id);
+	});
 
 	cache_tiles.clear();
+	tile_chipsets.clear();
 }
 
 void Cache::ClearAll() {
@@ -516,6 +828,48 @@ void Cache::ClearAll() {
 	system2_name.clear();
 }
 
+void Cache::SetBudgets(const Game_ConfigCache& cfg) {
+	cache_limit = cfg.size.Get() * MB;
+
+	groups[Group_Picture].budget = cfg.picture.Get() * MB;
+	groups[Group_Panorama].budget = cfg.panorama.Get() * MB;
+	groups[Group_Charset].budget = cfg.charset.Get() * MB;
+	groups[Group_Chipset].budget = cfg.chipset.Get() * MB;
+	groups[Group_Battle].budget = cfg.battle.Get() * MB;
+	groups[Group_Other].budget = cfg.other.Get() * MB;
+}
+
+Cache::Stats Cache::GetStats() {
+	Stats r;
+	r.name = "Total";
+	for (auto& tier : tiers) {
+		r.hits += tier.hits;
+		r.misses += tier.misses;
+		r.evictions += tier.evictions;
+		r.entries += tier.entries;
+	}
+	r.bytes = cache_size;
+	r.budget = cache_limit;
+	return r;
+}
+
+std::vector<Cache::Stats> Cache::GetMaterialStats() {
+	std::vector<Stats> r;
+	for (int i = 0; i < tier_count; ++i) {
+		auto& tier = tiers[i];
+		Stats s;
+		s.name = i == tier_exfont ? "ExFont" : spec[i].directory;
+		s.hits = tier.hits;
+		s.misses = tier.misses;
+		s.evictions = tier.evictions;
+		s.entries = tier.entries;
+		s.bytes = tier.size;
+		s.budget = groups[TierGroup(i)].budget;
+		r.push_back(s);
+	}
+	return r;
+}
+
 void Cache::SetSystemName(std::string filename) {
 	system_name = std::move(filename);
 }
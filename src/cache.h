@@ -19,6 +19,7 @@
 #define EP_CACHE_H
 
 // Headers
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,7 @@
 class Color;
 class Rect;
 class Tone;
+struct Game_ConfigCache;
 
 /**
  * Cache namespace.
@@ -54,12 +56,52 @@ namespace Cache {
 	BitmapRef System(StringView filename);
 	BitmapRef System2(StringView filename);
 
+	/**
+	 * Decodes an image on the decode pool and adds it to the cache, so the
+	 * image getter of the material returns it without decoding.
+	 * Images of unknown directories, missing images and images already in
+	 * the cache are skipped.
+	 *
+	 * @param folder_name material directory, e.g. "CharSet"
+	 * @param filename image to decode
+	 * @param transparent as passed to the image getter, e.g. Picture
+	 * @param done called on the main thread when the image is in the cache
+	 */
+	void Preload(StringView folder_name, StringView filename, bool transparent, std::function<void()> done);
+
+	/** Preloads with the transparency of the material, as used by getters without a transparent argument */
+	void Preload(StringView folder_name, StringView filename, std::function<void()> done);
+
 	BitmapRef Tile(StringView filename, int tile_id);
 	BitmapRef SpriteEffect(const BitmapRef& src_bitmap, const Rect& rect, bool flip_x, bool flip_y, const Tone& tone, const Color& blend);
 
 	void Clear();
 	void ClearAll();
 
+	/**
+	 * Sets the memory budgets of the bitmap cache. Unused bitmaps are kept
+	 * until their group of materials or the whole cache exceeds its budget,
+	 * then the least recently used ones are freed.
+	 */
+	void SetBudgets(const Game_ConfigCache& cfg);
+
+	struct Stats {
+		const char* name = "";
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t evictions = 0;
+		size_t entries = 0;
+		size_t bytes = 0;
+		/** Budget shared by the group of the material, 0 when only the total applies */
+		size_t budget = 0;
+	};
+
+	/** @return bitmap cache counters of all materials */
+	Stats GetStats();
+
+	/** @return bitmap cache counters of each material */
+	std::vector<Stats> GetMaterialStats();
+
 	/** @return the configured system bitmap, or nullptr if there is no system */
 	BitmapRef System();
 
@@ -17,6 +17,9 @@ void ChatName::Draw(Bitmap& dst) {
 		dirty = true;
 		return;
 	}
+	if (!player.in_view) {
+		return;
+	}
 
 	if (dirty) {
 		// Up to 3 utf-8 characters
@@ -56,6 +59,19 @@ void ChatName::Draw(Bitmap& dst) {
 	dst.Blit(x, y, *nick_img, nick_img->GetRect(), Opacity::Opaque());
 }
 
+void ChatName::SetNickname(std::string nickname) {
+	this->nickname = std::move(nickname);
+	nick_img.reset();
+	dirty = true;
+}
+
+void ChatName::Reset(int id) {
+	SetZ(Priority_Frame + (id << 8));
+	SetNickname("");
+	sys_graphic.reset();
+	request_id.reset();
+}
+
 void ChatName::SetSystemGraphic(StringView sys_name) {
 	FileRequestAsync* request = AsyncHandler::RequestFile("System", sys_name);
 	request_id = request->Bind([this](FileRequestResult* result) {
@@ -1,9 +1,8 @@
 #ifndef EP_CHATNAME_H
 #define EP_CHATNAME_H
 
-#include <queue>
-
 #include "game_multiplayer.h"
+#include "multiplayer_jitter_buffer.h"
 #include "game_playerother.h"
 #include "sprite_character.h"
 #include "bitmap.h"
@@ -18,6 +17,11 @@ public:
 
 	void SetSystemGraphic(StringView sys_name);
 
+	void SetNickname(std::string nickname);
+
+	/** Drops the state of the previous player when the entry is reused. */
+	void Reset(int id);
+
 private:
 	PlayerOther& player;
 	std::string nickname;
@@ -28,10 +32,12 @@ private:
 };
 
 struct PlayerOther {
-	std::queue<std::pair<int,int>> mvq; //queue of move commands
+	Multiplayer::JitterBuffer mvq; //buffered move commands
 	std::unique_ptr<Game_PlayerOther> ch; //character
 	std::unique_ptr<Sprite_Character> sprite;
 	std::unique_ptr<ChatName> chat_name;
+	bool in_view = true; //near the screen, updated every frame
+	bool audible = true; //close enough to the main player to hear its SE
 };
 
 #endif
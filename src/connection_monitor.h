@@ -2,15 +2,31 @@
 #define EP_CONNECTION_MONITOR_H
 
 #include "multiplayer_packet.h"
+#include "game_clock.h"
 
 class ConnectionMonitor {
 public:
+	using duration = Game_Clock::duration;
+
 	enum class Action {
 		NONE,
 		DROP, // drop that message, without dispatching it
 	};
+	virtual ~ConnectionMonitor() = default;
+
 	virtual Action OnReceive(std::string_view name, const Multiplayer::S2CPacket& p) = 0;
+
+	/** A packet that was not dropped went through its handler. */
+	virtual void OnHandled(std::string_view name, duration decode, duration handle) {}
+	/** A raw message arrived, before it is split into packets. */
+	virtual void OnMessageReceived(size_t bytes) {}
+	/** A message went out, bytes include the signature header. */
+	virtual void OnMessageSent(size_t bytes) {}
+	/** The outbound queue is flushed with this many packets in it. */
+	virtual void OnFlush(size_t queued) {}
+	virtual void OnOpen() {}
+	/** The connection was lost, explicit closing is not reported. */
+	virtual void OnClose() {}
 };
 
 #endif
-
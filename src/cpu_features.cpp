@@ -0,0 +1,123 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cpu_features.h"
+
+#ifdef EP_SIMD_X86
+#  if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+#endif
+
+namespace {
+	struct Features {
+		bool sse41 = false;
+		bool avx2 = false;
+		bool sha = false;
+		bool neon = false;
+		const char* description = "none";
+	};
+
+#ifdef EP_SIMD_X86
+	void Cpuid(int leaf, int sub, unsigned int regs[4]) {
+#  if defined(_MSC_VER) && !defined(__clang__)
+		int r[4];
+		__cpuidex(r, leaf, sub);
+		for (int i = 0; i < 4; ++i)
+			regs[i] = static_cast<unsigned int>(r[i]);
+#  else
+		__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#  endif
+	}
+
+	unsigned long long Xgetbv() {
+#  if defined(_MSC_VER) && !defined(__clang__)
+		return _xgetbv(0);
+#  else
+		unsigned int lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return (static_cast<unsigned long long>(hi) << 32) | lo;
+#  endif
+	}
+#endif
+
+	Features Detect() {
+		Features f;
+#ifdef EP_SIMD_X86
+		unsigned int r[4];
+		Cpuid(0, 0, r);
+		const unsigned int max_leaf = r[0];
+
+		Cpuid(1, 0, r);
+		const bool ssse3 = r[2] & (1u << 9);
+		f.sse41 = ssse3 && (r[2] & (1u << 19));
+		const bool osxsave = r[2] & (1u << 27);
+		const bool avx = r[2] & (1u << 28);
+		// the OS must save the ymm registers on context switches
+		const bool ymm_enabled = osxsave && (Xgetbv() & 0x6) == 0x6;
+
+		if (max_leaf >= 7) {
+			Cpuid(7, 0, r);
+			f.avx2 = avx && ymm_enabled && (r[1] & (1u << 5));
+			f.sha = f.sse41 && (r[1] & (1u << 29));
+		}
+
+		if (f.avx2 && f.sha) {
+			f.description = "SSE4.1 AVX2 SHA";
+		} else if (f.avx2) {
+			f.description = "SSE4.1 AVX2";
+		} else if (f.sha) {
+			f.description = "SSE4.1 SHA";
+		} else if (f.sse41) {
+			f.description = "SSE4.1";
+		}
+#endif
+#ifdef EP_SIMD_NEON
+		// NEON is part of the baseline on every target this is enabled for
+		f.neon = true;
+		f.description = "NEON";
+#endif
+		return f;
+	}
+
+	const Features& Get() {
+		static const Features features = Detect();
+		return features;
+	}
+}
+
+bool CpuFeatures::HasSse41() {
+	return Get().sse41;
+}
+
+bool CpuFeatures::HasAvx2() {
+	return Get().avx2;
+}
+
+bool CpuFeatures::HasSha() {
+	return Get().sha;
+}
+
+bool CpuFeatures::HasNeon() {
+	return Get().neon;
+}
+
+const char* CpuFeatures::GetDescription() {
+	return Get().description;
+}
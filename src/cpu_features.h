@@ -0,0 +1,59 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_CPU_FEATURES_H
+#define EP_CPU_FEATURES_H
+
+/**
+ * SIMD code paths are compiled when PLAYER_SIMD is defined and selected at
+ * runtime, so a binary built for a generic target still runs everywhere.
+ *
+ * EP_SIMD_X86 is defined when x86 intrinsics can be used. Functions using
+ * them are marked with EP_TARGET("<isa>") so the rest of the translation
+ * unit is still compiled for the baseline instruction set.
+ */
+#if defined(PLAYER_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#  define EP_SIMD_X86 1
+#  if defined(_MSC_VER) && !defined(__clang__)
+#    define EP_TARGET(isa)
+#  else
+#    define EP_TARGET(isa) __attribute__((target(isa)))
+#  endif
+#endif
+
+#if defined(PLAYER_SIMD) && (defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64))
+#  define EP_SIMD_NEON 1
+#endif
+
+namespace CpuFeatures {
+	/** @return whether SSE4.1 (and SSSE3) can be used */
+	bool HasSse41();
+
+	/** @return whether AVX2 can be used, including OS support for the registers */
+	bool HasAvx2();
+
+	/** @return whether the SHA extensions can be used */
+	bool HasSha();
+
+	/** @return whether NEON can be used */
+	bool HasNeon();
+
+	/** @return the usable features as a string for the log, e.g. "SSE4.1 AVX2" */
+	const char* GetDescription();
+}
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Headers
+#include "decode_pool.h"
+#include "output.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct Job {
+		std::function<void()> work;
+		std::function<void()> done;
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable work_cv;
+	std::condition_variable finished_cv;
+	std::deque<Job> queue;
+	std::vector<Job> finished;
+	/** Jobs submitted and not yet handed back by Update */
+	size_t pending = 0;
+	bool quit = false;
+
+	void WorkerLoop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			work_cv.wait(lock, []() { return quit || !queue.empty(); });
+			if (quit) {
+				return;
+			}
+
+			Job job = std::move(queue.front());
+			queue.pop_front();
+			lock.unlock();
+			job.work();
+			lock.lock();
+
+			finished.push_back(std::move(job));
+			finished_cv.notify_all();
+		}
+	}
+}
+
+void DecodePool::SetThreads(int threads) {
+#if defined(EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+	// Not built with thread support
+	threads = 0;
+#endif
+	threads = std::max(threads, 0);
+	if (threads == GetThreads()) {
+		return;
+	}
+
+	Finish();
+	Quit();
+
+	quit = false;
+	for (int i = 0; i < threads; ++i) {
+		workers.emplace_back(WorkerLoop);
+	}
+
+	if (threads > 0) {
+		Output::Debug("Decoding assets on {} threads", threads);
+	}
+}
+
+int DecodePool::GetThreads() {
+	return static_cast<int>(workers.size());
+}
+
+void DecodePool::Submit(std::function<void()> work, std::function<void()> done) {
+	if (workers.empty()) {
+		work();
+		done();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back({ std::move(work), std::move(done) });
+		++pending;
+	}
+	work_cv.notify_one();
+}
+
+void DecodePool::Update() {
+	std::vector<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (finished.empty()) {
+			return;
+		}
+		jobs.swap(finished);
+		pending -= jobs.size();
+	}
+
+	// Callbacks can submit new jobs
+	for (auto& job : jobs) {
+		job.done();
+	}
+}
+
+size_t DecodePool::GetPending() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending;
+}
+
+void DecodePool::Finish() {
+	while (GetPending() > 0) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			finished_cv.wait(lock, []() { return !finished.empty(); });
+		}
+		Update();
+	}
+}
+
+void DecodePool::Quit() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	work_cv.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	queue.clear();
+	finished.clear();
+	pending = 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EP_DECODE_POOL_H
+#define EP_DECODE_POOL_H
+
+// Headers
+#include <cstddef>
+#include <functional>
+
+/**
+ * Worker threads that decode assets in the background. The work of a job
+ * runs on a worker, its done callback runs afterwards on the main thread
+ * from Update(), in the order the jobs finished.
+ *
+ * Work must not touch the filesystem, the cache or any other state of the
+ * main thread: read the file first and decode from memory.
+ */
+namespace DecodePool {
+	/**
+	 * Sets the number of worker threads. Finishes all queued jobs first.
+	 *
+	 * @param threads worker threads, 0 runs jobs immediately in Submit
+	 */
+	void SetThreads(int threads);
+
+	/** @return number of worker threads */
+	int GetThreads();
+
+	/**
+	 * Queues a job.
+	 *
+	 * @param work runs on a worker thread
+	 * @param done runs on the main thread when work finished
+	 */
+	void Submit(std::function<void()> work, std::function<void()> done);
+
+	/** Runs the done callbacks of all finished jobs. Called once per frame. */
+	void Update();
+
+	/** @return jobs whose done callback did not run yet */
+	size_t GetPending();
+
+	/** Waits for all queued jobs and runs their done callbacks */
+	void Finish();
+
+	/** Stops the worker threads, queued jobs are discarded */
+	void Quit();
+}
+
+#endif
@@ -23,6 +23,7 @@
 
 class Bitmap;
 class Drawable;
+class DrawableList;
 
 template <typename T>
 static constexpr bool IsDrawable = std::is_base_of<Drawable,T>::value;
@@ -77,6 +78,27 @@ public:
 
 	virtual void Draw(Bitmap& dst) = 0;
 
+	/**
+	 * Prepares the drawable for banded rendering. The frame is then drawn by
+	 * calling DrawBand once per band, on several threads at the same time.
+	 * Called on the main thread in draw order, so everything Draw would
+	 * change in the drawable or in shared state must be changed here.
+	 * This includes Bitmap::Validate on the bitmaps DrawBand draws from.
+	 *
+	 * @param dst the whole frame, only used for its size
+	 * @return false when the drawable must be drawn by Draw instead
+	 */
+	virtual bool PrepareBands(const Bitmap& dst);
+
+	/**
+	 * Draws the part of the drawable that is inside the clip rect of dst.
+	 * Must only read state, and must write to dst only through blits that
+	 * honor the clip rect.
+	 *
+	 * @param dst the frame, clipped to one band
+	 */
+	virtual void DrawBand(Bitmap& dst) const;
+
 	int GetZ() const;
 
 	void SetZ(int z);
@@ -111,8 +133,14 @@ public:
 	 */
 	static int GetPriorityForBattleLayer(int which);
 private:
+	friend class DrawableList;
+	friend struct DrawableMgr;
+
 	int32_t _z = 0;
 	Flags _flags = Flags::Default;
+	/** List the drawable is in and its position there, maintained by the list */
+	DrawableList* _list = nullptr;
+	size_t _list_index = 0;
 };
 
 inline Drawable::Flags operator|(Drawable::Flags l, Drawable::Flags r) {
@@ -137,6 +165,13 @@ inline Drawable::Drawable(int z, Flags flags)
 {
 }
 
+inline bool Drawable::PrepareBands(const Bitmap&) {
+	return false;
+}
+
+inline void Drawable::DrawBand(Bitmap&) const {
+}
+
 inline int Drawable::GetZ() const {
 	return _z;
 }
@@ -29,9 +29,15 @@ DrawableList::~DrawableList() {
 	if (DrawableMgr::GetLocalListPtr() == this) {
 		DrawableMgr::SetLocalList(nullptr);
 	}
+	for (auto* drawable : _list) {
+		drawable->_list = nullptr;
+	}
 }
 
 void DrawableList::Clear() {
+	for (auto* drawable : _list) {
+		drawable->_list = nullptr;
+	}
 	_list.clear();
 	SetClean();
 }
@@ -41,39 +47,113 @@ bool DrawableList::IsSorted() const {
 }
 
 void DrawableList::Sort() {
-	// stable sort to work around a flickering event sprite issue when
-	// the map is scrolling (have same Z value)
-	std::stable_sort(_list.begin(), _list.end(), DrawCmp);
+	if (_dirty) {
+		// stable sort to work around a flickering event sprite issue when
+		// the map is scrolling (have same Z value)
+		std::stable_sort(_list.begin(), _list.end(), DrawCmp);
+		Reindex(0, _list.size());
+	} else if (_repair_count > 0) {
+		Repair();
+	}
 	SetClean();
 }
 
+void DrawableList::Repair() {
+	// All drawables outside of the marked ones are still in order, so an
+	// insertion sort starting at the first marked drawable is done once it
+	// passed the last one and finds a drawable in place. Insertion sort is
+	// stable and gives the same order as the stable sort.
+	const size_t size = _list.size();
+	size_t first = std::min(_repair_begin, size);
+	size_t i = first;
+
+	for (; i < size; ++i) {
+		auto* drawable = _list[i];
+		size_t j = i;
+		while (j > 0 && DrawCmp(drawable, _list[j - 1])) {
+			_list[j] = _list[j - 1];
+			--j;
+		}
+
+		if (j == i) {
+			if (i >= _repair_end) {
+				break;
+			}
+			continue;
+		}
+
+		_list[j] = drawable;
+		first = std::min(first, j);
+	}
+
+	Reindex(first, i);
+}
+
 void DrawableList::Append(Drawable* ptr) {
 	assert(ptr != nullptr);
-	assert(_list.end() == std::find(_list.begin(), _list.end(), ptr));
+	assert(ptr->_list == nullptr);
 
 	const bool ordered = _list.empty() || !DrawCmp(ptr, _list.back());
 
+	ptr->_list = this;
+	ptr->_list_index = _list.size();
 	_list.push_back(ptr);
 
 	if (!ordered) {
-		SetDirty();
+		SetDirty(ptr);
 	}
 }
 
 Drawable* DrawableList::Take(Drawable* ptr) {
-	auto iter = std::find(_list.begin(), _list.end(), ptr);
-	if (iter == _list.end()) {
+	if (ptr->_list != this) {
 		return nullptr;
 	}
 
-	auto ret = *iter;
-	// FIXME: Can we remove this O(N) operation here?
-	_list.erase(iter);
-	return ret;
+	const size_t index = ptr->_list_index;
+	assert(_list[index] == ptr);
+
+	_list.erase(_list.begin() + index);
+	ptr->_list = nullptr;
+	Reindex(index, _list.size());
+
+	if (_repair_count > 0) {
+		if (index < _repair_begin) {
+			--_repair_begin;
+		}
+		if (index < _repair_end) {
+			--_repair_end;
+		}
+	}
+
+	return ptr;
 
 	// Removing doesn't change sorted order, so not dirty flag.
 }
 
+void DrawableList::SetDirty(Drawable* ptr) {
+	assert(ptr->_list == this);
+
+	if (_dirty) {
+		return;
+	}
+
+	const size_t index = ptr->_list_index;
+	if (_repair_count == 0) {
+		_repair_begin = index;
+		_repair_end = index + 1;
+	} else {
+		_repair_begin = std::min(_repair_begin, index);
+		_repair_end = std::max(_repair_end, index + 1);
+	}
+	++_repair_count;
+
+	// Every marked drawable can move across the whole list, with many of
+	// them the full sort is faster
+	if (_repair_count * 4 > _list.size()) {
+		SetDirty();
+	}
+}
+
 void DrawableList::TakeFrom(DrawableList& other) noexcept {
 	if (&other == this) { return; }
 
@@ -83,7 +163,11 @@ void DrawableList::TakeFrom(DrawableList& other) noexcept {
 		return;
 	}
 
-	_list.insert(_list.end(), olist.begin(), olist.end());
+	for (auto* drawable : olist) {
+		drawable->_list = this;
+		drawable->_list_index = _list.size();
+		_list.push_back(drawable);
+	}
 	olist.clear();
 
 	SetDirty();
@@ -97,12 +181,15 @@ void DrawableList::Draw(Bitmap& dst, int min_z, int max_z) {
 		assert(IsSorted());
 	}
 
-	for (auto* drawable : _list) {
-		auto z = drawable->GetZ();
-		if (z < min_z) {
-			continue;
-		}
-		if (z > max_z) {
+	auto iter = _list.begin();
+	if (min_z != std::numeric_limits<int>::min()) {
+		iter = std::lower_bound(_list.begin(), _list.end(), min_z,
+				[](Drawable* drawable, int z) { return drawable->GetZ() < z; });
+	}
+
+	for (; iter != _list.end(); ++iter) {
+		auto* drawable = *iter;
+		if (drawable->GetZ() > max_z) {
 			break;
 		}
 		if (drawable->IsVisible()) {
@@ -110,4 +197,3 @@ void DrawableList::Draw(Bitmap& dst, int min_z, int max_z) {
 		}
 	}
 }
-
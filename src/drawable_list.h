@@ -37,7 +37,11 @@ class DrawableList {
 		/** Iterator type */
 		using iterator = std::vector<Drawable*>::const_iterator;
 
-		/** Sorts the drawables and clears the dirty flag.  */
+		/**
+		 * Sorts the drawables and clears the dirty flag.
+		 * When only a few drawables changed their Z value since the last sort,
+		 * just these are moved to their new place.
+		 */
 		void Sort();
 
 		/** Return true if drawables are sorted */
@@ -92,6 +96,14 @@ class DrawableList {
 		/** Mark the list as dirty. It will be sorted the next time Draw() is called */
 		void SetDirty();
 
+		/**
+		 * Mark a drawable of the list as out of order, because its Z value
+		 * changed. Only changed drawables are moved by the next sort.
+		 *
+		 * @param drawable the Drawable whose Z changed
+		 */
+		void SetDirty(Drawable* drawable);
+
 		/** @return an iterator to the beginning */
 		iterator begin() const { return _list.begin(); }
 
@@ -133,9 +145,16 @@ class DrawableList {
 
 	private:
 		std::vector<Drawable*> _list;
+		/** Full sort required */
 		bool _dirty = false;
+		/** Index range and number of drawables marked out of order */
+		size_t _repair_begin = 0;
+		size_t _repair_end = 0;
+		size_t _repair_count = 0;
 
 		void SetClean();
+		void Repair();
+		void Reindex(size_t first, size_t last);
 };
 
 template <typename T>
@@ -160,6 +179,8 @@ void DrawableList::TakeFrom(DrawableList& other, F&& cond) noexcept {
 		auto* draw = *iter;
 
 		if (cond(draw)) {
+			draw->_list = this;
+			draw->_list_index = _list.size();
 			_list.push_back(draw);
 			++shift;
 			continue;
@@ -168,6 +189,12 @@ void DrawableList::TakeFrom(DrawableList& other, F&& cond) noexcept {
 		++iter;
 	}
 	olist.resize(olist.size() - shift);
+	other.Reindex(0, olist.size());
+
+	// The marked drawables moved, the range of the partial sort is unknown
+	if (shift > 0 && other._repair_count > 0) {
+		other.SetDirty();
+	}
 
 	SetDirty();
 	if (olist.empty()) {
@@ -176,7 +203,7 @@ void DrawableList::TakeFrom(DrawableList& other, F&& cond) noexcept {
 }
 
 inline bool DrawableList::IsDirty() const {
-	return _dirty;
+	return _dirty || _repair_count > 0;
 }
 
 inline void DrawableList::SetDirty() {
@@ -185,6 +212,13 @@ inline void DrawableList::SetDirty() {
 
 inline void DrawableList::SetClean() {
 	_dirty = false;
+	_repair_count = 0;
+}
+
+inline void DrawableList::Reindex(size_t first, size_t last) {
+	for (size_t i = first; i < last; ++i) {
+		_list[i]->_list_index = i;
+	}
 }
 
 inline void DrawableList::Draw(Bitmap& dst) {
@@ -21,15 +21,8 @@
 DrawableList* DrawableMgr::_local = nullptr;
 
 void DrawableMgr::SetLocalList(DrawableList* list) {
-	if (list) {
-		// If a Drawable that is was attached to list changed it's Z value when list
-		// was not set as the current local list, the wrong list would have been set as dirty.
-		// To prevent this
-		// Always ensure local list gets sorted. When the list was used externally
-		// we have no guarantee that changes to it's contents keep it sorted.
-		list->SetDirty();
-	}
-
+	// Z changes are reported to the list a drawable is in, so switching
+	// the local list does not require a sort.
 	_local = list;
 }
 
@@ -38,13 +31,10 @@ void DrawableMgr::Register(Drawable* drawable) {
 }
 
 void DrawableMgr::Remove(Drawable* drawable) {
-	auto* list = GetLocalListPtr();
 	// Global drawables can be singletons, which may get destroyed after all scenes due
-	// static initialization order. Non-global drawables we assume are all gone before
-	// all lists are destroyed.
-	assert(list || drawable->IsGlobal());
-	if (list) {
-		list->Take(drawable);
+	// static initialization order. Lists detach their drawables when destroyed.
+	if (drawable->_list) {
+		drawable->_list->Take(drawable);
 	}
 }
 
@@ -47,8 +47,10 @@ inline DrawableList* DrawableMgr::GetLocalListPtr() {
 	return _local;
 }
 
-inline void DrawableMgr::OnUpdateZ(Drawable* /* drawable */) {
-	GetLocalList().SetDirty();
+inline void DrawableMgr::OnUpdateZ(Drawable* drawable) {
+	if (drawable->_list) {
+		drawable->_list->SetDirty(drawable);
+	}
 }
 
 #endif
@@ -15,6 +15,7 @@
  * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <sstream>
 
 #include "fps_overlay.h"
@@ -24,6 +25,7 @@
 #include "input.h"
 #include "font.h"
 #include "drawable_mgr.h"
+#include "game_multiplayer.h"
 
 using namespace std::chrono_literals;
 
@@ -43,6 +45,18 @@ void FpsOverlay::UpdateText() {
 	fps_dirty = true;
 }
 
+void FpsOverlay::UpdateNetText() {
+	net_text = Game_Multiplayer::GetTrafficSummary();
+	net_dirty = true;
+}
+
+void FpsOverlay::SetDrawNetStats(bool value) {
+	draw_net_stats = value;
+	if (draw_net_stats) {
+		UpdateNetText();
+	}
+}
+
 bool FpsOverlay::Update() {
 	int mod = static_cast<int>(Game_Clock::GetGameSpeedFactor());
 	if (mod != last_speed_mod) {
@@ -58,6 +72,9 @@ bool FpsOverlay::Update() {
 	last_refresh_time = now;
 
 	UpdateText();
+	if (draw_net_stats) {
+		UpdateNetText();
+	}
 
 	return true;
 }
@@ -84,6 +101,36 @@ void FpsOverlay::Draw(Bitmap& dst) {
 		dst.Blit(1, 2, *fps_bitmap, fps_rect, 255);
 	}
 
+	if (draw_net_stats) {
+		if (net_dirty) {
+			int width = 0;
+			int line_height = 0;
+			for (auto& line : net_text) {
+				Rect rect = Font::Default()->GetSize(line);
+				width = std::max(width, rect.width);
+				line_height = std::max(line_height, rect.height);
+			}
+			int height = line_height * static_cast<int>(net_text.size());
+
+			if (!net_bitmap || net_bitmap->GetWidth() < width + 2 || net_bitmap->GetHeight() < height + 1) {
+				net_bitmap = Bitmap::Create(width + 2, height + 1, true);
+			}
+			net_bitmap->Clear();
+			net_bitmap->Fill(Color(0, 0, 0, 128));
+			for (size_t i = 0; i < net_text.size(); ++i) {
+				net_bitmap->TextDraw(1, static_cast<int>(i) * line_height, Color(255, 255, 255, 255), net_text[i]);
+			}
+
+			net_rect = Rect(0, 0, width + 2, height + 1);
+
+			net_dirty = false;
+		}
+
+		// Below the fps display
+		int y = draw_fps ? 2 + fps_rect.height + 2 : 2;
+		dst.Blit(1, y, *net_bitmap, net_rect, 255);
+	}
+
 	// Always drawn when speedup is on independent of FPS
 	if (last_speed_mod > 1) {
 		if (speedup_dirty) {
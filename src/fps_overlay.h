@@ -20,6 +20,7 @@
 
 #include <deque>
 #include <string>
+#include <vector>
 #include "drawable.h"
 #include "memory_management.h"
 #include "rect.h"
@@ -27,7 +28,7 @@
 
 /**
  * FpsOverlay class.
- * Shows current FPS and the speedup indicator.
+ * Shows current FPS, the speedup indicator and the multiplayer traffic.
  */
 class FpsOverlay : public Drawable {
 public:
@@ -56,23 +57,39 @@ public:
 	 */
 	void SetDrawFps(bool value);
 
+	/**
+	 * Set whether we will render the multiplayer traffic statistics.
+	 *
+	 * @param value true if we want to draw to screen
+	 */
+	void SetDrawNetStats(bool value);
+
+	/** @return whether the multiplayer traffic statistics are rendered */
+	bool GetDrawNetStats() const;
+
 private:
 	void UpdateText();
+	void UpdateNetText();
 
 	BitmapRef fps_bitmap;
 	BitmapRef speedup_bitmap;
+	BitmapRef net_bitmap;
 	Game_Clock::time_point last_refresh_time;
 
 	/** Rect to draw on screen */
 	Rect fps_rect;
 	Rect speedup_rect;
+	Rect net_rect;
 
 	std::string text;
+	std::vector<std::string> net_text;
 
 	int last_speed_mod = 1;
 	bool speedup_dirty = true;
 	bool fps_dirty = true;
 	bool draw_fps = true;
+	bool net_dirty = false;
+	bool draw_net_stats = false;
 };
 
 inline std::string FpsOverlay::GetFpsString() const {
@@ -83,4 +100,8 @@ inline void FpsOverlay::SetDrawFps(bool value) {
 	draw_fps = value;
 }
 
+inline bool FpsOverlay::GetDrawNetStats() const {
+	return draw_net_stats;
+}
+
 #endif
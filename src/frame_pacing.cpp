@@ -0,0 +1,120 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Headers
+#include "frame_pacing.h"
+#include "output.h"
+#include <algorithm>
+#include <fmt/format.h>
+
+namespace {
+	double ToMs(FramePacing::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+}
+
+void FramePacing::Stats::Clear() {
+	presents = 0;
+	repeated = 0;
+	dropped = 0;
+	late = 0;
+	rows = 0;
+	present_time = {};
+	intervals.clear();
+}
+
+std::string FramePacing::Stats::ToJson(duration elapsed) const {
+	auto sorted = intervals;
+	std::sort(sorted.begin(), sorted.end());
+
+	auto percentile = [&](int p) {
+		if (sorted.empty()) {
+			return 0.0;
+		}
+		return ToMs(sorted[(sorted.size() - 1) * p / 100]);
+	};
+
+	duration total = {};
+	for (auto d : sorted) {
+		total += d;
+	}
+
+	const double seconds = std::chrono::duration<double>(elapsed).count();
+
+	return fmt::format(
+		R"({{"seconds":{:.1f},"fps":{:.2f},"interval_ms":{{"mean":{:.2f},"p50":{:.2f},"p99":{:.2f},"max":{:.2f}}},)"
+		R"("present_ms":{:.2f},"late":{},"repeated":{},"dropped":{},"rows":{}}})",
+		seconds, seconds > 0 ? presents / seconds : 0.0,
+		sorted.empty() ? 0.0 : ToMs(total) / sorted.size(), percentile(50), percentile(99), percentile(100),
+		presents ? ToMs(present_time) / presents : 0.0,
+		late, repeated, dropped, rows);
+}
+
+void FramePacing::SetDumpInterval(int seconds) {
+	dump_interval = std::max(seconds, 0);
+	stats.Clear();
+	last_present = {};
+	dump_start = {};
+}
+
+void FramePacing::OnPresent(time_point begin, time_point end, int rows, bool repeated) {
+	if (!IsEnabled()) {
+		return;
+	}
+
+	++stats.presents;
+	stats.repeated += repeated;
+	stats.rows += rows;
+	stats.present_time += end - begin;
+
+	if (last_present != time_point()) {
+		const auto interval = end - last_present;
+		stats.intervals.push_back(interval);
+		if (interval * 2 > target * 3) {
+			++stats.late;
+		}
+	}
+	last_present = end;
+}
+
+void FramePacing::OnFrameDropped() {
+	if (IsEnabled()) {
+		++stats.dropped;
+	}
+}
+
+bool FramePacing::Update(time_point now) {
+	if (!IsEnabled()) {
+		return false;
+	}
+
+	if (dump_start == time_point()) {
+		dump_start = now;
+		return false;
+	}
+
+	const auto elapsed = now - dump_start;
+	if (elapsed < std::chrono::seconds(dump_interval)) {
+		return false;
+	}
+
+	Output::Debug("pacing {}", stats.ToJson(elapsed));
+	stats.Clear();
+	dump_start = now;
+	return true;
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EP_FRAME_PACING_H
+#define EP_FRAME_PACING_H
+
+// Headers
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "game_clock.h"
+
+/**
+ * Frame pacing statistics of the display.
+ *
+ * Collects the time between presented frames, the time spent presenting
+ * (mostly the vsync wait) and how many rows were uploaded. When a dump
+ * interval is set the statistics are written to the log as a single JSON
+ * line ("pacing {...}").
+ */
+class FramePacing {
+public:
+	using duration = Game_Clock::duration;
+	using time_point = Game_Clock::time_point;
+
+	struct Stats {
+		uint32_t presents = 0;
+		/** presents that showed the previous frame again */
+		uint32_t repeated = 0;
+		/** frames replaced by a newer one before they were presented */
+		uint32_t dropped = 0;
+		/** intervals longer than 1.5 target frames */
+		uint32_t late = 0;
+		uint64_t rows = 0;
+		duration present_time = {};
+		/** time between the ends of consecutive presents */
+		std::vector<duration> intervals;
+
+		void Clear();
+
+		/**
+		 * @param elapsed time the statistics cover
+		 * @return the statistics as a JSON object
+		 */
+		std::string ToJson(duration elapsed) const;
+	};
+
+	/** @param frame the expected time between presents */
+	void SetTarget(duration frame);
+
+	/** @param seconds time between log dumps, 0 disables them */
+	void SetDumpInterval(int seconds);
+
+	/** @return whether statistics are collected */
+	bool IsEnabled() const;
+
+	/**
+	 * Records a present.
+	 *
+	 * @param begin when presenting started
+	 * @param end when the present returned
+	 * @param rows number of rows uploaded for it
+	 * @param repeated whether the previous frame was shown again
+	 */
+	void OnPresent(time_point begin, time_point end, int rows, bool repeated);
+
+	/** Records a frame that was replaced before it was presented. */
+	void OnFrameDropped();
+
+	/**
+	 * Writes the statistics to the log when the dump interval passed.
+	 *
+	 * @return true when they were written
+	 */
+	bool Update(time_point now);
+
+	/** @return statistics of the current dump interval */
+	const Stats& GetStats() const;
+
+private:
+	Stats stats;
+	duration target = Game_Clock::GetTargetGameTimeStep();
+	time_point last_present = {};
+	time_point dump_start = {};
+	int dump_interval = 0;
+};
+
+inline void FramePacing::SetTarget(duration frame) {
+	target = frame;
+}
+
+inline bool FramePacing::IsEnabled() const {
+	return dump_interval > 0;
+}
+
+inline const FramePacing::Stats& FramePacing::GetStats() const {
+	return stats;
+}
+
+#endif
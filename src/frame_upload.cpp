@@ -0,0 +1,88 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Headers
+#include "frame_upload.h"
+#include <algorithm>
+#include <cstring>
+
+void FrameUpload::Rows::Add(const Rows& other) {
+	if (other.Empty()) {
+		return;
+	}
+	if (Empty()) {
+		*this = other;
+		return;
+	}
+	top = std::min(top, other.top);
+	bottom = std::max(bottom, other.bottom);
+}
+
+void FrameUpload::Init(int buffers, int width, int height, int bytes_per_pixel) {
+	pitch = width * bytes_per_pixel;
+	this->height = height;
+	shadow.assign(static_cast<size_t>(pitch) * height, 0);
+	pending.resize(std::max(buffers, 1));
+	current = 0;
+	Invalidate();
+}
+
+void FrameUpload::Invalidate() {
+	std::fill(pending.begin(), pending.end(), Rows{ 0, height });
+	changed = true;
+}
+
+FrameUpload::Rows FrameUpload::AddFrame(const void* pixels, int src_pitch) {
+	Rows rows;
+	auto* src = static_cast<const uint8_t*>(pixels);
+	auto* dst = shadow.data();
+
+	for (int y = 0; y < height; ++y) {
+		if (std::memcmp(dst, src, pitch) != 0) {
+			std::memcpy(dst, src, pitch);
+			if (rows.Empty()) {
+				rows.top = y;
+			}
+			rows.bottom = y + 1;
+		}
+		src += src_pitch;
+		dst += pitch;
+	}
+
+	if (!rows.Empty()) {
+		for (auto& p : pending) {
+			p.Add(rows);
+		}
+		changed = true;
+	}
+
+	return rows;
+}
+
+int FrameUpload::NextBuffer(Rows& rows) {
+	if (changed) {
+		// A texture can still be in use by the GPU for the previous
+		// present, so a changed frame always goes to the next one
+		current = (current + 1) % GetBuffers();
+		changed = false;
+	}
+
+	rows = pending[current];
+	pending[current] = {};
+	return current;
+}
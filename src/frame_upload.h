@@ -0,0 +1,119 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EP_FRAME_UPLOAD_H
+#define EP_FRAME_UPLOAD_H
+
+// Headers
+#include <cstdint>
+#include <vector>
+
+/**
+ * Tracks which scanlines of a ring of streaming textures are out of date.
+ *
+ * Every frame is compared row by row with the previous one and the changed
+ * rows are copied into a shadow frame, the textures are uploaded from there.
+ * A texture only needs the rows that changed since its last upload, with N
+ * textures that is the union of the changes of the last N frames.
+ */
+class FrameUpload {
+public:
+	/** Rows [top, bottom) */
+	struct Rows {
+		int top = 0;
+		int bottom = 0;
+
+		bool Empty() const;
+		int Count() const;
+		void Add(const Rows& other);
+	};
+
+	/**
+	 * Sets the frame size and marks every texture as out of date.
+	 *
+	 * @param buffers number of textures in the ring
+	 * @param width frame width in pixels
+	 * @param height frame height in pixels
+	 * @param bytes_per_pixel pixel size
+	 */
+	void Init(int buffers, int width, int height, int bytes_per_pixel);
+
+	/** Marks every row of every texture as out of date. */
+	void Invalidate();
+
+	/**
+	 * Copies the rows of a frame that differ from the previous frame into
+	 * the shadow frame.
+	 *
+	 * @param pixels the frame
+	 * @param pitch bytes per row of pixels
+	 * @return the changed rows
+	 */
+	Rows AddFrame(const void* pixels, int pitch);
+
+	/**
+	 * Selects the texture the next present shows. The ring only advances
+	 * when a frame changed since the last call, otherwise the current
+	 * texture is shown again.
+	 *
+	 * @param rows receives the rows that must be uploaded to the texture
+	 * @return index of the texture
+	 */
+	int NextBuffer(Rows& rows);
+
+	/** @return the shadow frame */
+	const uint8_t* GetPixels() const;
+
+	/** @return bytes per row of the shadow frame */
+	int GetPitch() const;
+
+	/** @return number of textures in the ring */
+	int GetBuffers() const;
+
+private:
+	std::vector<uint8_t> shadow;
+	int pitch = 0;
+	int height = 0;
+
+	/** rows every texture misses */
+	std::vector<Rows> pending;
+	int current = 0;
+	bool changed = false;
+};
+
+inline bool FrameUpload::Rows::Empty() const {
+	return top >= bottom;
+}
+
+inline int FrameUpload::Rows::Count() const {
+	return Empty() ? 0 : bottom - top;
+}
+
+inline const uint8_t* FrameUpload::GetPixels() const {
+	return shadow.data();
+}
+
+inline int FrameUpload::GetPitch() const {
+	return pitch;
+}
+
+inline int FrameUpload::GetBuffers() const {
+	return static_cast<int>(pending.size());
+}
+
+#endif
@@ -116,6 +116,26 @@ void Game_Config::LoadFromArgs(CmdlineParser& cp) {
 			}
 			continue;
 		}
+		if (cp.ParseNext(arg, 1, "--render-threads")) {
+			if (arg.ParseValue(0, li_value)) {
+				video.render_threads.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--present-thread")) {
+			video.present_thread.Set(true);
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--no-present-thread")) {
+			video.present_thread.Set(false);
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--pacing-stats")) {
+			if (arg.ParseValue(0, li_value)) {
+				video.pacing_stats.Set(li_value);
+			}
+			continue;
+		}
 		if (cp.ParseNext(arg, 1, "--autobattle-algo")) {
 			std::string svalue;
 			if (arg.ParseValue(0, svalue)) {
@@ -130,6 +150,68 @@ void Game_Config::LoadFromArgs(CmdlineParser& cp) {
 			}
 			continue;
 		}
+		if (cp.ParseNext(arg, 1, "--bgm-read-ahead")) {
+			if (arg.ParseValue(0, li_value)) {
+				audio.bgm_read_ahead.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--bgm-crossfade")) {
+			audio.bgm_crossfade.Set(true);
+			continue;
+		}
+		if (cp.ParseNext(arg, 0, "--no-bgm-crossfade")) {
+			audio.bgm_crossfade.Set(false);
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--cache-size")) {
+			if (arg.ParseValue(0, li_value)) {
+				cache.size.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--decode-threads")) {
+			if (arg.ParseValue(0, li_value)) {
+				cache.decode_threads.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--sound-cache-size")) {
+			if (arg.ParseValue(0, li_value)) {
+				cache.sound.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--mp-latency")) {
+			if (arg.ParseValue(0, li_value)) {
+				multiplayer.move_latency.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--mp-max-lag")) {
+			if (arg.ParseValue(0, li_value)) {
+				multiplayer.move_max_lag.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--mp-stats")) {
+			if (arg.ParseValue(0, li_value)) {
+				multiplayer.stats_interval.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--mp-picture-rate")) {
+			if (arg.ParseValue(0, li_value)) {
+				multiplayer.picture_rate.Set(li_value);
+			}
+			continue;
+		}
+		if (cp.ParseNext(arg, 1, "--mp-sound-rate")) {
+			if (arg.ParseValue(0, li_value)) {
+				multiplayer.sound_rate.Set(li_value);
+			}
+			continue;
+		}
 
 		cp.SkipNext();
 	}
@@ -180,10 +262,74 @@ void Game_Config::LoadFromConfig(const std::string& path) {
 	if (ini.HasValue("video", "window-zoom")) {
 		video.window_zoom.Set(ini.GetInteger("video", "window-zoom", 0));
 	}
+	if (ini.HasValue("video", "render-threads")) {
+		video.render_threads.Set(ini.GetInteger("video", "render-threads", 0));
+	}
+	if (ini.HasValue("video", "present-thread")) {
+		video.present_thread.Set(ini.GetBoolean("video", "present-thread", false));
+	}
+	if (ini.HasValue("video", "pacing-stats")) {
+		video.pacing_stats.Set(ini.GetInteger("video", "pacing-stats", 0));
+	}
 
 	/** AUDIO SECTION */
 
+	if (ini.HasValue("audio", "bgm-read-ahead")) {
+		audio.bgm_read_ahead.Set(ini.GetInteger("audio", "bgm-read-ahead", 0));
+	}
+	if (ini.HasValue("audio", "bgm-crossfade")) {
+		audio.bgm_crossfade.Set(ini.GetBoolean("audio", "bgm-crossfade", false));
+	}
+
 	/** INPUT SECTION */
+
+	/** MULTIPLAYER SECTION */
+
+	if (ini.HasValue("multiplayer", "move-latency")) {
+		multiplayer.move_latency.Set(ini.GetInteger("multiplayer", "move-latency", 0));
+	}
+	if (ini.HasValue("multiplayer", "move-max-lag")) {
+		multiplayer.move_max_lag.Set(ini.GetInteger("multiplayer", "move-max-lag", 0));
+	}
+	if (ini.HasValue("multiplayer", "stats-interval")) {
+		multiplayer.stats_interval.Set(ini.GetInteger("multiplayer", "stats-interval", 0));
+	}
+	if (ini.HasValue("multiplayer", "picture-rate")) {
+		multiplayer.picture_rate.Set(ini.GetInteger("multiplayer", "picture-rate", 0));
+	}
+	if (ini.HasValue("multiplayer", "sound-rate")) {
+		multiplayer.sound_rate.Set(ini.GetInteger("multiplayer", "sound-rate", 0));
+	}
+
+	/** CACHE SECTION */
+
+	if (ini.HasValue("cache", "size")) {
+		cache.size.Set(ini.GetInteger("cache", "size", 0));
+	}
+	if (ini.HasValue("cache", "picture")) {
+		cache.picture.Set(ini.GetInteger("cache", "picture", 0));
+	}
+	if (ini.HasValue("cache", "panorama")) {
+		cache.panorama.Set(ini.GetInteger("cache", "panorama", 0));
+	}
+	if (ini.HasValue("cache", "charset")) {
+		cache.charset.Set(ini.GetInteger("cache", "charset", 0));
+	}
+	if (ini.HasValue("cache", "chipset")) {
+		cache.chipset.Set(ini.GetInteger("cache", "chipset", 0));
+	}
+	if (ini.HasValue("cache", "battle")) {
+		cache.battle.Set(ini.GetInteger("cache", "battle", 0));
+	}
+	if (ini.HasValue("cache", "other")) {
+		cache.other.Set(ini.GetInteger("cache", "other", 0));
+	}
+	if (ini.HasValue("cache", "decode-threads")) {
+		cache.decode_threads.Set(ini.GetInteger("cache", "decode-threads", 0));
+	}
+	if (ini.HasValue("cache", "sound")) {
+		cache.sound.Set(ini.GetInteger("cache", "sound", 0));
+	}
 }
 
 void Game_Config::WriteToConfig(const std::string& path) const {
@@ -221,10 +367,48 @@ void Game_Config::WriteToConfig(const std::string& path) const {
 	if (video.window_zoom.Enabled()) {
 		of << "window-zoom=" << video.window_zoom.Get() << "\n";
 	}
+	if (video.render_threads.Enabled()) {
+		of << "render-threads=" << video.render_threads.Get() << "\n";
+	}
+	if (video.present_thread.Enabled()) {
+		of << "present-thread=" << int(video.present_thread.Get()) << "\n";
+	}
+	if (video.pacing_stats.Enabled()) {
+		of << "pacing-stats=" << video.pacing_stats.Get() << "\n";
+	}
 	of << "\n";
 
 	/** AUDIO SECTION */
 
+	of << "[audio]\n";
+	of << "bgm-read-ahead=" << audio.bgm_read_ahead.Get() << "\n";
+	of << "bgm-crossfade=" << int(audio.bgm_crossfade.Get()) << "\n";
+	of << "\n";
+
 	/** INPUT SECTION */
+
+	/** MULTIPLAYER SECTION */
+
+	of << "[multiplayer]\n";
+	of << "move-latency=" << multiplayer.move_latency.Get() << "\n";
+	of << "move-max-lag=" << multiplayer.move_max_lag.Get() << "\n";
+	of << "stats-interval=" << multiplayer.stats_interval.Get() << "\n";
+	of << "picture-rate=" << multiplayer.picture_rate.Get() << "\n";
+	of << "sound-rate=" << multiplayer.sound_rate.Get() << "\n";
+	of << "\n";
+
+	/** CACHE SECTION */
+
+	of << "[cache]\n";
+	of << "size=" << cache.size.Get() << "\n";
+	of << "picture=" << cache.picture.Get() << "\n";
+	of << "panorama=" << cache.panorama.Get() << "\n";
+	of << "charset=" << cache.charset.Get() << "\n";
+	of << "chipset=" << cache.chipset.Get() << "\n";
+	of << "battle=" << cache.battle.Get() << "\n";
+	of << "other=" << cache.other.Get() << "\n";
+	of << "decode-threads=" << cache.decode_threads.Get() << "\n";
+	of << "sound=" << cache.sound.Get() << "\n";
+	of << "\n";
 }
 
@@ -35,14 +35,54 @@ struct Game_ConfigVideo {
 	BoolConfigParam fps_render_window{ false };
 	RangeConfigParam<int> fps_limit{ DEFAULT_FPS, 0, std::numeric_limits<int>::max() };
 	RangeConfigParam<int> window_zoom{ 2, 1, std::numeric_limits<int>::max() };
+	/** Horizontal bands the frame is drawn in by worker threads, 0 and 1 draw on the main thread */
+	RangeConfigParam<int> render_threads{ 0, 0, 16 };
+	/** Present on a separate thread, the main loop is then not paced by vsync */
+	BoolConfigParam present_thread{ false };
+	/** Seconds between frame pacing statistic dumps, 0 disables them */
+	RangeConfigParam<int> pacing_stats{ 0, 0, 3600 };
 };
 
 struct Game_ConfigAudio {
+	/** Decoded BGM kept ahead of playback in ms, 0 decodes in the audio callback */
+	RangeConfigParam<int> bgm_read_ahead{ 200, 0, 2000 };
+	/** Fade the previous BGM out while the next one fades in */
+	BoolConfigParam bgm_crossfade{ false };
+};
+
+struct Game_ConfigMultiplayer {
+	/** Delay in ms for buffering the moves of other players */
+	RangeConfigParam<int> move_latency{ 100, 0, 2000 };
+	/** Backlog in ms after which buffered moves are skipped */
+	RangeConfigParam<int> move_max_lag{ 1000, 0, 10000 };
+	/** Seconds between traffic statistic dumps to the log, 0 disables them */
+	RangeConfigParam<int> stats_interval{ 0, 0, 3600 };
+	/** Outbound picture packets per second, 0 is unlimited */
+	RangeConfigParam<int> picture_rate{ 120, 0, 10000 };
+	/** Outbound sound effect packets per second, 0 is unlimited */
+	RangeConfigParam<int> sound_rate{ 0, 0, 10000 };
 };
 
 struct Game_ConfigInput {
 };
 
+/** Bitmap cache budgets in MB, shared by the materials of a group, 0 means only the total applies */
+struct Game_ConfigCache {
+	RangeConfigParam<int> size{ 64, 4, 4096 };
+	RangeConfigParam<int> picture{ 24, 0, 4096 };
+	RangeConfigParam<int> panorama{ 12, 0, 4096 };
+	RangeConfigParam<int> charset{ 0, 0, 4096 };
+	RangeConfigParam<int> chipset{ 0, 0, 4096 };
+	/** Backdrops, battlers, battle animations and monsters */
+	RangeConfigParam<int> battle{ 8, 0, 4096 };
+	/** Facesets, system graphics, title and gameover screens */
+	RangeConfigParam<int> other{ 8, 0, 4096 };
+	/** Threads that decode requested images in the background, 0 decodes when an image is used */
+	RangeConfigParam<int> decode_threads{ 0, 0, 16 };
+	/** Decoded sound effects, resampled to the output format */
+	RangeConfigParam<int> sound{ 8, 0, 4096 };
+};
+
 struct Game_Config {
 	/** Path to last config file we read from */
 	std::string config_path;
@@ -57,7 +97,13 @@ struct Game_Config {
 	Game_ConfigAudio audio;
 
 	/** Input subsystem options */
-	Game_ConfigAudio input;
+	Game_ConfigInput input;
+
+	/** Multiplayer options */
+	Game_ConfigMultiplayer multiplayer;
+
+	/** Bitmap cache options */
+	Game_ConfigCache cache;
 
 	/**
 	 * Create an application config. This first determines the config file path if any,
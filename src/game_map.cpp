@@ -52,7 +52,7 @@
 #include <lcf/rpg/save.h>
 #include "scene_gameover.h"
 #include "game_multiplayer.h"
-#include <emscripten/emscripten.h>
+#include "web_api.h"
 
 namespace {
 	lcf::rpg::SaveMapInfo map_info;
@@ -90,6 +90,29 @@ void Game_Map::OnContinueFromBattle() {
 
 static Game_Map::Parallax::Params GetParallaxParams();
 
+/** Preloads the sounds the events of the map can play */
+static void PreloadSounds(const lcf::rpg::Map& map) {
+	std::vector<std::string> names;
+	for (const auto& ev : map.events) {
+		for (const auto& page : ev.pages) {
+			for (const auto& com : page.event_commands) {
+				if (static_cast<lcf::rpg::EventCommand::Code>(com.code) == lcf::rpg::EventCommand::Code::PlaySound) {
+					names.push_back(ToString(com.string));
+				}
+			}
+			for (const auto& move_command : page.move_route.move_commands) {
+				if (static_cast<lcf::rpg::MoveCommand::Code>(move_command.command_id) == lcf::rpg::MoveCommand::Code::play_sound_effect) {
+					names.push_back(ToString(move_command.parameter_string));
+				}
+			}
+		}
+	}
+
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+	Main_Data::game_system->SePreload(names);
+}
+
 void Game_Map::Init() {
 	Dispose();
 
@@ -310,9 +333,7 @@ std::unique_ptr<lcf::rpg::Map> Game_Map::loadMapFile(int map_id) {
 
 	Output::Debug("Loaded Map {}", map_name);
 
-	EM_ASM({
-		onLoadMap(UTF8ToString($0));
-	}, map_name.c_str());
+	Web_API::OnLoadMap(map_name);
 
 	if (map.get() == NULL) {
 		Output::ErrorStr(lcf::LcfReader::GetError());
@@ -350,6 +371,8 @@ void Game_Map::SetupCommon() {
 	for (const auto& ev : map->events) {
 		events.emplace_back(GetMapId(), &ev);
 	}
+
+	PreloadSounds(*map);
 }
 
 void Game_Map::PrepareSave(lcf::rpg::Save& save) {
@@ -1,6 +1,4 @@
-#include <map>
 #include <memory>
-#include <queue>
 #include <charconv>
 #include <utility>
 #include <bitset>
@@ -17,11 +15,15 @@
 #include "font.h"
 #include "input.h"
 #include "game_map.h"
+#include "game_clock.h"
 #include "game_system.h"
 #include "game_screen.h"
 #include "player.h"
 #include "cache.h"
 #include "chatname.h"
+#include "multiplayer_slot_map.h"
+#include "multiplayer_spatial_grid.h"
+#include "multiplayer_traffic_monitor.h"
 #include "web_api.h"
 #include "yno_connection.h"
 #include "yno_messages.h"
@@ -32,20 +34,46 @@ using Game_Multiplayer::Option;
 namespace {
 	YNOConnection initialize_connection();
 
+	// outbound packets per second, 0 is unlimited
+	int picture_budget = 120;
+	int sound_budget = 0;
+
 	Game_Multiplayer::SettingFlags mp_settings;
 	YNO::PacketLimiter limiter;
+	Multiplayer::TrafficMonitor traffic {&limiter};
 	YNOConnection connection = initialize_connection();
 	bool session_active = false; //if true, it will automatically reconnect when disconnected
 	int host_id = -1;
 	int room_id = -1;
 	std::string host_nickname = "";
-	std::map<int, PlayerOther> players;
-	std::vector<PlayerOther> dc_players;
-
-	void SpawnOtherPlayer(int id) {
+	Multiplayer::SlotMap<PlayerOther> players;
+	std::vector<PlayerOther*> dc_players; //fading out, recycled afterwards
+	Multiplayer::JitterBuffer::duration move_latency = std::chrono::milliseconds(100);
+	Multiplayer::JitterBuffer::duration move_max_lag = std::chrono::milliseconds(1000);
+
+	// tiles around the screen in which players are still fully updated
+	constexpr int view_margin = 2;
+	// frames between updates of players away from the screen
+	constexpr int culled_update_interval = 4;
+	// furthest distance in tiles at which a SE has a volume above 0
+	constexpr int earshot = 7;
+
+	Multiplayer::SpatialGrid grid;
+	Game_Multiplayer::CullStats cull_stats;
+	unsigned frame_count = 0;
+
+	PlayerOther& SpawnOtherPlayer(int id) {
 		auto& player = Main_Data::game_player;
-		auto& nplayer = players[id].ch;
-		nplayer = std::make_unique<Game_PlayerOther>();
+		bool reused;
+		auto& other = players.Insert(id, reused);
+		auto& nplayer = other.ch;
+		if (reused) {
+			// the sprite and chat name keep pointing to this character
+			*nplayer = Game_PlayerOther();
+			other.mvq.Clear();
+		} else {
+			nplayer = std::make_unique<Game_PlayerOther>();
+		}
 		nplayer->SetX(player->GetX());
 		nplayer->SetY(player->GetY());
 		nplayer->SetSpriteGraphic(player->GetSpriteName(), player->GetSpriteIndex());
@@ -55,17 +83,32 @@ namespace {
 		nplayer->SetLayer(player->GetLayer());
 		nplayer->SetMultiplayerVisible(false);
 		nplayer->SetBaseOpacity(0);
+		other.mvq.SetTargetLatency(move_latency);
+		other.mvq.SetMaxLag(move_max_lag);
+		other.in_view = true;
+		other.audible = true;
 
 		auto scene_map = Scene::Find(Scene::SceneType::Map);
 		if (scene_map == nullptr) {
 			Output::Debug("unexpected");
-			return;
+			return other;
 		}
 		auto old_list = &DrawableMgr::GetLocalList();
 		DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
-		players[id].sprite = std::make_unique<Sprite_Character>(nplayer.get());
-		players[id].sprite->SetTone(Main_Data::game_screen->GetTone());
+		if (!other.sprite) {
+			other.sprite = std::make_unique<Sprite_Character>(nplayer.get());
+		}
+		other.sprite->SetTone(Main_Data::game_screen->GetTone());
+		if (other.chat_name) {
+			other.chat_name->Reset(id);
+		}
 		DrawableMgr::SetLocalList(old_list);
+		return other;
+	}
+
+	PlayerOther& GetOtherPlayer(int id) {
+		auto* player = players.Find(id);
+		return player ? *player : SpawnOtherPlayer(id);
 	}
 
 	//this assumes that the player is stopped
@@ -86,6 +129,47 @@ namespace {
 		player->Move(dir[dy+1][dx+1]);
 	}
 
+	// time a single tile move takes at normal game speed
+	Multiplayer::JitterBuffer::duration GetWalkTime(const Game_PlayerOther& player) {
+		int frames = SCREEN_TILE_SIZE / (1 << (1 + player.GetMoveSpeed()));
+		return Game_Clock::GetTargetGameTimeStep() * frames;
+	}
+
+	// marks which players are near the screen and in earshot
+	void UpdateInterest() {
+		const int map_w = Game_Map::GetWidth();
+		const int map_h = Game_Map::GetHeight();
+		const bool loop_h = Game_Map::LoopHorizontal();
+		const bool loop_v = Game_Map::LoopVertical();
+
+		grid.Reset(map_w, map_h, loop_h, loop_v);
+		// the grid stores dense indices, they stay valid for this frame
+		for (size_t i = 0; i < players.size(); ++i) {
+			auto& player = *players.At(i).second;
+			player.in_view = false;
+			player.audible = false;
+			grid.Insert(static_cast<int>(i), player.ch->GetX(), player.ch->GetY());
+		}
+		grid.Build();
+
+		const int view_x = Game_Map::GetDisplayX() / SCREEN_TILE_SIZE - view_margin;
+		const int view_y = Game_Map::GetDisplayY() / SCREEN_TILE_SIZE - view_margin;
+		const int view_w = SCREEN_WIDTH / SCREEN_TILE_SIZE + view_margin * 2 + 1;
+		const int view_h = SCREEN_HEIGHT / SCREEN_TILE_SIZE + view_margin * 2 + 1;
+		grid.Query(view_x, view_y, view_w, view_h, [] (int i) {
+			players.At(i).second->in_view = true;
+		});
+
+		const int px = Main_Data::game_player->GetX();
+		const int py = Main_Data::game_player->GetY();
+		grid.Query(px - earshot, py - earshot, earshot * 2 + 1, earshot * 2 + 1, [&] (int i) {
+			auto& player = *players.At(i).second;
+			int dx = Multiplayer::SpatialGrid::Delta(px, player.ch->GetX(), map_w, loop_h);
+			int dy = Multiplayer::SpatialGrid::Delta(py, player.ch->GetY(), map_h, loop_v);
+			player.audible = static_cast<int>(std::sqrt(dx * dx + dy * dy)) <= earshot;
+		});
+	}
+
 	std::string get_room_url(int room_id) {
 		auto server_url = Web_API::GetSocketURL();
 		std::string room_url = server_url + std::to_string(room_id);
@@ -114,6 +198,11 @@ namespace {
 			Web_API::UpdateConnectionStatus(1); // connected;
 			auto& player = Main_Data::game_player;
 			namespace C = YNO_Messages::C2S;
+			if (p.wire == 1) {
+				// sent as text, everything after it is binary
+				connection.SendPacket(C::WirePacket(1));
+				connection.SetWireFormat(Multiplayer::WireFormat::Binary);
+			}
 			// SendMainPlayerPos();
 			connection.SendPacketAsync<C::MainPlayerPosPacket>(player->GetX(), player->GetY());
 			// SendMainPlayerMoveSpeed(player->GetMoveSpeed());
@@ -136,26 +225,18 @@ namespace {
 		});
 		conn.RegisterHandler<ConnectPacket>("c", [] (ConnectPacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
+			GetOtherPlayer(p.id);
 			Web_API::SyncPlayerData(p.uuid, p.rank, p.id);
 		});
 		conn.RegisterHandler<DisconnectPacket>("d", [] (DisconnectPacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
-			auto& player = players[p.id];
-			if (player.chat_name) {
-				auto scene_map = Scene::Find(Scene::SceneType::Map);
-				if (scene_map == nullptr) {
-					Output::Debug("unexpected");
-					//return;
+			auto* player = players.Detach(p.id);
+			if (player) {
+				if (player->chat_name) {
+					player->chat_name->SetNickname("");
 				}
-				auto old_list = &DrawableMgr::GetLocalList();
-				DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
-				player.chat_name.reset();
-				DrawableMgr::SetLocalList(old_list);
+				dc_players.push_back(player);
 			}
-			dc_players.push_back(std::move(player));
-			players.erase(p.id);
 			if (Main_Data::game_pictures) {
 				Main_Data::game_pictures->EraseAllMultiplayerForPlayer(p.id);
 			}
@@ -165,45 +246,40 @@ namespace {
 		conn.RegisterHandler<ChatPacket>("say", [] (ChatPacket& p) {
 			if (p.id == host_id) Web_API::OnChatMessageReceived(p.msg);
 			else {
-				if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
+				GetOtherPlayer(p.id);
 				Web_API::OnChatMessageReceived(p.msg, p.id);
 			}
 		});
 		conn.RegisterHandler<MovePacket>("m", [] (MovePacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
-			auto& player = players[p.id];
+			auto& player = GetOtherPlayer(p.id);
 			int x = Utils::Clamp(p.x, 0, Game_Map::GetWidth() - 1);
 			int y = Utils::Clamp(p.y, 0, Game_Map::GetHeight() - 1);
-			player.mvq.push(std::make_pair(x, y));
+			player.mvq.Push(x, y, Game_Clock::GetFrameTime(), GetWalkTime(*player.ch));
 
 		});
 		conn.RegisterHandler<FacingPacket>("f", [] (FacingPacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
-			auto& player = players[p.id];
+			auto& player = GetOtherPlayer(p.id);
 			int facing = Utils::Clamp(p.facing, 0, 3);
 			player.ch->SetFacing(facing);
 		});
 		conn.RegisterHandler<SpeedPacket>("spd", [] (SpeedPacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
-			auto& player = players[p.id];
+			auto& player = GetOtherPlayer(p.id);
 			int speed = Utils::Clamp(p.speed, 1, 6);
 			player.ch->SetMoveSpeed(speed);
 		});
 		conn.RegisterHandler<SpritePacket>("spr", [] (SpritePacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
-			auto& player = players[p.id];
+			auto& player = GetOtherPlayer(p.id);
 			int idx = Utils::Clamp(p.index, 0, 7);
 			player.ch->SetSpriteGraphic(std::string(p.name), idx);
 			Web_API::OnPlayerSpriteUpdated(p.name, idx, p.id);
 		});
 		conn.RegisterHandler<SystemPacket>("sys", [] (SystemPacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
-			auto& player = players[p.id];
+			auto& player = GetOtherPlayer(p.id);
 			auto chat_name = player.chat_name.get();
 			if (chat_name) {
 				chat_name->SetSystemGraphic(std::string(p.name));
@@ -212,10 +288,13 @@ namespace {
 		});
 		conn.RegisterHandler<SEPacket>("se", [] (SEPacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
+			auto& player = GetOtherPlayer(p.id);
 
 			if (mp_settings(Option::ENABLE_PLAYER_SOUNDS)) {
-				auto& player = players[p.id];
+				if (!player.audible) {
+					++cull_stats.se_skipped;
+					return;
+				}
 
 				int px = Main_Data::game_player->GetX();
 				int py = Main_Data::game_player->GetY();
@@ -246,14 +325,14 @@ namespace {
 
 				int dist = std::sqrt(rx * rx + ry * ry);
 				float dist_volume = 75.0f - ((float)dist * 10.0f);
-				float sound_volume_multiplier = float(p.snd.volume) / 100.0f;
+				float sound_volume_multiplier = float(p.volume) / 100.0f;
 				int real_volume = std::max((int)(dist_volume * sound_volume_multiplier), 0);
 
 				lcf::rpg::Sound sound;
-				sound.name = p.snd.name;
+				sound.name = std::string(p.name);
 				sound.volume = real_volume;
-				sound.tempo = p.snd.tempo;
-				sound.balance = p.snd.balance;
+				sound.tempo = p.tempo;
+				sound.balance = p.balance;
 
 				Main_Data::game_system->SePlay(sound);
 			}
@@ -278,28 +357,27 @@ namespace {
 
 		conn.RegisterHandler<ShowPicturePacket>("ap", [modify_args] (ShowPicturePacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
+			GetOtherPlayer(p.id);
 			modify_args(p);
 			int pic_id = p.pic_id + (p.id + 1) * 50; //offset to avoid conflicting with others using the same picture
 			Main_Data::game_pictures->Show(pic_id, p.params);
 		});
 		conn.RegisterHandler<MovePicturePacket>("mp", [modify_args] (MovePicturePacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
+			GetOtherPlayer(p.id);
 			int pic_id = p.pic_id + (p.id + 1) * 50; //offset to avoid conflicting with others using the same picture
 			modify_args(p);
 			Main_Data::game_pictures->Move(pic_id, p.params);
 		});
 		conn.RegisterHandler<ErasePicturePacket>("rp", [] (ErasePicturePacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
+			GetOtherPlayer(p.id);
 			int pic_id = p.pic_id + (p.id + 1) * 50; //offset to avoid conflicting with others using the same picture
 			Main_Data::game_pictures->Erase(pic_id);
 		});
 		conn.RegisterHandler<NamePacket>("name", [] (NamePacket& p) {
 			if (p.id == host_id) return;
-			if (players.find(p.id) == players.end()) SpawnOtherPlayer(p.id);
-			auto& player = players[p.id];
+			auto& player = GetOtherPlayer(p.id);
 			auto scene_map = Scene::Find(Scene::SceneType::Map);
 			if (scene_map == nullptr) {
 				Output::Debug("unexpected");
@@ -307,12 +385,18 @@ namespace {
 			}
 			auto old_list = &DrawableMgr::GetLocalList();
 			DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
-			player.chat_name = std::make_unique<ChatName>(p.id, player, std::string(p.name));
+			if (player.chat_name) {
+				player.chat_name->SetNickname(std::string(p.name));
+			} else {
+				player.chat_name = std::make_unique<ChatName>(p.id, player, std::string(p.name));
+			}
 			DrawableMgr::SetLocalList(old_list);
 
 			Web_API::OnPlayerNameUpdated(p.name, p.id);
 		});
-		conn.SetMonitor(&limiter);
+		conn.SetMonitor(&traffic);
+		conn.SetBudget(Multiplayer::PacketLane::Picture, picture_budget);
+		conn.SetBudget(Multiplayer::PacketLane::Sound, sound_budget);
 		return conn;
 	}
 
@@ -386,8 +470,8 @@ void Game_Multiplayer::Quit() {
 	Web_API::UpdateConnectionStatus(0); // disconnected
 	session_active = false;
 	connection.Close();
-	players.clear();
 	dc_players.clear();
+	players.clear();
 	if (Main_Data::game_pictures) {
 		Main_Data::game_pictures->EraseAllMultiplayer();
 	}
@@ -441,14 +525,14 @@ void Game_Multiplayer::PictureErased(int pic_id) {
 }
 
 void Game_Multiplayer::ApplyFlash(int r, int g, int b, int power, int frames) {
-for (auto& p : players) {
-		p.second.ch->Flash(r, g, b, power, frames);
+	for (auto& p : players) {
+		p.second->ch->Flash(r, g, b, power, frames);
 	}
 }
 
 void Game_Multiplayer::ApplyTone(Tone tone) {
 	for (auto& p : players) {
-		p.second.sprite->SetTone(tone);
+		p.second->sprite->SetTone(tone);
 	}
 }
 
@@ -458,15 +542,65 @@ void Game_Multiplayer::ApplyScreenTone() {
 
 Game_Multiplayer::SettingFlags& Game_Multiplayer::GetSettingFlags() { return mp_settings; }
 
+const Game_Multiplayer::CullStats& Game_Multiplayer::GetCullStats() { return cull_stats; }
+
+std::vector<std::string> Game_Multiplayer::GetTrafficSummary() {
+	auto r = traffic.GetSummary();
+	r.insert(r.begin(), fmt::format("Players {}  Culled {}  Inaudible {}",
+		cull_stats.players, cull_stats.culled, cull_stats.inaudible));
+	auto out = connection.GetOutboundStats();
+	r.insert(r.begin() + 2, fmt::format("Deferred {}  Coalesced {}  SE dropped {}",
+		out.deferred, out.coalesced, out.dropped));
+	return r;
+}
+
+void Game_Multiplayer::SetTrafficDumpInterval(int seconds) {
+	traffic.SetDumpInterval(seconds);
+}
+
+void Game_Multiplayer::SetOutboundBudget(int pictures_per_second, int sounds_per_second) {
+	picture_budget = pictures_per_second;
+	sound_budget = sounds_per_second;
+	connection.SetBudget(Multiplayer::PacketLane::Picture, picture_budget);
+	connection.SetBudget(Multiplayer::PacketLane::Sound, sound_budget);
+}
+
+void Game_Multiplayer::SetMoveBuffering(int latency_ms, int max_lag_ms) {
+	move_latency = std::chrono::milliseconds(latency_ms);
+	move_max_lag = std::chrono::milliseconds(max_lag_ms);
+	for (auto& p : players) {
+		p.second->mvq.SetTargetLatency(move_latency);
+		p.second->mvq.SetMaxLag(move_max_lag);
+	}
+}
+
 void Game_Multiplayer::Update() {
 	if (mp_settings(Option::SINGLE_PLAYER)) return;
 
+	cull_stats.se_skipped = 0;
+	connection.Poll();
+
+	UpdateInterest();
+	++frame_count;
+	cull_stats.players = players.size();
+	cull_stats.culled = 0;
+	cull_stats.inaudible = 0;
+
+	const auto now = Game_Clock::GetFrameTime();
 	for (auto& p : players) {
-		auto& q = p.second.mvq;
-		auto& ch = p.second.ch;
-		if (!q.empty() && ch->IsStopping()) {
-			MovePlayerToPos(ch, q.front().first, q.front().second);
-			q.pop();
+		auto& player = *p.second;
+		auto& ch = player.ch;
+		auto& sprite = player.sprite;
+		auto step = player.mvq.Update(now);
+		if (step.started) {
+			// a late frame can start the next move before the last one ended
+			ch->SetRemainingStep(0);
+			if (step.skipped) {
+				ch->SetX(step.x);
+				ch->SetY(step.y);
+			} else {
+				MovePlayerToPos(ch, step.x, step.y);
+			}
 			if (!ch->IsMultiplayerVisible()) {
 				ch->SetMultiplayerVisible(true);
 			}
@@ -474,9 +608,27 @@ void Game_Multiplayer::Update() {
 		if (ch->IsMultiplayerVisible() && ch->GetBaseOpacity() < 32) {
 			ch->SetBaseOpacity(ch->GetBaseOpacity() + 1);
 		}
-		ch->SetProcessed(false);
-		ch->Update();
-		p.second.sprite->Update();
+		if (!player.audible) {
+			++cull_stats.inaudible;
+		}
+
+		// away from the screen only the position has to stay current,
+		// the ids spread the character updates over the frames
+		const bool culled = !player.in_view;
+		if (!culled || (frame_count + p.first) % culled_update_interval == 0) {
+			ch->SetProcessed(false);
+			ch->Update();
+		}
+		if (ch->IsMoving()) {
+			// walk at the pace of the buffer instead of the frame rate
+			ch->SetRemainingStep(step.remaining);
+		}
+		if (culled) {
+			++cull_stats.culled;
+			sprite->SetVisible(false);
+		} else {
+			sprite->Update();
+		}
 	}
 
 	if (!dc_players.empty()) {
@@ -489,15 +641,22 @@ void Game_Multiplayer::Update() {
 		auto old_list = &DrawableMgr::GetLocalList();
 		DrawableMgr::SetLocalList(&scene_map->GetDrawableList());
 		
-		for (auto dcpi = dc_players.rbegin(); dcpi != dc_players.rend(); dcpi++) {
-			auto& ch = (*dcpi).ch;
+		for (size_t i = 0; i < dc_players.size();) {
+			auto& player = *dc_players[i];
+			auto& ch = player.ch;
 			if (ch->GetBaseOpacity() > 0) {
 				ch->SetBaseOpacity(ch->GetBaseOpacity() - 1);
 				ch->SetProcessed(false);
 				ch->Update();
-				(*dcpi).sprite->Update();
+				player.sprite->Update();
+				++i;
 			} else {
-				dc_players.erase(dcpi.base() - 1);
+				// hidden until the pool hands it out again
+				player.sprite->SetVisible(false);
+				player.in_view = false;
+				players.Recycle(&player);
+				dc_players[i] = dc_players.back();
+				dc_players.pop_back();
 			}
 		}
 
@@ -505,5 +664,6 @@ void Game_Multiplayer::Update() {
 	}
 
 	connection.FlushQueue();
+	traffic.Update(Game_Clock::GetFrameTime());
 }
 
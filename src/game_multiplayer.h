@@ -2,6 +2,7 @@
 #define EP_GAME_MULTIPLAYER_H
 
 #include <string>
+#include <vector>
 #include <bitset>
 #include "string_view.h"
 #include "game_pictures.h"
@@ -25,6 +26,47 @@ namespace Game_Multiplayer {
 	void ApplyTone(Tone tone);
 	void ApplyScreenTone();
 
+	/**
+	 * Configures the jitter buffer of remote player movement.
+	 *
+	 * @param latency_ms delay moves are played back with
+	 * @param max_lag_ms backlog after which moves are skipped
+	 */
+	void SetMoveBuffering(int latency_ms, int max_lag_ms);
+
+	/** How many remote players were skipped in the last Update */
+	struct CullStats {
+		/** remote players on the map */
+		int players = 0;
+		/** players away from the screen, updated at a lower rate without sprite */
+		int culled = 0;
+		/** players out of earshot of the main player */
+		int inaudible = 0;
+		/** SE of inaudible players that were not played */
+		int se_skipped = 0;
+	};
+
+	const CullStats& GetCullStats();
+
+	/** @return traffic statistics of the last second for the overlay, one entry per line */
+	std::vector<std::string> GetTrafficSummary();
+
+	/**
+	 * Writes the traffic statistics to the log as JSON in an interval.
+	 *
+	 * @param seconds interval, 0 disables it
+	 */
+	void SetTrafficDumpInterval(int seconds);
+
+	/**
+	 * Limits outbound cosmetic packets. Picture updates over the budget are
+	 * sent later, merged to their latest state; sounds over it are skipped.
+	 *
+	 * @param pictures_per_second picture packets per second, 0 is unlimited
+	 * @param sounds_per_second sound packets per second, 0 is unlimited
+	 */
+	void SetOutboundBudget(int pictures_per_second, int sounds_per_second);
+
 	enum class Option {
 		SINGLE_PLAYER,
 		ENABLE_NICKS,
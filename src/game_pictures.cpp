@@ -347,6 +347,7 @@ void Game_Pictures::RequestPictureSprite(Picture& pic) {
 
 	FileRequestAsync* request = AsyncHandler::RequestFile("Picture", name);
 	request->SetGraphicFile(true);
+	request->SetTransparent(pic.data.use_transparent_color);
 
 	int pic_id = pic.data.ID;
 
@@ -184,6 +184,19 @@ void Game_System::SePlay(const lcf::rpg::Animation &animation) {
 	}
 }
 
+void Game_System::SePreload(const std::vector<std::string>& names) {
+	se_preload_ids.clear();
+	for (const auto& name : names) {
+		if (name.empty() || name == "(OFF)" || StringView(name).ends_with(".script")) {
+			continue;
+		}
+
+		FileRequestAsync* request = AsyncHandler::RequestFile("Sound", name);
+		se_preload_ids.push_back(request->Bind(&Game_System::OnSePreloadReady, this));
+		request->Start();
+	}
+}
+
 StringView Game_System::GetSystemName() {
 	return !data.graphics_name.empty() ?
 		StringView(data.graphics_name) : StringView(lcf::Data::system.system_name);
@@ -568,6 +581,15 @@ void Game_System::OnSeReady(FileRequestResult* result, lcf::rpg::Sound se, bool
 	Audio().SE_Play(std::move(stream), se.volume, se.tempo);
 }
 
+void Game_System::OnSePreloadReady(FileRequestResult* result) {
+	Filesystem_Stream::InputStream stream;
+	if (IsStopSoundFilename(result->file, stream) || !stream) {
+		return;
+	}
+
+	Audio().SE_Preload(std::move(stream));
+}
+
 bool Game_System::IsMessageTransparent() {
 	if (Player::IsRPG2k() && Game_Battle::IsBattleRunning()) {
 		return false;
@@ -21,6 +21,7 @@
 // Headers
 #include <string>
 #include <map>
+#include <vector>
 #include <lcf/rpg/animation.h>
 #include <lcf/rpg/music.h>
 #include <lcf/rpg/sound.h>
@@ -146,6 +147,15 @@ public:
 	 */
 	void SePlay(const lcf::rpg::Animation& animation);
 
+	/**
+	 * Prepares sounds that are likely to be played soon so that playing them
+	 * does not decode. Replaces the sounds of the previous call that are
+	 * still being requested.
+	 *
+	 * @param names sound filenames.
+	 */
+	void SePreload(const std::vector<std::string>& names);
+
 	/** @return system graphic filename.  */
 	StringView GetSystemName();
 
@@ -489,6 +499,7 @@ private:
 	void OnBgmReady(FileRequestResult* result);
 	void OnBgmInelukiReady(FileRequestResult* result);
 	void OnSeReady(FileRequestResult* result, lcf::rpg::Sound se, bool stop_sounds);
+	void OnSePreloadReady(FileRequestResult* result);
 	void OnChangeSystemGraphicReady(FileRequestResult* result);
 private:
 	lcf::rpg::SaveSystem data;
@@ -496,6 +507,7 @@ private:
 	FileRequestBinding music_request_id;
 	FileRequestBinding system_request_id;
 	std::map<std::string, FileRequestBinding> se_request_ids;
+	std::vector<FileRequestBinding> se_preload_ids;
 	Color bg_color = Color{ 0, 0, 0, 255 };
 	bool bgm_pending = false;
 };
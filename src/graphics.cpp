@@ -21,6 +21,7 @@
 #include <chrono>
 
 #include "graphics.h"
+#include "band_renderer.h"
 #include "cache.h"
 #include "player.h"
 #include "fps_overlay.h"
@@ -30,6 +31,7 @@
 #include "drawable_mgr.h"
 #include "baseui.h"
 #include "game_clock.h"
+#include "output.h"
 
 using namespace std::chrono_literals;
 
@@ -40,6 +42,7 @@ namespace Graphics {
 
 	std::unique_ptr<MessageOverlay> message_overlay;
 	std::unique_ptr<FpsOverlay> fps_overlay;
+	std::unique_ptr<BandRenderer> band_renderer;
 
 	std::string window_title_key;
 }
@@ -53,6 +56,7 @@ void Graphics::Init() {
 }
 
 void Graphics::Quit() {
+	band_renderer.reset();
 	fps_overlay.reset();
 	message_overlay.reset();
 
@@ -127,7 +131,27 @@ void Graphics::LocalDraw(Bitmap& dst, int min_z, int max_z) {
 		current_scene->DrawBackground(dst);
 	}
 
-	drawable_list.Draw(dst, min_z, max_z);
+	if (band_renderer) {
+		band_renderer->Draw(dst, drawable_list, min_z, max_z);
+	} else {
+		drawable_list.Draw(dst, min_z, max_z);
+	}
+}
+
+void Graphics::SetRenderThreads(int threads) {
+#if defined(EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+	// Not built with thread support
+	threads = 0;
+#endif
+	if (threads <= 1) {
+		band_renderer.reset();
+		return;
+	}
+
+	if (!band_renderer || band_renderer->GetBands() != threads) {
+		band_renderer = std::make_unique<BandRenderer>(threads);
+		Output::Debug("Drawing the screen in {} bands", threads);
+	}
 }
 
 std::shared_ptr<Scene> Graphics::UpdateSceneCallback() {
@@ -151,3 +175,7 @@ MessageOverlay& Graphics::GetMessageOverlay() {
 	return *message_overlay;
 }
 
+FpsOverlay& Graphics::GetFpsOverlay() {
+	return *fps_overlay;
+}
+
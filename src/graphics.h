@@ -26,6 +26,7 @@
 #include "game_clock.h"
 
 class MessageOverlay;
+class FpsOverlay;
 class Scene;
 
 /**
@@ -52,6 +53,14 @@ namespace Graphics {
 
 	void LocalDraw(Bitmap& dst, int min_z, int max_z);
 
+	/**
+	 * Sets the number of horizontal bands the scene is drawn in, each on
+	 * its own thread. 0 or 1 draws everything on the main thread.
+	 *
+	 * @param threads number of bands
+	 */
+	void SetRenderThreads(int threads);
+
 	std::shared_ptr<Scene> UpdateSceneCallback();
 
 	/**
@@ -61,6 +70,13 @@ namespace Graphics {
 	 * @return message overlay
 	 */
 	MessageOverlay& GetMessageOverlay();
+
+	/**
+	 * Returns a handle to the fps overlay.
+	 *
+	 * @return fps overlay
+	 */
+	FpsOverlay& GetFpsOverlay();
 }
 
 #endif
@@ -75,6 +75,7 @@ namespace Input {
 		FAST_FORWARD_PLUS,
 		TOGGLE_FULLSCREEN,
 		TOGGLE_ZOOM,
+		TOGGLE_NET_STATS,
 		BUTTON_COUNT
 	};
 
@@ -118,6 +119,7 @@ namespace Input {
 		"FAST_FORWARD_PLUS",
 		"TOGGLE_FULLSCREEN",
 		"TOGGLE_ZOOM",
+		"TOGGLE_NET_STATS",
 		"BUTTON_COUNT");
 
 	constexpr auto kButtonHelp = lcf::makeEnumTags<InputButton>(
@@ -160,6 +162,7 @@ namespace Input {
 		"Fast forward plus key",
 		"Toggle Fullscreen mode",
 		"Toggle Window Zoom level",
+		"Toggle the multiplayer traffic display",
 		"Total Button Count");
 
 	/**
@@ -173,6 +176,7 @@ namespace Input {
 			case TAKE_SCREENSHOT:
 			case SHOW_LOG:
 			case TOGGLE_ZOOM:
+			case TOGGLE_NET_STATS:
 			case FAST_FORWARD:
 			case FAST_FORWARD_PLUS:
 				return true;
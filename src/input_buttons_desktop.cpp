@@ -94,6 +94,7 @@ Input::ButtonMappingArray Input::GetDefaultButtonMappings() {
 		{SHOW_LOG, Keys::F3},
 		{TOGGLE_FULLSCREEN, Keys::F4},
 		{TOGGLE_ZOOM, Keys::F5},
+		{TOGGLE_NET_STATS, Keys::F8},
 		{PAGE_UP, Keys::PGUP},
 		{PAGE_DOWN, Keys::PGDN},
 		{RESET, Keys::F12},
@@ -1,23 +1,74 @@
 #include "multiplayer_connection.h"
 #include "output.h"
+#include <algorithm>
 
 using namespace Multiplayer;
 
 void Connection::SendPacket(const C2SPacket& p) {
-	Send(p.ToBytes());
+	if (wire_format == WireFormat::Binary) {
+		std::string r(1, Packet::BINARY_MARKER);
+		r += p.ToBinary();
+		Send(r);
+	} else {
+		Send(p.ToBytes());
+	}
 }
 
 void Connection::FlushQueue() {
+	NotifyFlush();
 	while (!m_queue.empty()) {
-		auto& e = m_queue.front();
-		Send(e->ToBytes());
+		SendPacket(m_queue.front());
 		m_queue.pop();
 	}
+	for (size_t n = TakeDeferred(); n > 0; --n) {
+		SendPacket(m_deferred.front());
+		m_deferred.pop();
+	}
+}
+
+void Connection::SetBudget(PacketLane lane, int per_second) {
+	if (lane == PacketLane::Priority)
+		return;
+	// a quarter second worth of packets may go out at once
+	Budget(lane).SetRate(per_second, std::max(per_second / 4, 1));
+}
+
+Connection::OutboundStats Connection::GetOutboundStats() const {
+	OutboundStats s;
+	s.deferred = m_deferred.size();
+	s.coalesced = m_deferred.GetCoalescedCount();
+	s.dropped = sounds_dropped;
+	return s;
+}
+
+size_t Connection::TakeDeferred() {
+	// budgets advance with the frame time, all packets of a frame share it
+	auto now = Game_Clock::GetFrameTime();
+	size_t n = 0;
+	while (n < m_deferred.size() && Budget(PacketLane::Picture).Take(now))
+		++n;
+	return n;
+}
+
+namespace {
+	struct HandlerNameLess {
+		template <typename T>
+		bool operator()(const T& a, std::string_view b) const { return a.first < b; }
+	};
+}
+
+void Connection::AddHandler(std::string_view name, Handler h) {
+	auto it = std::lower_bound(handlers.begin(), handlers.end(), name, HandlerNameLess());
+	if (it != handlers.end() && it->first == name) {
+		it->second = std::move(h);
+	} else {
+		handlers.emplace(it, name, std::move(h));
+	}
 }
 
-void Connection::Dispatch(std::string_view name, ParameterList args) {
-	auto it = handlers.find(std::string(name));
-	if (it != handlers.end()) {
+void Connection::Dispatch(std::string_view name, const ParameterList& args) {
+	auto it = std::lower_bound(handlers.begin(), handlers.end(), name, HandlerNameLess());
+	if (it != handlers.end() && it->first == name) {
 		try {
 			std::invoke(it->second, args);
 		} catch (MessageProcessingException& e) {
@@ -32,17 +83,60 @@ void Connection::Dispatch(std::string_view name, ParameterList args) {
 	}
 }
 
+void Connection::DispatchMessage(std::string_view msg) {
+	if (monitor)
+		monitor->OnMessageReceived(msg.size());
+	auto p = msg.find(Packet::PARAM_DELIM);
+	if (p == msg.npos) {
+		/*
+		Usually npos is the maximum value of size_t.
+		Adding to it is undefined behavior.
+		If it returns end iterator instead of npos, the if statement is
+		duplicated code because the statement in else clause will handle it.
+		*/
+		Dispatch(msg);
+	} else {
+		auto namestr = msg.substr(0, p);
+		auto argstr = msg.substr(p + Packet::PARAM_DELIM.size());
+		Dispatch(namestr, Split(argstr));
+	}
+}
+
+void Connection::DispatchBinary(std::string_view msg) {
+	if (monitor)
+		monitor->OnMessageReceived(msg.size());
+	if (msg.empty() || msg.front() != Packet::BINARY_MARKER) {
+		Output::Debug("Binary message without marker");
+		return;
+	}
+	msg.remove_prefix(1);
+
+	S2CPacket::BinaryScratch scratch;
+	ParameterList args;
+	std::string_view name;
+	while (!msg.empty()) {
+		try {
+			S2CPacket::DecodeBinary(msg, name, args, scratch);
+		} catch (PacketDecodingException& e) {
+			Output::Debug("Exception when decoding binary message: {}", e.what());
+			return;
+		}
+		Dispatch(name, args);
+	}
+}
+
 Connection::ParameterList Connection::Split(std::string_view src,
 	std::string_view delim) {
 	size_t p{}, p2{};
-	std::vector<std::string_view> r;
+	ParameterList r;
 	while ((p = src.find(delim, p)) != src.npos) {
-		r.emplace_back(src.substr(p2, p - p2));
+		if (!r.push_back(src.substr(p2, p - p2)))
+			return r;
 		p += delim.size();
 		p2 = p;
 	}
 	if (p2 != src.length())
-		r.emplace_back(src.substr(p2));
+		r.push_back(src.substr(p2));
 	return r;
 }
 
@@ -51,6 +145,12 @@ void Connection::RegisterSystemHandler(SystemMessage m, SystemMessageHandler h)
 }
 
 void Connection::DispatchSystem(SystemMessage m) {
+	if (monitor) {
+		if (m == SystemMessage::OPEN)
+			monitor->OnOpen();
+		else if (m == SystemMessage::CLOSE)
+			monitor->OnClose();
+	}
 	auto f = sys_handlers[static_cast<size_t>(m)];
 	if (f)
 		std::invoke(f, *this);
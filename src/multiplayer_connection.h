@@ -2,15 +2,15 @@
 #define EP_MULTIPLAYER_CONNECTION_H
 
 #include <stdexcept>
-#include <queue>
 #include <memory>
-#include <map>
 #include <vector>
 #include <functional>
 #include <type_traits>
 #include <string>
 
 #include "multiplayer_packet.h"
+#include "multiplayer_packet_queue.h"
+#include "multiplayer_token_bucket.h"
 #include "connection_monitor.h"
 
 namespace Multiplayer {
@@ -24,20 +24,68 @@ public:
 
 class Connection {
 public:
-	Connection() : connected(false), monitor(nullptr) {}
+	Connection() : connected(false), wire_format(WireFormat::Text), monitor(nullptr) {}
 	Connection(const Connection&) = delete;
 	Connection(Connection&&) = default;
 	Connection& operator=(const Connection&) = delete;
 	Connection& operator=(Connection&&) = default;
 
-	using ParameterList = std::vector<std::string_view>;
+	using ParameterList = Multiplayer::ParameterList;
 
 	void SendPacket(const C2SPacket& p);
+	/**
+	 * Queues a packet until the next FlushQueue.
+	 * State packets replace a pending packet of the same kind, see PacketQueue.
+	 *
+	 * Packets of a limited lane are subject to its budget: sounds beyond it
+	 * are dropped, pictures wait in a separate queue until tokens are
+	 * available and coalesce there meanwhile.
+	 */
 	template<typename T, typename... Args>
 	void SendPacketAsync(Args... args) {
-		m_queue.emplace(new T(args...));
+		constexpr PacketLane lane = LaneOf<T>::value;
+		if constexpr (lane == PacketLane::Sound) {
+			if (!Budget(lane).Take(Game_Clock::GetFrameTime())) {
+				++sounds_dropped;
+				return;
+			}
+		}
+		if constexpr (lane == PacketLane::Picture) {
+			// keep the order of pictures while the deferred queue drains
+			if (Budget(lane).IsLimited() || !m_deferred.empty()) {
+				if (m_deferred.full()) {
+					// never drop a picture update, overdraw the budget instead
+					Budget(lane).Force(Game_Clock::GetFrameTime());
+					SendPacket(m_deferred.front());
+					m_deferred.pop();
+				}
+				m_deferred.Emplace<T>(args...);
+				return;
+			}
+		}
+		if (m_queue.full())
+			FlushQueue();
+		m_queue.Emplace<T>(args...);
 	}
 
+	/**
+	 * Sets the outbound budget of a lane.
+	 *
+	 * @param lane lane to limit, the priority lane is never limited
+	 * @param per_second packets per second, 0 disables the limit
+	 */
+	void SetBudget(PacketLane lane, int per_second);
+
+	struct OutboundStats {
+		/** picture packets waiting for budget */
+		size_t deferred = 0;
+		/** picture moves replaced by a newer one while waiting */
+		size_t coalesced = 0;
+		/** sound packets dropped over budget */
+		size_t dropped = 0;
+	};
+	OutboundStats GetOutboundStats() const;
+
 	virtual void Open(std::string_view uri) = 0;
 	virtual void Close() {}
 
@@ -49,11 +97,22 @@ public:
 		std::is_constructible<M, const ParameterList&>
 	>>>
 	void RegisterHandler(std::string_view name, std::function<void (M&)> h) {
-		handlers.emplace(name, [this, h, name] (const ParameterList& args) {
+		AddHandler(name, [this, h, name] (const ParameterList& args) {
+			// Connections without a monitor, e.g. in tests, skip the timing.
+			// Game_Multiplayer always sets one, it also applies the limiter.
+			if (!monitor) {
+				M pack {args};
+				std::invoke(h, pack);
+				return;
+			}
+			auto t0 = Game_Clock::now();
 			M pack {args};
-			if (Notify(name, pack) == ConnectionMonitor::Action::DROP)
+			auto t1 = Game_Clock::now();
+			if (monitor->OnReceive(name, pack) == ConnectionMonitor::Action::DROP)
 				return;
+			auto t2 = Game_Clock::now();
 			std::invoke(h, pack);
+			monitor->OnHandled(name, t1 - t0, Game_Clock::now() - t2);
 		});
 	}
 
@@ -65,7 +124,13 @@ public:
 	using SystemMessageHandler = std::function<void (Connection&)>;
 	void RegisterSystemHandler(SystemMessage m, SystemMessageHandler h);
 
-	void Dispatch(std::string_view name, ParameterList args = ParameterList());
+	void Dispatch(std::string_view name, const ParameterList& args = ParameterList());
+
+	/** Splits a raw "name<PARAM_DELIM>args..." message and dispatches it. */
+	void DispatchMessage(std::string_view msg);
+
+	/** Decodes every packet of a binary message and dispatches them. */
+	void DispatchBinary(std::string_view msg);
 
 	bool IsConnected() const { return connected; }
 
@@ -76,26 +141,62 @@ public:
 
 	void SetMonitor(ConnectionMonitor* m) { monitor = m; }
 
-	static std::vector<std::string_view> Split(std::string_view src, std::string_view delim = Packet::PARAM_DELIM);
+	/** Format of outgoing packets, incoming ones are detected per message. */
+	void SetWireFormat(WireFormat f) { wire_format = f; }
+	WireFormat GetWireFormat() const { return wire_format; }
+
+	/**
+	 * Splits src at every delim without allocating.
+	 * Parameters beyond ParameterList::MAX_PARAMS are dropped.
+	 */
+	static ParameterList Split(std::string_view src, std::string_view delim = Packet::PARAM_DELIM);
 
 protected:
 	bool connected;
-	std::queue<std::unique_ptr<C2SPacket>> m_queue;
+	WireFormat wire_format;
+	PacketQueue m_queue;
+	/** picture lane packets waiting for budget */
+	PacketQueue m_deferred;
+
+	/** @return amount of deferred packets the budget allows to send now */
+	size_t TakeDeferred();
 
 	void SetConnected(bool v) { connected = v; }
 	void DispatchSystem(SystemMessage m);
-	ConnectionMonitor::Action Notify(std::string_view name, const S2CPacket& p) {
+	void NotifySent(size_t bytes) {
 		if (monitor)
-			return monitor->OnReceive(name, p);
-		return ConnectionMonitor::Action::NONE;
+			monitor->OnMessageSent(bytes);
 	}
+	void NotifyFlush() {
+		if (monitor && !m_queue.empty())
+			monitor->OnFlush(m_queue.size());
+	}
+
+	using Handler = std::function<void (const ParameterList&)>;
+	void AddHandler(std::string_view name, Handler h);
 
-	std::map<std::string, std::function<void (const ParameterList&)>> handlers;
+	/**
+	 * Handler table sorted by packet name. Names are string literals, so
+	 * the views stay valid and lookups are a binary search without
+	 * building a std::string key.
+	 */
+	std::vector<std::pair<std::string_view, Handler>> handlers;
 	SystemMessageHandler sys_handlers[static_cast<size_t>(SystemMessage::_PLACEHOLDER)];
 
 	ConnectionMonitor* monitor;
 
 	std::string key;
+
+private:
+	template <typename T, typename = void>
+	struct LaneOf : std::integral_constant<PacketLane, PacketLane::Priority> {};
+	template <typename T>
+	struct LaneOf<T, std::void_t<decltype(T::lane)>> : std::integral_constant<PacketLane, T::lane> {};
+
+	TokenBucket& Budget(PacketLane lane) { return budgets[static_cast<size_t>(lane)]; }
+
+	TokenBucket budgets[static_cast<size_t>(PacketLane::_Count)];
+	size_t sounds_dropped = 0;
 };
 
 }
@@ -0,0 +1,66 @@
+#include "multiplayer_jitter_buffer.h"
+#include <algorithm>
+
+using namespace Multiplayer;
+
+void JitterBuffer::Push(int x, int y, time_point now, duration walk) {
+	auto start = now + latency;
+	if (count > 0) {
+		auto& last = At(count - 1);
+		start = std::max(start, last.start + last.walk);
+	} else if (has_current) {
+		start = std::max(start, current.start + current.walk);
+	}
+
+	if (start - now > latency + max_lag || count == CAPACITY) {
+		// too far behind, the queued moves are not worth replaying
+		skipped += count;
+		head = 0;
+		count = 0;
+		start = now;
+		skip_pending = true;
+	}
+
+	At(count++) = { x, y, start, walk };
+}
+
+JitterBuffer::Step JitterBuffer::Update(time_point now) {
+	Step r;
+
+	// Moves are scheduled back to back, so the next one is only due when
+	// the current one finished. After a stall one move per call is started
+	// until the schedule caught up.
+	if (count > 0 && now >= At(0).start) {
+		current = At(0);
+		has_current = true;
+		head = (head + 1) % CAPACITY;
+		--count;
+		r.started = true;
+		r.skipped = skip_pending;
+		skip_pending = false;
+	}
+
+	if (!has_current)
+		return r;
+
+	r.x = current.x;
+	r.y = current.y;
+	auto elapsed = now - current.start;
+	if (elapsed < current.walk) {
+		r.remaining = STEP_SIZE - static_cast<int>(STEP_SIZE * elapsed / current.walk);
+	}
+	return r;
+}
+
+void JitterBuffer::Clear() {
+	head = 0;
+	count = 0;
+	has_current = false;
+	skip_pending = false;
+}
+
+JitterBuffer::duration JitterBuffer::GetBacklog(time_point now) const {
+	if (count == 0)
+		return duration::zero();
+	return std::max(duration::zero(), At(count - 1).start - now);
+}
@@ -0,0 +1,104 @@
+#ifndef EP_MULTIPLAYER_JITTER_BUFFER_H
+#define EP_MULTIPLAYER_JITTER_BUFFER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+#include "game_clock.h"
+
+namespace Multiplayer {
+
+/**
+ * Playout buffer for the tile moves of a remote player.
+ *
+ * Every move is scheduled target latency after it arrived, but never
+ * before the previous move finished walking, so bursts are replayed at
+ * walking pace. When the schedule falls more than max lag behind, the
+ * buffer skips ahead to the newest position.
+ *
+ * Progress of the current move is derived from the clock, not from frames,
+ * so the sub-tile position stays smooth independent of the game speed.
+ */
+class JitterBuffer {
+public:
+	using time_point = Game_Clock::time_point;
+	using duration = Game_Clock::duration;
+
+	/** Sub-tile steps per tile, same scale as SCREEN_TILE_SIZE */
+	static constexpr int STEP_SIZE = 256;
+	static constexpr size_t CAPACITY = 32;
+
+	struct Step {
+		/** tile the player moves to */
+		int x = 0;
+		int y = 0;
+		/** distance left to x/y, like Game_Character::GetRemainingStep */
+		int remaining = 0;
+		/** a new move began, the character has to be moved to x/y */
+		bool started = false;
+		/** moves were dropped, x/y is not adjacent to the previous tile */
+		bool skipped = false;
+	};
+
+	void SetTargetLatency(duration d) { latency = d; }
+	duration GetTargetLatency() const { return latency; }
+
+	void SetMaxLag(duration d) { max_lag = d; }
+	duration GetMaxLag() const { return max_lag; }
+
+	/**
+	 * Queues a move.
+	 *
+	 * @param x tile x
+	 * @param y tile y
+	 * @param now arrival time
+	 * @param walk time a single tile move takes at the current speed
+	 */
+	void Push(int x, int y, time_point now, duration walk);
+
+	/**
+	 * Advances playout to now.
+	 * Starts at most one new move per call.
+	 */
+	Step Update(time_point now);
+
+	/** Drops all queued moves, the current position is kept. */
+	void Clear();
+
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+
+	/** @return how far behind now the last queued move is scheduled */
+	duration GetBacklog(time_point now) const;
+
+	/** @return amount of moves dropped by skipping ahead */
+	size_t GetSkipCount() const { return skipped; }
+
+private:
+	struct Sample {
+		int x;
+		int y;
+		time_point start;
+		duration walk;
+	};
+
+	Sample& At(size_t i) { return samples[(head + i) % CAPACITY]; }
+	const Sample& At(size_t i) const { return samples[(head + i) % CAPACITY]; }
+
+	std::array<Sample, CAPACITY> samples = {};
+	size_t head = 0;
+	size_t count = 0;
+
+	duration latency = std::chrono::milliseconds(100);
+	duration max_lag = std::chrono::milliseconds(1000);
+
+	Sample current = {};
+	bool has_current = false;
+	bool skip_pending = false;
+	size_t skipped = 0;
+};
+
+}
+
+#endif
@@ -63,3 +63,148 @@ std::string C2SPacket::Sanitize(std::string_view param) {
 }
 
 
+namespace {
+	// Index is the opcode, 0 is reserved so that a message never starts
+	// with an opcode byte equal to BINARY_MARKER. Only append to this list.
+	constexpr std::string_view opcodes[] = {
+		"",
+		"s", "c", "d", "m", "f", "spd", "spr", "sys", "se",
+		"ap", "mp", "rp", "name", "say", "gsay", "ploc", "ban",
+		"wire",
+	};
+	constexpr size_t opcode_count = sizeof(opcodes) / sizeof(std::string_view);
+
+	bool is_canonical_int(std::string_view s) {
+		if (s.empty() || s.size() > 11)
+			return false;
+		size_t i = s[0] == '-' ? 1 : 0;
+		if (i == s.size())
+			return false;
+		// no leading zeros and no "-0"
+		if (s[i] == '0' && (s.size() > 1))
+			return false;
+		for (size_t j = i; j < s.size(); ++j) {
+			if (s[j] < '0' || s[j] > '9')
+				return false;
+		}
+		int r;
+		auto e = std::from_chars(s.data(), s.data() + s.size(), r);
+		return e.ec == std::errc() && e.ptr == s.data() + s.size();
+	}
+}
+
+uint8_t Packet::GetOpcode(std::string_view name) {
+	for (size_t i = 1; i < opcode_count; ++i) {
+		if (opcodes[i] == name)
+			return static_cast<uint8_t>(i);
+	}
+	return OPCODE_EXTENDED;
+}
+
+std::string_view Packet::GetOpcodeName(uint8_t opcode) {
+	if (opcode < opcode_count)
+		return opcodes[opcode];
+	return {};
+}
+
+void Packet::AppendVarint(std::string& s, uint64_t v) {
+	while (v >= 0x80) {
+		s += static_cast<char>((v & 0x7F) | 0x80);
+		v >>= 7;
+	}
+	s += static_cast<char>(v);
+}
+
+uint64_t Packet::ReadVarint(std::string_view& s) {
+	uint64_t r = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (s.empty())
+			throw PacketDecodingException("Truncated varint");
+		uint8_t b = static_cast<uint8_t>(s.front());
+		s.remove_prefix(1);
+		r |= static_cast<uint64_t>(b & 0x7F) << shift;
+		if (!(b & 0x80))
+			return r;
+	}
+	throw PacketDecodingException("Varint too long");
+}
+
+void C2SPacket::AppendBinaryHeader(std::string& s, std::string_view name, size_t param_count) {
+	auto op = GetOpcode(name);
+	s += static_cast<char>(op);
+	if (op == OPCODE_EXTENDED) {
+		AppendVarint(s, name.size());
+		s.append(name.data(), name.size());
+	}
+	AppendVarint(s, param_count);
+}
+
+std::string C2SPacket::TextToBinary(std::string_view text) {
+	auto p = text.find(PARAM_DELIM);
+	auto name = text.substr(0, p);
+
+	size_t count = 0;
+	for (auto q = p; q != text.npos; q = text.find(PARAM_DELIM, q + PARAM_DELIM.size()))
+		++count;
+
+	std::string r;
+	AppendBinaryHeader(r, name, count);
+	while (p != text.npos) {
+		auto start = p + PARAM_DELIM.size();
+		p = text.find(PARAM_DELIM, start);
+		auto param = text.substr(start, p == text.npos ? text.npos : p - start);
+		if (is_canonical_int(param)) {
+			AppendBinary(r, S2CPacket::Decode<int>(param));
+		} else {
+			AppendBinary(r, param);
+		}
+	}
+	return r;
+}
+
+void S2CPacket::DecodeBinary(std::string_view& msg, std::string_view& name,
+		ParameterList& params, BinaryScratch& scratch) {
+	if (msg.empty())
+		throw PacketDecodingException("Empty packet");
+	auto op = static_cast<uint8_t>(msg.front());
+	msg.remove_prefix(1);
+	if (op == OPCODE_EXTENDED) {
+		auto len = ReadVarint(msg);
+		if (len > msg.size())
+			throw PacketDecodingException("Truncated name");
+		name = msg.substr(0, len);
+		msg.remove_prefix(len);
+	} else {
+		name = GetOpcodeName(op);
+		if (name.empty())
+			throw PacketDecodingException("Unknown opcode");
+	}
+
+	auto count = ReadVarint(msg);
+	params.clear();
+	char* out = scratch.data();
+	char* const out_end = scratch.data() + scratch.size();
+	for (uint64_t i = 0; i < count; ++i) {
+		auto h = ReadVarint(msg);
+		std::string_view param;
+		if (h & 1) {
+			auto len = h >> 1;
+			if (len > msg.size())
+				throw PacketDecodingException("Truncated string");
+			param = msg.substr(0, len);
+			msg.remove_prefix(len);
+		} else {
+			if (params.size() == ParameterList::MAX_PARAMS)
+				continue;
+			auto zz = static_cast<uint32_t>(h >> 1);
+			int v = static_cast<int>((zz >> 1) ^ (~(zz & 1) + 1));
+			auto e = std::to_chars(out, out_end, v);
+			if (e.ec != std::errc())
+				throw PacketDecodingException("Too many int params");
+			param = std::string_view(out, e.ptr - out);
+			out = e.ptr;
+		}
+		// surplus params are decoded but dropped, like in Split
+		params.push_back(param);
+	}
+}
@@ -2,7 +2,11 @@
 #define EP_MULTIPLAYER_PACKET_H
 
 #include <string>
+#include <string_view>
+#include <array>
+#include <initializer_list>
 #include <charconv>
+#include <cstdint>
 #include <stdexcept>
 
 namespace Multiplayer {
@@ -14,13 +18,104 @@ public:
 	PacketDecodingException(const std::string& w) : runtime_error(std::move(w)) {}
 };
 
+/**
+ * Fixed capacity list of views into a received message.
+ * Used instead of a vector so that splitting a message never allocates.
+ * The views are only valid while the message buffer is alive, i.e. for the
+ * duration of the handler call.
+ */
+class ParameterList {
+public:
+	/** more than any packet in the protocol uses, extra params are dropped */
+	static constexpr size_t MAX_PARAMS = 32;
+
+	using const_iterator = const std::string_view*;
+
+	ParameterList() = default;
+	ParameterList(std::initializer_list<std::string_view> ilist) {
+		for (auto& v : ilist)
+			push_back(v);
+	}
+
+	/** @return false when the list is full and v was dropped */
+	bool push_back(std::string_view v) {
+		if (count == MAX_PARAMS)
+			return false;
+		params[count++] = v;
+		return true;
+	}
+
+	std::string_view at(size_t i) const {
+		if (i >= count)
+			throw std::out_of_range("ParameterList::at");
+		return params[i];
+	}
+	std::string_view operator[](size_t i) const { return params[i]; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	void clear() { count = 0; }
+
+	const_iterator begin() const { return params.data(); }
+	const_iterator end() const { return params.data() + count; }
+private:
+	std::array<std::string_view, MAX_PARAMS> params;
+	size_t count = 0;
+};
+
+/**
+ * Encoding used on the wire.
+ *
+ * Text is the original protocol: fields rendered as strings, separated by
+ * PARAM_DELIM, messages separated by MSG_DELIM.
+ *
+ * Binary is negotiated with the server after connecting. A binary message
+ * starts with BINARY_MARKER followed by packets of the form
+ *   opcode:u8 [name_len:varint name]? param_count:varint param*
+ * The name is only present for OPCODE_EXTENDED. Every param starts with a
+ * varint h. If the low bit is clear it is an int, zigzag encoded in h >> 1,
+ * otherwise h >> 1 bytes of string data follow.
+ */
+enum class WireFormat {
+	Text,
+	Binary,
+};
+
+/**
+ * Outbound budget class of a C2S packet, declared by the packet type as
+ * `static constexpr PacketLane lane = ...;`.
+ */
+enum class PacketLane {
+	/** position, chat and session state, never limited */
+	Priority,
+	/** sound effects, dropped when over budget */
+	Sound,
+	/** picture updates, deferred and coalesced when over budget */
+	Picture,
+	_Count,
+};
+
 class Packet {
 public:
 	constexpr static std::string_view PARAM_DELIM = "\uFFFF";
 	constexpr static std::string_view MSG_DELIM = "\uFFFE";
 
+	constexpr static char BINARY_MARKER = '\0';
+	constexpr static uint8_t OPCODE_EXTENDED = 0xFF;
+
 	Packet() {}
 	virtual ~Packet() = default;
+
+	/** @return opcode of a packet name or OPCODE_EXTENDED if it has none */
+	static uint8_t GetOpcode(std::string_view name);
+
+	/** @return packet name of an opcode, empty when invalid */
+	static std::string_view GetOpcodeName(uint8_t opcode);
+
+	static void AppendVarint(std::string& s, uint64_t v);
+
+	/** Reads a varint from the front of s and removes it. */
+	static uint64_t ReadVarint(std::string_view& s);
 protected:
 };
 
@@ -29,9 +124,26 @@ public:
 	virtual ~C2SPacket() = default;
 	virtual std::string ToBytes() const = 0;
 
+	/**
+	 * Binary encoding of the packet. Packets on hot paths override this,
+	 * all others are converted from their text form.
+	 */
+	virtual std::string ToBinary() const { return TextToBinary(ToBytes()); }
+
+	std::string Encode(WireFormat f) const {
+		return f == WireFormat::Binary ? ToBinary() : ToBytes();
+	}
+
 	C2SPacket(std::string _name) : m_name(std::move(_name)) {}
 	std::string_view GetName() const { return m_name; }
 
+	/**
+	 * Converts a text packet to the binary format. Fields that are the
+	 * canonical decimal form of an int are sent as int, which round trips
+	 * to the same text on the other side.
+	 */
+	static std::string TextToBinary(std::string_view text);
+
 	static std::string Sanitize(std::string_view param);
 
 	static std::string ToString(const char* x) { return ToString(std::string_view(x)); }
@@ -58,6 +170,33 @@ public:
 		s += ToString(t);
 		AppendPartial(s, args...);
 	}
+
+	static void AppendBinary(std::string& s, int x) {
+		uint32_t zz = (static_cast<uint32_t>(x) << 1) ^ static_cast<uint32_t>(x >> 31);
+		AppendVarint(s, static_cast<uint64_t>(zz) << 1);
+	}
+	static void AppendBinary(std::string& s, bool x) { AppendBinary(s, x ? 1 : 0); }
+	static void AppendBinary(std::string& s, std::string_view v) {
+		AppendVarint(s, (static_cast<uint64_t>(v.size()) << 1) | 1);
+		s.append(v.data(), v.size());
+	}
+	static void AppendBinary(std::string& s, const char* x) { AppendBinary(s, std::string_view(x)); }
+
+	/** Writes opcode (and name if needed) and param count. */
+	static void AppendBinaryHeader(std::string& s, std::string_view name, size_t param_count);
+
+	template<typename... Args>
+	static void AppendBinaryPartial(std::string& s, Args... args) {
+		(AppendBinary(s, args), ...);
+	}
+
+	template<typename... Args>
+	std::string BuildBinary(Args... args) const {
+		std::string r;
+		AppendBinaryHeader(r, m_name, sizeof...(args));
+		AppendBinaryPartial(r, args...);
+		return r;
+	}
 protected:
 	std::string m_name;
 };
@@ -69,25 +208,38 @@ public:
 	template<typename T>
 	static T Decode(std::string_view s);
 
-	template<>
-	int Decode(std::string_view s) {
-		int r;
-		auto e = std::from_chars(s.data(), s.data() + s.size(), r);
-		if (e.ec != std::errc())
-			throw PacketDecodingException("Decoding int");
-		return r;
-	}
-
-	template<>
-	bool Decode(std::string_view s) {
-		if (s == "1")
-			return true;
-		if (s == "0")
-			return true;
-		throw PacketDecodingException("Decoding bool");
-	}
+	/** Enough room to render every int param of a packet as text. */
+	using BinaryScratch = std::array<char, ParameterList::MAX_PARAMS * 12>;
+
+	/**
+	 * Decodes the next packet of a binary message and removes it from msg.
+	 * Int params are rendered as text into scratch, so the packet classes
+	 * decode them exactly like text params.
+	 *
+	 * @throw PacketDecodingException on malformed input
+	 */
+	static void DecodeBinary(std::string_view& msg, std::string_view& name,
+			ParameterList& params, BinaryScratch& scratch);
 };
 
+template<>
+inline int S2CPacket::Decode(std::string_view s) {
+	int r;
+	auto e = std::from_chars(s.data(), s.data() + s.size(), r);
+	if (e.ec != std::errc())
+		throw PacketDecodingException("Decoding int");
+	return r;
+}
+
+template<>
+inline bool S2CPacket::Decode(std::string_view s) {
+	if (s == "1")
+		return true;
+	if (s == "0")
+		return true;
+	throw PacketDecodingException("Decoding bool");
+}
+
 }
 #endif
 
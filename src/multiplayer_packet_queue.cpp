@@ -0,0 +1,59 @@
+#include "multiplayer_packet_queue.h"
+#include <algorithm>
+
+using namespace Multiplayer;
+
+PacketQueue::PacketQueue() : slots(new Slot[CAPACITY]) {}
+
+PacketQueue::PacketQueue(PacketQueue&& o) noexcept {
+	*this = std::move(o);
+}
+
+PacketQueue& PacketQueue::operator=(PacketQueue&& o) noexcept {
+	if (this != &o) {
+		if (slots)
+			clear();
+		// packets stay in their slots, only the ring changes owner
+		slots = std::move(o.slots);
+		head = o.head;
+		count = o.count;
+		std::copy(o.pending, o.pending + o.pending_count, pending);
+		pending_count = o.pending_count;
+		coalesced = o.coalesced;
+		o.head = o.count = o.pending_count = 0;
+	}
+	return *this;
+}
+
+PacketQueue::~PacketQueue() {
+	if (slots)
+		clear();
+}
+
+PacketQueue::Pending* PacketQueue::FindPending(std::string_view name, int key) {
+	for (size_t i = 0; i < pending_count; ++i) {
+		if (pending[i].key == key && pending[i].name == name)
+			return &pending[i];
+	}
+	return nullptr;
+}
+
+void PacketQueue::pop() {
+	// a sent state packet can not be replaced anymore
+	for (size_t i = 0; i < pending_count; ++i) {
+		if (pending[i].slot == head) {
+			pending[i] = pending[--pending_count];
+			break;
+		}
+	}
+	Get(head)->~C2SPacket();
+	head = (head + 1) % CAPACITY;
+	--count;
+}
+
+void PacketQueue::clear() {
+	while (!empty())
+		pop();
+	head = 0;
+	pending_count = 0;
+}
@@ -0,0 +1,135 @@
+#ifndef EP_MULTIPLAYER_PACKET_QUEUE_H
+#define EP_MULTIPLAYER_PACKET_QUEUE_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "multiplayer_packet.h"
+
+namespace Multiplayer {
+
+/**
+ * Outbound packet FIFO backed by a fixed ring of preallocated slots.
+ *
+ * Packets are constructed in place, so queuing never touches the heap
+ * (apart from what the packet members themselves allocate) and a packet
+ * never moves once constructed.
+ *
+ * Packet types that describe state instead of an event declare
+ * `static constexpr bool coalesce = true;`. A queued state packet that has
+ * not been followed by an event packet yet is overwritten in place by the
+ * next packet of the same name, so only the latest state is sent. Types
+ * with several independent states (one per picture for example) also
+ * provide `int GetCoalesceKey() const` to tell them apart. Event
+ * packets act as a barrier, which keeps state and events in their
+ * original relative order.
+ */
+class PacketQueue {
+public:
+	static constexpr size_t SLOT_SIZE = 384;
+	static constexpr size_t CAPACITY = 128;
+
+	PacketQueue();
+	PacketQueue(const PacketQueue&) = delete;
+	PacketQueue& operator=(const PacketQueue&) = delete;
+	PacketQueue(PacketQueue&& o) noexcept;
+	PacketQueue& operator=(PacketQueue&& o) noexcept;
+	~PacketQueue();
+
+	/**
+	 * Queues a packet of type T, or replaces the pending one with the same
+	 * name if T is a state packet.
+	 * The queue must not be full.
+	 */
+	template <typename T, typename... Args>
+	void Emplace(Args&&... args);
+
+	bool empty() const { return count == 0; }
+	bool full() const { return count == CAPACITY; }
+	size_t size() const { return count; }
+
+	C2SPacket& front() { return *Get(head); }
+
+	void pop();
+	void clear();
+
+	/** @return amount of packets replaced by a newer state packet */
+	size_t GetCoalescedCount() const { return coalesced; }
+
+private:
+	struct Slot {
+		alignas(std::max_align_t) unsigned char storage[SLOT_SIZE];
+	};
+
+	template <typename T, typename = void>
+	struct IsCoalescing : std::false_type {};
+	template <typename T>
+	struct IsCoalescing<T, std::void_t<decltype(T::coalesce)>> : std::bool_constant<T::coalesce> {};
+
+	template <typename T, typename = void>
+	struct HasCoalesceKey : std::false_type {};
+	template <typename T>
+	struct HasCoalesceKey<T, std::void_t<decltype(std::declval<const T&>().GetCoalesceKey())>> : std::true_type {};
+
+	/** queued state packets that can still be replaced */
+	struct Pending {
+		std::string_view name;
+		int key;
+		size_t slot;
+	};
+	// every queued packet can be pending, so coalescing never runs out of entries
+	static constexpr size_t MAX_PENDING = CAPACITY;
+
+	C2SPacket* Get(size_t slot) {
+		return std::launder(reinterpret_cast<C2SPacket*>(slots[slot].storage));
+	}
+	Pending* FindPending(std::string_view name, int key);
+
+	std::unique_ptr<Slot[]> slots;
+	size_t head = 0;
+	size_t count = 0;
+	Pending pending[MAX_PENDING];
+	size_t pending_count = 0;
+	size_t coalesced = 0;
+};
+
+template <typename T, typename... Args>
+void PacketQueue::Emplace(Args&&... args) {
+	static_assert(std::is_base_of_v<C2SPacket, T>, "not a C2SPacket");
+	static_assert(sizeof(T) <= SLOT_SIZE, "increase PacketQueue::SLOT_SIZE");
+	static_assert(alignof(T) <= alignof(Slot), "packet over-aligned");
+
+	if constexpr (IsCoalescing<T>::value) {
+		T packet(std::forward<Args>(args)...);
+		int key = 0;
+		if constexpr (HasCoalesceKey<T>::value)
+			key = packet.GetCoalesceKey();
+		if (auto* p = FindPending(packet.GetName(), key)) {
+			Get(p->slot)->~C2SPacket();
+			auto* np = new (slots[p->slot].storage) T(std::move(packet));
+			// the name view must point into the live packet
+			p->name = np->GetName();
+			++coalesced;
+			return;
+		}
+
+		size_t slot = (head + count) % CAPACITY;
+		auto* np = new (slots[slot].storage) T(std::move(packet));
+		++count;
+		if (pending_count < MAX_PENDING)
+			pending[pending_count++] = { np->GetName(), key, slot };
+	} else {
+		size_t slot = (head + count) % CAPACITY;
+		new (slots[slot].storage) T(std::forward<Args>(args)...);
+		++count;
+		// events are a barrier, earlier state must stay before them
+		pending_count = 0;
+	}
+}
+
+}
+
+#endif
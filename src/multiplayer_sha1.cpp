@@ -0,0 +1,231 @@
+#include "multiplayer_sha1.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef EP_SIMD_X86
+#  include <immintrin.h>
+#endif
+
+using namespace Multiplayer;
+
+namespace {
+	inline uint32_t Rol(uint32_t v, int n) {
+		return (v << n) | (v >> (32 - n));
+	}
+
+	inline uint32_t LoadBE(const uint8_t* p) {
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+
+	void CompressScalar(uint32_t state[5], const uint8_t* blocks, size_t count) {
+		for (; count > 0; --count, blocks += 64) {
+			uint32_t w[16];
+			for (int i = 0; i < 16; ++i)
+				w[i] = LoadBE(blocks + i * 4);
+
+			uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+			// message schedule in a rolling window of 16 words
+			auto schedule = [&w] (int i) {
+				if (i >= 16)
+					w[i & 15] = Rol(w[(i - 3) & 15] ^ w[(i - 8) & 15] ^ w[(i - 14) & 15] ^ w[i & 15], 1);
+				return w[i & 15];
+			};
+			auto round = [&] (uint32_t f, uint32_t k, uint32_t wi) {
+				uint32_t t = Rol(a, 5) + f + e + k + wi;
+				e = d;
+				d = c;
+				c = Rol(b, 30);
+				b = a;
+				a = t;
+			};
+			// one loop per round function keeps the rounds free of branches
+			for (int i = 0; i < 20; ++i)
+				round(d ^ (b & (c ^ d)), 0x5A827999, schedule(i));
+			for (int i = 20; i < 40; ++i)
+				round(b ^ c ^ d, 0x6ED9EBA1, schedule(i));
+			for (int i = 40; i < 60; ++i)
+				round((b & c) | (d & (b | c)), 0x8F1BBCDC, schedule(i));
+			for (int i = 60; i < 80; ++i)
+				round(b ^ c ^ d, 0xCA62C1D6, schedule(i));
+			state[0] += a;
+			state[1] += b;
+			state[2] += c;
+			state[3] += d;
+			state[4] += e;
+		}
+	}
+
+#ifdef EP_SIMD_X86
+	// Four rounds of group g, msg0 holds the finished schedule words of g.
+	// Also advances the schedule: msg1 is finished for g + 1, msg2 and msg3
+	// get their contributions for g + 2 and g + 3.
+#  define SHA1_ROUNDS4(e_in, e_out, msg0, msg1, msg2, msg3, func) \
+		e_in = _mm_sha1nexte_epu32(e_in, msg0); \
+		e_out = abcd; \
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0); \
+		abcd = _mm_sha1rnds4_epu32(abcd, e_in, func); \
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0); \
+		msg2 = _mm_xor_si128(msg2, msg0);
+
+	EP_TARGET("sha,sse4.1")
+	void CompressShaNi(uint32_t state[5], const uint8_t* blocks, size_t count) {
+		const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+		__m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+		abcd = _mm_shuffle_epi32(abcd, 0x1B);
+		__m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+		__m128i e1;
+
+		for (; count > 0; --count, blocks += 64) {
+			const __m128i abcd_save = abcd;
+			const __m128i e0_save = e0;
+
+			__m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks)), mask);
+			__m128i m1 = _mm_setzero_si128();
+			__m128i m2 = _mm_setzero_si128();
+			__m128i m3 = _mm_setzero_si128();
+
+			// rounds 0-3
+			e0 = _mm_add_epi32(e0, m0);
+			e1 = abcd;
+			abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+			// rounds 4-15, the schedule steps for unloaded words are overwritten
+			m1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16)), mask);
+			SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 0)
+			m2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 32)), mask);
+			SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 0)
+			m3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 48)), mask);
+			SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 0)
+
+			// rounds 16-79
+			SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 0)
+			SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 1)
+			SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 1)
+			SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 1)
+			SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 1)
+			SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 1)
+			SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 2)
+			SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 2)
+			SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 2)
+			SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 2)
+			SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 2)
+			SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 3)
+			SHA1_ROUNDS4(e0, e1, m0, m1, m2, m3, 3)
+			SHA1_ROUNDS4(e1, e0, m1, m2, m3, m0, 3)
+			SHA1_ROUNDS4(e0, e1, m2, m3, m0, m1, 3)
+			SHA1_ROUNDS4(e1, e0, m3, m0, m1, m2, 3)
+
+			e0 = _mm_sha1nexte_epu32(e0, e0_save);
+			abcd = _mm_add_epi32(abcd, abcd_save);
+		}
+
+		abcd = _mm_shuffle_epi32(abcd, 0x1B);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state), abcd);
+		state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+	}
+#  undef SHA1_ROUNDS4
+#endif
+
+	Sha1::Kernel DefaultKernel() {
+		return Sha1::IsSupported(Sha1::Kernel::ShaNi) ? Sha1::Kernel::ShaNi : Sha1::Kernel::Scalar;
+	}
+
+	Sha1::Kernel kernel = DefaultKernel();
+	Sha1::CompressFn compress = Sha1::GetCompressFn(kernel);
+}
+
+bool Sha1::IsSupported(Kernel k) {
+	switch (k) {
+		case Kernel::Scalar:
+			return true;
+		case Kernel::ShaNi:
+#ifdef EP_SIMD_X86
+			return CpuFeatures::HasSha();
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+Sha1::CompressFn Sha1::GetCompressFn(Kernel k) {
+	switch (k) {
+		case Kernel::Scalar:
+			return CompressScalar;
+		case Kernel::ShaNi:
+#ifdef EP_SIMD_X86
+			return CompressShaNi;
+#else
+			return nullptr;
+#endif
+	}
+	return nullptr;
+}
+
+void Sha1::SetKernel(Kernel k) {
+	kernel = k;
+	compress = GetCompressFn(k);
+}
+
+Sha1::Kernel Sha1::GetKernel() {
+	return kernel;
+}
+
+void Sha1::Reset() {
+	h[0] = 0x67452301;
+	h[1] = 0xEFCDAB89;
+	h[2] = 0x98BADCFE;
+	h[3] = 0x10325476;
+	h[4] = 0xC3D2E1F0;
+	block_len = 0;
+	total = 0;
+}
+
+void Sha1::Update(const void* data, size_t len) {
+	auto* p = static_cast<const uint8_t*>(data);
+	total += len;
+
+	if (block_len > 0) {
+		size_t n = std::min(len, sizeof(block) - block_len);
+		std::memcpy(block + block_len, p, n);
+		block_len += n;
+		p += n;
+		len -= n;
+		if (block_len < sizeof(block))
+			return;
+		compress(h, block, 1);
+		block_len = 0;
+	}
+
+	// whole blocks are compressed straight from the input
+	if (len >= 64) {
+		size_t blocks = len / 64;
+		compress(h, p, blocks);
+		p += blocks * 64;
+		len -= blocks * 64;
+	}
+
+	std::memcpy(block, p, len);
+	block_len = len;
+}
+
+void Sha1::Final(Digest digest) {
+	const uint64_t bits = total * 8;
+
+	block[block_len++] = 0x80;
+	if (block_len > 56) {
+		std::memset(block + block_len, 0, sizeof(block) - block_len);
+		compress(h, block, 1);
+		block_len = 0;
+	}
+	std::memset(block + block_len, 0, 56 - block_len);
+	for (int i = 0; i < 8; ++i) {
+		block[56 + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+	}
+	compress(h, block, 1);
+	block_len = 0;
+
+	std::memcpy(digest, h, sizeof(h));
+}
@@ -0,0 +1,57 @@
+#ifndef EP_MULTIPLAYER_SHA1_H
+#define EP_MULTIPLAYER_SHA1_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Multiplayer {
+
+/**
+ * Incremental SHA1 without heap allocations.
+ *
+ * The object is the complete hash state, so a copy taken after hashing a
+ * constant prefix is a midstate that other messages can continue from.
+ * Blocks are compressed by the SHA extensions when the CPU has them.
+ */
+class Sha1 {
+public:
+	using Digest = uint32_t[5];
+	using CompressFn = void (*)(uint32_t state[5], const uint8_t* blocks, size_t count);
+
+	enum class Kernel {
+		Scalar,
+		/** x86 SHA extensions */
+		ShaNi,
+	};
+
+	Sha1() { Reset(); }
+
+	void Reset();
+
+	void Update(const void* data, size_t len);
+	void Update(std::string_view s) { Update(s.data(), s.size()); }
+
+	/** Pads the message and writes the digest. Reset before reusing the object. */
+	void Final(Digest digest);
+
+	/** @return whether the kernel can run on this CPU */
+	static bool IsSupported(Kernel k);
+
+	/** Selects the kernel used by all hashes, it must be supported. */
+	static void SetKernel(Kernel k);
+	static Kernel GetKernel();
+
+	/** @return compression function of a kernel, nullptr when not compiled in */
+	static CompressFn GetCompressFn(Kernel k);
+
+private:
+	uint32_t h[5];
+	uint8_t block[64];
+	size_t block_len;
+	uint64_t total;
+};
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef EP_MULTIPLAYER_SLOT_MAP_H
+#define EP_MULTIPLAYER_SLOT_MAP_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Multiplayer {
+
+/**
+ * Pool of objects addressed by an integer id.
+ *
+ * Objects are allocated once and recycled afterwards, their address stays
+ * the same until clear, so drawables may keep references to them.
+ * Active objects are stored in a dense array for iteration and an open
+ * addressing table maps ids to their position in it.
+ */
+template <typename T>
+class SlotMap {
+public:
+	using value_type = std::pair<int, T*>;
+	using iterator = typename std::vector<value_type>::iterator;
+	using const_iterator = typename std::vector<value_type>::const_iterator;
+
+	/** @return object of id or nullptr */
+	T* Find(int id) const;
+
+	/**
+	 * Adds id, taking a recycled object if there is one.
+	 *
+	 * @param id id to add, must not be in the map
+	 * @param reused set to true when the object was recycled and still
+	 *   holds the state of its previous owner
+	 * @return the object
+	 */
+	T& Insert(int id, bool& reused);
+
+	/**
+	 * Removes id from the map. The object stays alive until it is passed
+	 * to Recycle.
+	 *
+	 * @return the object or nullptr
+	 */
+	T* Detach(int id);
+
+	/** Makes a detached object available to Insert again. */
+	void Recycle(T* obj) { free_objects.push_back(obj); }
+
+	/** Destroys all objects, including recycled ones. */
+	void clear();
+
+	size_t size() const { return dense.size(); }
+	bool empty() const { return dense.empty(); }
+
+	/** @return amount of objects waiting for reuse */
+	size_t GetPooledCount() const { return free_objects.size(); }
+
+	/** @return entry at dense index i, valid until the next Insert or Detach */
+	value_type& At(size_t i) { return dense[i]; }
+
+	iterator begin() { return dense.begin(); }
+	iterator end() { return dense.end(); }
+	const_iterator begin() const { return dense.begin(); }
+	const_iterator end() const { return dense.end(); }
+
+private:
+	static constexpr int EMPTY = -1;
+
+	size_t Home(int id) const {
+		// fibonacci hashing, the upper bits are the well mixed ones
+		return (static_cast<uint32_t>(id) * 2654435769u) >> (32 - bits);
+	}
+	size_t Mask() const { return table.size() - 1; }
+	/** @return table index of id or npos */
+	size_t FindSlot(int id) const;
+	void Rehash(size_t size_bits);
+
+	std::vector<std::unique_ptr<T>> storage;
+	std::vector<T*> free_objects;
+	std::vector<value_type> dense;
+	/** dense index per slot, EMPTY when unused */
+	std::vector<int> table;
+	unsigned bits = 0;
+};
+
+template <typename T>
+size_t SlotMap<T>::FindSlot(int id) const {
+	if (table.empty())
+		return static_cast<size_t>(-1);
+	for (size_t i = Home(id); table[i] != EMPTY; i = (i + 1) & Mask()) {
+		if (dense[table[i]].first == id)
+			return i;
+	}
+	return static_cast<size_t>(-1);
+}
+
+template <typename T>
+T* SlotMap<T>::Find(int id) const {
+	size_t slot = FindSlot(id);
+	if (slot == static_cast<size_t>(-1))
+		return nullptr;
+	return dense[table[slot]].second;
+}
+
+template <typename T>
+void SlotMap<T>::Rehash(size_t size_bits) {
+	bits = size_bits;
+	table.assign(size_t(1) << bits, EMPTY);
+	for (size_t d = 0; d < dense.size(); ++d) {
+		size_t i = Home(dense[d].first);
+		while (table[i] != EMPTY)
+			i = (i + 1) & Mask();
+		table[i] = static_cast<int>(d);
+	}
+}
+
+template <typename T>
+T& SlotMap<T>::Insert(int id, bool& reused) {
+	// keep the load factor at or below one half
+	if ((dense.size() + 1) * 2 > table.size())
+		Rehash(bits == 0 ? 4 : bits + 1);
+
+	T* obj;
+	reused = !free_objects.empty();
+	if (reused) {
+		obj = free_objects.back();
+		free_objects.pop_back();
+	} else {
+		storage.emplace_back(new T());
+		obj = storage.back().get();
+	}
+
+	dense.emplace_back(id, obj);
+	size_t i = Home(id);
+	while (table[i] != EMPTY)
+		i = (i + 1) & Mask();
+	table[i] = static_cast<int>(dense.size() - 1);
+	return *obj;
+}
+
+template <typename T>
+T* SlotMap<T>::Detach(int id) {
+	size_t slot = FindSlot(id);
+	if (slot == static_cast<size_t>(-1))
+		return nullptr;
+
+	const int d = table[slot];
+	T* obj = dense[d].second;
+
+	// fill the hole in the dense array with the last entry
+	const int last = static_cast<int>(dense.size()) - 1;
+	if (d != last) {
+		table[FindSlot(dense[last].first)] = d;
+		dense[d] = dense[last];
+	}
+	dense.pop_back();
+
+	// backward shift deletion, no tombstones needed
+	size_t hole = slot;
+	for (size_t j = (hole + 1) & Mask(); table[j] != EMPTY; j = (j + 1) & Mask()) {
+		size_t home = Home(dense[table[j]].first);
+		// move j into the hole unless its home lies cyclically in (hole, j]
+		bool in_range = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+		if (!in_range) {
+			table[hole] = table[j];
+			hole = j;
+		}
+	}
+	table[hole] = EMPTY;
+
+	return obj;
+}
+
+template <typename T>
+void SlotMap<T>::clear() {
+	dense.clear();
+	free_objects.clear();
+	table.clear();
+	bits = 0;
+	storage.clear();
+}
+
+}
+
+#endif
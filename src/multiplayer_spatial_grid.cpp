@@ -0,0 +1,76 @@
+#include "multiplayer_spatial_grid.h"
+#include <algorithm>
+
+using namespace Multiplayer;
+
+void SpatialGrid::Reset(int map_width, int map_height, bool loop_h, bool loop_v) {
+	width = std::max(map_width, 1);
+	height = std::max(map_height, 1);
+	this->loop_h = loop_h;
+	this->loop_v = loop_v;
+	cells_x = (width + CELL_SIZE - 1) / CELL_SIZE;
+	cells_y = (height + CELL_SIZE - 1) / CELL_SIZE;
+	entries.clear();
+	cell_start.assign(cells_x * cells_y + 1, 0);
+}
+
+void SpatialGrid::Insert(int id, int x, int y) {
+	x = std::clamp(x, 0, width - 1);
+	y = std::clamp(y, 0, height - 1);
+	int cell = (y / CELL_SIZE) * cells_x + x / CELL_SIZE;
+	entries.push_back({ cell, id, x, y });
+}
+
+void SpatialGrid::Build() {
+	std::sort(entries.begin(), entries.end(), [] (const Entry& a, const Entry& b) {
+		return a.cell < b.cell;
+	});
+
+	std::fill(cell_start.begin(), cell_start.end(), 0);
+	for (auto& e : entries) {
+		++cell_start[e.cell + 1];
+	}
+	for (size_t i = 1; i < cell_start.size(); ++i) {
+		cell_start[i] += cell_start[i - 1];
+	}
+}
+
+int SpatialGrid::Split(int pos, int len, int size, bool loop, Span* out) {
+	if (len <= 0)
+		return 0;
+
+	if (!loop) {
+		int begin = std::max(pos, 0);
+		int end = std::min(pos + len, size);
+		if (begin >= end)
+			return 0;
+		out[0] = { begin, end };
+		return 1;
+	}
+
+	if (len >= size) {
+		out[0] = { 0, size };
+		return 1;
+	}
+	int begin = ((pos % size) + size) % size;
+	int end = begin + len;
+	if (end <= size) {
+		out[0] = { begin, end };
+		return 1;
+	}
+	out[0] = { begin, size };
+	out[1] = { 0, end - size };
+	return 2;
+}
+
+int SpatialGrid::Delta(int a, int b, int size, bool loop) {
+	int d = b - a;
+	if (loop && size > 0) {
+		if (d > size / 2) {
+			d -= size;
+		} else if (d < -size / 2) {
+			d += size;
+		}
+	}
+	return d;
+}
@@ -0,0 +1,118 @@
+#ifndef EP_MULTIPLAYER_SPATIAL_GRID_H
+#define EP_MULTIPLAYER_SPATIAL_GRID_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Multiplayer {
+
+/**
+ * Uniform grid over tile positions, used to find the remote players near
+ * the screen or the main player without testing every one of them.
+ *
+ * The grid is rebuilt every frame: Reset, Insert all entries, Build, then
+ * Query. Rects passed to Query may exceed the map and wrap around on
+ * looping axes.
+ */
+class SpatialGrid {
+public:
+	/** width and height of a cell in tiles */
+	static constexpr int CELL_SIZE = 8;
+
+	/** Removes all entries and sets up the cells for a map. */
+	void Reset(int map_width, int map_height, bool loop_h, bool loop_v);
+
+	void Insert(int id, int x, int y);
+
+	/** Sorts the inserted entries into their cells. */
+	void Build();
+
+	/**
+	 * Calls fn(id) for every entry inside a tile rect.
+	 *
+	 * @param x left tile
+	 * @param y top tile
+	 * @param w width in tiles
+	 * @param h height in tiles
+	 * @param fn callback
+	 */
+	template <typename F>
+	void Query(int x, int y, int w, int h, F&& fn) const;
+
+	/**
+	 * @return shortest signed distance from a to b, wrapping around
+	 *   when the axis loops
+	 */
+	static int Delta(int a, int b, int size, bool loop);
+
+	size_t size() const { return entries.size(); }
+
+private:
+	struct Entry {
+		int cell;
+		int id;
+		int x;
+		int y;
+	};
+
+	/** half open tile range that does not wrap */
+	struct Span {
+		int begin;
+		int end;
+	};
+
+	/** Splits a possibly wrapping range into at most two spans. */
+	static int Split(int pos, int len, int size, bool loop, Span* out);
+
+	template <typename F>
+	void QuerySpan(const Span& sx, const Span& sy, F& fn) const;
+
+	std::vector<Entry> entries;
+	/** first entry of each cell, one extra for the end */
+	std::vector<int> cell_start;
+	int width = 0;
+	int height = 0;
+	int cells_x = 0;
+	int cells_y = 0;
+	bool loop_h = false;
+	bool loop_v = false;
+};
+
+template <typename F>
+void SpatialGrid::Query(int x, int y, int w, int h, F&& fn) const {
+	if (entries.empty())
+		return;
+
+	Span sx[2];
+	Span sy[2];
+	int nx = Split(x, w, width, loop_h, sx);
+	int ny = Split(y, h, height, loop_v, sy);
+	for (int i = 0; i < nx; ++i) {
+		for (int j = 0; j < ny; ++j) {
+			QuerySpan(sx[i], sy[j], fn);
+		}
+	}
+}
+
+template <typename F>
+void SpatialGrid::QuerySpan(const Span& sx, const Span& sy, F& fn) const {
+	const int cx0 = sx.begin / CELL_SIZE;
+	const int cx1 = (sx.end - 1) / CELL_SIZE;
+	const int cy0 = sy.begin / CELL_SIZE;
+	const int cy1 = (sy.end - 1) / CELL_SIZE;
+	for (int cy = cy0; cy <= cy1; ++cy) {
+		for (int cx = cx0; cx <= cx1; ++cx) {
+			const int cell = cy * cells_x + cx;
+			for (int i = cell_start[cell]; i < cell_start[cell + 1]; ++i) {
+				auto& e = entries[i];
+				if (e.x >= sx.begin && e.x < sx.end && e.y >= sy.begin && e.y < sy.end) {
+					fn(e.id);
+				}
+			}
+		}
+	}
+}
+
+}
+
+#endif
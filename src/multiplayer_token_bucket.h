@@ -0,0 +1,74 @@
+#ifndef EP_MULTIPLAYER_TOKEN_BUCKET_H
+#define EP_MULTIPLAYER_TOKEN_BUCKET_H
+
+#include <algorithm>
+#include <chrono>
+
+#include "game_clock.h"
+
+namespace Multiplayer {
+
+/**
+ * Token bucket rate limiter.
+ *
+ * Tokens refill continuously at the configured rate up to the burst size,
+ * every admitted packet takes one. A rate of 0 admits everything.
+ */
+class TokenBucket {
+public:
+	using time_point = Game_Clock::time_point;
+
+	/**
+	 * @param per_second refill rate, 0 disables the limit
+	 * @param burst maximum amount of tokens
+	 */
+	void SetRate(int per_second, int burst) {
+		rate = per_second;
+		capacity = std::max(burst, 1);
+		tokens = capacity;
+		started = false;
+	}
+
+	bool IsLimited() const { return rate > 0; }
+
+	/** @return true when a token was available and taken */
+	bool Take(time_point now) {
+		if (!IsLimited())
+			return true;
+		Refill(now);
+		if (tokens < 1.0)
+			return false;
+		tokens -= 1.0;
+		return true;
+	}
+
+	/** Takes a token even when there is none, the debt is paid by the next refills. */
+	void Force(time_point now) {
+		if (!IsLimited())
+			return;
+		Refill(now);
+		tokens -= 1.0;
+	}
+
+	double GetTokens() const { return tokens; }
+
+private:
+	void Refill(time_point now) {
+		if (started) {
+			double elapsed = std::chrono::duration<double>(now - last).count();
+			tokens = std::min<double>(capacity, tokens + std::max(elapsed, 0.0) * rate);
+		}
+		started = true;
+		last = now;
+	}
+
+	double tokens = 0.0;
+	int rate = 0;
+	int capacity = 1;
+	time_point last = {};
+	bool started = false;
+};
+
+}
+
+#endif
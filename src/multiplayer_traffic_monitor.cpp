@@ -0,0 +1,192 @@
+#include "multiplayer_traffic_monitor.h"
+#include "output.h"
+#include <algorithm>
+#include <fmt/format.h>
+
+using namespace Multiplayer;
+
+namespace {
+	constexpr auto interval = std::chrono::seconds(1);
+	constexpr size_t summary_packets = 5;
+
+	double ToMs(ConnectionMonitor::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	long long ToUs(ConnectionMonitor::duration d) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+	}
+}
+
+TrafficMonitor::PacketStats& TrafficMonitor::Stats::Packet(std::string_view name) {
+	auto it = std::lower_bound(packets.begin(), packets.end(), name,
+		[] (const auto& a, std::string_view b) { return a.first < b; });
+	if (it == packets.end() || it->first != name) {
+		it = packets.emplace(it, std::string(name), PacketStats());
+	}
+	return it->second;
+}
+
+void TrafficMonitor::Stats::Add(const Stats& o) {
+	bytes_in += o.bytes_in;
+	bytes_out += o.bytes_out;
+	messages_in += o.messages_in;
+	messages_out += o.messages_out;
+	flushes += o.flushes;
+	queued += o.queued;
+	max_queue = std::max(max_queue, o.max_queue);
+	opens += o.opens;
+	reconnects += o.reconnects;
+	closes += o.closes;
+	for (auto& p : o.packets) {
+		auto& s = Packet(p.first);
+		s.count += p.second.count;
+		s.dropped += p.second.dropped;
+		s.decode += p.second.decode;
+		s.handle += p.second.handle;
+	}
+}
+
+void TrafficMonitor::Stats::Clear() {
+	// the packet names stay, most of them come back in the next interval
+	auto names = std::move(packets);
+	*this = Stats();
+	packets = std::move(names);
+	for (auto& p : packets) {
+		p.second = PacketStats();
+	}
+}
+
+ConnectionMonitor::duration TrafficMonitor::Stats::GetDecodeTime() const {
+	duration d = {};
+	for (auto& p : packets) {
+		d += p.second.decode;
+	}
+	return d;
+}
+
+ConnectionMonitor::duration TrafficMonitor::Stats::GetHandleTime() const {
+	duration d = {};
+	for (auto& p : packets) {
+		d += p.second.handle;
+	}
+	return d;
+}
+
+ConnectionMonitor::Action TrafficMonitor::OnReceive(std::string_view name, const Multiplayer::S2CPacket& p) {
+	auto& s = current.Packet(name);
+	++s.count;
+	auto action = next ? next->OnReceive(name, p) : Action::NONE;
+	if (action == Action::DROP) {
+		++s.dropped;
+	}
+	return action;
+}
+
+void TrafficMonitor::OnHandled(std::string_view name, duration decode, duration handle) {
+	auto& s = current.Packet(name);
+	s.decode += decode;
+	s.handle += handle;
+}
+
+void TrafficMonitor::OnMessageReceived(size_t bytes) {
+	current.bytes_in += bytes;
+	++current.messages_in;
+}
+
+void TrafficMonitor::OnMessageSent(size_t bytes) {
+	current.bytes_out += bytes;
+	++current.messages_out;
+}
+
+void TrafficMonitor::OnFlush(size_t queued) {
+	++current.flushes;
+	current.queued += queued;
+	current.max_queue = std::max<uint32_t>(current.max_queue, queued);
+}
+
+void TrafficMonitor::OnOpen() {
+	++current.opens;
+	if (connection_lost) {
+		++current.reconnects;
+		connection_lost = false;
+	}
+}
+
+void TrafficMonitor::OnClose() {
+	++current.closes;
+	connection_lost = true;
+}
+
+bool TrafficMonitor::Update(time_point now) {
+	if (!started) {
+		interval_start = now;
+		started = true;
+		return false;
+	}
+	if (now - interval_start < interval) {
+		return false;
+	}
+	interval_start = now;
+
+	std::swap(last, current);
+	current.Clear();
+
+	if (dump_interval > 0) {
+		dump.Add(last);
+		if (++dump_elapsed >= dump_interval) {
+			Output::Debug("mpstats {}", ToJson(dump, dump_elapsed));
+			dump.Clear();
+			dump_elapsed = 0;
+		}
+	}
+	return true;
+}
+
+std::vector<std::string> TrafficMonitor::GetSummary() const {
+	std::vector<std::string> r;
+	const auto& s = last;
+	r.push_back(fmt::format("In {:.1f} KB/s {}/s  Out {:.1f} KB/s {}/s",
+		s.bytes_in / 1024.0, s.messages_in, s.bytes_out / 1024.0, s.messages_out));
+	r.push_back(fmt::format("Queue avg {:.1f} max {}  Reconnects {}",
+		s.flushes ? double(s.queued) / s.flushes : 0.0, s.max_queue, s.reconnects));
+	r.push_back(fmt::format("Decode {:.2f} ms  Handle {:.2f} ms",
+		ToMs(s.GetDecodeTime()), ToMs(s.GetHandleTime())));
+
+	// the packet types costing the most frame time
+	std::vector<const std::pair<std::string, PacketStats>*> top;
+	for (auto& p : s.packets) {
+		if (p.second.count > 0)
+			top.push_back(&p);
+	}
+	auto cost = [] (const auto* p) { return p->second.decode + p->second.handle; };
+	std::sort(top.begin(), top.end(), [&] (const auto* a, const auto* b) {
+		return cost(a) > cost(b);
+	});
+	if (top.size() > summary_packets)
+		top.resize(summary_packets);
+	for (auto* p : top) {
+		r.push_back(fmt::format("{:>4} {:>4}/s {:.2f} ms", p->first, p->second.count, ToMs(cost(p))));
+	}
+	return r;
+}
+
+std::string TrafficMonitor::ToJson(const Stats& s, double seconds) {
+	std::string r = fmt::format("{{\"seconds\":{},\"bytes_in\":{},\"bytes_out\":{},"
+		"\"messages_in\":{},\"messages_out\":{},\"flushes\":{},\"queued\":{},\"max_queue\":{},"
+		"\"opens\":{},\"reconnects\":{},\"closes\":{},\"packets\":{{",
+		seconds, s.bytes_in, s.bytes_out, s.messages_in, s.messages_out,
+		s.flushes, s.queued, s.max_queue, s.opens, s.reconnects, s.closes);
+	bool first = true;
+	for (auto& p : s.packets) {
+		if (p.second.count == 0)
+			continue;
+		if (!first)
+			r += ',';
+		first = false;
+		r += fmt::format("\"{}\":{{\"count\":{},\"dropped\":{},\"decode_us\":{},\"handle_us\":{}}}",
+			p.first, p.second.count, p.second.dropped, ToUs(p.second.decode), ToUs(p.second.handle));
+	}
+	r += "}}";
+	return r;
+}
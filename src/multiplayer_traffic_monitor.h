@@ -0,0 +1,101 @@
+#ifndef EP_MULTIPLAYER_TRAFFIC_MONITOR_H
+#define EP_MULTIPLAYER_TRAFFIC_MONITOR_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "connection_monitor.h"
+
+namespace Multiplayer {
+
+/**
+ * Collects traffic statistics of a connection.
+ *
+ * Counters are collected over one second intervals, the last complete one
+ * is shown by the overlay. Intervals are also summed up and written to the
+ * log as a single JSON line ("mpstats {...}") when a dump interval is set.
+ *
+ * Whether packets are dropped is decided by the wrapped monitor.
+ */
+class TrafficMonitor : public ConnectionMonitor {
+public:
+	using time_point = Game_Clock::time_point;
+
+	struct PacketStats {
+		uint32_t count = 0;
+		uint32_t dropped = 0;
+		duration decode = {};
+		duration handle = {};
+	};
+
+	struct Stats {
+		uint64_t bytes_in = 0;
+		uint64_t bytes_out = 0;
+		uint32_t messages_in = 0;
+		uint32_t messages_out = 0;
+		uint32_t flushes = 0;
+		/** sum of the queue depth of all flushes */
+		uint64_t queued = 0;
+		uint32_t max_queue = 0;
+		uint32_t opens = 0;
+		uint32_t reconnects = 0;
+		uint32_t closes = 0;
+		/** sorted by packet name */
+		std::vector<std::pair<std::string, PacketStats>> packets;
+
+		PacketStats& Packet(std::string_view name);
+		void Add(const Stats& o);
+		void Clear();
+
+		duration GetDecodeTime() const;
+		duration GetHandleTime() const;
+	};
+
+	/** @param next monitor deciding about dropping packets, can be null */
+	explicit TrafficMonitor(ConnectionMonitor* next = nullptr) : next(next) {}
+
+	Action OnReceive(std::string_view name, const Multiplayer::S2CPacket& p) override;
+	void OnHandled(std::string_view name, duration decode, duration handle) override;
+	void OnMessageReceived(size_t bytes) override;
+	void OnMessageSent(size_t bytes) override;
+	void OnFlush(size_t queued) override;
+	void OnOpen() override;
+	void OnClose() override;
+
+	/**
+	 * Closes the current interval once a second passed and writes the dump
+	 * when it is due.
+	 *
+	 * @return true when the interval was closed
+	 */
+	bool Update(time_point now);
+
+	/** @param seconds time between log dumps, 0 disables them */
+	void SetDumpInterval(int seconds) { dump_interval = seconds; }
+
+	/** @return statistics of the last complete interval */
+	const Stats& GetLastInterval() const { return last; }
+
+	/** @return overlay text, one entry per line */
+	std::vector<std::string> GetSummary() const;
+
+	/** @return stats as a single line JSON object */
+	static std::string ToJson(const Stats& s, double seconds);
+
+private:
+	ConnectionMonitor* next;
+	Stats current;
+	Stats last;
+	Stats dump;
+	time_point interval_start = {};
+	int dump_interval = 0;
+	int dump_elapsed = 0;
+	bool started = false;
+	bool connection_lost = false;
+};
+
+}
+
+#endif
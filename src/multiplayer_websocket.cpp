@@ -0,0 +1,475 @@
+#include "multiplayer_websocket.h"
+#include "output.h"
+#include "TinySHA1.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+using namespace Multiplayer;
+
+namespace {
+	constexpr std::string_view WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	constexpr size_t READ_CHUNK = 16 * 1024;
+	// refuse frames larger than this, the YNO protocol never comes close
+	constexpr uint64_t MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+	std::mt19937& rng() {
+		static std::mt19937 gen{std::random_device{}()};
+		return gen;
+	}
+
+	bool iequals_prefix(std::string_view line, std::string_view prefix) {
+		if (line.size() < prefix.size())
+			return false;
+		for (size_t i = 0; i < prefix.size(); ++i) {
+			if (std::tolower(static_cast<unsigned char>(line[i])) !=
+					std::tolower(static_cast<unsigned char>(prefix[i])))
+				return false;
+		}
+		return true;
+	}
+
+	std::string_view trim(std::string_view s) {
+		while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+			s.remove_prefix(1);
+		while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+			s.remove_suffix(1);
+		return s;
+	}
+}
+
+WebSocketClient::~WebSocketClient() {
+	Close();
+}
+
+std::string WebSocketClient::Base64Encode(const uint8_t* data, size_t len) {
+	static constexpr char table[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string r;
+	r.reserve((len + 2) / 3 * 4);
+	size_t i = 0;
+	for (; i + 2 < len; i += 3) {
+		uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+		r += table[(v >> 18) & 63];
+		r += table[(v >> 12) & 63];
+		r += table[(v >> 6) & 63];
+		r += table[v & 63];
+	}
+	if (i + 1 == len) {
+		uint32_t v = data[i] << 16;
+		r += table[(v >> 18) & 63];
+		r += table[(v >> 12) & 63];
+		r += "==";
+	} else if (i + 2 == len) {
+		uint32_t v = (data[i] << 16) | (data[i + 1] << 8);
+		r += table[(v >> 18) & 63];
+		r += table[(v >> 12) & 63];
+		r += table[(v >> 6) & 63];
+		r += '=';
+	}
+	return r;
+}
+
+std::string WebSocketClient::ComputeAccept(std::string_view key) {
+	sha1::SHA1 digest;
+	digest.processBytes(key.data(), key.size());
+	digest.processBytes(WS_GUID.data(), WS_GUID.size());
+	uint8_t result[20];
+	digest.getDigestBytes(result);
+	return Base64Encode(result, sizeof(result));
+}
+
+void WebSocketClient::Connect(std::string_view uri) {
+	Close();
+	++generation;
+	failed = false;
+
+	constexpr std::string_view scheme = "ws://";
+	if (uri.substr(0, scheme.size()) != scheme) {
+		Output::Warning("WebSocket: Only ws:// URIs are supported: {}", uri);
+		Fail();
+		return;
+	}
+	uri.remove_prefix(scheme.size());
+
+	auto slash = uri.find('/');
+	std::string_view hostport = uri.substr(0, slash);
+	path = slash == uri.npos ? "/" : std::string(uri.substr(slash));
+
+	std::string port = "80";
+	auto colon = hostport.rfind(':');
+	if (colon != hostport.npos) {
+		port = std::string(hostport.substr(colon + 1));
+		host = std::string(hostport.substr(0, colon));
+	} else {
+		host = std::string(hostport);
+	}
+
+	addrinfo hints{};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* res = nullptr;
+	// Blocking lookup, only meant for local test servers
+	int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+	if (err != 0 || !res) {
+		Output::Warning("WebSocket: Cannot resolve {}: {}", host, gai_strerror(err));
+		Fail();
+		return;
+	}
+
+	fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (fd < 0) {
+		freeaddrinfo(res);
+		Output::Warning("WebSocket: socket() failed: {}", strerror(errno));
+		Fail();
+		return;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	int rc = ::connect(fd, res->ai_addr, res->ai_addrlen);
+	freeaddrinfo(res);
+	if (rc < 0 && errno != EINPROGRESS) {
+		Output::Warning("WebSocket: connect() failed: {}", strerror(errno));
+		Fail();
+		return;
+	}
+
+	uint8_t nonce[16];
+	for (auto& b : nonce)
+		b = static_cast<uint8_t>(rng()());
+	handshake_key = Base64Encode(nonce, sizeof(nonce));
+
+	state = State::CONNECTING;
+}
+
+void WebSocketClient::Close() {
+	if (fd >= 0) {
+		if (state == State::OPEN) {
+			// Best effort close frame, the socket is discarded right after
+			outbuf.erase(0, outbuf_pos);
+			outbuf_pos = 0;
+			QueueFrame(OP_CLOSE, {});
+			FlushOutput();
+		}
+		::close(fd);
+		fd = -1;
+	}
+	if (state != State::CLOSED)
+		++generation;
+	state = State::CLOSED;
+	inbuf.clear();
+	inbuf_pos = 0;
+	outbuf.clear();
+	outbuf_pos = 0;
+	fragments.clear();
+	fragment_opcode = OP_CONTINUATION;
+}
+
+void WebSocketClient::Fail() {
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+	state = State::CLOSED;
+	failed = true;
+}
+
+void WebSocketClient::Poll() {
+	auto gen = generation;
+
+	if (failed) {
+		failed = false;
+		if (on_close)
+			on_close();
+		return;
+	}
+
+	if (state == State::CLOSED)
+		return;
+
+	if (state == State::CONNECTING) {
+		pollfd pfd{fd, POLLOUT, 0};
+		if (::poll(&pfd, 1, 0) <= 0)
+			return;
+		int so_error = 0;
+		socklen_t len = sizeof(so_error);
+		getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len);
+		if (so_error != 0) {
+			Output::Debug("WebSocket: Connection failed: {}", strerror(so_error));
+			Fail();
+			Poll();
+			return;
+		}
+
+		std::string req = "GET " + path + " HTTP/1.1\r\n"
+			"Host: " + host + "\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: " + handshake_key + "\r\n"
+			"Sec-WebSocket-Protocol: binary\r\n"
+			"Sec-WebSocket-Version: 13\r\n\r\n";
+		// The handshake must precede any queued frame
+		outbuf.insert(outbuf_pos, req);
+		state = State::HANDSHAKE;
+	}
+
+	if (!FlushOutput() || !ReadInput()) {
+		Fail();
+		Poll();
+		return;
+	}
+
+	if (state == State::HANDSHAKE) {
+		if (!ProcessHandshake()) {
+			Fail();
+			Poll();
+			return;
+		}
+		if (state != State::OPEN)
+			return;
+		if (on_open)
+			on_open();
+		if (gen != generation)
+			return;
+	}
+
+	if (!ProcessFrames()) {
+		if (gen != generation)
+			return;
+		Fail();
+		Poll();
+		return;
+	}
+}
+
+void WebSocketClient::Send(std::string_view data, bool is_text) {
+	if (state == State::CLOSED)
+		return;
+	QueueFrame(is_text ? OP_TEXT : OP_BINARY, data);
+	if (state == State::OPEN && !FlushOutput())
+		Fail();
+}
+
+void WebSocketClient::QueueFrame(uint8_t opcode, std::string_view payload) {
+	if (outbuf_pos > 0 && outbuf_pos == outbuf.size()) {
+		outbuf.clear();
+		outbuf_pos = 0;
+	}
+
+	const uint64_t len = payload.size();
+	outbuf += static_cast<char>(0x80 | opcode);
+	if (len < 126) {
+		outbuf += static_cast<char>(0x80 | len);
+	} else if (len <= 0xFFFF) {
+		outbuf += static_cast<char>(0x80 | 126);
+		outbuf += static_cast<char>((len >> 8) & 0xFF);
+		outbuf += static_cast<char>(len & 0xFF);
+	} else {
+		outbuf += static_cast<char>(0x80 | 127);
+		for (int i = 7; i >= 0; --i)
+			outbuf += static_cast<char>((len >> (i * 8)) & 0xFF);
+	}
+
+	// Client to server frames must be masked
+	uint32_t m = rng()();
+	uint8_t mask[4] = {
+		static_cast<uint8_t>(m >> 24), static_cast<uint8_t>(m >> 16),
+		static_cast<uint8_t>(m >> 8), static_cast<uint8_t>(m)
+	};
+	outbuf.append(reinterpret_cast<const char*>(mask), 4);
+
+	size_t off = outbuf.size();
+	outbuf.append(payload.data(), payload.size());
+	for (size_t i = 0; i < payload.size(); ++i)
+		outbuf[off + i] ^= mask[i & 3];
+}
+
+bool WebSocketClient::FlushOutput() {
+	if (state == State::CONNECTING)
+		return true;
+	while (outbuf_pos < outbuf.size()) {
+		ssize_t n = ::send(fd, outbuf.data() + outbuf_pos, outbuf.size() - outbuf_pos, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return true;
+			if (errno == EINTR)
+				continue;
+			Output::Debug("WebSocket: send() failed: {}", strerror(errno));
+			return false;
+		}
+		outbuf_pos += n;
+	}
+	outbuf.clear();
+	outbuf_pos = 0;
+	return true;
+}
+
+bool WebSocketClient::ReadInput() {
+	if (inbuf_pos > 0) {
+		inbuf.erase(0, inbuf_pos);
+		inbuf_pos = 0;
+	}
+	char buf[READ_CHUNK];
+	for (;;) {
+		ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+		if (n > 0) {
+			inbuf.append(buf, n);
+			continue;
+		}
+		if (n == 0) {
+			Output::Debug("WebSocket: Connection closed by peer");
+			return false;
+		}
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return true;
+		if (errno == EINTR)
+			continue;
+		Output::Debug("WebSocket: recv() failed: {}", strerror(errno));
+		return false;
+	}
+}
+
+bool WebSocketClient::ProcessHandshake() {
+	auto end = inbuf.find("\r\n\r\n");
+	if (end == inbuf.npos)
+		return true;
+
+	std::string_view response(inbuf.data(), end);
+	auto eol = response.find("\r\n");
+	std::string_view status = response.substr(0, eol);
+	if (status.find(" 101") == status.npos) {
+		Output::Warning("WebSocket: Upgrade rejected: {}", status);
+		return false;
+	}
+
+	bool accepted = false;
+	auto expected = ComputeAccept(handshake_key);
+	while (eol != response.npos) {
+		response.remove_prefix(eol + 2);
+		eol = response.find("\r\n");
+		auto line = response.substr(0, eol);
+		constexpr std::string_view accept_hdr = "Sec-WebSocket-Accept:";
+		if (iequals_prefix(line, accept_hdr)) {
+			accepted = trim(line.substr(accept_hdr.size())) == expected;
+		}
+	}
+	if (!accepted) {
+		Output::Warning("WebSocket: Invalid Sec-WebSocket-Accept");
+		return false;
+	}
+
+	inbuf_pos = end + 4;
+	state = State::OPEN;
+	return true;
+}
+
+bool WebSocketClient::ProcessFrames() {
+	auto gen = generation;
+
+	while (state == State::OPEN) {
+		const size_t avail = inbuf.size() - inbuf_pos;
+		if (avail < 2)
+			return true;
+
+		auto* p = reinterpret_cast<const uint8_t*>(inbuf.data() + inbuf_pos);
+		const bool fin = p[0] & 0x80;
+		const uint8_t opcode = p[0] & 0x0F;
+		const bool masked = p[1] & 0x80;
+		uint64_t len = p[1] & 0x7F;
+		size_t hdr = 2;
+		if (len == 126) {
+			if (avail < 4)
+				return true;
+			len = (p[2] << 8) | p[3];
+			hdr = 4;
+		} else if (len == 127) {
+			if (avail < 10)
+				return true;
+			len = 0;
+			for (int i = 0; i < 8; ++i)
+				len = (len << 8) | p[2 + i];
+			hdr = 10;
+		}
+		if (len > MAX_FRAME_SIZE) {
+			Output::Warning("WebSocket: Frame too large ({} bytes)", len);
+			return false;
+		}
+		const size_t mask_off = hdr;
+		if (masked)
+			hdr += 4;
+		if (avail < hdr + len)
+			return true;
+
+		std::string_view payload(inbuf.data() + inbuf_pos + hdr, len);
+		if (masked) {
+			// Servers must not mask, but tolerate it
+			char* d = &inbuf[inbuf_pos + hdr];
+			for (size_t i = 0; i < len; ++i)
+				d[i] ^= p[mask_off + (i & 3)];
+		}
+		inbuf_pos += hdr + len;
+
+		switch (opcode) {
+			case OP_TEXT:
+			case OP_BINARY:
+				// Only control frames may be interleaved with a fragmented message
+				if (fragment_opcode != OP_CONTINUATION) {
+					Output::Warning("WebSocket: Data frame inside a fragmented message");
+					return false;
+				}
+				if (fin) {
+					if (on_message)
+						on_message(payload, opcode == OP_TEXT);
+				} else {
+					fragment_opcode = opcode;
+					fragments.assign(payload);
+				}
+				break;
+			case OP_CONTINUATION:
+				if (fragment_opcode == OP_CONTINUATION) {
+					Output::Warning("WebSocket: Continuation frame without a fragmented message");
+					return false;
+				}
+				fragments.append(payload);
+				if (fin) {
+					std::string msg = std::move(fragments);
+					const bool is_text = fragment_opcode == OP_TEXT;
+					fragments.clear();
+					fragment_opcode = OP_CONTINUATION;
+					if (on_message)
+						on_message(msg, is_text);
+				}
+				break;
+			case OP_PING:
+				QueueFrame(OP_PONG, payload);
+				if (!FlushOutput())
+					return false;
+				break;
+			case OP_PONG:
+				break;
+			case OP_CLOSE:
+				Output::Debug("WebSocket: Close frame received");
+				return false;
+			default:
+				Output::Warning("WebSocket: Unknown opcode {}", opcode);
+				return false;
+		}
+
+		if (gen != generation)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,119 @@
+#ifndef EP_MULTIPLAYER_WEBSOCKET_H
+#define EP_MULTIPLAYER_WEBSOCKET_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstdint>
+
+namespace Multiplayer {
+
+/**
+ * Minimal non-blocking WebSocket (RFC 6455) client on top of POSIX sockets.
+ *
+ * Only plain ws:// URIs are supported. Nothing blocks except the name lookup
+ * in Connect; all other progress (connect, handshake, reading frames and
+ * flushing pending writes) happens in Poll, which is meant to be called once
+ * per frame from the game loop.
+ */
+class WebSocketClient {
+public:
+	enum class State {
+		CLOSED,
+		CONNECTING, // TCP connect in progress
+		HANDSHAKE, // HTTP upgrade sent, waiting for the response
+		OPEN,
+	};
+
+	using OpenHandler = std::function<void ()>;
+	using CloseHandler = std::function<void ()>;
+	using MessageHandler = std::function<void (std::string_view data, bool is_text)>;
+
+	WebSocketClient() = default;
+	WebSocketClient(const WebSocketClient&) = delete;
+	WebSocketClient& operator=(const WebSocketClient&) = delete;
+	~WebSocketClient();
+
+	/**
+	 * Starts connecting to a ws:// URI.
+	 * Failures are reported through the close handler on the next Poll.
+	 *
+	 * @param uri target, e.g. ws://127.0.0.1:8080/1
+	 */
+	void Connect(std::string_view uri);
+
+	/** Closes the connection without invoking the close handler. */
+	void Close();
+
+	/**
+	 * Advances the connection state and dispatches all received messages.
+	 * Handlers may call Connect or Close, Poll returns right after.
+	 */
+	void Poll();
+
+	/**
+	 * Queues a data frame. Pending data is written as far as the socket
+	 * accepts it, the rest is flushed by the next Poll.
+	 */
+	void Send(std::string_view data, bool is_text = false);
+
+	State GetState() const { return state; }
+	bool IsOpen() const { return state == State::OPEN; }
+
+	/** @return amount of bytes queued but not yet accepted by the kernel */
+	size_t GetPendingBytes() const { return outbuf.size() - outbuf_pos; }
+
+	void SetOpenHandler(OpenHandler h) { on_open = std::move(h); }
+	void SetCloseHandler(CloseHandler h) { on_close = std::move(h); }
+	void SetMessageHandler(MessageHandler h) { on_message = std::move(h); }
+
+	/** Base64 encoding as used by the handshake, exposed for the tests. */
+	static std::string Base64Encode(const uint8_t* data, size_t len);
+
+	/** @return expected Sec-WebSocket-Accept value for a Sec-WebSocket-Key */
+	static std::string ComputeAccept(std::string_view key);
+
+private:
+	enum Opcode : uint8_t {
+		OP_CONTINUATION = 0x0,
+		OP_TEXT = 0x1,
+		OP_BINARY = 0x2,
+		OP_CLOSE = 0x8,
+		OP_PING = 0x9,
+		OP_PONG = 0xA,
+	};
+
+	void Fail();
+	void QueueFrame(uint8_t opcode, std::string_view payload);
+	bool FlushOutput();
+	bool ReadInput();
+	bool ProcessHandshake();
+	bool ProcessFrames();
+
+	int fd = -1;
+	State state = State::CLOSED;
+	/** incremented on every Connect/Close to detect reentrant state changes */
+	unsigned generation = 0;
+	bool failed = false;
+
+	std::string host;
+	std::string path;
+	std::string handshake_key;
+
+	std::string inbuf;
+	size_t inbuf_pos = 0;
+	std::string outbuf;
+	size_t outbuf_pos = 0;
+
+	std::string fragments;
+	// Opcode of the fragmented message in progress, OP_CONTINUATION if none
+	uint8_t fragment_opcode = OP_CONTINUATION;
+
+	OpenHandler on_open;
+	CloseHandler on_close;
+	MessageHandler on_message;
+};
+
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EP_OPEN_HASH_MAP_H
+#define EP_OPEN_HASH_MAP_H
+
+// Headers
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * Hash map with open addressing and linear probing.
+ *
+ * Keys and values are stored inline in one array, so a lookup touches a
+ * few neighbouring slots and never allocates. Meant for small POD keys
+ * that are looked up every frame.
+ *
+ * Pointers returned by Find and operator[] are invalidated by every
+ * insertion and erase.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>>
+class OpenHashMap {
+public:
+	OpenHashMap() = default;
+
+	/** @return number of entries */
+	size_t size() const { return count; }
+
+	/** @return true when there are no entries */
+	bool empty() const { return count == 0; }
+
+	/** @return number of slots */
+	size_t capacity() const { return slots.size(); }
+
+	/** @return true when the next insertion of a new key resizes the table */
+	bool IsFull() const { return (count + 1) * 4 > slots.size() * 3; }
+
+	/**
+	 * Looks up a key.
+	 *
+	 * @param key the key to look up.
+	 * @return the value or nullptr if there is none.
+	 */
+	V* Find(const K& key) {
+		if (count == 0) {
+			return nullptr;
+		}
+		for (size_t i = Home(key);; i = (i + 1) & mask) {
+			auto& slot = slots[i];
+			if (!slot.used) {
+				return nullptr;
+			}
+			if (slot.key == key) {
+				return &slot.value;
+			}
+		}
+	}
+
+	const V* Find(const K& key) const {
+		return const_cast<OpenHashMap*>(this)->Find(key);
+	}
+
+	/**
+	 * Looks up a key and inserts a default constructed value if there is none.
+	 *
+	 * @param key the key to look up.
+	 * @return the value.
+	 */
+	V& operator[](const K& key) {
+		if (IsFull()) {
+			Rehash(slots.empty() ? 16 : slots.size() * 2);
+		}
+		for (size_t i = Home(key);; i = (i + 1) & mask) {
+			auto& slot = slots[i];
+			if (!slot.used) {
+				slot.key = key;
+				slot.value = V();
+				slot.used = true;
+				++count;
+				return slot.value;
+			}
+			if (slot.key == key) {
+				return slot.value;
+			}
+		}
+	}
+
+	/**
+	 * Removes a key.
+	 *
+	 * @param key the key to remove.
+	 * @return true if the key was found.
+	 */
+	bool Erase(const K& key) {
+		if (count == 0) {
+			return false;
+		}
+		size_t i = Home(key);
+		for (;; i = (i + 1) & mask) {
+			if (!slots[i].used) {
+				return false;
+			}
+			if (slots[i].key == key) {
+				break;
+			}
+		}
+
+		// Shift the following entries of the probe run back, so lookups
+		// never need tombstones.
+		for (size_t j = (i + 1) & mask; slots[j].used; j = (j + 1) & mask) {
+			size_t home = Home(slots[j].key);
+			bool movable = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+			if (movable) {
+				slots[i] = std::move(slots[j]);
+				i = j;
+			}
+		}
+		slots[i] = Slot();
+		--count;
+		return true;
+	}
+
+	/**
+	 * Removes all entries for which pred(key, value) returns true and
+	 * rehashes the remaining ones in place.
+	 *
+	 * @param pred the predicate.
+	 * @return number of removed entries.
+	 */
+	template <typename F>
+	size_t EraseIf(F pred) {
+		if (count == 0) {
+			return 0;
+		}
+		size_t before = count;
+		Rehash(slots.size(), pred);
+		return before - count;
+	}
+
+	/** Calls f(key, value) for every entry. */
+	template <typename F>
+	void ForEach(F f) const {
+		for (auto& slot : slots) {
+			if (slot.used) {
+				f(slot.key, slot.value);
+			}
+		}
+	}
+
+	/** Removes all entries and releases the memory. */
+	void clear() {
+		slots.clear();
+		slots.shrink_to_fit();
+		mask = 0;
+		count = 0;
+	}
+
+private:
+	struct Slot {
+		K key = {};
+		V value = {};
+		bool used = false;
+	};
+
+	size_t Home(const K& key) const {
+		// Spread the upper bits in, Hash may be the identity.
+		uint64_t h = static_cast<uint64_t>(Hash()(key)) * UINT64_C(0x9E3779B97F4A7C15);
+		return static_cast<size_t>(h >> 32) & mask;
+	}
+
+	template <typename F = bool(*)(const K&, const V&)>
+	void Rehash(size_t new_capacity, F drop = [](const K&, const V&) { return false; }) {
+		std::vector<Slot> old(new_capacity);
+		old.swap(slots);
+		mask = new_capacity - 1;
+		count = 0;
+
+		for (auto& slot : old) {
+			if (!slot.used || drop(slot.key, slot.value)) {
+				continue;
+			}
+			size_t i = Home(slot.key);
+			while (slots[i].used) {
+				i = (i + 1) & mask;
+			}
+			slots[i] = std::move(slot);
+			++count;
+		}
+	}
+
+	std::vector<Slot> slots;
+	size_t mask = 0;
+	size_t count = 0;
+};
+
+#endif
@@ -25,6 +25,7 @@
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <mutex>
 
 #include "graphics.h"
 #include "output.h"
@@ -78,6 +79,10 @@ namespace {
 
 	Filesystem_Stream::OutputStream LOG_FILE;
 	bool output_recurse = false;
+	// Worker threads (e.g. asset decoding) can log too, recursive because
+	// opening the log file can log
+	std::recursive_mutex log_mutex;
+	const std::thread::id main_thread_id = std::this_thread::get_id();
 	bool init = false;
 
 	std::ostream& output_time() {
@@ -145,6 +150,9 @@ void Output::IgnorePause(bool const val) {
 }
 
 static void WriteLog(LogLevel lvl, std::string const& msg, Color const& c = Color()) {
+	std::lock_guard<std::recursive_mutex> lock(log_mutex);
+	const bool main_thread = std::this_thread::get_id() == main_thread_id;
+
 #ifdef EMSCRIPTEN
 
 // Allow pretty log output and filtering in browser console
@@ -177,7 +185,8 @@ EM_ASM({
 	bool add_to_buffer = true;
 
 	// Prevent recursion when the Save filesystem writes to the logfile on startup before it is ready
-	if (!output_recurse) {
+	// Messages of other threads are buffered, the filesystem is not thread safe
+	if (!output_recurse && main_thread) {
 		output_recurse = true;
 		if (FileFinder::Save()) {
 			add_to_buffer = false;
@@ -227,7 +236,7 @@ EM_ASM({
 
 #endif
 
-	if (lvl != LogLevel::Debug && lvl != LogLevel::Error) {
+	if (main_thread && lvl != LogLevel::Debug && lvl != LogLevel::Error) {
 		Graphics::GetMessageOverlay().AddMessage(msg, c);
 	}
 }
@@ -30,6 +30,16 @@ Plane::Plane() : Drawable(0)
 }
 
 void Plane::Draw(Bitmap& dst) {
+	Refresh();
+	DrawBand(dst);
+}
+
+bool Plane::PrepareBands(const Bitmap&) {
+	Refresh();
+	return true;
+}
+
+void Plane::Refresh() {
 	if (!bitmap) return;
 
 	if (needs_refresh) {
@@ -43,8 +53,12 @@ void Plane::Draw(Bitmap& dst) {
 		tone_bitmap->Clear();
 		tone_bitmap->ToneBlit(0, 0, *bitmap, bitmap->GetRect(), tone_effect, Opacity::Opaque());
 	}
+}
+
+void Plane::DrawBand(Bitmap& dst) const {
+	if (!bitmap) return;
 
-	BitmapRef source = tone_effect == Tone() ? bitmap : tone_bitmap;
+	const BitmapRef& source = tone_effect == Tone() ? bitmap : tone_bitmap;
 
 	Rect dst_rect = dst.GetRect();
 	int src_x = -ox;
@@ -32,6 +32,8 @@ public:
 	Plane();
 
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap& dst) override;
+	void DrawBand(Bitmap& dst) const override;
 
 	BitmapRef const& GetBitmap() const;
 	void SetBitmap(BitmapRef const& bitmap);
@@ -51,6 +53,8 @@ private:
 	int ox = 0;
 	int oy = 0;
 	bool needs_refresh = false;
+
+	void Refresh();
 };
 
 inline BitmapRef const& Plane::GetBitmap() const {
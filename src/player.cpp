@@ -44,9 +44,15 @@
 
 #include "async_handler.h"
 #include "audio.h"
+#include "audio_generic.h"
+#include "audio_mixer.h"
+#include "audio_secache.h"
+#include "bitmap_kernels.h"
 #include "cache.h"
 #include "rand.h"
 #include "cmdline_parser.h"
+#include "cpu_features.h"
+#include "decode_pool.h"
 #include "dynrpg.h"
 #include "filefinder.h"
 #include "filefinder_rtp.h"
@@ -57,6 +63,7 @@
 #include "game_message.h"
 #include "game_enemyparty.h"
 #include "game_ineluki.h"
+#include "game_multiplayer.h"
 #include "game_party.h"
 #include "game_player.h"
 #include "game_switches.h"
@@ -66,6 +73,7 @@
 #include "game_variables.h"
 #include "game_targets.h"
 #include "graphics.h"
+#include "fps_overlay.h"
 #include <lcf/inireader.h>
 #include "input.h"
 #include <lcf/ldb/reader.h>
@@ -188,6 +196,9 @@ void Player::Init(int argc, char *argv[]) {
 #endif
 
 	Game_Clock::logClockInfo();
+	Output::Debug("SIMD: {}", CpuFeatures::GetDescription());
+	Output::Debug("Bitmap kernels: {}", BitmapKernels::GetKernelName(BitmapKernels::GetKernel()));
+	Output::Debug("Audio mixer: {}", AudioMixer::GetKernelName(AudioMixer::GetKernel()));
 	Rand::SeedRandomNumberGenerator(time(NULL));
 
 #ifdef EMSCRIPTEN
@@ -219,6 +230,16 @@ void Player::Init(int argc, char *argv[]) {
 	Input::AddRecordingData(Input::RecordingData::CommandLine, command_line);
 
 	player_config = std::move(cfg.player);
+	Game_Multiplayer::SetMoveBuffering(cfg.multiplayer.move_latency.Get(),
+		cfg.multiplayer.move_max_lag.Get());
+	Cache::SetBudgets(cfg.cache);
+	DecodePool::SetThreads(cfg.cache.decode_threads.Get());
+	AudioSeCache::SetBudget(cfg.cache.sound.Get() * 1024 * 1024);
+	GenericAudio::SetOptions(cfg.audio);
+	Graphics::SetRenderThreads(cfg.video.render_threads.Get());
+	Game_Multiplayer::SetTrafficDumpInterval(cfg.multiplayer.stats_interval.Get());
+	Game_Multiplayer::SetOutboundBudget(cfg.multiplayer.picture_rate.Get(),
+		cfg.multiplayer.sound_rate.Get());
 }
 
 void Player::Run() {
@@ -325,6 +346,10 @@ void Player::UpdateInput() {
 	if (Input::IsSystemTriggered(Input::TOGGLE_ZOOM)) {
 		DisplayUi->ToggleZoom();
 	}
+	if (Input::IsSystemTriggered(Input::TOGGLE_NET_STATS)) {
+		auto& overlay = Graphics::GetFpsOverlay();
+		overlay.SetDrawNetStats(!overlay.GetDrawNetStats());
+	}
 	float speed = 1.0;
 	/*if (Input::IsSystemPressed(Input::FAST_FORWARD)) {
 		speed = speed_modifier;
@@ -363,6 +388,7 @@ void Player::Update(bool update_scene) {
 	}
 
 	Audio().Update();
+	DecodePool::Update();
 	Input::Update();
 
 	// Game events can query full screen status and change their behavior, so this needs to
@@ -420,6 +446,7 @@ void Player::Exit() {
 	DisplayUi->UpdateDisplay();
 #endif
 
+	DecodePool::Quit();
 	Player::ResetGameObjects();
 	Font::Dispose();
 	DynRpg::Reset();
@@ -1322,6 +1349,10 @@ void Player::PrintUsage() {
 R"(EasyRPG Player - An open source interpreter for RPG Maker 2000/2003 games.
 Options:
       --battle-test N      Start a battle test with monster party N.
+      --bgm-crossfade      Fade the previous music out while new music fades in.
+      --bgm-read-ahead N   Decode music N ms ahead of playback on a separate
+                           thread. The default is 200, 0 decodes in the audio
+                           callback.
       --disable-audio      Disable audio (in case you prefer your own music).
       --disable-rtp        Disable support for the Runtime Package (RTP).
       --encoding N         Instead of auto detecting the encoding or using
@@ -1343,16 +1374,39 @@ Options:
                            This option is not supported on all platforms.
       --no-vsync           Disable vertical sync and use fps-limit. Even without
                            this option, vsync may not be supported on all platforms.
+      --cache-size N       Keep up to N MB of unused images in memory. The
+                           default is 64.
+      --decode-threads N   Decode requested images on N background threads.
+                           The default is 0 (decode when an image is used).
+      --sound-cache-size N Keep up to N MB of decoded sound effects in memory.
+                           The default is 8.
       --enable-mouse       Use mouse click for decision and scroll wheel for lists
       --enable-touch       Use one/two finger tap for decision/cancel
       --hide-title         Hide the title background image and center the
                            command menu.
       --load-game-id N     Skip the title scene and load SaveN.lsd
                            (N is padded to two digits).
+      --mp-latency N       Buffer the movement of other players for N ms to
+                           smooth out network jitter. The default is 100.
+      --mp-max-lag N       Skip buffered movement of other players once it
+                           falls more than N ms behind. The default is 1000.
+      --mp-picture-rate N  Send at most N picture updates per second. Moves
+                           over the limit are merged into their final target.
+                           The default is 120, 0 disables the limit.
+      --mp-sound-rate N    Send at most N sound effects per second, others are
+                           not sent. The default is 0 (no limit).
+      --mp-stats N         Write multiplayer traffic statistics to the log
+                           every N seconds as a "mpstats" JSON line.
       --new-game           Skip the title scene and start a new game directly.
+      --pacing-stats N     Write frame pacing statistics to the log every N
+                           seconds as a "pacing" JSON line.
+      --present-thread     Show frames from a separate thread, so the game
+                           does not wait for vertical sync.
       --project-path PATH  Instead of using the working directory the game in
                            PATH is used.
       --record-input PATH  Record all button input to a log file at PATH.
+      --render-threads N   Draw the screen in N horizontal bands on N threads.
+                           The default is 0, drawing on the main thread only.
       --replay-input PATH  Replays button presses from an input log generated by
                            --record-input.
       --save-path PATH     Instead of storing save files in the game directory
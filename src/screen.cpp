@@ -30,13 +30,26 @@ Screen::Screen() : Drawable(Priority_Screen)
 }
 
 void Screen::Draw(Bitmap& dst) {
+	PrepareBands(dst);
+	DrawBand(dst);
+}
+
+bool Screen::PrepareBands(const Bitmap&) {
 	auto flash_color = Main_Data::game_screen->GetFlashColor();
-	if (flash_color.alpha > 0) {
+	draw_flash = flash_color.alpha > 0;
+	if (draw_flash) {
 		if (!flash) {
 			flash = Bitmap::Create(SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT, flash_color);
 		} else {
 			flash->Fill(flash_color);
 		}
+		flash->Validate();
+	}
+	return true;
+}
+
+void Screen::DrawBand(Bitmap& dst) const {
+	if (draw_flash) {
 		dst.Blit(0, 0, *flash, flash->GetRect(), 255);
 	}
 }
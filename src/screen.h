@@ -37,9 +37,12 @@ public:
 	Screen();
 
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap& dst) override;
+	void DrawBand(Bitmap& dst) const override;
 
 private:
 	BitmapRef flash;
+	bool draw_flash = false;
 };
 
 #endif
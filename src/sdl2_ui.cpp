@@ -147,6 +147,16 @@ Sdl2Ui::Sdl2Ui(long width, long height, const Game_ConfigVideo& cfg) : BaseUi(cf
 		Output::Error("Couldn't initialize SDL.\n{}\n", SDL_GetError());
 	}
 
+	use_present_thread = cfg.present_thread.Get();
+#if defined(EMSCRIPTEN) || defined(__ANDROID__) || defined(__APPLE__)
+	if (use_present_thread) {
+		// The renderer must stay on the main thread here
+		Output::Debug("SDL2: Present thread not supported on this platform");
+		use_present_thread = false;
+	}
+#endif
+	frame_pacing.SetDumpInterval(cfg.pacing_stats.Get());
+
 	RequestVideoMode(width, height,
 			cfg.window_zoom.Get(),
 			cfg.fullscreen.Get(),
@@ -180,11 +190,10 @@ Sdl2Ui::Sdl2Ui(long width, long height, const Game_ConfigVideo& cfg) : BaseUi(cf
 }
 
 Sdl2Ui::~Sdl2Ui() {
-	if (sdl_texture) {
-		SDL_DestroyTexture(sdl_texture);
-	}
-	if (sdl_renderer) {
-		SDL_DestroyRenderer(sdl_renderer);
+	if (present_thread.joinable()) {
+		StopPresentThread();
+	} else {
+		DestroyRenderer();
 	}
 	if (sdl_window) {
 		SDL_DestroyWindow(sdl_window);
@@ -244,13 +253,14 @@ void Sdl2Ui::EndDisplayModeChange() {
 			SetIsFullscreen((current_display_mode.flags & SDL_WINDOW_FULLSCREEN_DESKTOP) == SDL_WINDOW_FULLSCREEN_DESKTOP);
 #endif
 	}
+
+	ReleaseWindowEvents();
 }
 
 bool Sdl2Ui::RefreshDisplayMode() {
 	uint32_t flags = current_display_mode.flags;
 	int display_width = current_display_mode.width;
 	int display_height = current_display_mode.height;
-	bool& vsync = current_display_mode.vsync;
 
 #ifdef SUPPORT_ZOOM
 	display_width *= current_display_mode.zoom;
@@ -293,70 +303,17 @@ bool Sdl2Ui::RefreshDisplayMode() {
 
 		SetAppIcon();
 
-		uint32_t rendered_flag = 0;
-
-#ifndef __MORPHOS__
-		if (vsync) {
-			rendered_flag |= SDL_RENDERER_PRESENTVSYNC;
-		}
-#endif
-
-		sdl_renderer = SDL_CreateRenderer(sdl_window, -1, rendered_flag);
-		if (!sdl_renderer) {
-			Output::Debug("SDL_CreateRenderer failed : {}", SDL_GetError());
-			return false;
-		}
-
-		auto renderer_sg = lcf::makeScopeGuard([&]() {
-				SDL_DestroyRenderer(sdl_renderer);
-				sdl_renderer = nullptr;
-				});
-
-		uint32_t texture_format = SDL_PIXELFORMAT_UNKNOWN;
-
-		SDL_RendererInfo rinfo = {};
-		if (SDL_GetRendererInfo(sdl_renderer, &rinfo) == 0) {
-			Output::Debug("SDL2: RendererInfo hw={} sw={} vsync={}",
-					!!(rinfo.flags & SDL_RENDERER_ACCELERATED),
-					!!(rinfo.flags & SDL_RENDERER_SOFTWARE),
-					!!(rinfo.flags & SDL_RENDERER_PRESENTVSYNC)
-					);
-			texture_format = SelectFormat(rinfo, false);
-		} else {
-			Output::Debug("SDL_GetRendererInfo failed : {}", SDL_GetError());
-		}
-
-		vsync = rinfo.flags & SDL_RENDERER_PRESENTVSYNC;
-		SetFrameRateSynchronized(vsync);
-
-		if (texture_format == SDL_PIXELFORMAT_UNKNOWN) {
-			texture_format = GetDefaultFormat();
-			Output::Debug("SDL2: None of the ({}) detected formats were supported! Falling back to {}. This will likely cause performance degredation.",
-					rinfo.num_texture_formats, SDL_GetPixelFormatName(texture_format));
-			// Run again to print all the formats on this system.
-			SelectFormat(rinfo, true);
-		}
-
-		Output::Debug("SDL2: Selected Pixel Format {}", SDL_GetPixelFormatName(texture_format));
-
-		// Flush display
-		SDL_RenderClear(sdl_renderer);
-		SDL_RenderPresent(sdl_renderer);
-
-		SDL_RenderSetLogicalSize(sdl_renderer, SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT);
-
-
-		sdl_texture = SDL_CreateTexture(sdl_renderer,
-			texture_format,
-			SDL_TEXTUREACCESS_STREAMING,
-			SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT);
-
-		if (!sdl_texture) {
-			Output::Debug("SDL_CreateTexture failed : {}", SDL_GetError());
+		if (use_present_thread) {
+			// Runs before the event watch of the renderer
+			SDL_AddEventWatch(&Sdl2Ui::WindowEventWatch, this);
+			if (!StartPresentThread()) {
+				SDL_DelEventWatch(&Sdl2Ui::WindowEventWatch, this);
+				return false;
+			}
+		} else if (!CreateRenderer()) {
 			return false;
 		}
 
-		renderer_sg.Dismiss();
 		window_sg.Dismiss();
 	} else {
 		// Browser handles fast resizing for emscripten, TODO: use fullscreen API
@@ -380,15 +337,7 @@ bool Sdl2Ui::RefreshDisplayMode() {
 	// creating the renderer (i.e. Windows), see also comment in SetAppIcon()
 	SetAppIcon();
 
-	uint32_t sdl_pixel_fmt = GetDefaultFormat();
-	int a, w, h;
-
-	if (SDL_QueryTexture(sdl_texture, &sdl_pixel_fmt, &a, &w, &h) != 0) {
-		Output::Debug("SDL_QueryTexture failed : {}", SDL_GetError());
-		return false;
-	}
-
-	auto format = GetDynamicFormat(sdl_pixel_fmt);
+	auto format = GetDynamicFormat(texture_format);
 	Bitmap::SetFormat(Bitmap::ChooseFormat(format));
 
 	if (!main_surface) {
@@ -400,6 +349,217 @@ bool Sdl2Ui::RefreshDisplayMode() {
 	return true;
 }
 
+bool Sdl2Ui::CreateRenderer() {
+	bool& vsync = current_display_mode.vsync;
+
+	uint32_t rendered_flag = 0;
+
+#ifndef __MORPHOS__
+	if (vsync) {
+		rendered_flag |= SDL_RENDERER_PRESENTVSYNC;
+	}
+#endif
+
+	sdl_renderer = SDL_CreateRenderer(sdl_window, -1, rendered_flag);
+	if (!sdl_renderer) {
+		Output::Debug("SDL_CreateRenderer failed : {}", SDL_GetError());
+		return false;
+	}
+
+	auto renderer_sg = lcf::makeScopeGuard([&]() {
+			DestroyRenderer();
+			});
+
+	texture_format = SDL_PIXELFORMAT_UNKNOWN;
+
+	SDL_RendererInfo rinfo = {};
+	if (SDL_GetRendererInfo(sdl_renderer, &rinfo) == 0) {
+		Output::Debug("SDL2: RendererInfo hw={} sw={} vsync={}",
+				!!(rinfo.flags & SDL_RENDERER_ACCELERATED),
+				!!(rinfo.flags & SDL_RENDERER_SOFTWARE),
+				!!(rinfo.flags & SDL_RENDERER_PRESENTVSYNC)
+				);
+		texture_format = SelectFormat(rinfo, false);
+	} else {
+		Output::Debug("SDL_GetRendererInfo failed : {}", SDL_GetError());
+	}
+
+	vsync = rinfo.flags & SDL_RENDERER_PRESENTVSYNC;
+	// With the present thread the main loop keeps its own pace
+	SetFrameRateSynchronized(vsync && !use_present_thread);
+
+	SDL_DisplayMode mode;
+	if (vsync && SDL_GetWindowDisplayMode(sdl_window, &mode) == 0 && mode.refresh_rate > 0) {
+		frame_pacing.SetTarget(Game_Clock::TimeStepFromFps(mode.refresh_rate));
+	} else if (fps_limit > 0) {
+		frame_pacing.SetTarget(frame_limit);
+	}
+
+	if (texture_format == SDL_PIXELFORMAT_UNKNOWN) {
+		texture_format = GetDefaultFormat();
+		Output::Debug("SDL2: None of the ({}) detected formats were supported! Falling back to {}. This will likely cause performance degredation.",
+				rinfo.num_texture_formats, SDL_GetPixelFormatName(texture_format));
+		// Run again to print all the formats on this system.
+		SelectFormat(rinfo, true);
+	}
+
+	Output::Debug("SDL2: Selected Pixel Format {}", SDL_GetPixelFormatName(texture_format));
+
+	// Flush display
+	SDL_RenderClear(sdl_renderer);
+	SDL_RenderPresent(sdl_renderer);
+
+	SDL_RenderSetLogicalSize(sdl_renderer, SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT);
+
+
+	// Frames rotate through the textures, so a texture the GPU may still
+	// read from is not written to. The present thread runs ahead by one.
+	const int buffers = use_present_thread ? 3 : 2;
+	for (int i = 0; i < buffers; ++i) {
+		auto* texture = SDL_CreateTexture(sdl_renderer,
+			texture_format,
+			SDL_TEXTUREACCESS_STREAMING,
+			SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT);
+
+		if (!texture) {
+			Output::Debug("SDL_CreateTexture failed : {}", SDL_GetError());
+			return false;
+		}
+		sdl_textures.push_back(texture);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		frame_upload.Init(buffers, SCREEN_TARGET_WIDTH, SCREEN_TARGET_HEIGHT, SDL_BYTESPERPIXEL(texture_format));
+	}
+	presented_buffer = -1;
+
+	renderer_sg.Dismiss();
+	return true;
+}
+
+void Sdl2Ui::DestroyRenderer() {
+	for (auto* texture : sdl_textures) {
+		SDL_DestroyTexture(texture);
+	}
+	sdl_textures.clear();
+
+	if (sdl_renderer) {
+		SDL_DestroyRenderer(sdl_renderer);
+		sdl_renderer = nullptr;
+	}
+}
+
+bool Sdl2Ui::StartPresentThread() {
+	present_state = PresentState::Starting;
+	present_thread = std::thread(&Sdl2Ui::PresentThreadLoop, this);
+
+	{
+		std::unique_lock<std::mutex> lock(frame_mutex);
+		present_cv.wait(lock, [this]() { return present_state != PresentState::Starting; });
+		if (present_state == PresentState::Running) {
+			Output::Debug("SDL2: Presenting on a separate thread");
+			return true;
+		}
+	}
+
+	present_thread.join();
+	return false;
+}
+
+void Sdl2Ui::StopPresentThread() {
+	SDL_DelEventWatch(&Sdl2Ui::WindowEventWatch, this);
+	ReleaseWindowEvents();
+
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		present_state = PresentState::Stopping;
+	}
+	present_cv.notify_all();
+	present_thread.join();
+}
+
+void Sdl2Ui::PresentThreadLoop() {
+	// The renderer belongs to the thread that created it
+	bool created;
+	{
+		std::lock_guard<std::mutex> render_lock(render_mutex);
+		created = CreateRenderer();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		present_state = created ? PresentState::Running : PresentState::Failed;
+	}
+	present_cv.notify_all();
+
+	if (!created) {
+		return;
+	}
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(frame_mutex);
+			present_cv.wait(lock, [this]() { return frame_pending || present_state == PresentState::Stopping; });
+			if (present_state == PresentState::Stopping) {
+				break;
+			}
+			frame_pending = false;
+		}
+
+		std::lock_guard<std::mutex> render_lock(render_mutex);
+		Present();
+	}
+
+	std::lock_guard<std::mutex> render_lock(render_mutex);
+	DestroyRenderer();
+}
+
+int Sdl2Ui::WindowEventWatch(void* userdata, SDL_Event* evnt) {
+	// The renderer adjusts itself to window changes from inside the event
+	// loop of the main thread. Keep the present thread out of the renderer
+	// until the main thread processed the events.
+	auto* ui = static_cast<Sdl2Ui*>(userdata);
+	if (evnt->type == SDL_WINDOWEVENT && std::this_thread::get_id() == ui->main_thread_id
+			&& !ui->window_event_lock.owns_lock()) {
+		ui->window_event_lock = std::unique_lock<std::mutex>(ui->render_mutex);
+	}
+	return 1;
+}
+
+void Sdl2Ui::ReleaseWindowEvents() {
+	if (window_event_lock.owns_lock()) {
+		window_event_lock.unlock();
+	}
+}
+
+void Sdl2Ui::Present() {
+	FrameUpload::Rows rows;
+	int buffer;
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		buffer = frame_upload.NextBuffer(rows);
+		if (!rows.Empty()) {
+			// SDL_UpdateTexture was found to be faster than SDL_LockTexture / SDL_UnlockTexture.
+			const int pitch = frame_upload.GetPitch();
+			SDL_Rect rect = { 0, rows.top, SCREEN_TARGET_WIDTH, rows.Count() };
+			SDL_UpdateTexture(sdl_textures[buffer], &rect, frame_upload.GetPixels() + rows.top * pitch, pitch);
+		}
+	}
+
+	const bool repeated = buffer == presented_buffer;
+	presented_buffer = buffer;
+
+	const auto begin = Game_Clock::now();
+	SDL_RenderClear(sdl_renderer);
+	SDL_RenderCopy(sdl_renderer, sdl_textures[buffer], NULL, NULL);
+	SDL_RenderPresent(sdl_renderer);
+	const auto end = Game_Clock::now();
+
+	std::lock_guard<std::mutex> lock(frame_mutex);
+	frame_pacing.OnPresent(begin, end, rows.Count(), repeated);
+}
+
 void Sdl2Ui::ToggleFullscreen() {
 	BeginDisplayModeChange();
 	if ((current_display_mode.flags & SDL_WINDOW_FULLSCREEN_DESKTOP) == SDL_WINDOW_FULLSCREEN_DESKTOP)
@@ -458,14 +618,30 @@ void Sdl2Ui::ProcessEvents() {
 		if (Player::exit_flag)
 			break;
 	}
+
+	ReleaseWindowEvents();
 }
 
 void Sdl2Ui::UpdateDisplay() {
-	// SDL_UpdateTexture was found to be faster than SDL_LockTexture / SDL_UnlockTexture.
-	SDL_UpdateTexture(sdl_texture, NULL, main_surface->pixels(), main_surface->pitch());
-	SDL_RenderClear(sdl_renderer);
-	SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
-	SDL_RenderPresent(sdl_renderer);
+	const bool threaded = present_thread.joinable();
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		frame_upload.AddFrame(main_surface->pixels(), main_surface->pitch());
+		frame_pacing.Update(Game_Clock::now());
+
+		if (threaded) {
+			if (frame_pending) {
+				frame_pacing.OnFrameDropped();
+			}
+			frame_pending = true;
+		}
+	}
+
+	if (threaded) {
+		present_cv.notify_all();
+	} else {
+		Present();
+	}
 }
 
 void Sdl2Ui::SetTitle(const std::string &title) {
@@ -490,6 +666,14 @@ void Sdl2Ui::ProcessEvent(SDL_Event &evnt) {
 			ProcessActiveEvent(evnt);
 			return;
 
+		case SDL_RENDER_TARGETS_RESET:
+		case SDL_RENDER_DEVICE_RESET: {
+			// The textures lost their content, the next present uploads the whole frame
+			std::lock_guard<std::mutex> lock(frame_mutex);
+			frame_upload.Invalidate();
+			return;
+		}
+
 		case SDL_QUIT:
 			Player::exit_flag = true;
 			return;
@@ -21,9 +21,15 @@
 // Headers
 #include "baseui.h"
 #include "color.h"
+#include "frame_pacing.h"
+#include "frame_upload.h"
 #include "rect.h"
 #include "system.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <SDL.h>
 
 extern "C" {
@@ -80,6 +86,33 @@ private:
 	 */
 	bool RefreshDisplayMode();
 
+	/**
+	 * Creates the renderer and the streaming textures. Called on the thread
+	 * that presents.
+	 *
+	 * @return whether the creation was successful.
+	 */
+	bool CreateRenderer();
+	void DestroyRenderer();
+
+	/** Uploads the out of date rows of the next texture and presents it. */
+	void Present();
+
+	/**
+	 * Present thread, owns the renderer and presents every frame passed by
+	 * UpdateDisplay. Frames arriving faster than they are presented replace
+	 * the pending one.
+	 */
+	/** @{ */
+
+	bool StartPresentThread();
+	void StopPresentThread();
+	void PresentThreadLoop();
+	static int SDLCALL WindowEventWatch(void* userdata, SDL_Event* evnt);
+	void ReleaseWindowEvents();
+
+	/** @} */
+
 	void BeginDisplayModeChange();
 	void EndDisplayModeChange();
 
@@ -119,10 +152,37 @@ private:
 	DisplayMode last_display_mode;
 
 	/** Main SDL window. */
-	SDL_Texture* sdl_texture = nullptr;
 	SDL_Window* sdl_window = nullptr;
 	SDL_Renderer* sdl_renderer = nullptr;
 
+	/** Streaming textures the frames rotate through */
+	std::vector<SDL_Texture*> sdl_textures;
+	uint32_t texture_format = SDL_PIXELFORMAT_UNKNOWN;
+	int presented_buffer = -1;
+
+	FrameUpload frame_upload;
+	FramePacing frame_pacing;
+
+	enum class PresentState {
+		Starting,
+		Running,
+		Failed,
+		Stopping
+	};
+
+	bool use_present_thread = false;
+	std::thread present_thread;
+	std::thread::id main_thread_id = std::this_thread::get_id();
+	/** Guards frame_upload, frame_pacing and the present thread state */
+	std::mutex frame_mutex;
+	std::condition_variable present_cv;
+	PresentState present_state = PresentState::Starting;
+	bool frame_pending = false;
+	/** Held by the present thread while it uses the renderer */
+	std::mutex render_mutex;
+	/** Held by the main thread while the renderer processes window events */
+	std::unique_lock<std::mutex> window_event_lock;
+
 	std::unique_ptr<AudioInterface> audio_;
 };
 
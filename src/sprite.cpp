@@ -37,18 +37,44 @@ void Sprite::Draw(Bitmap& dst) {
 	BlitScreen(dst);
 }
 
+bool Sprite::PrepareBands(const Bitmap&) {
+	ClearBand();
+	if (GetWidth() > 0 && GetHeight() > 0) {
+		band_bitmap = PrepareBlitScreen(band_rect);
+	}
+	if (band_bitmap) {
+		// Shared by the bands, bitmap_effects may be new
+		band_bitmap->Validate();
+	}
+	return true;
+}
+
+void Sprite::DrawBand(Bitmap& dst) const {
+	if (band_bitmap) {
+		BlitScreenIntern(dst, *band_bitmap, band_rect);
+	}
+}
+
 void Sprite::BlitScreen(Bitmap& dst) {
+	Rect rect;
+	auto* draw_bitmap = PrepareBlitScreen(rect);
+	if (draw_bitmap) {
+		BlitScreenIntern(dst, *draw_bitmap, rect);
+	}
+}
+
+const Bitmap* Sprite::PrepareBlitScreen(Rect& rect) {
 	if (!bitmap || (opacity_top_effect <= 0 && opacity_bottom_effect <= 0))
-		return;
+		return nullptr;
 
 	BitmapRef draw_bitmap = Refresh(src_rect_effect);
 	if (!draw_bitmap) {
-		return;
+		return nullptr;
 	}
 
 	bitmap_changed = false;
 
-	Rect rect = src_rect_effect.GetSubRect(src_rect);
+	rect = src_rect_effect.GetSubRect(src_rect);
 	if (draw_bitmap == bitmap_effects) {
 		// When a "sprite rect" (src_rect_effect) is used bitmap_effects
 		// only has the size of this subrect instead of the whole bitmap
@@ -56,7 +82,8 @@ void Sprite::BlitScreen(Bitmap& dst) {
 		rect.y %= bitmap_effects->GetHeight();
 	}
 
-	BlitScreenIntern(dst, *draw_bitmap, rect);
+	// draw_bitmap is either bitmap or bitmap_effects, both keep it alive
+	return draw_bitmap.get();
 }
 
 void Sprite::BlitScreenIntern(Bitmap& dst, Bitmap const& draw_bitmap, Rect const& src_rect) const
@@ -34,6 +34,13 @@ public:
 
 	void Draw(Bitmap& dst) override;
 
+	/**
+	 * Sprites are drawn in bands unless a subclass changes Draw, those
+	 * must override PrepareBands too.
+	 */
+	bool PrepareBands(const Bitmap& dst) override;
+	void DrawBand(Bitmap& dst) const override;
+
 	virtual int GetWidth() const;
 	virtual int GetHeight() const;
 
@@ -102,6 +109,10 @@ public:
 	 */
 	void SetFlashEffect(const Color &color);
 
+protected:
+	/** Makes the next DrawBand calls draw nothing. */
+	void ClearBand();
+
 private:
 	BitmapRef bitmap;
 
@@ -137,12 +148,21 @@ private:
 	bool current_flip_y = false;
 	bool bitmap_changed = true;
 
+	/** What DrawBand blits, owned by bitmap or bitmap_effects */
+	const Bitmap* band_bitmap = nullptr;
+	Rect band_rect;
+
 	void BlitScreen(Bitmap& dst);
+	const Bitmap* PrepareBlitScreen(Rect& rect);
 	void BlitScreenIntern(Bitmap& dst, Bitmap const& draw_bitmap,
 							Rect const& src_rect) const;
 	BitmapRef Refresh(Rect& rect);
 };
 
+inline void Sprite::ClearBand() {
+	band_bitmap = nullptr;
+}
+
 inline int Sprite::GetWidth() const {
 	return src_rect.width;
 }
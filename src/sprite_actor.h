@@ -89,6 +89,7 @@ public:
 	int GetHeight() const override;
 
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap&) override { return false; }
 
 	Game_Actor* GetBattler() const;
 
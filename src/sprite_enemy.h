@@ -41,6 +41,7 @@ public:
 	~Sprite_Enemy() override;
 
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap&) override { return false; }
 
 	Game_Enemy* GetBattler() const;
 
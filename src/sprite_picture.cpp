@@ -64,19 +64,33 @@ void Sprite_Picture::OnPictureShow() {
 
 
 void Sprite_Picture::Draw(Bitmap& dst) {
+	if (UpdatePicture()) {
+		Sprite::Draw(dst);
+	}
+}
+
+bool Sprite_Picture::PrepareBands(const Bitmap& dst) {
+	if (UpdatePicture()) {
+		return Sprite::PrepareBands(dst);
+	}
+	ClearBand();
+	return true;
+}
+
+bool Sprite_Picture::UpdatePicture() {
 	const auto& pic = Main_Data::game_pictures->GetPicture(pic_id);
 	const auto& data = pic.data;
 
 	auto& bitmap = GetBitmap();
 
 	if (!bitmap) {
-		return;
+		return false;
 	}
 
 	const bool is_battle = Game_Battle::IsBattleRunning();
 
 	if (is_battle ? !pic.IsOnBattle() : !pic.IsOnMap()) {
-		return;
+		return false;
 	}
 
 	// RPG Maker 2k3 1.12: Spritesheets
@@ -146,5 +160,5 @@ void Sprite_Picture::Draw(Bitmap& dst) {
 	SetFlipY((data.easyrpg_flip & lcf::rpg::SavePicture::EasyRpgFlip_y) == lcf::rpg::SavePicture::EasyRpgFlip_y);
 	SetBlendType(data.easyrpg_blend_mode);
 
-	Sprite::Draw(dst);
+	return true;
 }
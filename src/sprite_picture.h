@@ -35,10 +35,18 @@ public:
 	Sprite_Picture(int pic_id, Drawable::Flags flags = Drawable::Flags::Default);
 
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap& dst) override;
 
 	void OnPictureShow();
 
 private:
+	/**
+	 * Applies the picture state to the sprite.
+	 *
+	 * @return false when the picture is not drawn
+	 */
+	bool UpdatePicture();
+
 	int last_spritesheet_frame = -1;
 	const int pic_id = 0;
 	const bool feature_spritesheet = false;
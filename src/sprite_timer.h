@@ -37,6 +37,7 @@ public:
 
 protected:
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap&) override { return false; }
 
 	int which = 0;
 
@@ -52,6 +52,7 @@ public:
 	void StopAttack();
 
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap&) override { return false; }
 
 protected:
 	void CreateSprite();
@@ -54,6 +54,7 @@ void Spriteset_Map::Refresh() {
 	tilemap.reset(new Tilemap());
 	tilemap->SetWidth(Game_Map::GetWidth());
 	tilemap->SetHeight(Game_Map::GetHeight());
+	tilemap->SetLoop(Game_Map::LoopHorizontal(), Game_Map::LoopVertical());
 
 	airship_shadows.clear();
 	character_sprites.clear();
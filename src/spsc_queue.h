@@ -0,0 +1,121 @@
+/*
+ * This file is part of EasyRPG Player.
+ *
+ * EasyRPG Player is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EasyRPG Player is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with EasyRPG Player. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EP_SPSC_QUEUE_H
+#define EP_SPSC_QUEUE_H
+
+// Headers
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * A bounded lock-free queue for exactly one producer and one consumer
+ * thread. Neither side ever blocks or allocates after construction, which
+ * makes it safe to use from an audio callback.
+ *
+ * Either side may change threads when the switch is synchronized by other
+ * means, e.g. a mutex held by the old and the new thread.
+ */
+template <typename T>
+class SpscQueue {
+	public:
+		/**
+		 * @param capacity maximum number of queued elements, rounded up to
+		 * a power of two
+		 */
+		explicit SpscQueue(size_t capacity);
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		/**
+		 * Appends an element. Must only be called by the producer.
+		 *
+		 * @param value element to move into the queue
+		 * @return false when the queue is full, value is untouched then
+		 */
+		bool Push(T&& value);
+
+		/**
+		 * Removes the oldest element. Must only be called by the consumer.
+		 *
+		 * @param value receives the element
+		 * @return false when the queue is empty
+		 */
+		bool Pop(T& value);
+
+		/** @return whether the queue is empty, only exact for the consumer */
+		bool IsEmpty() const;
+
+		/** @return maximum number of queued elements */
+		size_t GetCapacity() const;
+
+	private:
+		std::vector<T> slots;
+		size_t mask = 0;
+		/** Next slot to read, written by the consumer */
+		alignas(64) std::atomic<size_t> head = { 0 };
+		/** Next slot to write, written by the producer */
+		alignas(64) std::atomic<size_t> tail = { 0 };
+};
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity) {
+	size_t size = 1;
+	while (size < capacity) {
+		size *= 2;
+	}
+	slots.resize(size);
+	mask = size - 1;
+}
+
+template <typename T>
+inline bool SpscQueue<T>::Push(T&& value) {
+	const size_t t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) == slots.size()) {
+		return false;
+	}
+	slots[t & mask] = std::move(value);
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+inline bool SpscQueue<T>::Pop(T& value) {
+	const size_t h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+	value = std::move(slots[h & mask]);
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+inline bool SpscQueue<T>::IsEmpty() const {
+	return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+template <typename T>
+inline size_t SpscQueue<T>::GetCapacity() const {
+	return slots.size();
+}
+
+#endif
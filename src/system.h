@@ -105,7 +105,7 @@
 
 #endif
 
-#if defined(HAVE_LIBSAMPLERATE) || defined(HAVE_LIBSPEEXDSP)
+#if defined(HAVE_LIBSAMPLERATE) || defined(HAVE_LIBSPEEXDSP) || defined(PLAYER_BUILTIN_RESAMPLER)
 #  define USE_AUDIO_RESAMPLER
 #endif
 
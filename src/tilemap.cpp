@@ -95,3 +95,17 @@ void Tilemap::SetTone(Tone tone) {
 	layer_down.SetTone(tone);
 	layer_up.SetTone(tone);
 }
+
+void Tilemap::SetLoop(bool horizontal, bool vertical) {
+	layer_down.SetLoop(horizontal, vertical);
+	layer_up.SetLoop(horizontal, vertical);
+}
+
+bool Tilemap::IsRetained() const {
+	return layer_down.IsRetained();
+}
+
+void Tilemap::SetRetained(bool retained) {
+	layer_down.SetRetained(retained);
+	layer_up.SetRetained(retained);
+}
@@ -64,6 +64,9 @@ public:
 	void OnSubstituteUp();
 	void SetFastBlitDown(bool fast);
 	void SetTone(Tone tone);
+	void SetLoop(bool horizontal, bool vertical);
+	bool IsRetained() const;
+	void SetRetained(bool retained);
 
 private:
 	TilemapLayer layer_down, layer_up;
@@ -16,8 +16,8 @@
  */
 
 // Headers
+#include <algorithm>
 #include <cstring>
-#include <cmath>
 #include "tilemap_layer.h"
 #include "output.h"
 #include "player.h"
@@ -28,7 +28,6 @@
 #include "game_map.h"
 #include "game_system.h"
 #include "drawable_mgr.h"
-#include "baseui.h"
 
 // Blocks subtiles IDs
 // Mess with this code and you will die in 3 days...
@@ -152,17 +151,6 @@ TilemapLayer::TilemapLayer(int ilayer) :
 {
 }
 
-// This setup of having an always inlined DrawTile() which dispatches to DrawTileImpl()
-// was created intentionally. Inlining the transparency check was measured and shown
-// to provide a performance improvement
-EP_ALWAYS_INLINE
-void TilemapLayer::DrawTile(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tileset, int x, int y, int row, int col, uint32_t tone_hash, bool allow_fast_blit) {
-	auto op = tileset.GetTileOpacity(col, row);
-	if (op != ImageOpacity::Transparent) {
-		DrawTileImpl(dst, tileset, tone_tileset, x, y, row, col, tone_hash, op, allow_fast_blit);
-	}
-}
-
 void TilemapLayer::DrawTileImpl(Bitmap& dst, Bitmap& tileset, Bitmap& tone_tileset, int x, int y, int row, int col, uint32_t tone_hash, ImageOpacity op, bool allow_fast_blit) {
 
 	auto rect = Rect{ col * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE };
@@ -205,36 +193,35 @@ static uint32_t MakeAbTileHash(int id, int anim_step) {
 	return static_cast<uint32_t>((id + (anim_step << 12)) | (4 << 24));
 }
 
-void TilemapLayer::Draw(Bitmap& dst, int z_order) {
+static int DivRoundingDown(int n, int m) {
+	if (n >= 0) return n / m;
+	return (n - m + 1) / m;
+}
+
+static int Mod(int n, int m) {
+	int rem = n % m;
+	return rem >= 0 ? rem : m + rem;
+}
+
+TilemapLayer::View TilemapLayer::GetView(const Bitmap& dst) const {
+	View view;
+
 	// Get the number of tiles that can be displayed on window
-	int tiles_x = (int)ceil(DisplayUi->GetWidth() / (float)TILE_SIZE);
-	int tiles_y = (int)ceil(DisplayUi->GetHeight() / (float)TILE_SIZE);
+	view.tiles_x = (dst.width() + TILE_SIZE - 1) / TILE_SIZE;
+	view.tiles_y = (dst.height() + TILE_SIZE - 1) / TILE_SIZE;
 
 	// If ox or oy are not equal to the tile size draw the next tile too
 	// to prevent black (empty) tiles at the borders
 	if (ox % TILE_SIZE != 0) {
-		++tiles_x;
+		++view.tiles_x;
 	}
 	if (oy % TILE_SIZE != 0) {
-		++tiles_y;
+		++view.tiles_y;
 	}
 
-	const bool loop_h = Game_Map::LoopHorizontal();
-	const bool loop_v = Game_Map::LoopVertical();
-
-	auto div_rounding_down = [](int n, int m) {
-		if (n >= 0) return n / m;
-		return (n - m + 1) / m;
-	};
-	auto mod = [](int n, int m) {
-		int rem = n % m;
-		return rem >= 0 ? rem : m + rem;
-	};
-
 	// FIXME: When Game_Map singleton is made an object we can remove this null check
 	const auto frames = Main_Data::game_system ? Main_Data::game_system->GetFrameCounter() : 0;
-	auto animation_step_c = (frames / 6) % 4;
-	auto animation_step_ab = frames / animation_speed;
+	int animation_step_ab = frames / animation_speed;
 	if (animation_type) {
 		animation_step_ab %= 3;
 	} else {
@@ -243,120 +230,306 @@ void TilemapLayer::Draw(Bitmap& dst, int z_order) {
 			animation_step_ab = 1;
 		}
 	}
+	view.anim_step[Anim_None] = 0;
+	view.anim_step[Anim_AB] = animation_step_ab;
+	view.anim_step[Anim_C] = (frames / 6) % 4;
+
+	view.sheets[Sheet_None] = nullptr;
+	view.sheets[Sheet_Chipset] = chipset.get();
+	view.sheets[Sheet_AutotilesAB] = autotiles_ab_screen.get();
+	view.sheets[Sheet_AutotilesD] = autotiles_d_screen.get();
+	view.sheet_effects[Sheet_None] = nullptr;
+	view.sheet_effects[Sheet_Chipset] = chipset_effect.get();
+	view.sheet_effects[Sheet_AutotilesAB] = autotiles_ab_screen_effect.get();
+	view.sheet_effects[Sheet_AutotilesD] = autotiles_d_screen_effect.get();
+
+	view.div_ox = DivRoundingDown(ox, TILE_SIZE);
+	view.div_oy = DivRoundingDown(oy, TILE_SIZE);
+
+	view.mod_ox = Mod(ox, TILE_SIZE);
+	view.mod_oy = Mod(oy, TILE_SIZE);
+
+	return view;
+}
+
+int TilemapLayer::GetViewCell(int x, int y) const {
+	// Get the real maps tile coordinates
+	if (loop_horizontal) x = Mod(x, width);
+	if (loop_vertical) y = Mod(y, height);
 
-	const int div_ox = div_rounding_down(ox, TILE_SIZE);
-	const int div_oy = div_rounding_down(oy, TILE_SIZE);
+	bool out_of_bounds =
+		x < 0 || x >= width ||
+		y < 0 || y >= height;
+
+	if (out_of_bounds) {
+		return -1;
+	}
 
-	const int mod_ox = mod(ox, TILE_SIZE);
-	const int mod_oy = mod(oy, TILE_SIZE);
+	return x + y * width;
+}
+
+// Resolved in ResolveCell, so drawing a cell is a lookup of its source for
+// the current animation step and a blit.
+EP_ALWAYS_INLINE
+void TilemapLayer::DrawCell(Bitmap& dst, int cell, int x, int y, const View& view) {
+	const int step = view.anim_step[cells.anim[cell]];
+	const TileSource& src = cells.source[cell * ANIM_VARIANTS + step];
+	if (src.op == ImageOpacity::Transparent) {
+		return;
+	}
 
-	for (int y = 0; y < tiles_y; y++) {
-		for (int x = 0; x < tiles_x; x++) {
+	const int sheet = cells.sheet[cell];
+	const bool allow_fast_blit = layer != 0 || cells.z[cell] == Priority_TilesetBelow;
+	const uint32_t tone_hash = cells.tone_hash[cell] + (step << 12);
+	DrawTileImpl(dst, *view.sheets[sheet], *view.sheet_effects[sheet], x, y, src.row, src.col, tone_hash, src.op, allow_fast_blit);
+}
 
-			// Get the real maps tile coordinates
-			int map_x = div_ox + x;
-			int map_y = div_oy + y;
-			if (loop_h) map_x = mod(map_x, width);
-			if (loop_v) map_y = mod(map_y, height);
+void TilemapLayer::Draw(Bitmap& dst, int z_order) {
+	const auto view = GetView(dst);
 
-			int map_draw_x = x * TILE_SIZE - mod_ox;
-			int map_draw_y = y * TILE_SIZE - mod_oy;
+	if (retained) {
+		UpdateRetained(dst, z_order, view);
+		BlitRetained(dst, z_order);
+		return;
+	}
 
-			bool out_of_bounds =
-				map_x < 0 || map_x >= width ||
-				map_y < 0 || map_y >= height;
+	for (int y = 0; y < view.tiles_y; y++) {
+		for (int x = 0; x < view.tiles_x; x++) {
+			const int cell = GetViewCell(view.div_ox + x, view.div_oy + y);
 
-			if (out_of_bounds) {
+			// Draw the sublayer if its z is being draw now
+			if (cell >= 0 && z_order == cells.z[cell]) {
+				DrawCell(dst, cell, x * TILE_SIZE - view.mod_ox, y * TILE_SIZE - view.mod_oy, view);
+			}
+		}
+	}
+}
+
+bool TilemapLayer::PrepareBands(const Bitmap& dst, int z_order) {
+	// Without the retained surfaces every tile is drawn from the shared
+	// sheets and their effect caches, that stays serial
+	if (!retained) {
+		return false;
+	}
+	UpdateRetained(dst, z_order, GetView(dst));
+	GetRetainedSurface(z_order).bitmap->Validate();
+	return true;
+}
+
+void TilemapLayer::DrawBand(Bitmap& dst, int z_order) const {
+	BlitRetained(dst, z_order);
+}
+
+void TilemapLayer::UpdateRetained(const Bitmap& dst, int z_order, const View& view) {
+	auto& surface = GetRetainedSurface(z_order);
+
+	// One tile of margin, so every partially visible tile has a cell
+	const int cols = (dst.width() + TILE_SIZE - 1) / TILE_SIZE + 1;
+	const int rows = (dst.height() + TILE_SIZE - 1) / TILE_SIZE + 1;
+	if (!surface.bitmap || surface.cols != cols || surface.rows != rows) {
+		surface.bitmap = Bitmap::Create(cols * TILE_SIZE, rows * TILE_SIZE, true);
+		surface.cols = cols;
+		surface.rows = rows;
+		surface.cells.assign(cols * rows, RetainedCell());
+	}
+	auto& bitmap = *surface.bitmap;
+
+	// The surface is a ring buffer: the tile at view position (x, y) always
+	// goes to cell (x mod cols, y mod rows). When scrolling, the cells that
+	// left the view are reused for the ones that entered it, so only the
+	// newly exposed strip and tiles with a new animation step are drawn.
+	for (int y = view.div_oy; y < view.div_oy + view.tiles_y; y++) {
+		const int cell_y = Mod(y, rows);
+		for (int x = view.div_ox; x < view.div_ox + view.tiles_x; x++) {
+			const int cell_x = Mod(x, cols);
+			auto& cell = surface.cells[cell_x + cell_y * cols];
+
+			int tile = GetViewCell(x, y);
+			if (tile >= 0 && cells.z[tile] != z_order) {
+				tile = -1;
+			}
+			const int anim = tile >= 0 ? view.anim_step[cells.anim[tile]] : -1;
+
+			if (cell.x == x && cell.y == y && cell.anim == anim) {
 				continue;
 			}
+			cell.x = x;
+			cell.y = y;
+			cell.anim = anim;
+
+			const int draw_x = cell_x * TILE_SIZE;
+			const int draw_y = cell_y * TILE_SIZE;
+			bitmap.ClearRect(Rect(draw_x, draw_y, TILE_SIZE, TILE_SIZE));
+			if (tile >= 0) {
+				DrawCell(bitmap, tile, draw_x, draw_y, view);
+			}
+		}
+	}
 
-			// Get the tile data
-			TileData &tile = GetDataCache(map_x, map_y);
+	surface.src_x = Mod(view.div_ox, cols) * TILE_SIZE + view.mod_ox;
+	surface.src_y = Mod(view.div_oy, rows) * TILE_SIZE + view.mod_oy;
+}
 
-			// Draw the sublayer if its z is being draw now
-			if (z_order == tile.z) {
-				if (layer == 0) {
-					// If lower layer
-					bool allow_fast_blit = (tile.z == Priority_TilesetBelow);
-
-					if (tile.ID >= BLOCK_E && tile.ID < BLOCK_E + BLOCK_E_TILES) {
-						int id = substitutions[tile.ID - BLOCK_E];
-						// If Block E
-
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 96) {
-							// If from first column of the block
-							col = 12 + id % 6;
-							row = id / 6;
-						} else {
-							// If from second column of the block
-							col = 18 + (id - 96) % 6;
-							row = (id - 96) / 6;
-						}
-
-						auto tone_hash = MakeETileHash(id);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else if (tile.ID >= BLOCK_C && tile.ID < BLOCK_D) {
-						// If Block C
-
-						// Get the tile coordinates from chipset
-						int col = 3 + (tile.ID - BLOCK_C) / 50;
-						int row = 4 + animation_step_c;
-
-						auto tone_hash = MakeCTileHash(tile.ID, animation_step_c);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else if (tile.ID < BLOCK_C) {
-						// If Blocks A1, A2, B
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileAB(tile.ID, animation_step_ab);
-
-						int col = pos.x;
-						int row = pos.y;
-
-						// Create tone changed tile
-						auto tone_hash = MakeAbTileHash(tile.ID,  animation_step_ab);
-						DrawTile(dst, *autotiles_ab_screen, *autotiles_ab_screen_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					} else {
-						// If blocks D1-D12
-
-						// Draw the tile from autotile cache
-						TileXY pos = GetCachedAutotileD(tile.ID);
-
-						int col = pos.x;
-						int row = pos.y;
-
-						auto tone_hash = MakeDTileHash(tile.ID);
-						DrawTile(dst, *autotiles_d_screen, *autotiles_d_screen_effect, map_draw_x, map_draw_y, row, col, tone_hash, allow_fast_blit);
-					}
-				} else {
-					// If upper layer
-
-					// Check that block F is being drawn
-					if (tile.ID >= BLOCK_F && tile.ID < BLOCK_F + BLOCK_F_TILES) {
-						int id = substitutions[tile.ID - BLOCK_F];
-						int row, col;
-
-						// Get the tile coordinates from chipset
-						if (id < 48) {
-							// If from first column of the block
-							col = 18 + id % 6;
-							row = 8 + id / 6;
-						} else {
-							// If from second column of the block
-							col = 24 + (id - 48) % 6;
-							row = (id - 48) / 6;
-						}
-
-						auto tone_hash = MakeFTileHash(id);
-						DrawTile(dst, *chipset, *chipset_effect, map_draw_x, map_draw_y, row, col, tone_hash);
-					}
-				}
+void TilemapLayer::BlitRetained(Bitmap& dst, int z_order) const {
+	const auto& surface = GetRetainedSurface(z_order);
+	const auto& bitmap = *surface.bitmap;
+
+	// Copy the view out of the ring, it wraps around at most once per axis
+	const int src_x = surface.src_x;
+	const int src_y = surface.src_y;
+	const int left_w = std::min(dst.width(), bitmap.width() - src_x);
+	const int top_h = std::min(dst.height(), bitmap.height() - src_y);
+	// Like the tiles, the lower sublayer is copied opaque when nothing is below it
+	const bool fast = fast_blit && layer == 0 && z_order == lower_layer.GetZ();
+
+	auto blit = [&](int dst_x, int dst_y, int x, int y, int w, int h) {
+		if (w <= 0 || h <= 0) {
+			return;
+		}
+		if (fast) {
+			dst.BlitFast(dst_x, dst_y, bitmap, Rect(x, y, w, h), Opacity::Opaque());
+		} else {
+			dst.Blit(dst_x, dst_y, bitmap, Rect(x, y, w, h), Opacity::Opaque());
+		}
+	};
+	blit(0, 0, src_x, src_y, left_w, top_h);
+	blit(left_w, 0, 0, src_y, dst.width() - left_w, top_h);
+	blit(0, top_h, src_x, 0, left_w, dst.height() - top_h);
+	blit(left_w, top_h, 0, 0, dst.width() - left_w, dst.height() - top_h);
+}
+
+void TilemapLayer::Invalidate() {
+	for (auto& surface : retained_surfaces) {
+		std::fill(surface.cells.begin(), surface.cells.end(), RetainedCell());
+	}
+}
+
+void TilemapLayer::SetRetained(bool nretained) {
+	retained = nretained;
+	if (!retained) {
+		for (auto& surface : retained_surfaces) {
+			surface = {};
+		}
+	}
+}
+
+void TilemapLayer::SetLoop(bool horizontal, bool vertical) {
+	if (loop_horizontal != horizontal || loop_vertical != vertical) {
+		loop_horizontal = horizontal;
+		loop_vertical = vertical;
+		Invalidate();
+	}
+}
+
+void TilemapLayer::ResolveCell(int cell) {
+	const short id = cells.id[cell];
+	TileSource* src = &cells.source[cell * ANIM_VARIANTS];
+
+	TileSheet sheet = Sheet_None;
+	AnimKind anim = Anim_None;
+	uint32_t tone_hash = 0;
+
+	auto set = [&](int step, int col, int row) {
+		src[step].col = col;
+		src[step].row = row;
+	};
+
+	if (layer == 0) {
+		// If lower layer
+		if (id >= BLOCK_E && id < BLOCK_E + BLOCK_E_TILES) {
+			int sub_id = substitutions[id - BLOCK_E];
+			// If Block E
+
+			// Get the tile coordinates from chipset
+			if (sub_id < 96) {
+				// If from first column of the block
+				set(0, 12 + sub_id % 6, sub_id / 6);
+			} else {
+				// If from second column of the block
+				set(0, 18 + (sub_id - 96) % 6, (sub_id - 96) / 6);
+			}
+
+			sheet = Sheet_Chipset;
+			tone_hash = MakeETileHash(sub_id);
+		} else if (id >= BLOCK_C && id < BLOCK_D) {
+			// If Block C
+
+			// Get the tile coordinates from chipset
+			for (int step = 0; step < 4; ++step) {
+				set(step, 3 + (id - BLOCK_C) / 50, 4 + step);
 			}
+
+			sheet = Sheet_Chipset;
+			anim = Anim_C;
+			tone_hash = MakeCTileHash(id, 0);
+		} else if (id < BLOCK_C) {
+			// If Blocks A1, A2, B
+
+			// Draw the tile from autotile cache
+			for (int step = 0; step < 3; ++step) {
+				TileXY pos = GetCachedAutotileAB(id, step);
+				set(step, pos.x, pos.y);
+			}
+
+			sheet = Sheet_AutotilesAB;
+			anim = Anim_AB;
+			tone_hash = MakeAbTileHash(id, 0);
+		} else {
+			// If blocks D1-D12
+
+			// Draw the tile from autotile cache
+			TileXY pos = GetCachedAutotileD(id);
+			set(0, pos.x, pos.y);
+
+			sheet = Sheet_AutotilesD;
+			tone_hash = MakeDTileHash(id);
+		}
+	} else {
+		// If upper layer
+
+		// Check that block F is being drawn
+		if (id >= BLOCK_F && id < BLOCK_F + BLOCK_F_TILES) {
+			int sub_id = substitutions[id - BLOCK_F];
+
+			// Get the tile coordinates from chipset
+			if (sub_id < 48) {
+				// If from first column of the block
+				set(0, 18 + sub_id % 6, 8 + sub_id / 6);
+			} else {
+				// If from second column of the block
+				set(0, 24 + (sub_id - 48) % 6, (sub_id - 48) / 6);
+			}
+
+			sheet = Sheet_Chipset;
+			tone_hash = MakeFTileHash(sub_id);
 		}
 	}
+
+	// The opacity class of the source tile, empty tiles are never drawn
+	Bitmap* bitmap =
+		sheet == Sheet_Chipset ? chipset.get() :
+		sheet == Sheet_AutotilesAB ? autotiles_ab_screen.get() :
+		sheet == Sheet_AutotilesD ? autotiles_d_screen.get() :
+		nullptr;
+	const int variants = anim == Anim_C ? 4 : anim == Anim_AB ? 3 : 1;
+	for (int step = 0; step < ANIM_VARIANTS; ++step) {
+		if (!bitmap || step >= variants) {
+			src[step] = TileSource();
+			continue;
+		}
+		src[step].op = bitmap->GetTileOpacity(src[step].col, src[step].row);
+	}
+
+	cells.sheet[cell] = sheet;
+	cells.anim[cell] = anim;
+	cells.tone_hash[cell] = tone_hash;
+}
+
+void TilemapLayer::ResolveCells() {
+	for (int i = 0; i < static_cast<int>(cells.id.size()); ++i) {
+		ResolveCell(i);
+	}
+	applied_substitutions.assign(substitutions.begin(), substitutions.end());
 }
 
 TilemapLayer::TileXY TilemapLayer::GetCachedAutotileAB(short ID, short animID) {
@@ -372,41 +545,50 @@ TilemapLayer::TileXY TilemapLayer::GetCachedAutotileD(short ID) {
 	return autotiles_d[block][subtile];
 }
 
-void TilemapLayer::CreateTileCache(const std::vector<short>& nmap_data) {
-	data_cache_vec.resize(width * height);
-	for (int x = 0; x < width; x++) {
-		for (int y = 0; y < height; y++) {
-			TileData tile;
-
-			// Get the tile ID
-			tile.ID = nmap_data[x + y * width];
-
-			tile.z = Priority_TilesetBelow;
-
-			// Calculate the tile Z
-			if (!passable.empty()) {
-				if (tile.ID >= BLOCK_F) { // Upper layer
-					if ((passable[substitutions[tile.ID - BLOCK_F]] & Passable::Above) != 0)
-						tile.z = Priority_TilesetAbove + 1; // Upper sublayer
-					else
-						tile.z = Priority_TilesetBelow + 1; // Lower sublayer
-
-				} else { // Lower layer
-					int chip_index =
-						tile.ID >= BLOCK_E ? substitutions[tile.ID - BLOCK_E] + 18 :
-						tile.ID >= BLOCK_D ? (tile.ID - BLOCK_D) / 50 + 6 :
-						tile.ID >= BLOCK_C ? (tile.ID - BLOCK_C) / 50 + 3 :
-						tile.ID / 1000;
-					if ((passable[chip_index] & (Passable::Wall | Passable::Above)) != 0)
-						tile.z = Priority_TilesetAbove; // Upper sublayer
-					else
-						tile.z = Priority_TilesetBelow; // Lower sublayer
-
-				}
-			}
-			GetDataCache(x, y) = tile;
+void TilemapLayer::UpdateCellZ(int cell) {
+	const short id = cells.id[cell];
+	int z = Priority_TilesetBelow;
+
+	// Calculate the tile Z
+	if (!passable.empty()) {
+		if (id >= BLOCK_F) { // Upper layer
+			if ((passable[substitutions[id - BLOCK_F]] & Passable::Above) != 0)
+				z = Priority_TilesetAbove + 1; // Upper sublayer
+			else
+				z = Priority_TilesetBelow + 1; // Lower sublayer
+
+		} else { // Lower layer
+			int chip_index =
+				id >= BLOCK_E ? substitutions[id - BLOCK_E] + 18 :
+				id >= BLOCK_D ? (id - BLOCK_D) / 50 + 6 :
+				id >= BLOCK_C ? (id - BLOCK_C) / 50 + 3 :
+				id / 1000;
+			if ((passable[chip_index] & (Passable::Wall | Passable::Above)) != 0)
+				z = Priority_TilesetAbove; // Upper sublayer
+			else
+				z = Priority_TilesetBelow; // Lower sublayer
+
 		}
 	}
+	cells.z[cell] = z;
+}
+
+void TilemapLayer::CreateTileCache(const std::vector<short>& nmap_data) {
+	const int count = width * height;
+	if (static_cast<int>(cells.id.size()) != count) {
+		cells.id.resize(count);
+		cells.z.resize(count);
+		cells.sheet.assign(count, Sheet_None);
+		cells.anim.assign(count, Anim_None);
+		cells.tone_hash.assign(count, 0);
+		cells.source.assign(count * ANIM_VARIANTS, TileSource());
+	}
+
+	for (int i = 0; i < count; i++) {
+		// Get the tile ID
+		cells.id[i] = nmap_data[i];
+		UpdateCellZ(i);
+	}
 }
 
 void TilemapLayer::GenerateAutotileAB(short ID, short animID) {
@@ -608,6 +790,7 @@ void TilemapLayer::SetChipset(BitmapRef const& nchipset) {
 	chipset = nchipset;
 	chipset_effect = Bitmap::Create(chipset->width(), chipset->height());
 	chipset_tone_tiles.clear();
+	Invalidate();
 
 	if (autotiles_ab_next != 0 && autotiles_d_screen != nullptr && layer == 0) {
 		autotiles_ab_screen = GenerateAutotiles(autotiles_ab_next, autotiles_ab_map);
@@ -616,6 +799,9 @@ void TilemapLayer::SetChipset(BitmapRef const& nchipset) {
 		autotiles_ab_screen_effect = Bitmap::Create(autotiles_ab_screen->width(), autotiles_ab_screen->height());
 		autotiles_d_screen_effect = Bitmap::Create(autotiles_d_screen->width(), autotiles_d_screen->height());
 	}
+
+	// Tile opacity depends on the new images
+	ResolveCells();
 }
 
 void TilemapLayer::SetMapData(std::vector<short> nmap_data) {
@@ -629,20 +815,17 @@ void TilemapLayer::SetMapData(std::vector<short> nmap_data) {
 		autotiles_d_map.clear();
 		autotiles_ab_next = 0;
 		autotiles_d_next = 0;
-		for (int y = 0; y < height; y++) {
-			for (int x = 0; x < width; x++) {
-
-				if (GetDataCache(x, y).ID < BLOCK_C) {
-					// If blocks A and B
+		for (short id : cells.id) {
+			if (id < BLOCK_C) {
+				// If blocks A and B
 
-					GenerateAutotileAB(GetDataCache(x, y).ID, 0);
-					GenerateAutotileAB(GetDataCache(x, y).ID, 1);
-					GenerateAutotileAB(GetDataCache(x, y).ID, 2);
-				} else if (GetDataCache(x, y).ID >= BLOCK_D && GetDataCache(x, y).ID < BLOCK_E) {
-					// If block D
+				GenerateAutotileAB(id, 0);
+				GenerateAutotileAB(id, 1);
+				GenerateAutotileAB(id, 2);
+			} else if (id >= BLOCK_D && id < BLOCK_E) {
+				// If block D
 
-					GenerateAutotileD(GetDataCache(x, y).ID);
-				}
+				GenerateAutotileD(id);
 			}
 		}
 		autotiles_ab_screen = GenerateAutotiles(autotiles_ab_next, autotiles_ab_map);
@@ -654,7 +837,10 @@ void TilemapLayer::SetMapData(std::vector<short> nmap_data) {
 		chipset_tone_tiles.clear();
 	}
 
+	ResolveCells();
+
 	map_data = std::move(nmap_data);
+	Invalidate();
 }
 
 void TilemapLayer::SetPassable(std::vector<unsigned char> npassable) {
@@ -662,11 +848,34 @@ void TilemapLayer::SetPassable(std::vector<unsigned char> npassable) {
 
 	// Recalculate z values of all tiles
 	CreateTileCache(map_data);
+	Invalidate();
 }
 
 void TilemapLayer::OnSubstitute() {
-	// Recalculate z values of all tiles
-	CreateTileCache(map_data);
+	// Only cells of Block E (lower layer) or F (upper layer) use substitutions
+	const int block = layer == 0 ? BLOCK_E : BLOCK_F;
+	const int block_tiles = std::min<int>(layer == 0 ? BLOCK_E_TILES : BLOCK_F_TILES, substitutions.size());
+
+	std::vector<bool> changed(block_tiles);
+	bool any_changed = false;
+	for (int i = 0; i < block_tiles; ++i) {
+		changed[i] = i >= static_cast<int>(applied_substitutions.size()) || applied_substitutions[i] != substitutions[i];
+		any_changed |= changed[i];
+	}
+	if (!any_changed) {
+		return;
+	}
+	applied_substitutions.assign(substitutions.begin(), substitutions.end());
+
+	// Recalculate z values and sources of the affected tiles
+	for (int i = 0; i < static_cast<int>(cells.id.size()); ++i) {
+		const int sub = cells.id[i] - block;
+		if (sub >= 0 && sub < block_tiles && changed[sub]) {
+			UpdateCellZ(i);
+			ResolveCell(i);
+		}
+	}
+	Invalidate();
 }
 
 TilemapSubLayer::TilemapSubLayer(TilemapLayer* tilemap, int z) :
@@ -684,6 +893,17 @@ void TilemapSubLayer::Draw(Bitmap& dst) {
 	tilemap->Draw(dst, GetZ());
 }
 
+bool TilemapSubLayer::PrepareBands(const Bitmap& dst) {
+	draw_band = tilemap->GetChipset() != nullptr;
+	return !draw_band || tilemap->PrepareBands(dst, GetZ());
+}
+
+void TilemapSubLayer::DrawBand(Bitmap& dst) const {
+	if (draw_band) {
+		tilemap->DrawBand(dst, GetZ());
+	}
+}
+
 void TilemapLayer::SetTone(Tone tone) {
 	if (tone == this->tone) {
 		return;
@@ -701,4 +921,5 @@ void TilemapLayer::SetTone(Tone tone) {
 		chipset_effect->Clear();
 	}
 	chipset_tone_tiles.clear();
+	Invalidate();
 }
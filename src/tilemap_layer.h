@@ -19,6 +19,7 @@
 #define EP_TILEMAP_LAYER_H
 
 // Headers
+#include <limits>
 #include <vector>
 #include <map>
 #include <unordered_set>
@@ -39,9 +40,12 @@ public:
 	TilemapSubLayer(TilemapLayer* tilemap, int z);
 
 	void Draw(Bitmap& dst) override;
+	bool PrepareBands(const Bitmap& dst) override;
+	void DrawBand(Bitmap& dst) const override;
 
 private:
 	TilemapLayer* tilemap = nullptr;
+	bool draw_band = false;
 };
 
 /**
@@ -53,6 +57,15 @@ public:
 
 	void Draw(Bitmap& dst, int z_order);
 
+	/**
+	 * Band rendering of a sublayer, only possible in retained mode.
+	 * PrepareBands updates the retained surface, DrawBand copies it out.
+	 *
+	 * @return whether the sublayer can be drawn in bands
+	 */
+	bool PrepareBands(const Bitmap& dst, int z_order);
+	void DrawBand(Bitmap& dst, int z_order) const;
+
 	BitmapRef const& GetChipset() const;
 	void SetChipset(BitmapRef const& nchipset);
 	const std::vector<short>& GetMapData() const;
@@ -85,6 +98,27 @@ public:
 
 	void SetTone(Tone tone);
 
+	/**
+	 * Enables retained rendering. Every sublayer is kept in a screen sized
+	 * surface and only tiles that scrolled into view or changed their
+	 * animation step are drawn again. Enabled by default.
+	 *
+	 * @param retained true: draw through the retained surfaces
+	 */
+	void SetRetained(bool retained);
+	bool IsRetained() const;
+
+	/**
+	 * Sets whether the map wraps around at its borders.
+	 *
+	 * @param horizontal loops horizontally
+	 * @param vertical loops vertically
+	 */
+	void SetLoop(bool horizontal, bool vertical);
+
+	/** Forces all tiles to be drawn again on the next frame. */
+	void Invalidate();
+
 private:
 	BitmapRef chipset;
 	BitmapRef chipset_effect;
@@ -100,11 +134,13 @@ private:
 	int animation_type = 0;
 	int layer = 0;
 	bool fast_blit = false;
+	bool loop_horizontal = false;
+	bool loop_vertical = false;
+	bool retained = true;
 
 	void CreateTileCache(const std::vector<short>& nmap_data);
 	void GenerateAutotileAB(short ID, short animID);
 	void GenerateAutotileD(short ID);
-	void DrawTile(Bitmap& dst, Bitmap& tile, Bitmap& tone_tile, int x, int y, int row, int col, uint32_t tone_hash, bool allow_fast_blit = true);
 	void DrawTileImpl(Bitmap& dst, Bitmap& tile, Bitmap& tone_tile, int x, int y, int row, int col, uint32_t tone_hash, ImageOpacity op, bool allow_fast_blit);
 
 	static const int TILES_PER_ROW = 64;
@@ -135,14 +171,97 @@ private:
 	std::unordered_map<uint32_t, TileXY> autotiles_ab_map;
 	std::unordered_map<uint32_t, TileXY> autotiles_d_map;
 
-	struct TileData {
-		short ID;
-		int z;
+	/** Image a cell is drawn from */
+	enum TileSheet : uint8_t {
+		Sheet_None,
+		Sheet_Chipset,
+		Sheet_AutotilesAB,
+		Sheet_AutotilesD,
+		Sheet_Count
 	};
 
-	TileData& GetDataCache(int x, int y);
+	/** Animation step that selects the source of a cell */
+	enum AnimKind : uint8_t {
+		Anim_None,
+		Anim_AB,
+		Anim_C,
+		Anim_Count
+	};
 
-	std::vector<TileData> data_cache_vec;
+	/** Source variants per cell, one per animation step */
+	static constexpr int ANIM_VARIANTS = 4;
+
+	struct TileSource {
+		uint8_t col = 0;
+		uint8_t row = 0;
+		ImageOpacity op = ImageOpacity::Transparent;
+	};
+
+	/**
+	 * Per cell data resolved from the map data, indexed by x + y * width.
+	 * Drawing a cell does not need to look at the tile id again.
+	 */
+	struct CellCache {
+		std::vector<short> id;
+		std::vector<int> z;
+		std::vector<uint8_t> sheet;
+		std::vector<uint8_t> anim;
+		/** tone hash of step 0, step n adds n << 12 */
+		std::vector<uint32_t> tone_hash;
+		/** ANIM_VARIANTS entries per cell */
+		std::vector<TileSource> source;
+	};
+
+	CellCache cells;
+	/** substitutions the cells were resolved with */
+	std::vector<uint8_t> applied_substitutions;
+
+	void UpdateCellZ(int cell);
+	void ResolveCell(int cell);
+	void ResolveCells();
+
+	/** Visible tile range and animation state of a frame */
+	struct View {
+		int tiles_x;
+		int tiles_y;
+		int div_ox;
+		int div_oy;
+		int mod_ox;
+		int mod_oy;
+		int anim_step[Anim_Count];
+		Bitmap* sheets[Sheet_Count];
+		Bitmap* sheet_effects[Sheet_Count];
+	};
+
+	View GetView(const Bitmap& dst) const;
+	/** @return cell at a view position or -1 if it is outside of the map */
+	int GetViewCell(int x, int y) const;
+	void DrawCell(Bitmap& dst, int cell, int x, int y, const View& view);
+	void UpdateRetained(const Bitmap& dst, int z_order, const View& view);
+	void BlitRetained(Bitmap& dst, int z_order) const;
+
+	struct RetainedCell {
+		/** view position of the tile in the cell */
+		int x = std::numeric_limits<int>::min();
+		int y = 0;
+		int anim = -1;
+	};
+
+	struct RetainedSurface {
+		BitmapRef bitmap;
+		std::vector<RetainedCell> cells;
+		int cols = 0;
+		int rows = 0;
+		/** top left of the view in the ring */
+		int src_x = 0;
+		int src_y = 0;
+	};
+
+	/** lower and upper sublayer */
+	RetainedSurface retained_surfaces[2];
+
+	RetainedSurface& GetRetainedSurface(int z_order);
+	const RetainedSurface& GetRetainedSurface(int z_order) const;
 
 	TilemapSubLayer lower_layer;
 	TilemapSubLayer upper_layer;
@@ -220,13 +339,20 @@ inline void TilemapLayer::SetAnimationType(int type) {
 	animation_type = type;
 }
 
-inline void TilemapLayer::SetFastBlit(bool fast) {
-	fast_blit = fast;
+inline TilemapLayer::RetainedSurface& TilemapLayer::GetRetainedSurface(int z_order) {
+	return retained_surfaces[z_order == lower_layer.GetZ() ? 0 : 1];
+}
+
+inline const TilemapLayer::RetainedSurface& TilemapLayer::GetRetainedSurface(int z_order) const {
+	return retained_surfaces[z_order == lower_layer.GetZ() ? 0 : 1];
 }
 
-inline TilemapLayer::TileData& TilemapLayer::GetDataCache(int x, int y) {
-	return data_cache_vec[x + y * width];
+inline bool TilemapLayer::IsRetained() const {
+	return retained;
 }
 
+inline void TilemapLayer::SetFastBlit(bool fast) {
+	fast_blit = fast;
+}
 
 #endif
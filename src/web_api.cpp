@@ -1,7 +1,9 @@
 #include "web_api.h"
-#include "emscripten/emscripten.h"
 #include "output.h"
 
+#ifdef EMSCRIPTEN
+#include "emscripten/emscripten.h"
+
 using namespace Web_API;
 
 std::string Web_API::GetSocketURL() {
@@ -92,3 +94,63 @@ void Web_API::ShowNotice(std::string_view msg, NoticeType t) {
 	}, msg.data(), msg.size());
 }
 
+#else
+
+#include <cstdlib>
+
+// Native builds have no web frontend, the callbacks only log so that
+// multiplayer sessions can be followed in the terminal.
+
+std::string Web_API::GetSocketURL() {
+	// the room id is appended to this URL
+	const char* url = std::getenv("YNO_SOCKET_URL");
+	return url ? url : "ws://127.0.0.1:8028/";
+}
+
+void Web_API::OnLoadMap(std::string_view name) {
+}
+
+void Web_API::SyncPlayerData(std::string_view uuid, int rank, int id) {
+	Output::Debug("Multiplayer: Player {} uuid={} rank={}", id, uuid, rank);
+}
+
+void Web_API::SyncGlobalPlayerData(std::string_view uuid, std::string_view name, std::string_view sys, int rank) {
+}
+
+void Web_API::OnChatMessageReceived(std::string_view msg, int id) {
+	Output::Debug("Multiplayer: Chat {}: {}", id, msg);
+}
+
+void Web_API::OnGChatMessageReceived(std::string_view uuid, std::string_view map_id, std::string_view prev_map_id, std::string_view prev_locations, std::string_view msg) {
+	Output::Debug("Multiplayer: Global chat {}: {}", uuid, msg);
+}
+
+void Web_API::OnPlayerDisconnect(int id) {
+	Output::Debug("Multiplayer: Player {} disconnected", id);
+}
+
+void Web_API::OnPlayerNameUpdated(std::string_view name, int id) {
+	Output::Debug("Multiplayer: Player {} is now called {}", id, name);
+}
+
+void Web_API::OnPlayerSystemUpdated(std::string_view system, int id) {
+}
+
+void Web_API::UpdateConnectionStatus(int status) {
+	Output::Debug("Multiplayer: Connection status {}", status);
+}
+
+void Web_API::ReceiveInputFeedback(int s) {
+}
+
+void Web_API::OnPlayerSpriteUpdated(std::string_view name, int index, int id) {
+}
+
+void Web_API::OnUpdateSystemGraphic(std::string_view sys) {
+}
+
+void Web_API::ShowNotice(std::string_view msg, NoticeType t) {
+	Output::Warning("{}", msg);
+}
+
+#endif
@@ -1,11 +1,20 @@
 #include "yno_connection.h"
-#include <emscripten/websocket.h>
-#include "TinySHA1.hpp"
+#ifdef EMSCRIPTEN
+#  include <emscripten/websocket.h>
+#else
+#  include "multiplayer_websocket.h"
+#endif
+#include "yno_message_signer.h"
 
 struct YNOConnection::IMPL {
-	EMSCRIPTEN_WEBSOCKET_T socket;
 	size_t msg_count;
 	bool closed;
+	YNO::MessageSigner signer;
+	/** header and payload of the message being sent, reused */
+	std::string send_buffer;
+
+#ifdef EMSCRIPTEN
+	EMSCRIPTEN_WEBSOCKET_T socket;
 
 	static EM_BOOL onopen(int eventType, const EmscriptenWebSocketOpenEvent *event, void *userData) {
 		auto _this = static_cast<YNOConnection*>(userData);
@@ -26,44 +35,60 @@ struct YNOConnection::IMPL {
 			// so the actual length is numBytes - 1
 			std::string_view mstr(reinterpret_cast<const char*>(event->data),
 					event->numBytes - 1);
-			auto p = mstr.find(Multiplayer::Packet::PARAM_DELIM);
-			if (p == mstr.npos) {
-				/*
-				Usually npos is the maximum value of size_t.
-				Adding to it is undefined behavior.
-				If it returns end iterator instead of npos, the if statement is
-				duplicated code because the statement in else clause will handle it.
-				*/
-				_this->Dispatch(mstr);
-			} else {
-				auto namestr = mstr.substr(0, p);
-				auto argstr = mstr.substr(p + Multiplayer::Packet::PARAM_DELIM.size());
-				_this->Dispatch(namestr, Split(argstr));
-			}
+			_this->DispatchMessage(mstr);
+		} else {
+			std::string_view mstr(reinterpret_cast<const char*>(event->data),
+					event->numBytes);
+			_this->DispatchBinary(mstr);
 		}
 		return EM_TRUE;
 	}
+
+	void Bind(YNOConnection* _this) {
+		emscripten_websocket_set_onopen_callback(socket, _this, onopen);
+		emscripten_websocket_set_onclose_callback(socket, _this, onclose);
+		emscripten_websocket_set_onmessage_callback(socket, _this, onmessage);
+	}
+#else
+	Multiplayer::WebSocketClient socket;
+
+	void Bind(YNOConnection* _this) {
+		socket.SetOpenHandler([_this] () {
+			_this->SetConnected(true);
+			_this->DispatchSystem(SystemMessage::OPEN);
+		});
+		socket.SetCloseHandler([_this] () {
+			_this->SetConnected(false);
+			_this->DispatchSystem(SystemMessage::CLOSE);
+		});
+		socket.SetMessageHandler([_this] (std::string_view data, bool is_text) {
+			if (is_text)
+				_this->DispatchMessage(data);
+			else
+				_this->DispatchBinary(data);
+		});
+	}
+#endif
 };
 
 YNOConnection::YNOConnection() : impl(new IMPL) {
 	impl->msg_count = 0;
 	impl->closed = true;
+#ifndef EMSCRIPTEN
+	impl->Bind(this);
+#endif
 }
 
 YNOConnection::YNOConnection(YNOConnection&& o)
 	: Connection(std::move(o)), impl(std::move(o.impl)) {
-	emscripten_websocket_set_onopen_callback(impl->socket, this, IMPL::onopen);
-	emscripten_websocket_set_onclose_callback(impl->socket, this, IMPL::onclose);
-	emscripten_websocket_set_onmessage_callback(impl->socket, this, IMPL::onmessage);
+	impl->Bind(this);
 }
 YNOConnection& YNOConnection::operator=(YNOConnection&& o) {
 	Connection::operator=(std::move(o));
 	if (this != &o) {
 		Close();
 		impl = std::move(o.impl);
-		emscripten_websocket_set_onopen_callback(impl->socket, this, IMPL::onopen);
-		emscripten_websocket_set_onclose_callback(impl->socket, this, IMPL::onclose);
-		emscripten_websocket_set_onmessage_callback(impl->socket, this, IMPL::onmessage);
+		impl->Bind(this);
 	}
 	return *this;
 }
@@ -77,7 +102,10 @@ void YNOConnection::Open(std::string_view uri) {
 	if (!impl->closed) {
 		Close();
 	}
+	// binary is negotiated again on every connect
+	SetWireFormat(Multiplayer::WireFormat::Text);
 
+#ifdef EMSCRIPTEN
 	std::string s {uri};
 	EmscriptenWebSocketCreateAttributes ws_attrs = {
 		s.data(),
@@ -86,77 +114,102 @@ void YNOConnection::Open(std::string_view uri) {
 	};
 	impl->socket = emscripten_websocket_new(&ws_attrs);
 	impl->closed = false;
-	emscripten_websocket_set_onopen_callback(impl->socket, this, IMPL::onopen);
-	emscripten_websocket_set_onclose_callback(impl->socket, this, IMPL::onclose);
-	emscripten_websocket_set_onmessage_callback(impl->socket, this, IMPL::onmessage);
+	impl->Bind(this);
+#else
+	impl->closed = false;
+	impl->socket.Connect(uri);
+#endif
 }
 
 void YNOConnection::Close() {
 	if (impl->closed)
 		return;
 	impl->closed = true;
+	// deferred pictures belong to the room that is left
+	m_deferred.clear();
+#ifdef EMSCRIPTEN
 	// strange bug:
 	// calling with (impl->socket, 1005, "any reason") raises exceptions
 	// might be an emscripten bug
 	emscripten_websocket_close(impl->socket, 0, nullptr);
 	emscripten_websocket_delete(impl->socket);
+#else
+	impl->socket.Close();
+	SetConnected(false);
+#endif
 }
 
-static std::string_view get_secret() { return ""; }
-
-std::string calculate_header(std::string_view key, size_t count, std::string_view msg) {
-	char counter[7];
-	snprintf(counter, 7, "%06zu", count);
-
-	std::string hashmsg{key};
-	hashmsg += get_secret();
-	hashmsg += counter;
-	hashmsg += msg;
-
-	sha1::SHA1 digest;
-	uint32_t digest_result[5];
-	digest.processBytes(hashmsg.data(), hashmsg.size());
-	digest.getDigest(digest_result);
-
-	char signature[9];
-	snprintf(signature, 9, "%08x", digest_result[0]);
-
-	std::string r{signature};
-	r += counter;
-	return r;
+void YNOConnection::Poll() {
+#ifndef EMSCRIPTEN
+	impl->socket.Poll();
+#endif
 }
 
+static std::string_view get_secret() { return ""; }
+
 void YNOConnection::Send(std::string_view data) {
 	if (!IsConnected())
 		return;
+#ifdef EMSCRIPTEN
 	unsigned short ready;
 	emscripten_websocket_get_ready_state(impl->socket, &ready);
-	if (ready == 1) { // OPEN
-		++impl->msg_count;
-		auto sendmsg = calculate_header(GetKey(), impl->msg_count, data);
-		sendmsg += data;
-		emscripten_websocket_send_binary(impl->socket, sendmsg.data(), sendmsg.size());
-	}
+	if (ready != 1) // OPEN
+		return;
+#else
+	if (!impl->socket.IsOpen())
+		return;
+#endif
+
+	if (impl->signer.GetKey() != GetKey())
+		impl->signer.SetKey(GetKey(), get_secret());
+
+	++impl->msg_count;
+	auto& sendmsg = impl->send_buffer;
+	sendmsg.clear();
+	impl->signer.AppendHeader(sendmsg, impl->msg_count, data);
+	sendmsg += data;
+#ifdef EMSCRIPTEN
+	emscripten_websocket_send_binary(impl->socket, sendmsg.data(), sendmsg.size());
+#else
+	impl->socket.Send(sendmsg);
+#endif
+	NotifySent(sendmsg.size());
 }
 
 void YNOConnection::FlushQueue() {
+	NotifyFlush();
+	SendBulk(m_queue, m_queue.size());
+	SendBulk(m_deferred, TakeDeferred());
+}
+
+void YNOConnection::SendBulk(Multiplayer::PacketQueue& q, size_t count) {
 	auto namecmp = [] (std::string_view v, bool include) {
 		return (v != "name") == include;
 	};
 
+	const bool binary = GetWireFormat() == Multiplayer::WireFormat::Binary;
 	bool include = false;
-	while (!m_queue.empty()) {
+	while (count > 0) {
 		std::string bulk;
-		while (!m_queue.empty()) {
-			auto& e = m_queue.front();
-			if (namecmp(e->GetName(), include))
+		if (binary)
+			bulk += Multiplayer::Packet::BINARY_MARKER;
+		const size_t empty_size = bulk.size();
+		while (count > 0) {
+			auto& e = q.front();
+			if (namecmp(e.GetName(), include))
 				break;
-			if (!bulk.empty())
-				bulk += Multiplayer::Packet::MSG_DELIM;
-			bulk += e->ToBytes();
-			m_queue.pop();
+			if (binary) {
+				// binary packets are self delimiting
+				bulk += e.ToBinary();
+			} else {
+				if (!bulk.empty())
+					bulk += Multiplayer::Packet::MSG_DELIM;
+				bulk += e.ToBytes();
+			}
+			q.pop();
+			--count;
 		}
-		if (!bulk.empty())
+		if (bulk.size() != empty_size)
 			Send(bulk);
 		include = !include;
 	}
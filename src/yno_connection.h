@@ -14,7 +14,16 @@ public:
 	void Close() override;
 	void Send(std::string_view data) override;
 	void FlushQueue() override;
+
+	/**
+	 * Processes pending socket events. The emscripten backend is driven by
+	 * the browser event loop, so this only does work for the native backend.
+	 */
+	void Poll();
 protected:
+	/** Sends the first count packets of q, batched into as few messages as possible. */
+	void SendBulk(Multiplayer::PacketQueue& q, size_t count);
+
 	struct IMPL;
 	std::unique_ptr<IMPL> impl;
 };
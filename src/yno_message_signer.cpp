@@ -0,0 +1,44 @@
+#include "yno_message_signer.h"
+#include <algorithm>
+#include <charconv>
+
+using namespace YNO;
+
+namespace {
+	/** Same as snprintf(out, 7, "%06zu", count): zero padded, cut after 6 digits */
+	void FormatCounter(size_t count, char out[6]) {
+		char digits[24];
+		auto end = std::to_chars(digits, digits + sizeof(digits), count).ptr;
+		int len = static_cast<int>(end - digits);
+		int pad = len < 6 ? 6 - len : 0;
+		for (int i = 0; i < 6; ++i) {
+			out[i] = i < pad ? '0' : digits[i - pad];
+		}
+	}
+}
+
+void MessageSigner::SetKey(std::string_view key, std::string_view secret) {
+	this->key = std::string(key);
+	prefix.Reset();
+	prefix.Update(key);
+	prefix.Update(secret);
+}
+
+void MessageSigner::AppendHeader(std::string& out, size_t count, std::string_view msg) const {
+	char counter[6];
+	FormatCounter(count, counter);
+
+	Multiplayer::Sha1 sha = prefix;
+	sha.Update(counter, sizeof(counter));
+	sha.Update(msg);
+	Multiplayer::Sha1::Digest digest;
+	sha.Final(digest);
+
+	static constexpr char hex[] = "0123456789abcdef";
+	char header[HEADER_SIZE];
+	for (int i = 0; i < 8; ++i) {
+		header[i] = hex[(digest[0] >> (28 - 4 * i)) & 0xF];
+	}
+	std::copy(counter, counter + 6, header + 8);
+	out.append(header, sizeof(header));
+}
@@ -0,0 +1,36 @@
+#ifndef EP_YNO_MESSAGE_SIGNER_H
+#define EP_YNO_MESSAGE_SIGNER_H
+
+#include <string>
+#include <string_view>
+
+#include "multiplayer_sha1.h"
+
+namespace YNO {
+
+/**
+ * Builds the header of outgoing messages: the first word of
+ * SHA1(key + secret + counter + message) as 8 hex digits, followed by the
+ * message counter as 6 digits.
+ *
+ * The constant key + secret prefix is hashed once into a midstate, each
+ * message only hashes the counter and its payload.
+ */
+class MessageSigner {
+public:
+	static constexpr size_t HEADER_SIZE = 14;
+
+	void SetKey(std::string_view key, std::string_view secret);
+	const std::string& GetKey() const { return key; }
+
+	/** Appends the header of message number count to out. */
+	void AppendHeader(std::string& out, size_t count, std::string_view msg) const;
+
+private:
+	std::string key;
+	Multiplayer::Sha1 prefix;
+};
+
+}
+
+#endif
@@ -9,6 +9,10 @@
 
 namespace YNO_Messages {
 namespace S2C {
+	/*
+	 * Packets only hold views into the received message. They must not be
+	 * kept around after their handler returns, copy what needs to outlive it.
+	 */
 	using S2CPacket = Multiplayer::S2CPacket;
 	using PL = Multiplayer::Connection::ParameterList;
 	class SyncPlayerDataPacket : public S2CPacket {
@@ -17,12 +21,15 @@ namespace S2C {
 			: host_id(Decode<int>(v.at(0))),
 			key(v.at(1)),
 			uuid(v.at(2)),
-			rank(Decode<int>(v.at(3))) {}
+			rank(Decode<int>(v.at(3))),
+			wire(v.size() > 4 ? Decode<int>(v.at(4)) : 0) {}
 
 		const int host_id;
-		const std::string key;
-		const std::string uuid;
+		const std::string_view key;
+		const std::string_view uuid;
 		const int rank;
+		/** 1 if the server accepts the binary wire format, older servers omit it */
+		const int wire;
 	};
 
 	class GlobalChatPacket : public S2CPacket {
@@ -37,14 +44,14 @@ namespace S2C {
 			prev_locations(v.at(6)),
 			msg(v.at(7)) {}
 
-		const std::string uuid;
-		const std::string name;
-		const std::string sys;
+		const std::string_view uuid;
+		const std::string_view name;
+		const std::string_view sys;
 		const int rank;
-		const std::string map_id;
-		const std::string prev_map_id;
-		const std::string prev_locations;
-		const std::string msg;
+		const std::string_view map_id;
+		const std::string_view prev_map_id;
+		const std::string_view prev_locations;
+		const std::string_view msg;
 	};
 
 	class PlayerPacket : public S2CPacket {
@@ -60,7 +67,7 @@ namespace S2C {
 			: PlayerPacket(v.at(0)),
 			uuid(v.at(1)),
 			rank(Decode<int>(v.at(2))) {}
-		const std::string uuid;
+		const std::string_view uuid;
 		const int rank;
 	};
 
@@ -75,7 +82,7 @@ namespace S2C {
 		ChatPacket(const PL& v)
 			: PlayerPacket(v.at(0)),
 			msg(v.at(1)) {}
-		const std::string msg;
+		const std::string_view msg;
 	};
 
 	class MovePacket : public PlayerPacket {
@@ -109,7 +116,7 @@ namespace S2C {
 			: PlayerPacket(v.at(0)),
 			name(v.at(1)),
 			index(Decode<int>(v.at(2))) {}
-		const std::string name;
+		const std::string_view name;
 		const int index;
 	};
 
@@ -118,23 +125,19 @@ namespace S2C {
 		SystemPacket(const PL& v)
 			: PlayerPacket(v.at(0)),
 			name(v.at(1)) {}
-		const std::string name;
+		const std::string_view name;
 	};
 
 	class SEPacket : public PlayerPacket {
 	public:
-		static lcf::rpg::Sound BuildSound(const PL& v) {
-			lcf::rpg::Sound s;
-			s.name = v.at(1);
-			s.volume = Decode<int>(v.at(2));
-			s.tempo = Decode<int>(v.at(3));
-			s.balance = Decode<int>(v.at(4));
-			return s;
-		}
 		SEPacket(const PL& v)
 			: PlayerPacket(v.at(0)),
-			snd(BuildSound(v)) {}
-		const lcf::rpg::Sound snd;
+			name(v.at(1)),
+			volume(Decode<int>(v.at(2))),
+			tempo(Decode<int>(v.at(3))),
+			balance(Decode<int>(v.at(4))) {}
+		const std::string_view name;
+		const int volume, tempo, balance;
 	};
 
 	class PicturePacket : public PlayerPacket {
@@ -205,7 +208,7 @@ namespace S2C {
 		NamePacket(const PL& v)
 			: PlayerPacket(v.at(0)),
 			name(v.at(1)) {}
-		const std::string name;
+		const std::string_view name;
 	};
 
 }
@@ -213,34 +216,42 @@ namespace C2S {
 	using C2SPacket = Multiplayer::C2SPacket;
 	class MainPlayerPosPacket : public C2SPacket {
 	public:
+		static constexpr bool coalesce = true;
 		MainPlayerPosPacket(int _x, int _y) : C2SPacket("m"),
 			x(_x), y(_y) {}
 		std::string ToBytes() const override { return Build(x, y); }
+		std::string ToBinary() const override { return BuildBinary(x, y); }
 	protected:
 		int x, y;
 	};
 
 	class FacingPacket : public C2SPacket {
 	public:
+		static constexpr bool coalesce = true;
 		FacingPacket(int _d) : C2SPacket("f"), d(_d) {}
 		std::string ToBytes() const override { return Build(d); }
+		std::string ToBinary() const override { return BuildBinary(d); }
 	protected:
 		int d;
 	};
 
 	class SpeedPacket : public C2SPacket {
 	public:
+		static constexpr bool coalesce = true;
 		SpeedPacket(int _spd) : C2SPacket("spd"), spd(_spd) {}
 		std::string ToBytes() const override { return Build( spd); }
+		std::string ToBinary() const override { return BuildBinary(spd); }
 	protected:
 		int spd;
 	};
 
 	class SpritePacket : public C2SPacket {
 	public:
+		static constexpr bool coalesce = true;
 		SpritePacket(std::string _n, int _i) : C2SPacket("spr"),
 			name(_n), index(_i) {}
 		std::string ToBytes() const override { return Build(name, index); }
+		std::string ToBinary() const override { return BuildBinary(std::string_view(name), index); }
 	protected:
 		std::string name;
 		int index;
@@ -256,8 +267,10 @@ namespace C2S {
 
 	class SEPacket : public C2SPacket {
 	public:
+		static constexpr Multiplayer::PacketLane lane = Multiplayer::PacketLane::Sound;
 		SEPacket(lcf::rpg::Sound _d) : C2SPacket("se"), snd(std::move(_d)) {}
 		std::string ToBytes() const override { return Build(snd.name, snd.volume, snd.tempo, snd.balance); }
+		std::string ToBinary() const override { return BuildBinary(std::string_view(snd.name), snd.volume, snd.tempo, snd.balance); }
 	protected:
 		lcf::rpg::Sound snd;
 	};
@@ -290,6 +303,7 @@ namespace C2S {
 			: C2SPacket(std::move(_name)), pic_id(_pic_id), p(_p),
 		map_x(_mx), map_y(_my),
 		pan_x(_panx), pan_y(_pany) {}
+		static constexpr Multiplayer::PacketLane lane = Multiplayer::PacketLane::Picture;
 		void Append(std::string& s) const {
 			AppendPartial(s, pic_id, p.position_x, p.position_y,
 					map_x, map_y, pan_x, pan_y,
@@ -297,7 +311,21 @@ namespace C2S {
 					p.red, p.green, p.blue, p.saturation,
 					p.effect_mode, p.effect_power);
 		}
+		static constexpr size_t FIELD_COUNT = 16;
+		void AppendBinaryFields(std::string& s) const {
+			AppendBinaryPartial(s, pic_id, p.position_x, p.position_y,
+					map_x, map_y, pan_x, pan_y,
+					p.magnify, p.top_trans, p.bottom_trans,
+					p.red, p.green, p.blue, p.saturation,
+					p.effect_mode, p.effect_power);
+		}
 	protected:
+		// p refers to a member of the derived packet, copies must rebind it
+		PicturePacket(const PicturePacket& o, Game_Pictures::Params& _p)
+			: C2SPacket(o), pic_id(o.pic_id), p(_p),
+		map_x(o.map_x), map_y(o.map_y),
+		pan_x(o.pan_x), pan_y(o.pan_y) {}
+
 		int pic_id;
 		Game_Pictures::Params& p;
 		int map_x, map_y;
@@ -309,12 +337,21 @@ namespace C2S {
 		ShowPicturePacket(int _pid, Game_Pictures::ShowParams _p,
 				int _mx, int _my, int _px, int _py)
 			: PicturePacket("ap", _pid, p_show, _mx, _my, _px, _py), p_show(std::move(_p)) {}
+		ShowPicturePacket(const ShowPicturePacket& o)
+			: PicturePacket(o, p_show), p_show(o.p_show) {}
 		std::string ToBytes() const override {
 			std::string r {GetName()};
 			PicturePacket::Append(r);
 			AppendPartial(r, p_show.name, p_show.use_transparent_color, p_show.fixed_to_map);
 			return r;
 		}
+		std::string ToBinary() const override {
+			std::string r;
+			AppendBinaryHeader(r, GetName(), FIELD_COUNT + 3);
+			PicturePacket::AppendBinaryFields(r);
+			AppendBinaryPartial(r, std::string_view(p_show.name), p_show.use_transparent_color, p_show.fixed_to_map);
+			return r;
+		}
 	protected:
 		Game_Pictures::ShowParams p_show;
 	};
@@ -324,20 +361,34 @@ namespace C2S {
 		MovePicturePacket(int _pid, Game_Pictures::MoveParams _p,
 				int _mx, int _my, int _px, int _py)
 			: PicturePacket("mp", _pid, p_move, _mx, _my, _px, _py), p_move(std::move(_p)) {}
+		MovePicturePacket(const MovePicturePacket& o)
+			: PicturePacket(o, p_move), p_move(o.p_move) {}
+		// a move that is still queued is replaced by the next move of the same picture
+		static constexpr bool coalesce = true;
+		int GetCoalesceKey() const { return pic_id; }
 		std::string ToBytes() const override {
 			std::string r {GetName()};
 			PicturePacket::Append(r);
 			AppendPartial(r, p_move.duration);
 			return r;
 		}
+		std::string ToBinary() const override {
+			std::string r;
+			AppendBinaryHeader(r, GetName(), FIELD_COUNT + 1);
+			PicturePacket::AppendBinaryFields(r);
+			AppendBinaryPartial(r, p_move.duration);
+			return r;
+		}
 	protected:
 		Game_Pictures::MoveParams p_move;
 	};
 
 	class ErasePicturePacket : public C2SPacket {
 	public:
+		static constexpr Multiplayer::PacketLane lane = Multiplayer::PacketLane::Picture;
 		ErasePicturePacket(int _pid) : C2SPacket("rp"), pic_id(_pid) {}
 		std::string ToBytes() const override { return Build(pic_id); }
+		std::string ToBinary() const override { return BuildBinary(pic_id); }
 	protected:
 		int pic_id;
 	};
@@ -360,6 +411,15 @@ namespace C2S {
 		std::string msg;
 	};
 
+	/** Asks the server to use the binary wire format from now on. */
+	class WirePacket : public C2SPacket {
+	public:
+		WirePacket(int _format) : C2SPacket("wire"), format(_format) {}
+		std::string ToBytes() const override { return Build(format); }
+	protected:
+		int format;
+	};
+
 	class BanUserPacket : public C2SPacket {
 	public:
 		BanUserPacket(std::string _uuid) : C2SPacket("ban"),
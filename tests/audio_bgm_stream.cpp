@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "audio_bgm_stream.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("AudioBgmStream");
+
+namespace {
+
+/** Mono S16 at 1000 Hz, sample i has the value i */
+class CountingDecoder : public AudioDecoderBase {
+	public:
+		explicit CountingDecoder(int samples) : samples(samples) {}
+
+		bool Open(Filesystem_Stream::InputStream) override { return true; }
+		void Pause() override {}
+		void Resume() override {}
+		int GetVolume() const override { return volume; }
+		void SetVolume(int new_volume) override { volume = new_volume; }
+		void SetFade(int end, std::chrono::milliseconds) override { volume = end; }
+		bool Seek(std::streamoff, std::ios_base::seekdir) override {
+			position = 0;
+			return true;
+		}
+		bool IsFinished() const override { return position >= samples; }
+		void Update(std::chrono::microseconds) override {}
+		void GetFormat(int& frequency, Format& format, int& channels) const override {
+			frequency = 1000;
+			format = Format::S16;
+			channels = 1;
+		}
+		int GetTicks() const override { return position; }
+
+		std::atomic<bool> blocked = { false };
+		std::atomic<bool> fail = { false };
+
+	protected:
+		int FillBuffer(uint8_t* buffer, int size) override {
+			while (blocked) {
+				std::this_thread::yield();
+			}
+			if (fail) {
+				return -1;
+			}
+			auto* out = reinterpret_cast<int16_t*>(buffer);
+			int count = std::min(size / 2, samples - position);
+			for (int i = 0; i < count; ++i) {
+				out[i] = static_cast<int16_t>(position++);
+			}
+			return count * 2;
+		}
+
+	private:
+		int samples;
+		int position = 0;
+		int volume = 100;
+};
+
+/** Reads until count samples arrived, waiting for the decode thread when it is behind */
+std::vector<int16_t> Read(AudioBgmStream& stream, int count, int chunk) {
+	std::vector<int16_t> samples;
+	std::vector<int16_t> buffer(chunk);
+
+	for (int tries = 0; (int)samples.size() < count && tries < 10000; ++tries) {
+		int size = std::min<int>(chunk, count - samples.size()) * 2;
+		int read = stream.Decode(reinterpret_cast<uint8_t*>(buffer.data()), size);
+		if (read <= 0) {
+			if (stream.IsFinished() || read < 0) {
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		samples.insert(samples.end(), buffer.begin(), buffer.begin() + read / 2);
+	}
+	return samples;
+}
+
+}
+
+TEST_CASE("Blocks") {
+	AudioBgmStream stream(std::make_unique<CountingDecoder>(100), std::chrono::milliseconds(50));
+	REQUIRE_EQ(stream.GetBlockCount(), 5);
+
+	int frequency;
+	AudioDecoderBase::Format format;
+	int channels;
+	stream.GetFormat(frequency, format, channels);
+	REQUIRE_EQ(frequency, 1000);
+	REQUIRE_EQ(format, AudioDecoderBase::Format::S16);
+	REQUIRE_EQ(channels, 1);
+
+	AudioBgmStream minimum(std::make_unique<CountingDecoder>(100), std::chrono::milliseconds(0));
+	REQUIRE_EQ(minimum.GetBlockCount(), 2);
+}
+
+TEST_CASE("Sequence") {
+	AudioBgmStream stream(std::make_unique<CountingDecoder>(1000), std::chrono::milliseconds(50));
+
+	// chunks that do not line up with the blocks
+	auto samples = Read(stream, 1000, 7);
+	REQUIRE_EQ(samples.size(), 1000);
+	for (int i = 0; i < 1000; ++i) {
+		REQUIRE_EQ(samples[i], i);
+	}
+	REQUIRE(stream.IsFinished());
+	REQUIRE_EQ(stream.GetTicks(), 1000);
+}
+
+TEST_CASE("Looping") {
+	auto decoder = std::make_unique<CountingDecoder>(25);
+	decoder->SetLooping(true);
+	AudioBgmStream stream(std::move(decoder), std::chrono::milliseconds(30));
+
+	auto samples = Read(stream, 100, 16);
+	REQUIRE_EQ(samples.size(), 100);
+	for (int i = 0; i < 100; ++i) {
+		REQUIRE_EQ(samples[i], i % 25);
+	}
+	REQUIRE_FALSE(stream.IsFinished());
+	REQUIRE_GE(stream.GetLoopCount(), 3);
+}
+
+TEST_CASE("Volume") {
+	auto decoder = std::make_unique<CountingDecoder>(100000);
+	decoder->SetVolume(80);
+	AudioBgmStream stream(std::move(decoder), std::chrono::milliseconds(50));
+	REQUIRE_EQ(stream.GetVolume(), 80);
+
+	// Applies to the blocks decoded after the change
+	stream.SetVolume(40);
+	for (int i = 0; i < 100 && stream.GetVolume() != 40; ++i) {
+		Read(stream, 10, 10);
+	}
+	REQUIRE_EQ(stream.GetVolume(), 40);
+
+	REQUIRE(stream.SetPitch(150));
+	REQUIRE_EQ(stream.GetPitch(), 150);
+}
+
+TEST_CASE("Underrun") {
+	auto decoder = std::make_unique<CountingDecoder>(1000);
+	auto* counting = decoder.get();
+	counting->blocked = true;
+	AudioBgmStream stream(std::move(decoder), std::chrono::milliseconds(50));
+
+	std::vector<uint8_t> buffer(20);
+	REQUIRE_EQ(stream.Decode(buffer.data(), 20), 0);
+	REQUIRE_EQ(stream.GetUnderruns(), 1);
+	REQUIRE_FALSE(stream.IsFinished());
+
+	counting->blocked = false;
+	auto samples = Read(stream, 10, 10);
+	REQUIRE_EQ(samples.size(), 10);
+	REQUIRE_EQ(samples[0], 0);
+}
+
+TEST_CASE("Error") {
+	auto decoder = std::make_unique<CountingDecoder>(1000);
+	decoder->fail = true;
+	AudioBgmStream stream(std::move(decoder), std::chrono::milliseconds(50));
+
+	std::vector<uint8_t> buffer(20);
+	int read = 0;
+	for (int i = 0; i < 1000 && read == 0; ++i) {
+		read = stream.Decode(buffer.data(), 20);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	REQUIRE_EQ(read, -1);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,171 @@
+#include "audio_mixer.h"
+#include "doctest.h"
+#include <cstring>
+#include <vector>
+
+TEST_SUITE_BEGIN("AudioMixer");
+
+namespace {
+
+using AudioMixer::Kernel;
+using Format = AudioDecoderBase::Format;
+
+constexpr Kernel kernels[] = { Kernel::Scalar, Kernel::Sse41, Kernel::Avx2, Kernel::Neon };
+
+/** Restores the startup kernel at the end of a test */
+struct KernelGuard {
+	Kernel prev = AudioMixer::GetKernel();
+	~KernelGuard() { AudioMixer::SetKernel(prev); }
+};
+
+std::vector<float> MakeSamples(int count, float amplitude) {
+	std::vector<float> samples(count);
+	uint32_t seed = 12345;
+	for (auto& s: samples) {
+		seed = seed * 1103515245 + 12345;
+		s = (static_cast<int>(seed >> 8 & 0xFFFF) - 32768) / 32768.0f * amplitude;
+	}
+	return samples;
+}
+
+}
+
+TEST_CASE("ToFloatFormats") {
+	float out[2];
+
+	const int8_t s8[] = { -128, 64 };
+	AudioMixer::ToFloat(s8, Format::S8, 2, out);
+	REQUIRE_EQ(out[0], -1.0f);
+	REQUIRE_EQ(out[1], 0.5f);
+
+	const uint8_t u8[] = { 0, 192 };
+	AudioMixer::ToFloat(u8, Format::U8, 2, out);
+	REQUIRE_EQ(out[0], -1.0f);
+	REQUIRE_EQ(out[1], 0.5f);
+
+	const int16_t s16[] = { -32768, 16384 };
+	AudioMixer::ToFloat(s16, Format::S16, 2, out);
+	REQUIRE_EQ(out[0], -1.0f);
+	REQUIRE_EQ(out[1], 0.5f);
+
+	const uint16_t u16[] = { 0, 49152 };
+	AudioMixer::ToFloat(u16, Format::U16, 2, out);
+	REQUIRE_EQ(out[0], -1.0f);
+	REQUIRE_EQ(out[1], 0.5f);
+
+	const int32_t s32[] = { INT32_MIN, 1 << 30 };
+	AudioMixer::ToFloat(s32, Format::S32, 2, out);
+	REQUIRE_EQ(out[0], -1.0f);
+	REQUIRE_EQ(out[1], 0.5f);
+
+	const uint32_t u32[] = { 0, 3u << 30 };
+	AudioMixer::ToFloat(u32, Format::U32, 2, out);
+	REQUIRE_EQ(out[0], -1.0f);
+	REQUIRE_EQ(out[1], 0.5f);
+
+	const float f32[] = { -1.0f, 0.5f };
+	AudioMixer::ToFloat(f32, Format::F32, 2, out);
+	REQUIRE_EQ(out[0], -1.0f);
+	REQUIRE_EQ(out[1], 0.5f);
+}
+
+TEST_CASE("Accumulate") {
+	const float stereo[] = { 0.5f, -0.5f };
+	const float mono[] = { 0.25f };
+	const float quad[] = { 0.5f, 0.25f, 1.0f, 1.0f };
+	float mix[2] = {};
+
+	AudioMixer::Accumulate(mix, stereo, 1, 2, 0.5f);
+	REQUIRE_EQ(mix[0], 0.25f);
+	REQUIRE_EQ(mix[1], -0.25f);
+
+	// mono is added to both sides
+	AudioMixer::Accumulate(mix, mono, 1, 1, 1.0f);
+	REQUIRE_EQ(mix[0], 0.5f);
+	REQUIRE_EQ(mix[1], 0.0f);
+
+	// only the first two channels are used
+	AudioMixer::Accumulate(mix, quad, 1, 4, 1.0f);
+	REQUIRE_EQ(mix[0], 1.0f);
+	REQUIRE_EQ(mix[1], 0.25f);
+}
+
+TEST_CASE("ToS16") {
+	const float mix[] = { 0.5f, -0.5f, 1.0f, -1.0f, 1.5f, -3.0f };
+	int16_t out[6];
+
+	// no compression, out of range values are clamped
+	AudioMixer::ToS16(mix, 6, 1.0f, out);
+	REQUIRE_EQ(out[0], 16384);
+	REQUIRE_EQ(out[1], -16384);
+	REQUIRE_EQ(out[2], 32767);
+	REQUIRE_EQ(out[3], -32768);
+	REQUIRE_EQ(out[4], 32767);
+	REQUIRE_EQ(out[5], -32768);
+
+	// peaks above 0.8 are compressed so that total volume is full scale
+	AudioMixer::ToS16(mix, 6, 1.8f, out);
+	REQUIRE_EQ(out[0], 16384);
+	REQUIRE_EQ(out[1], -16384);
+	REQUIRE_EQ(out[2], 27525);
+	REQUIRE_EQ(out[3], -27525);
+	REQUIRE_EQ(out[4], 30801);
+	REQUIRE_EQ(out[5], -32768);
+}
+
+TEST_CASE("KernelsMatchScalar") {
+	KernelGuard guard;
+
+	// odd sizes cover the scalar tails of the vector loops
+	for (int frames: { 1, 3, 7, 8, 17, 255 }) {
+		const int count = frames * 2;
+		auto stereo = MakeSamples(count, 1.0f);
+		auto mono = MakeSamples(frames, 1.0f);
+		std::vector<int16_t> s16(count);
+		for (int i = 0; i < count; ++i) {
+			s16[i] = static_cast<int16_t>(stereo[i] * 32767.0f);
+		}
+
+		std::vector<float> ref_float(count);
+		std::vector<float> ref_mix(count);
+		std::vector<int16_t> ref_out(count);
+		std::vector<int16_t> ref_compressed(count);
+
+		AudioMixer::SetKernel(Kernel::Scalar);
+		AudioMixer::ToFloat(s16.data(), Format::S16, count, ref_float.data());
+		AudioMixer::Accumulate(ref_mix.data(), stereo.data(), frames, 2, 0.75f);
+		AudioMixer::Accumulate(ref_mix.data(), mono.data(), frames, 1, 1.25f);
+		AudioMixer::ToS16(ref_mix.data(), count, 1.0f, ref_out.data());
+		AudioMixer::ToS16(ref_mix.data(), count, 2.0f, ref_compressed.data());
+
+		for (auto k: kernels) {
+			if (!AudioMixer::IsSupported(k))
+				continue;
+
+			CAPTURE(AudioMixer::GetKernelName(k));
+			CAPTURE(frames);
+			AudioMixer::SetKernel(k);
+
+			std::vector<float> out_float(count);
+			std::vector<float> out_mix(count);
+			std::vector<int16_t> out(count);
+			std::vector<int16_t> compressed(count);
+
+			AudioMixer::ToFloat(s16.data(), Format::S16, count, out_float.data());
+			AudioMixer::Accumulate(out_mix.data(), stereo.data(), frames, 2, 0.75f);
+			AudioMixer::Accumulate(out_mix.data(), mono.data(), frames, 1, 1.25f);
+			// convert the reference mix so only the conversion is compared
+			AudioMixer::ToS16(ref_mix.data(), count, 1.0f, out.data());
+			AudioMixer::ToS16(ref_mix.data(), count, 2.0f, compressed.data());
+
+			REQUIRE(out_float == ref_float);
+			for (int i = 0; i < count; ++i) {
+				REQUIRE_EQ(out_mix[i], doctest::Approx(ref_mix[i]).epsilon(1e-6));
+			}
+			REQUIRE(out == ref_out);
+			REQUIRE(compressed == ref_compressed);
+		}
+	}
+}
+
+TEST_SUITE_END();
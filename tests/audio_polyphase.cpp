@@ -0,0 +1,214 @@
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "audio_mixer.h"
+#include "audio_polyphase.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("AudioPolyphase");
+
+namespace {
+
+using Quality = AudioPolyphase::Quality;
+
+std::vector<float> Sine(int frames, int channels, double frequency, int rate) {
+	std::vector<float> samples(frames * channels);
+	for (int i = 0; i < frames; ++i) {
+		for (int c = 0; c < channels; ++c) {
+			// the channels differ in phase to catch mixed up planes
+			samples[i * channels + c] = static_cast<float>(0.5 * std::sin(2.0 * M_PI * frequency * i / rate + c));
+		}
+	}
+	return samples;
+}
+
+/** Prepares the table of the ratio and selects it, like AudioResampler does */
+void SetRate(AudioPolyphase& resampler, int input_rate, int output_rate) {
+	resampler.Prepare(input_rate, output_rate);
+	resampler.SetRate(input_rate, output_rate);
+}
+
+/** Resamples all of src, passing the input in chunks of the given size */
+std::vector<float> Resample(AudioPolyphase& resampler, const std::vector<float>& src, int chunk) {
+	const int channels = resampler.GetChannels();
+	const int frames = static_cast<int>(src.size()) / channels;
+	std::vector<float> dst;
+	std::vector<float> buffer(chunk * 4 * channels);
+
+	int offset = 0;
+	for (;;) {
+		if (offset == frames) {
+			resampler.Flush();
+		}
+		int in = std::min(chunk, frames - offset);
+		int out = chunk * 4;
+		resampler.Process(src.data() + offset * channels, in, buffer.data(), out);
+		offset += in;
+		dst.insert(dst.end(), buffer.begin(), buffer.begin() + out * channels);
+		if (out == 0 && offset == frames) {
+			return dst;
+		}
+	}
+}
+
+/** Largest difference to the sine at the output rate, ignoring the start and the end */
+double SineError(Quality quality, int channels, double frequency, int input_rate, int output_rate) {
+	AudioPolyphase resampler(channels, quality);
+	SetRate(resampler, input_rate, output_rate);
+
+	const int frames = input_rate / 10;
+	auto dst = Resample(resampler, Sine(frames, channels, frequency, input_rate), 100);
+	auto expected = Sine(static_cast<int>(dst.size()) / channels, channels, frequency, output_rate);
+
+	double error = 0.0;
+	for (size_t i = 100 * channels; i + 100 * channels < dst.size(); ++i) {
+		error = std::max(error, std::fabs(double(dst[i]) - expected[i]));
+	}
+	return error;
+}
+
+/** RMS of the output, ignoring the start and the end */
+double Rms(const std::vector<float>& samples) {
+	double sum = 0.0;
+	int count = 0;
+	for (size_t i = 200; i + 200 < samples.size(); ++i) {
+		sum += double(samples[i]) * samples[i];
+		++count;
+	}
+	return std::sqrt(sum / count);
+}
+
+}
+
+TEST_CASE("Phases") {
+	AudioPolyphase resampler(2, Quality::Low);
+	REQUIRE_EQ(resampler.GetTaps(), 16);
+
+	SetRate(resampler, 44100, 48000);
+	REQUIRE_EQ(resampler.GetPhases(), 160);
+	SetRate(resampler, 22050, 48000);
+	REQUIRE_EQ(resampler.GetPhases(), 320);
+	SetRate(resampler, 32000, 44100);
+	REQUIRE_EQ(resampler.GetPhases(), 441);
+	SetRate(resampler, 11025, 48000);
+	REQUIRE_EQ(resampler.GetPhases(), 640);
+	// 44100 Hz with a pitch of 73
+	SetRate(resampler, 44100 * 73, 48000 * 100);
+	REQUIRE_EQ(resampler.GetPhases(), 1024);
+
+	// Without a prepared table, e.g. a pitch change on the audio thread
+	resampler.Prepare(44100, 48000);
+	resampler.SetRate(44100 * 2, 48000);
+	REQUIRE_EQ(resampler.GetPhases(), 1024);
+	resampler.SetRate(44100, 48000);
+	REQUIRE_EQ(resampler.GetPhases(), 160);
+	// Preparing another ratio replaces the table in use
+	resampler.Prepare(11025, 48000);
+	resampler.SetRate(11025, 48000);
+	resampler.Prepare(44100, 48000);
+	REQUIRE_EQ(resampler.GetPhases(), 1024);
+	// Preparing the current ratio switches to its table
+	resampler.Prepare(11025, 48000);
+	REQUIRE_EQ(resampler.GetPhases(), 640);
+
+	REQUIRE_EQ(AudioPolyphase(1, Quality::Medium).GetTaps(), 32);
+	REQUIRE_EQ(AudioPolyphase(1, Quality::High).GetTaps(), 64);
+}
+
+TEST_CASE("Length") {
+	for (auto quality : { Quality::Low, Quality::High }) {
+		for (int output_rate : { 22050, 32000, 48000 }) {
+			AudioPolyphase resampler(1, quality);
+			SetRate(resampler, 44100, output_rate);
+			auto dst = Resample(resampler, std::vector<float>(44100), 256);
+
+			// Flush produces the frames up to the end of the input
+			REQUIRE_EQ(dst.size(), output_rate);
+		}
+	}
+}
+
+TEST_CASE("Flush") {
+	// The end of the input reaches the output
+	AudioPolyphase resampler(1, Quality::Medium);
+	SetRate(resampler, 44100, 48000);
+	std::vector<float> src(1000);
+	src.back() = 1.0f;
+	auto dst = Resample(resampler, src, 100);
+
+	REQUIRE_EQ(dst.size(), 1089);
+	REQUIRE_GT(*std::max_element(dst.end() - 4, dst.end()), 0.5f);
+
+	// Only once until Reset
+	resampler.Flush();
+	float out[16];
+	int in = 0;
+	int count = 16;
+	resampler.Process(nullptr, in, out, count);
+	REQUIRE_EQ(count, 0);
+}
+
+TEST_CASE("Sine") {
+	REQUIRE_LT(SineError(Quality::Low, 2, 1000.0, 44100, 48000), 2e-3);
+	REQUIRE_LT(SineError(Quality::Medium, 2, 1000.0, 22050, 48000), 2e-4);
+	REQUIRE_LT(SineError(Quality::High, 1, 1000.0, 32000, 44100), 2e-5);
+	REQUIRE_LT(SineError(Quality::Medium, 2, 1000.0, 48000, 22050), 2e-4);
+	// nearest phase of a pitch that does not reduce
+	REQUIRE_LT(SineError(Quality::Medium, 1, 1000.0, 44100 * 73, 48000 * 100), 2e-3);
+}
+
+TEST_CASE("Stopband") {
+	// 16 kHz is above the Nyquist frequency of the output
+	for (auto quality : { Quality::Low, Quality::Medium, Quality::High }) {
+		AudioPolyphase resampler(1, quality);
+		SetRate(resampler, 48000, 22050);
+		auto dst = Resample(resampler, Sine(48000, 1, 16000.0, 48000), 512);
+		REQUIRE_LT(Rms(dst), 0.5 / std::sqrt(2.0) / 100.0);
+	}
+}
+
+TEST_CASE("Chunks") {
+	auto src = Sine(5000, 2, 440.0, 44100);
+
+	AudioPolyphase whole(2, Quality::Medium);
+	SetRate(whole, 44100, 48000);
+	auto expected = Resample(whole, src, 5000);
+
+	AudioPolyphase chunked(2, Quality::Medium);
+	SetRate(chunked, 44100, 48000);
+	REQUIRE_EQ(Resample(chunked, src, 7), expected);
+
+	// Reset starts over
+	chunked.Reset();
+	REQUIRE_EQ(Resample(chunked, src, 1000), expected);
+}
+
+TEST_CASE("KernelsMatchScalar") {
+	auto src = Sine(2000, 2, 3000.0, 44100);
+	auto prev = AudioMixer::GetKernel();
+
+	AudioMixer::SetKernel(AudioMixer::Kernel::Scalar);
+	AudioPolyphase scalar(2, Quality::High);
+	SetRate(scalar, 44100, 48000);
+	auto expected = Resample(scalar, src, 256);
+
+	for (auto kernel : { AudioMixer::Kernel::Sse41, AudioMixer::Kernel::Avx2, AudioMixer::Kernel::Neon }) {
+		if (!AudioMixer::IsSupported(kernel)) {
+			continue;
+		}
+		AudioMixer::SetKernel(kernel);
+		AudioPolyphase resampler(2, Quality::High);
+		SetRate(resampler, 44100, 48000);
+		auto dst = Resample(resampler, src, 256);
+
+		REQUIRE_EQ(dst.size(), expected.size());
+		for (size_t i = 0; i < dst.size(); ++i) {
+			REQUIRE(std::fabs(dst[i] - expected[i]) < 1e-5f);
+		}
+	}
+
+	AudioMixer::SetKernel(prev);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,156 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include "audio_secache.h"
+#include "doctest.h"
+
+#ifdef WANT_DRWAV
+
+TEST_SUITE_BEGIN("AudioSeCache");
+
+namespace {
+
+/** Samples are not resampled, so a sample of this many frames takes 1000 bytes */
+constexpr int frames = 500;
+
+/** Mono S16 WAV file in a stream */
+Filesystem_Stream::InputStream MakeWav(const std::string& name) {
+	auto put = [](std::string& out, uint32_t value, int bytes) {
+		for (int i = 0; i < bytes; ++i) {
+			out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+		}
+	};
+
+	const uint32_t data_size = frames * 2;
+	std::string wav = "RIFF";
+	put(wav, 36 + data_size, 4);
+	wav += "WAVEfmt ";
+	put(wav, 16, 4);
+	put(wav, 1, 2); // PCM
+	put(wav, 1, 2); // channels
+	put(wav, 22050, 4);
+	put(wav, 22050 * 2, 4);
+	put(wav, 2, 2);
+	put(wav, 16, 2);
+	wav += "data";
+	put(wav, data_size, 4);
+	wav.append(data_size, '\x10');
+
+	return Filesystem_Stream::InputStream(new std::stringbuf(wav), name);
+}
+
+bool IsCached(const std::string& name) {
+	// Without data only a cached sample can be created
+	auto se = AudioSeCache::Create(Filesystem_Stream::InputStream(new std::stringbuf(), name));
+	return se && se->IsCached();
+}
+
+/** Plays the sample, the decoder keeps it alive while it exists */
+std::unique_ptr<AudioDecoderBase> Play(const std::string& name) {
+	auto se = AudioSeCache::Create(MakeWav(name));
+	REQUIRE(se);
+	return se->CreateSeDecoder();
+}
+
+/** Resets the cache, restores the default budget at the end of a test */
+struct CacheGuard {
+	explicit CacheGuard(size_t budget) {
+		AudioSeCache::SetTargetFormat(0, AudioDecoder::Format::S16);
+		AudioSeCache::Clear();
+		AudioSeCache::SetBudget(budget);
+	}
+	~CacheGuard() {
+		AudioSeCache::Clear();
+		AudioSeCache::SetBudget(8 * 1024 * 1024);
+	}
+};
+
+}
+
+TEST_CASE("Cached") {
+	CacheGuard guard(3000);
+
+	REQUIRE_FALSE(IsCached("a"));
+	auto dec = Play("a");
+	REQUIRE(IsCached("a"));
+
+	std::vector<uint8_t> buffer(4000);
+	REQUIRE_GT(dec->Decode(buffer.data(), buffer.size()), 0);
+}
+
+TEST_CASE("LeastRecentlyUsed") {
+	CacheGuard guard(3000);
+
+	Play("a");
+	Play("b");
+	Play("c");
+	// a is used again, b is the oldest now
+	Play("a");
+	Play("d");
+
+	REQUIRE(IsCached("a"));
+	REQUIRE_FALSE(IsCached("b"));
+	REQUIRE(IsCached("c"));
+	REQUIRE(IsCached("d"));
+}
+
+TEST_CASE("Budget") {
+	CacheGuard guard(3000);
+
+	Play("a");
+	Play("b");
+	Play("c");
+
+	// Lowering the budget frees the oldest
+	AudioSeCache::SetBudget(1000);
+	REQUIRE_FALSE(IsCached("a"));
+	REQUIRE_FALSE(IsCached("b"));
+	REQUIRE(IsCached("c"));
+}
+
+TEST_CASE("PlayingStays") {
+	CacheGuard guard(2000);
+
+	auto playing = Play("a");
+	Play("b");
+	Play("c");
+
+	// a is the oldest but still playing
+	REQUIRE(IsCached("a"));
+	REQUIRE_FALSE(IsCached("b"));
+	REQUIRE(IsCached("c"));
+
+	// Freed with the next sample once it stopped
+	playing.reset();
+	Play("d");
+	REQUIRE_FALSE(IsCached("a"));
+	REQUIRE(IsCached("c"));
+	REQUIRE(IsCached("d"));
+}
+
+TEST_CASE("PreloadDoesNotEvict") {
+	CacheGuard guard(2500);
+
+	REQUIRE(AudioSeCache::Preload(MakeWav("a")));
+	REQUIRE(AudioSeCache::Preload(MakeWav("b")));
+	REQUIRE(IsCached("a"));
+	REQUIRE(IsCached("b"));
+
+	// Does not fit without freeing a
+	REQUIRE_FALSE(AudioSeCache::Preload(MakeWav("c")));
+	REQUIRE_FALSE(IsCached("c"));
+	REQUIRE(IsCached("a"));
+	REQUIRE(IsCached("b"));
+
+	// Already cached
+	REQUIRE(AudioSeCache::Preload(MakeWav("a")));
+
+	// Playing still frees the oldest
+	Play("c");
+	REQUIRE(IsCached("c"));
+	REQUIRE_FALSE(IsCached("a"));
+}
+
+TEST_SUITE_END();
+
+#endif
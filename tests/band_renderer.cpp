@@ -0,0 +1,124 @@
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "band_renderer.h"
+#include "drawable_list.h"
+#include "bitmap.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("BandRenderer");
+
+namespace {
+
+class TestRect : public Drawable {
+	public:
+		TestRect(int z, Rect rect, Color color, bool bands)
+			: Drawable(z, Drawable::Flags::Global), rect(rect), color(color), bands(bands) {}
+
+		void Draw(Bitmap& dst) override {
+			++draws;
+			dst.FillRect(rect, color);
+		}
+
+		bool PrepareBands(const Bitmap&) override {
+			++prepares;
+			return bands;
+		}
+
+		void DrawBand(Bitmap& dst) const override {
+			++band_draws;
+			dst.FillRect(rect, color);
+		}
+
+		Rect rect;
+		Color color;
+		bool bands = false;
+		int draws = 0;
+		int prepares = 0;
+		mutable std::atomic<int> band_draws = { 0 };
+};
+
+using Rects = std::vector<std::unique_ptr<TestRect>>;
+
+Rects MakeRects(int count, int width, int height) {
+	Rects rects;
+	for (int i = 0; i < count; ++i) {
+		Rect rect(i * 7 % width - 4, i * 13 % height - 4, 8 + i % 5 * 4, 6 + i % 7 * 3);
+		Color color(i * 40 % 256, i * 90 % 256, i * 20 % 256, 255);
+		// every third drawable must be drawn serially
+		rects.push_back(std::make_unique<TestRect>(i % 4, rect, color, i % 3 != 0));
+	}
+	return rects;
+}
+
+void testIdentical(int width, int height, int bands) {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Bitmap serial(width, height, false);
+	Bitmap banded(width, height, false);
+	serial.Clear();
+	banded.Clear();
+
+	auto rects = MakeRects(24, width, height);
+	DrawableList list;
+	for (auto& rect : rects) {
+		list.Append(rect.get());
+	}
+
+	list.Draw(serial);
+
+	BandRenderer renderer(bands);
+	renderer.Draw(banded, list, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+
+	REQUIRE_EQ(std::memcmp(serial.pixels(), banded.pixels(), serial.pitch() * height), 0);
+}
+
+}
+
+TEST_CASE("Identical") {
+	testIdentical(64, 48, 4);
+}
+
+TEST_CASE("MoreBandsThanRows") {
+	testIdentical(32, 3, 8);
+}
+
+TEST_CASE("SingleBand") {
+	testIdentical(32, 32, 1);
+}
+
+TEST_CASE("Calls") {
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+	Bitmap bitmap(32, 32, false);
+
+	TestRect band(0, Rect(0, 0, 32, 32), Color(255, 0, 0, 255), true);
+	TestRect serial(1, Rect(0, 0, 16, 16), Color(0, 255, 0, 255), false);
+	TestRect hidden(2, Rect(0, 0, 16, 16), Color(0, 0, 255, 255), true);
+	TestRect above(3, Rect(0, 0, 16, 16), Color(0, 0, 255, 255), true);
+	hidden.SetVisible(false);
+
+	DrawableList list;
+	list.Append(&above);
+	list.Append(&hidden);
+	list.Append(&serial);
+	list.Append(&band);
+
+	BandRenderer renderer(3);
+	REQUIRE_EQ(renderer.GetBands(), 3);
+	renderer.Draw(bitmap, list, 0, 2);
+
+	REQUIRE_FALSE(list.IsDirty());
+	REQUIRE_EQ(band.prepares, 1);
+	REQUIRE_EQ(band.band_draws, 3);
+	REQUIRE_EQ(band.draws, 0);
+	REQUIRE_EQ(serial.prepares, 1);
+	REQUIRE_EQ(serial.band_draws, 0);
+	REQUIRE_EQ(serial.draws, 1);
+	REQUIRE_EQ(hidden.prepares, 0);
+	REQUIRE_EQ(hidden.band_draws, 0);
+	REQUIRE_EQ(above.prepares, 0);
+	REQUIRE_EQ(above.band_draws, 0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,266 @@
+#include "bitmap_kernels.h"
+#include "bitmap_hslrgb.h"
+#include "doctest.h"
+#include <vector>
+
+TEST_SUITE_BEGIN("BitmapKernels");
+
+namespace {
+
+using BitmapKernels::Kernel;
+
+constexpr Kernel kernels[] = { Kernel::Scalar, Kernel::Sse41, Kernel::Avx2, Kernel::Neon };
+
+constexpr BitmapKernels::PixelShifts shifts_rgba = { 24, 16, 8, 0 };
+constexpr BitmapKernels::PixelShifts shifts_bgra = { 8, 16, 24, 0 };
+constexpr BitmapKernels::PixelShifts shifts_argb = { 16, 8, 0, 24 };
+
+/** ToneBlit as it was written before the kernels existed */
+uint32_t ReferenceTone(uint32_t pixel, const Tone& tone, const BitmapKernels::PixelShifts& sh) {
+	int c[3] = { int(pixel >> sh.r) & 0xFF, int(pixel >> sh.g) & 0xFF, int(pixel >> sh.b) & 0xFF };
+	const int a = (pixel >> sh.a) & 0xFF;
+
+	if (tone.gray != 128) {
+		int sat = tone.gray > 128 ? 1024 + (tone.gray - 128) * 16 : tone.gray * 8;
+		int lum = (7471 * c[2] + 38470 * c[1] + 19595 * c[0]) >> 16;
+		for (auto& v: c) {
+			v = (lum * 1024 + (v - lum) * sat) >> 10;
+			v = v > 255 ? 255 : v < 0 ? 0 : v;
+		}
+	}
+
+	const int t[3] = { tone.red, tone.green, tone.blue };
+	for (int i = 0; i < 3; ++i) {
+		int res;
+		if (t[i] <= 128)
+			res = (2 * t[i] * c[i]) / 255;
+		else
+			res = 255 - 2 * (255 - t[i]) * (255 - c[i]) / 255;
+		c[i] = res > 255 ? 255 : res < 0 ? 0 : res;
+	}
+
+	return ((uint32_t)c[0] << sh.r) | ((uint32_t)c[1] << sh.g) | ((uint32_t)c[2] << sh.b) | ((uint32_t)a << sh.a);
+}
+
+/** HueChangeBlit as it was written before the kernels existed */
+uint32_t ReferenceHue(uint32_t pixel, int hue) {
+	uint8_t r = (pixel>>24) & 0xFF;
+	uint8_t g = (pixel>>16) & 0xFF;
+	uint8_t b = (pixel>> 8) & 0xFF;
+	uint8_t a = pixel & 0xFF;
+	if (a > 0)
+		RGB_adjust_HSL(r, g, b, hue);
+	return ((uint32_t) r << 24) | ((uint32_t) g << 16) | ((uint32_t) b << 8) | (uint32_t) a;
+}
+
+/** ComputeImageOpacity as it was written before the kernels existed */
+ImageOpacity ReferenceOpacity(const uint32_t* p, int width, int height, int stride, uint32_t mask) {
+	bool all_opaque = true;
+	bool all_transp = true;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			auto px = p[x + y * stride] & mask;
+			all_transp &= (px == 0);
+			all_opaque &= (px == mask);
+		}
+	}
+
+	return
+		all_transp ? ImageOpacity::Transparent :
+		all_opaque ? ImageOpacity::Opaque :
+		ImageOpacity::Partial;
+}
+
+std::vector<uint32_t> Pixels(size_t count) {
+	std::vector<uint32_t> pixels(count);
+	uint32_t x = 0x12345678;
+	for (auto& p: pixels) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		p = x;
+	}
+	// fully transparent and opaque pixels and the channel extremes
+	for (size_t i = 0; i < count; i += 5)
+		pixels[i] &= 0xFFFFFF00;
+	for (size_t i = 1; i < count; i += 7)
+		pixels[i] |= 0xFF;
+	for (size_t i = 2; i < count; i += 11)
+		pixels[i] = (i & 8) ? 0xFFFFFFFF : 0x000000FF;
+	return pixels;
+}
+
+}
+
+TEST_CASE("ToneMatchesReference") {
+	const auto kernel = BitmapKernels::GetKernel();
+	// odd count to cover the scalar tail of every vector width
+	const auto input = Pixels(203);
+	const int values[] = { 0, 1, 64, 127, 128, 129, 200, 255 };
+
+	for (auto k: kernels) {
+		if (!BitmapKernels::IsSupported(k))
+			continue;
+		BitmapKernels::SetKernel(k);
+		INFO(BitmapKernels::GetKernelName(k));
+
+		for (auto& sh: { shifts_rgba, shifts_bgra, shifts_argb }) {
+			for (int gray: values) {
+				for (int red: values) {
+					for (int blue: { 0, 128, 255 }) {
+						const Tone tone(red, 255 - red, blue, gray);
+						if (tone == Tone())
+							continue;
+						for (bool skip: { false, true }) {
+							auto pixels = input;
+							BitmapKernels::ToneRows(pixels.data(), pixels.size(), 1, 0, tone, sh, skip);
+							for (size_t i = 0; i < pixels.size(); ++i) {
+								const bool transparent = ((input[i] >> sh.a) & 0xFF) == 0;
+								const uint32_t expected = skip && transparent ? input[i] : ReferenceTone(input[i], tone, sh);
+								REQUIRE_EQ(pixels[i], expected);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	BitmapKernels::SetKernel(kernel);
+}
+
+TEST_CASE("ToneRowsStride") {
+	const auto kernel = BitmapKernels::GetKernel();
+	const auto input = Pixels(40 * 6);
+	const Tone tone(255, 0, 64, 0);
+
+	for (auto k: kernels) {
+		if (!BitmapKernels::IsSupported(k))
+			continue;
+		BitmapKernels::SetKernel(k);
+		INFO(BitmapKernels::GetKernelName(k));
+
+		auto pixels = input;
+		// 29 of 40 pixels in 5 rows starting at column 3
+		BitmapKernels::ToneRows(pixels.data() + 3, 29, 5, 40, tone, shifts_rgba, true);
+		for (int y = 0; y < 6; ++y) {
+			for (int x = 0; x < 40; ++x) {
+				const size_t i = y * 40 + x;
+				const bool inside = y < 5 && x >= 3 && x < 32 && (input[i] & 0xFF) != 0;
+				REQUIRE_EQ(pixels[i], inside ? ReferenceTone(input[i], tone, shifts_rgba) : input[i]);
+			}
+		}
+	}
+	BitmapKernels::SetKernel(kernel);
+}
+
+TEST_CASE("HueMatchesReference") {
+	const auto kernel = BitmapKernels::GetKernel();
+
+	// every ordering and tie of the channels around the sector borders
+	const uint32_t values[] = { 0, 1, 2, 63, 64, 127, 128, 129, 200, 254, 255 };
+	std::vector<uint32_t> input;
+	for (auto r: values)
+		for (auto g: values)
+			for (auto b: values)
+				input.push_back(r << 24 | g << 16 | b << 8 | ((r + g + b) & 3) * 85);
+	auto random = Pixels(301);
+	input.insert(input.end(), random.begin(), random.end());
+
+	for (auto k: kernels) {
+		if (!BitmapKernels::IsSupported(k))
+			continue;
+		BitmapKernels::SetKernel(k);
+		INFO(BitmapKernels::GetKernelName(k));
+
+		for (int hue: { 0, 1, 0x80, 0x100, 0x2FF, 0x300, 0x5FF, 0x600 }) {
+			auto pixels = input;
+			BitmapKernels::HueRow(pixels.data(), pixels.size(), hue);
+			for (size_t i = 0; i < pixels.size(); ++i)
+				REQUIRE_EQ(pixels[i], ReferenceHue(input[i], hue));
+		}
+	}
+	BitmapKernels::SetKernel(kernel);
+}
+
+TEST_CASE("OpacityMatchesReference") {
+	const auto kernel = BitmapKernels::GetKernel();
+	constexpr int w = 83;
+	constexpr int h = 5;
+	const uint32_t mask = 0xFF000000;
+
+	for (auto k: kernels) {
+		if (!BitmapKernels::IsSupported(k))
+			continue;
+		BitmapKernels::SetKernel(k);
+		INFO(BitmapKernels::GetKernelName(k));
+
+		for (uint32_t fill: { 0x00000000u, 0xFF000000u, 0x00FFFFFFu, 0xFFFFFFFFu, 0x80123456u }) {
+			// a single different pixel at every position, with and without other channels
+			for (uint32_t odd: { 0x00000000u, 0xFF000000u, 0x7F000000u, 0x00000001u }) {
+				for (int pos = 0; pos < w * h; pos += 3) {
+					std::vector<uint32_t> pixels(w * h, fill);
+					pixels[pos] = odd;
+					REQUIRE_EQ(BitmapKernels::ComputeOpacity(pixels.data(), w, h, w, mask),
+						ReferenceOpacity(pixels.data(), w, h, w, mask));
+					// sub rectangles with row strides
+					for (int width: { 1, 4, 15, 16, 17, 31, 32, 33, 64 }) {
+						REQUIRE_EQ(BitmapKernels::ComputeOpacity(pixels.data() + 2, width, h - 1, w, mask),
+							ReferenceOpacity(pixels.data() + 2, width, h - 1, w, mask));
+					}
+				}
+			}
+		}
+
+		REQUIRE_EQ(BitmapKernels::ComputeOpacity(nullptr, 0, 0, 0, mask), ImageOpacity::Transparent);
+	}
+	BitmapKernels::SetKernel(kernel);
+}
+
+TEST_CASE("TileOpacityMatchesReference") {
+	const auto kernel = BitmapKernels::GetKernel();
+	constexpr int tile = 16;
+	constexpr int tiles_w = 6;
+	constexpr int tiles_h = 4;
+	// an extra column of pixels that is not part of any tile
+	constexpr int stride = tiles_w * tile + 1;
+	const uint32_t mask = 0x000000FF;
+
+	std::vector<uint32_t> pixels(stride * tiles_h * tile, 0);
+	for (int ty = 0; ty < tiles_h; ++ty) {
+		for (int tx = 0; tx < tiles_w; ++tx) {
+			const int kind = (tx + ty * tiles_w) % 5;
+			for (int y = 0; y < tile; ++y) {
+				for (int x = 0; x < tile; ++x) {
+					uint32_t& px = pixels[(ty * tile + y) * stride + tx * tile + x];
+					switch (kind) {
+						case 0: px = 0x12345600; break;
+						case 1: px = 0x123456FF; break;
+						case 2: px = (x + y) % 2 ? 0xFF : 0; break;
+						// one pixel in the last row differs
+						case 3: px = (y == tile - 1 && x == tile - 1) ? 0x80 : 0xFF; break;
+						case 4: px = (y == tile - 1 && x == 0) ? 0xFF : 0x00; break;
+					}
+				}
+			}
+		}
+	}
+
+	for (auto k: kernels) {
+		if (!BitmapKernels::IsSupported(k))
+			continue;
+		BitmapKernels::SetKernel(k);
+		INFO(BitmapKernels::GetKernelName(k));
+
+		std::vector<ImageOpacity> ops(tiles_w * tiles_h);
+		BitmapKernels::ComputeTileOpacity(pixels.data(), tiles_w, tiles_h, tile, stride, mask, ops.data());
+		for (int ty = 0; ty < tiles_h; ++ty) {
+			for (int tx = 0; tx < tiles_w; ++tx) {
+				const uint32_t* p = pixels.data() + ty * tile * stride + tx * tile;
+				REQUIRE_EQ(ops[tx + ty * tiles_w], ReferenceOpacity(p, tile, tile, stride, mask));
+			}
+		}
+	}
+	BitmapKernels::SetKernel(kernel);
+}
+
+TEST_SUITE_END();
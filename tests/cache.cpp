@@ -0,0 +1,172 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include "cache.h"
+#include "bitmap.h"
+#include "filefinder.h"
+#include "filefinder_rtp.h"
+#include "game_clock.h"
+#include "game_config.h"
+#include "main_data.h"
+#include "output.h"
+#include "pixel_format.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("Cache");
+
+namespace {
+
+using namespace std::chrono_literals;
+
+/**
+ * Missing images are cached as checkerboards of the maximum size,
+ * a picture takes 640x480x4 bytes, a Battle2 image 640x640x4 bytes.
+ */
+constexpr size_t picture_size = 640 * 480 * 4;
+
+/** Resets the cache on the test game, restores the default budgets at the end of a test */
+struct CacheGuard {
+	explicit CacheGuard(Game_ConfigCache cfg) {
+		lvl = Output::GetLogLevel();
+		Output::SetLogLevel(LogLevel::Error);
+		Bitmap::SetFormat(format_R8G8B8A8_a().format());
+		FileFinder::SetGameFilesystem(FileFinder::Root().Subtree(EP_TEST_PATH "/game"));
+		Main_Data::filefinder_rtp = std::make_unique<FileFinder_RTP>(true, true, "");
+		Game_Clock::ResetFrame(t);
+		Cache::ClearAll();
+		Cache::SetBudgets(cfg);
+	}
+	~CacheGuard() {
+		Cache::ClearAll();
+		Cache::SetBudgets(Game_ConfigCache());
+		Main_Data::filefinder_rtp.reset();
+		FileFinder::SetGameFilesystem(FilesystemView());
+		Output::SetLogLevel(lvl);
+	}
+
+	/** Loads the next image of a later frame, so the cache can order them across materials */
+	void NextFrame() {
+		t += 1s;
+		Game_Clock::ResetFrame(t);
+	}
+
+	Game_Clock::time_point t;
+	LogLevel lvl;
+};
+
+Game_ConfigCache MakeConfig(int size, int picture, int battle) {
+	Game_ConfigCache cfg;
+	cfg.size.Set(size);
+	cfg.picture.Set(picture);
+	cfg.battle.Set(battle);
+	return cfg;
+}
+
+/** @return whether the picture is in the cache, loads it when it is not */
+bool IsCached(StringView name) {
+	const auto hits = Cache::GetStats().hits;
+	Cache::Picture(name, true);
+	return Cache::GetStats().hits > hits;
+}
+
+}
+
+TEST_CASE("EvictLeastRecentlyUsed") {
+	// room for two pictures
+	CacheGuard guard(MakeConfig(64, 3, 0));
+
+	Cache::Picture("a", true);
+	Cache::Picture("b", true);
+	Cache::Picture("a", true);
+	Cache::Picture("c", true);
+
+	CHECK_EQ(Cache::GetStats().entries, 2);
+	CHECK(IsCached("a"));
+	CHECK(IsCached("c"));
+	CHECK_FALSE(IsCached("b"));
+}
+
+TEST_CASE("GroupBudget") {
+	// every material fits on its own, together they exceed the battle budget
+	CacheGuard guard(MakeConfig(64, 0, 2));
+	const auto evictions = Cache::GetStats().evictions;
+
+	Cache::Battle("a");
+	guard.NextFrame();
+	Cache::Battle2("b");
+
+	CHECK_EQ(Cache::GetStats().entries, 1);
+	CHECK_EQ(Cache::GetStats().evictions - evictions, 1);
+
+	// the pictures are not part of the group
+	for (auto name : { "p1", "p2", "p3" }) {
+		Cache::Picture(name, true);
+	}
+	CHECK_EQ(Cache::GetStats().entries, 4);
+}
+
+TEST_CASE("TotalBudget") {
+	// only the total budget applies, it frees the oldest bitmap of all materials
+	CacheGuard guard(MakeConfig(4, 0, 0));
+
+	Cache::Picture("a", true);
+	guard.NextFrame();
+	Cache::Battle2("b");
+	guard.NextFrame();
+	Cache::Picture("c", true);
+
+	CHECK_EQ(Cache::GetStats().entries, 3);
+	CHECK_LE(Cache::GetStats().bytes, 4 * 1024 * 1024);
+
+	guard.NextFrame();
+	Cache::Picture("d", true);
+
+	CHECK_EQ(Cache::GetStats().entries, 3);
+	CHECK_LE(Cache::GetStats().bytes, 4 * 1024 * 1024);
+	CHECK_FALSE(IsCached("a"));
+}
+
+TEST_CASE("InUseSurvives") {
+	// room for one picture
+	CacheGuard guard(MakeConfig(64, 1, 0));
+
+	auto a = Cache::Picture("a", true);
+	auto b = Cache::Picture("b", true);
+	Cache::Picture("c", true);
+
+	// only unused bitmaps are freed, even when the budget stays exceeded
+	CHECK_EQ(Cache::GetStats().entries, 3);
+	CHECK_EQ(Cache::GetStats().bytes, 3 * picture_size);
+
+	b.reset();
+	Cache::Picture("d", true);
+
+	CHECK(IsCached("a"));
+	CHECK_FALSE(IsCached("b"));
+}
+
+TEST_CASE("Counters") {
+	CacheGuard guard(MakeConfig(64, 1, 0));
+	const auto before = Cache::GetStats();
+
+	Cache::Picture("a", true);
+	Cache::Picture("a", true);
+	Cache::Picture("a", false);
+	Cache::Picture("b", true);
+
+	const auto after = Cache::GetStats();
+	CHECK_EQ(after.misses - before.misses, 3);
+	CHECK_EQ(after.hits - before.hits, 1);
+	CHECK_EQ(after.evictions - before.evictions, 2);
+	CHECK_EQ(after.entries, 1);
+	CHECK_EQ(after.bytes, picture_size);
+
+	for (const auto& s : Cache::GetMaterialStats()) {
+		if (s.name == std::string("Picture")) {
+			CHECK_EQ(s.entries, 1);
+			CHECK_EQ(s.budget, 1024 * 1024);
+		}
+	}
+}
+
+TEST_SUITE_END();
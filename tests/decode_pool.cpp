@@ -0,0 +1,70 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "decode_pool.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("DecodePool");
+
+TEST_CASE("NoThreads") {
+	DecodePool::SetThreads(0);
+	REQUIRE_EQ(DecodePool::GetThreads(), 0);
+
+	int work = 0;
+	int done = 0;
+	DecodePool::Submit([&]() { ++work; }, [&]() { REQUIRE_EQ(work, 1); ++done; });
+
+	REQUIRE_EQ(work, 1);
+	REQUIRE_EQ(done, 1);
+	REQUIRE_EQ(DecodePool::GetPending(), 0);
+}
+
+TEST_CASE("Threads") {
+	DecodePool::SetThreads(3);
+	REQUIRE_EQ(DecodePool::GetThreads(), 3);
+
+	constexpr int jobs = 64;
+	const auto main_thread = std::this_thread::get_id();
+	std::vector<int> results(jobs);
+	std::atomic<int> off_main = { 0 };
+	int done = 0;
+
+	for (int i = 0; i < jobs; ++i) {
+		DecodePool::Submit([&, i]() {
+				results[i] = i * i;
+				off_main += std::this_thread::get_id() != main_thread;
+			}, [&, i]() {
+				REQUIRE((std::this_thread::get_id() == main_thread));
+				REQUIRE_EQ(results[i], i * i);
+				++done;
+			});
+	}
+
+	// done callbacks only run from Update
+	REQUIRE_EQ(done, 0);
+
+	DecodePool::Finish();
+	REQUIRE_EQ(done, jobs);
+	REQUIRE_EQ(off_main, jobs);
+	REQUIRE_EQ(DecodePool::GetPending(), 0);
+
+	DecodePool::Quit();
+	REQUIRE_EQ(DecodePool::GetThreads(), 0);
+}
+
+TEST_CASE("SubmitFromDone") {
+	DecodePool::SetThreads(2);
+
+	int done = 0;
+	DecodePool::Submit([]() {}, [&]() {
+			++done;
+			DecodePool::Submit([]() {}, [&]() { ++done; });
+		});
+
+	DecodePool::Finish();
+	REQUIRE_EQ(done, 2);
+
+	DecodePool::SetThreads(0);
+}
+
+TEST_SUITE_END();
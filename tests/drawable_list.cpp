@@ -1,5 +1,9 @@
 #include <cassert>
 #include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
 #include "utils.h"
 #include "drawable_list.h"
 #include "drawable_mgr.h"
@@ -350,4 +354,152 @@ TEST_CASE("TakeFromPred") {
 	REQUIRE(list2.IsDirty());
 }
 
+TEST_CASE("TakeFromPredMarked") {
+	DrawableList default_list;
+	DrawableMgr::SetLocalList(&default_list);
+
+	TestFrame f1(0);
+	TestFrame f2(0);
+	std::vector<std::unique_ptr<TestSprite>> sprites;
+
+	DrawableList list1;
+	DrawableList list2;
+
+	list2.Append(&f1);
+	list2.Append(&f2);
+	for (int z = 1; z <= 8; ++z) {
+		sprites.push_back(std::make_unique<TestSprite>(z));
+		list2.Append(sprites.back().get());
+	}
+	REQUIRE_FALSE(list2.IsDirty());
+
+	// marked for a partial sort, then the drawables before it are taken
+	sprites.back()->SetZ(0);
+	REQUIRE(list2.IsDirty());
+
+	list1.TakeFrom(list2, [](auto* d) { return d->IsShared(); });
+
+	REQUIRE_EQ(list2.size(), 8L);
+	REQUIRE(list2.IsDirty());
+
+	list2.Sort();
+	REQUIRE(list2.IsSorted());
+	REQUIRE_EQ(list2[0], sprites.back().get());
+	REQUIRE_EQ(list2[1], sprites.front().get());
+}
+
+TEST_CASE("TakeOtherList") {
+	DrawableList list1;
+	DrawableList list2;
+
+	TestSprite s1;
+	TestSprite s2;
+
+	list1.Append(&s1);
+	list2.Append(&s2);
+
+	REQUIRE_EQ(list1.Take(&s2), nullptr);
+	REQUIRE_EQ(list1.size(), 1L);
+	REQUIRE_EQ(list2.Take(&s2), &s2);
+	REQUIRE_EQ(list2.size(), 0L);
+
+	list2.Append(&s2);
+	REQUIRE_EQ(list2.size(), 1L);
+}
+
+TEST_CASE("DestroyList") {
+	TestSprite s1;
+
+	{
+		DrawableList list;
+		list.Append(&s1);
+	}
+
+	DrawableList list;
+	list.Append(&s1);
+	REQUIRE_EQ(list.Take(&s1), &s1);
+}
+
+TEST_CASE("SetZ") {
+	DrawableList default_list;
+	DrawableMgr::SetLocalList(&default_list);
+
+	DrawableList list;
+
+	TestSprite s1(1);
+	TestSprite s2(2);
+	TestSprite s3(3);
+	TestSprite s4(4);
+	TestSprite s5(5);
+
+	for (auto* s: { &s1, &s2, &s3, &s4, &s5 }) {
+		list.Append(s);
+	}
+
+	// the list the drawable is in gets dirty, not the local list
+	s4.SetZ(0);
+	REQUIRE(list.IsDirty());
+	REQUIRE_FALSE(default_list.IsDirty());
+
+	list.Sort();
+	REQUIRE_FALSE(list.IsDirty());
+	REQUIRE(list.IsSorted());
+	REQUIRE_EQ(list[0], &s4);
+	REQUIRE_EQ(list[1], &s1);
+
+	// same Z keeps the order
+	s1.SetZ(3);
+	list.Sort();
+	REQUIRE_EQ(list[1], &s2);
+	REQUIRE_EQ(list[2], &s1);
+	REQUIRE_EQ(list[3], &s3);
+
+	REQUIRE_EQ(list.Take(&s1), &s1);
+	REQUIRE_EQ(list.Take(&s4), &s4);
+	REQUIRE_EQ(list[0], &s2);
+	REQUIRE_EQ(list[1], &s3);
+	REQUIRE_EQ(list[2], &s5);
+}
+
+TEST_CASE("SetZSameAsStableSort") {
+	DrawableList default_list;
+	DrawableMgr::SetLocalList(&default_list);
+
+	constexpr int count = 1000;
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> z(0, 200);
+
+	DrawableList list;
+	std::vector<std::unique_ptr<TestSprite>> sprites;
+	for (int i = 0; i < count; ++i) {
+		sprites.push_back(std::make_unique<TestSprite>(z(rng)));
+		list.Append(sprites.back().get());
+	}
+	list.Sort();
+
+	for (int round = 0; round < 50; ++round) {
+		// a few moving characters, sometimes all of them
+		const int changes = round % 10 == 9 ? count : round % 8 + 1;
+		for (int i = 0; i < changes; ++i) {
+			auto& sprite = sprites[rng() % count];
+			sprite->SetZ(round % 2 ? z(rng) : sprite->GetZ() + 1);
+		}
+
+		std::vector<Drawable*> expected(list.begin(), list.end());
+		std::stable_sort(expected.begin(), expected.end(), [](auto* l, auto* r) { return l->GetZ() < r->GetZ(); });
+
+		list.Sort();
+		REQUIRE(std::equal(list.begin(), list.end(), expected.begin()));
+
+		// removal still finds every drawable after reordering
+		if (round % 5 == 0) {
+			auto* taken = list.Take(sprites[round].get());
+			REQUIRE_EQ(taken, sprites[round].get());
+			list.Append(taken);
+			list.Sort();
+		}
+	}
+}
+
 TEST_SUITE_END();
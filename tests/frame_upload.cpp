@@ -0,0 +1,158 @@
+#include "frame_upload.h"
+#include "doctest.h"
+#include <cstdint>
+#include <vector>
+
+TEST_SUITE_BEGIN("FrameUpload");
+
+namespace {
+
+constexpr int width = 8;
+constexpr int height = 16;
+
+struct Frame {
+	/** padded rows like a surface with a larger pitch */
+	static constexpr int pitch = width + 4;
+	std::vector<uint32_t> pixels = std::vector<uint32_t>(pitch * height);
+
+	void Set(int y, uint32_t v) { pixels[y * pitch + 1] = v; }
+	const void* data() const { return pixels.data(); }
+};
+
+FrameUpload::Rows Upload(FrameUpload& upload, int& buffer) {
+	FrameUpload::Rows rows;
+	buffer = upload.NextBuffer(rows);
+	return rows;
+}
+
+}
+
+TEST_CASE("FirstUploadIsFull") {
+	FrameUpload upload;
+	upload.Init(2, width, height, 4);
+	REQUIRE_EQ(upload.GetBuffers(), 2);
+	REQUIRE_EQ(upload.GetPitch(), width * 4);
+
+	Frame frame;
+	auto changed = upload.AddFrame(frame.data(), Frame::pitch * 4);
+	REQUIRE(changed.Empty());
+
+	int buffer;
+	auto rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 1);
+	REQUIRE_EQ(rows.top, 0);
+	REQUIRE_EQ(rows.bottom, height);
+}
+
+TEST_CASE("UnchangedFrameRepeats") {
+	FrameUpload upload;
+	upload.Init(2, width, height, 4);
+
+	Frame frame;
+	int buffer;
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 1);
+
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	auto rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 1);
+	REQUIRE(rows.Empty());
+}
+
+TEST_CASE("ChangedRows") {
+	FrameUpload upload;
+	upload.Init(2, width, height, 4);
+
+	Frame frame;
+	int buffer;
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	Upload(upload, buffer);
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	Upload(upload, buffer);
+
+	// buffer 0 was never uploaded
+	frame.Set(5, 1);
+	frame.Set(7, 1);
+	auto changed = upload.AddFrame(frame.data(), Frame::pitch * 4);
+	REQUIRE_EQ(changed.top, 5);
+	REQUIRE_EQ(changed.bottom, 8);
+	auto rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 0);
+	REQUIRE_EQ(rows.top, 0);
+	REQUIRE_EQ(rows.bottom, height);
+
+	// buffer 1 misses this and the previous change
+	frame.Set(2, 1);
+	changed = upload.AddFrame(frame.data(), Frame::pitch * 4);
+	REQUIRE_EQ(changed.top, 2);
+	REQUIRE_EQ(changed.bottom, 3);
+	rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 1);
+	REQUIRE_EQ(rows.top, 2);
+	REQUIRE_EQ(rows.bottom, 8);
+
+	// buffer 0 only misses the last change
+	frame.Set(12, 1);
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 0);
+	REQUIRE_EQ(rows.top, 2);
+	REQUIRE_EQ(rows.bottom, 13);
+
+	REQUIRE_EQ(upload.GetPixels()[12 * upload.GetPitch() + 4], 1);
+}
+
+TEST_CASE("SeveralFramesPerUpload") {
+	FrameUpload upload;
+	upload.Init(3, width, height, 4);
+
+	Frame frame;
+	int buffer;
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	Upload(upload, buffer);
+	Upload(upload, buffer);
+
+	frame.Set(3, 1);
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	frame.Set(9, 1);
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	auto rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 2);
+	REQUIRE_EQ(rows.top, 0);
+	REQUIRE_EQ(rows.bottom, height);
+
+	// buffer 0 was never uploaded
+	frame.Set(3, 2);
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 0);
+	REQUIRE_EQ(rows.top, 0);
+	REQUIRE_EQ(rows.bottom, height);
+
+	frame.Set(4, 1);
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 1);
+	REQUIRE_EQ(rows.top, 3);
+	REQUIRE_EQ(rows.bottom, 10);
+}
+
+TEST_CASE("Invalidate") {
+	FrameUpload upload;
+	upload.Init(2, width, height, 4);
+
+	Frame frame;
+	int buffer;
+	upload.AddFrame(frame.data(), Frame::pitch * 4);
+	Upload(upload, buffer);
+	Upload(upload, buffer);
+
+	upload.Invalidate();
+	auto rows = Upload(upload, buffer);
+	REQUIRE_EQ(buffer, 0);
+	REQUIRE_EQ(rows.top, 0);
+	REQUIRE_EQ(rows.bottom, height);
+}
+
+TEST_SUITE_END();
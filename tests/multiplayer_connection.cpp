@@ -0,0 +1,310 @@
+#include "multiplayer_connection.h"
+#include "doctest.h"
+#include <vector>
+
+TEST_SUITE_BEGIN("MultiplayerConnection");
+
+namespace {
+
+using Multiplayer::Connection;
+using Multiplayer::Packet;
+using Multiplayer::ParameterList;
+
+class TestConnection : public Connection {
+public:
+	void Open(std::string_view) override {}
+	void Send(std::string_view data) override { sent.emplace_back(data); }
+
+	std::vector<std::string> sent;
+};
+
+struct StatePacket : public Multiplayer::C2SPacket {
+	static constexpr bool coalesce = true;
+	StatePacket(int _v) : C2SPacket("st"), v(_v) {}
+	std::string ToBytes() const override { return Build(v); }
+	int v;
+};
+
+struct EventPacket : public Multiplayer::C2SPacket {
+	EventPacket(int _v) : C2SPacket("ev"), v(_v) {}
+	std::string ToBytes() const override { return Build(v); }
+	int v;
+};
+
+struct PicturePacket : public Multiplayer::C2SPacket {
+	static constexpr Multiplayer::PacketLane lane = Multiplayer::PacketLane::Picture;
+	static constexpr bool coalesce = true;
+	PicturePacket(int _id, int _x) : C2SPacket("mp"), id(_id), x(_x) {}
+	std::string ToBytes() const override { return Build(id, x); }
+	int GetCoalesceKey() const { return id; }
+	int id;
+	int x;
+};
+
+struct ShowPacket : public Multiplayer::C2SPacket {
+	static constexpr Multiplayer::PacketLane lane = Multiplayer::PacketLane::Picture;
+	ShowPacket(int _id) : C2SPacket("ap"), id(_id) {}
+	std::string ToBytes() const override { return Build(id); }
+	int id;
+};
+
+struct SoundPacket : public Multiplayer::C2SPacket {
+	static constexpr Multiplayer::PacketLane lane = Multiplayer::PacketLane::Sound;
+	SoundPacket() : C2SPacket("se") {}
+	std::string ToBytes() const override { return Build(1); }
+};
+
+struct TestPacket : public Multiplayer::S2CPacket {
+	TestPacket(const ParameterList& v) : id(Decode<int>(v.at(0))), name(v.at(1)) {}
+	int id;
+	std::string_view name;
+};
+
+std::string Join(std::initializer_list<std::string_view> l) {
+	std::string r;
+	for (auto& s : l) {
+		if (!r.empty())
+			r += Packet::PARAM_DELIM;
+		r += s;
+	}
+	return r;
+}
+
+}
+
+TEST_CASE("Split") {
+	auto msg = Join({"1", "", "abc"});
+	auto p = Connection::Split(msg);
+
+	REQUIRE_EQ(p.size(), 3);
+	REQUIRE_EQ(p[0], "1");
+	REQUIRE_EQ(p[1], "");
+	REQUIRE_EQ(p[2], "abc");
+	REQUIRE_THROWS_AS(p.at(3), std::out_of_range);
+}
+
+TEST_CASE("SplitOverflow") {
+	std::string msg = "x";
+	for (size_t i = 0; i < ParameterList::MAX_PARAMS + 5; ++i) {
+		msg += Packet::PARAM_DELIM;
+		msg += "x";
+	}
+	auto p = Connection::Split(msg);
+
+	REQUIRE_EQ(p.size(), ParameterList::MAX_PARAMS);
+}
+
+TEST_CASE("Dispatch") {
+	TestConnection conn;
+	int called_a = 0;
+	int called_b = 0;
+	std::string name;
+
+	conn.RegisterHandler<TestPacket>("b", [&] (TestPacket& p) {
+		++called_b;
+		name = std::string(p.name);
+	});
+	conn.RegisterHandler<TestPacket>("a", [&] (TestPacket& p) { ++called_a; });
+
+	conn.DispatchMessage(Join({"b", "4", "nick"}));
+	REQUIRE_EQ(called_a, 0);
+	REQUIRE_EQ(called_b, 1);
+	REQUIRE_EQ(name, "nick");
+
+	conn.DispatchMessage(Join({"a", "1", "x"}));
+	REQUIRE_EQ(called_a, 1);
+
+	// unknown packets and decoding errors are dropped
+	conn.DispatchMessage(Join({"c", "1", "x"}));
+	conn.DispatchMessage(Join({"a", "zz", "x"}));
+	conn.DispatchMessage(Join({"a", "1"}));
+	REQUIRE_EQ(called_a, 1);
+	REQUIRE_EQ(called_b, 1);
+}
+
+TEST_CASE("BinaryEncoding") {
+	auto text = Join({"m", "5", "-3", "abc", "007"});
+	auto bin = Multiplayer::C2SPacket::TextToBinary(text);
+
+	REQUIRE_EQ(bin, std::string("\x04\x04\x14\x0a\x07" "abc" "\x07" "007", 12));
+
+	std::string_view msg = bin;
+	std::string_view name;
+	ParameterList params;
+	Multiplayer::S2CPacket::BinaryScratch scratch;
+	Multiplayer::S2CPacket::DecodeBinary(msg, name, params, scratch);
+
+	REQUIRE(msg.empty());
+	REQUIRE_EQ(name, "m");
+	REQUIRE_EQ(params.size(), 4);
+	REQUIRE_EQ(params[0], "5");
+	REQUIRE_EQ(params[1], "-3");
+	REQUIRE_EQ(params[2], "abc");
+	REQUIRE_EQ(params[3], "007");
+}
+
+TEST_CASE("BinaryDispatch") {
+	TestConnection conn;
+	std::vector<std::string> names;
+	conn.RegisterHandler<TestPacket>("name", [&] (TestPacket& p) {
+		names.emplace_back(p.name);
+	});
+
+	std::string msg(1, Packet::BINARY_MARKER);
+	msg += Multiplayer::C2SPacket::TextToBinary(Join({"name", "1", "alice"}));
+	msg += Multiplayer::C2SPacket::TextToBinary(Join({"name", "2", "12"}));
+	conn.DispatchBinary(msg);
+
+	REQUIRE_EQ(names.size(), 2);
+	REQUIRE_EQ(names[0], "alice");
+	REQUIRE_EQ(names[1], "12");
+
+	// truncated messages are dropped
+	msg.pop_back();
+	conn.DispatchBinary(msg);
+	REQUIRE_EQ(names.size(), 3);
+}
+
+TEST_CASE("QueueCoalescing") {
+	TestConnection conn;
+	conn.SendPacketAsync<StatePacket>(1);
+	conn.SendPacketAsync<StatePacket>(2);
+	conn.SendPacketAsync<EventPacket>(3);
+	conn.SendPacketAsync<StatePacket>(4);
+	conn.SendPacketAsync<StatePacket>(5);
+	conn.SendPacketAsync<EventPacket>(6);
+	conn.SendPacketAsync<EventPacket>(7);
+	conn.FlushQueue();
+
+	// state is replaced up to the next event, events are never dropped
+	std::vector<std::string> expected {
+		Join({"st", "2"}), Join({"ev", "3"}), Join({"st", "5"}),
+		Join({"ev", "6"}), Join({"ev", "7"})
+	};
+	REQUIRE_EQ(conn.sent, expected);
+
+	// sent packets are not replaced anymore
+	conn.sent.clear();
+	conn.SendPacketAsync<StatePacket>(8);
+	conn.FlushQueue();
+	conn.SendPacketAsync<StatePacket>(9);
+	conn.FlushQueue();
+	REQUIRE_EQ(conn.sent.size(), 2);
+}
+
+TEST_CASE("QueueOverflow") {
+	TestConnection conn;
+	const int n = Multiplayer::PacketQueue::CAPACITY * 2 + 3;
+	for (int i = 0; i < n; ++i)
+		conn.SendPacketAsync<EventPacket>(i);
+
+	// a full queue is flushed early
+	REQUIRE_EQ(conn.sent.size(), Multiplayer::PacketQueue::CAPACITY * 2);
+	conn.FlushQueue();
+	REQUIRE_EQ(conn.sent.size(), n);
+	for (int i = 0; i < n; ++i)
+		REQUIRE_EQ(conn.sent[i], Join({"ev", std::to_string(i)}));
+}
+
+TEST_CASE("TokenBucket") {
+	using namespace std::chrono_literals;
+	Multiplayer::TokenBucket bucket;
+	Game_Clock::time_point t;
+
+	// unlimited by default
+	for (int i = 0; i < 100; ++i)
+		REQUIRE(bucket.Take(t));
+
+	bucket.SetRate(10, 2);
+	REQUIRE(bucket.Take(t));
+	REQUIRE(bucket.Take(t));
+	REQUIRE_FALSE(bucket.Take(t));
+
+	REQUIRE(bucket.Take(t + 100ms));
+	REQUIRE_FALSE(bucket.Take(t + 100ms));
+
+	// refills up to the burst only
+	REQUIRE(bucket.Take(t + 10s));
+	REQUIRE(bucket.Take(t + 10s));
+	REQUIRE_FALSE(bucket.Take(t + 10s));
+
+	// forced tokens are paid back
+	bucket.Force(t + 10s);
+	REQUIRE_FALSE(bucket.Take(t + 10s + 100ms));
+	REQUIRE(bucket.Take(t + 10s + 200ms));
+}
+
+TEST_CASE("PictureBudget") {
+	using namespace std::chrono_literals;
+	Game_Clock::time_point t;
+	Game_Clock::ResetFrame(t);
+	TestConnection conn;
+	// burst of one picture
+	conn.SetBudget(Multiplayer::PacketLane::Picture, 1);
+
+	conn.SendPacketAsync<StatePacket>(1);
+	for (int x = 0; x < 10; ++x) {
+		conn.SendPacketAsync<PicturePacket>(1, x);
+		conn.SendPacketAsync<PicturePacket>(2, x);
+	}
+	REQUIRE_EQ(conn.GetOutboundStats().deferred, 2);
+	REQUIRE_EQ(conn.GetOutboundStats().coalesced, 18);
+
+	// state goes out first, then the final target of the first picture
+	conn.FlushQueue();
+	REQUIRE_EQ(conn.sent.size(), 2);
+	REQUIRE_EQ(conn.sent[0], StatePacket(1).ToBytes());
+	REQUIRE_EQ(conn.sent[1], PicturePacket(1, 9).ToBytes());
+	REQUIRE_EQ(conn.GetOutboundStats().deferred, 1);
+
+	// no new token within the same second
+	Game_Clock::ResetFrame(t + 500ms);
+	conn.FlushQueue();
+	REQUIRE_EQ(conn.sent.size(), 2);
+
+	Game_Clock::ResetFrame(t + 1s);
+	conn.SendPacketAsync<PicturePacket>(2, 20);
+	conn.FlushQueue();
+	REQUIRE_EQ(conn.sent.size(), 3);
+	REQUIRE_EQ(conn.sent[2], PicturePacket(2, 20).ToBytes());
+
+	// without a limit pictures skip the deferred queue
+	conn.SetBudget(Multiplayer::PacketLane::Picture, 0);
+	conn.SendPacketAsync<ShowPacket>(3);
+	conn.FlushQueue();
+	conn.SendPacketAsync<PicturePacket>(1, 30);
+	REQUIRE_EQ(conn.GetOutboundStats().deferred, 0);
+	conn.FlushQueue();
+	REQUIRE_EQ(conn.sent.size(), 5);
+	REQUIRE_EQ(conn.sent[3], ShowPacket(3).ToBytes());
+	REQUIRE_EQ(conn.sent[4], PicturePacket(1, 30).ToBytes());
+}
+
+TEST_CASE("PictureBudgetOverflow") {
+	TestConnection conn;
+	conn.SetBudget(Multiplayer::PacketLane::Picture, 1);
+
+	// events can not be coalesced, the oldest ones are sent when full
+	const int n = Multiplayer::PacketQueue::CAPACITY + 10;
+	for (int i = 0; i < n; ++i) {
+		conn.SendPacketAsync<ShowPacket>(i);
+	}
+	REQUIRE_EQ(conn.sent.size(), 10);
+	REQUIRE_EQ(conn.sent[0], ShowPacket(0).ToBytes());
+	REQUIRE_EQ(conn.GetOutboundStats().deferred, Multiplayer::PacketQueue::CAPACITY);
+}
+
+TEST_CASE("SoundBudget") {
+	TestConnection conn;
+	conn.SetBudget(Multiplayer::PacketLane::Sound, 8);
+
+	// burst of two sounds
+	for (int i = 0; i < 5; ++i) {
+		conn.SendPacketAsync<SoundPacket>();
+	}
+	conn.FlushQueue();
+	REQUIRE_EQ(conn.sent.size(), 2);
+	REQUIRE_EQ(conn.GetOutboundStats().dropped, 3);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,101 @@
+#include "multiplayer_jitter_buffer.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("MultiplayerJitterBuffer");
+
+namespace {
+
+using Multiplayer::JitterBuffer;
+using ms = std::chrono::milliseconds;
+
+JitterBuffer MakeBuffer() {
+	JitterBuffer b;
+	b.SetTargetLatency(ms(100));
+	b.SetMaxLag(ms(500));
+	return b;
+}
+
+}
+
+TEST_CASE("Latency") {
+	auto b = MakeBuffer();
+	JitterBuffer::time_point t0;
+
+	b.Push(1, 2, t0, ms(200));
+	REQUIRE_FALSE(b.Update(t0 + ms(99)).started);
+
+	auto s = b.Update(t0 + ms(100));
+	REQUIRE(s.started);
+	REQUIRE_FALSE(s.skipped);
+	REQUIRE_EQ(s.x, 1);
+	REQUIRE_EQ(s.y, 2);
+	REQUIRE_EQ(s.remaining, JitterBuffer::STEP_SIZE);
+
+	s = b.Update(t0 + ms(200));
+	REQUIRE_FALSE(s.started);
+	REQUIRE_EQ(s.remaining, JitterBuffer::STEP_SIZE / 2);
+
+	s = b.Update(t0 + ms(300));
+	REQUIRE_EQ(s.remaining, 0);
+	REQUIRE(b.empty());
+}
+
+TEST_CASE("Burst") {
+	auto b = MakeBuffer();
+	JitterBuffer::time_point t0;
+
+	// moves arriving at once are played back at walking pace
+	b.Push(1, 0, t0, ms(100));
+	b.Push(2, 0, t0, ms(100));
+	b.Push(3, 0, t0, ms(100));
+	REQUIRE_EQ(b.GetBacklog(t0), ms(300));
+
+	REQUIRE_EQ(b.Update(t0 + ms(100)).x, 1);
+	REQUIRE_FALSE(b.Update(t0 + ms(150)).started);
+	auto s = b.Update(t0 + ms(200));
+	REQUIRE(s.started);
+	REQUIRE_EQ(s.x, 2);
+	s = b.Update(t0 + ms(300));
+	REQUIRE(s.started);
+	REQUIRE_EQ(s.x, 3);
+	REQUIRE_EQ(b.GetSkipCount(), 0);
+}
+
+TEST_CASE("SkipAhead") {
+	auto b = MakeBuffer();
+	JitterBuffer::time_point t0;
+
+	for (int i = 0; i < 6; ++i)
+		b.Push(i, 0, t0, ms(100));
+	REQUIRE_EQ(b.size(), 6);
+
+	// would be scheduled 700ms ahead, more than latency + max lag
+	b.Push(6, 0, t0, ms(100));
+	REQUIRE_EQ(b.size(), 1);
+	REQUIRE_EQ(b.GetSkipCount(), 6);
+
+	auto s = b.Update(t0);
+	REQUIRE(s.started);
+	REQUIRE(s.skipped);
+	REQUIRE_EQ(s.x, 6);
+}
+
+TEST_CASE("Stall") {
+	auto b = MakeBuffer();
+	JitterBuffer::time_point t0;
+
+	b.Push(1, 0, t0, ms(100));
+	b.Push(2, 0, t0, ms(100));
+
+	// after a stall the moves are caught up one per update
+	auto s = b.Update(t0 + ms(400));
+	REQUIRE(s.started);
+	REQUIRE_EQ(s.x, 1);
+	REQUIRE_EQ(s.remaining, 0);
+	s = b.Update(t0 + ms(400));
+	REQUIRE(s.started);
+	REQUIRE_EQ(s.x, 2);
+	REQUIRE_FALSE(b.Update(t0 + ms(400)).started);
+}
+
+TEST_SUITE_END();
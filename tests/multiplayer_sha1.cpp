@@ -0,0 +1,123 @@
+#include "multiplayer_sha1.h"
+#include "yno_message_signer.h"
+#include "TinySHA1.hpp"
+#include "doctest.h"
+#include <cstdio>
+#include <string>
+
+TEST_SUITE_BEGIN("MultiplayerSha1");
+
+namespace {
+
+using Multiplayer::Sha1;
+
+std::string Hex(const Sha1::Digest d) {
+	char buf[41];
+	for (int i = 0; i < 5; ++i)
+		snprintf(buf + i * 8, 9, "%08x", d[i]);
+	return buf;
+}
+
+std::string Hash(std::string_view msg) {
+	Sha1 sha;
+	sha.Update(msg);
+	Sha1::Digest d;
+	sha.Final(d);
+	return Hex(d);
+}
+
+std::string Pattern(size_t len) {
+	std::string r;
+	for (size_t i = 0; i < len; ++i)
+		r += static_cast<char>((i * 131 + 7) & 0xFF);
+	return r;
+}
+
+/** The header as it was built before the signer existed */
+std::string ReferenceHeader(std::string_view key, std::string_view secret, size_t count, std::string_view msg) {
+	char counter[7];
+	snprintf(counter, 7, "%06zu", count);
+
+	std::string hashmsg{key};
+	hashmsg += secret;
+	hashmsg += counter;
+	hashmsg += msg;
+
+	sha1::SHA1 digest;
+	uint32_t digest_result[5];
+	digest.processBytes(hashmsg.data(), hashmsg.size());
+	digest.getDigest(digest_result);
+
+	char signature[9];
+	snprintf(signature, 9, "%08x", digest_result[0]);
+
+	std::string r{signature};
+	r += counter;
+	return r;
+}
+
+}
+
+TEST_CASE("Vectors") {
+	const auto kernel = Sha1::GetKernel();
+	for (auto k : { Sha1::Kernel::Scalar, Sha1::Kernel::ShaNi }) {
+		if (!Sha1::IsSupported(k))
+			continue;
+		Sha1::SetKernel(k);
+
+		REQUIRE_EQ(Hash(""), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+		REQUIRE_EQ(Hash("abc"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+		REQUIRE_EQ(Hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+			"84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+		REQUIRE_EQ(Hash(std::string(1000000, 'a')), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	}
+	Sha1::SetKernel(kernel);
+}
+
+TEST_CASE("KernelsMatch") {
+	if (!Sha1::IsSupported(Sha1::Kernel::ShaNi))
+		return;
+
+	auto scalar = Sha1::GetCompressFn(Sha1::Kernel::Scalar);
+	auto accel = Sha1::GetCompressFn(Sha1::Kernel::ShaNi);
+	auto data = Pattern(64 * 7);
+	uint32_t a[5] = { 1, 2, 3, 4, 5 };
+	uint32_t b[5] = { 1, 2, 3, 4, 5 };
+	for (size_t n = 1; n <= 7; ++n) {
+		scalar(a, reinterpret_cast<const uint8_t*>(data.data()), n);
+		accel(b, reinterpret_cast<const uint8_t*>(data.data()), n);
+		for (int i = 0; i < 5; ++i)
+			REQUIRE_EQ(a[i], b[i]);
+	}
+}
+
+TEST_CASE("Incremental") {
+	auto data = Pattern(300);
+	auto whole = Hash(data);
+	// every split point, crossing block boundaries
+	for (size_t split = 0; split <= data.size(); split += 7) {
+		Sha1 sha;
+		sha.Update(data.data(), split);
+		sha.Update(data.data() + split, data.size() - split);
+		Sha1::Digest d;
+		sha.Final(d);
+		REQUIRE_EQ(Hex(d), whole);
+	}
+}
+
+TEST_CASE("Signer") {
+	YNO::MessageSigner signer;
+	signer.SetKey("key1234", "secret");
+
+	for (size_t len : { 0, 1, 40, 49, 50, 57, 64, 200, 1000 }) {
+		auto msg = Pattern(len);
+		for (size_t count : { 1, 42, 999999, 1000000, 12345678 }) {
+			std::string header;
+			signer.AppendHeader(header, count, msg);
+			REQUIRE_EQ(header.size(), YNO::MessageSigner::HEADER_SIZE);
+			REQUIRE_EQ(header, ReferenceHeader("key1234", "secret", count, msg));
+		}
+	}
+}
+
+TEST_SUITE_END();
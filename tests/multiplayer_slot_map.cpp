@@ -0,0 +1,91 @@
+#include "multiplayer_slot_map.h"
+#include "doctest.h"
+#include <map>
+#include <random>
+
+TEST_SUITE_BEGIN("MultiplayerSlotMap");
+
+namespace {
+
+struct Entry {
+	int value = 0;
+};
+
+}
+
+TEST_CASE("InsertFind") {
+	Multiplayer::SlotMap<Entry> m;
+	bool reused;
+
+	REQUIRE(m.Find(1) == nullptr);
+	m.Insert(1, reused).value = 10;
+	REQUIRE_FALSE(reused);
+	m.Insert(7, reused).value = 70;
+	m.Insert(-3, reused).value = -30;
+
+	REQUIRE_EQ(m.size(), 3);
+	REQUIRE_EQ(m.Find(1)->value, 10);
+	REQUIRE_EQ(m.Find(7)->value, 70);
+	REQUIRE_EQ(m.Find(-3)->value, -30);
+	REQUIRE(m.Find(2) == nullptr);
+}
+
+TEST_CASE("Recycle") {
+	Multiplayer::SlotMap<Entry> m;
+	bool reused;
+
+	auto* a = &m.Insert(1, reused);
+	a->value = 5;
+	REQUIRE_EQ(m.Detach(1), a);
+	REQUIRE(m.Find(1) == nullptr);
+	REQUIRE(m.Detach(1) == nullptr);
+	REQUIRE_EQ(m.GetPooledCount(), 0);
+
+	m.Recycle(a);
+	REQUIRE_EQ(m.GetPooledCount(), 1);
+
+	// the object and its old state come back
+	auto* b = &m.Insert(2, reused);
+	REQUIRE(reused);
+	REQUIRE_EQ(b, a);
+	REQUIRE_EQ(b->value, 5);
+	REQUIRE_EQ(m.Find(2), a);
+}
+
+TEST_CASE("Churn") {
+	Multiplayer::SlotMap<Entry> m;
+	std::map<int, Entry*> ref;
+	std::mt19937 rng(1234);
+	bool reused;
+
+	for (int i = 0; i < 20000; ++i) {
+		int id = rng() % 300;
+		if (ref.count(id)) {
+			auto* e = m.Detach(id);
+			REQUIRE_EQ(e, ref[id]);
+			m.Recycle(e);
+			ref.erase(id);
+		} else {
+			auto& e = m.Insert(id, reused);
+			e.value = id;
+			ref[id] = &e;
+		}
+	}
+
+	REQUIRE_EQ(m.size(), ref.size());
+	for (auto& r : ref) {
+		REQUIRE_EQ(m.Find(r.first), r.second);
+		REQUIRE_EQ(r.second->value, r.first);
+	}
+	// every object was created once and is either used or pooled
+	REQUIRE_LE(m.size() + m.GetPooledCount(), 300);
+
+	size_t n = 0;
+	for (auto& p : m) {
+		REQUIRE_EQ(ref[p.first], p.second);
+		++n;
+	}
+	REQUIRE_EQ(n, ref.size());
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,60 @@
+#include "multiplayer_spatial_grid.h"
+#include "doctest.h"
+#include <algorithm>
+#include <vector>
+
+TEST_SUITE_BEGIN("MultiplayerSpatialGrid");
+
+namespace {
+
+using Multiplayer::SpatialGrid;
+
+std::vector<int> Query(const SpatialGrid& g, int x, int y, int w, int h) {
+	std::vector<int> r;
+	g.Query(x, y, w, h, [&] (int id) { r.push_back(id); });
+	std::sort(r.begin(), r.end());
+	return r;
+}
+
+}
+
+TEST_CASE("Query") {
+	SpatialGrid g;
+	g.Reset(50, 40, false, false);
+	g.Insert(1, 0, 0);
+	g.Insert(2, 10, 10);
+	g.Insert(3, 17, 10);
+	g.Insert(4, 49, 39);
+	g.Build();
+
+	REQUIRE_EQ(Query(g, 0, 0, 50, 40), std::vector<int>{1, 2, 3, 4});
+	REQUIRE_EQ(Query(g, 10, 10, 8, 1), std::vector<int>{2, 3});
+	REQUIRE_EQ(Query(g, 11, 0, 6, 40), std::vector<int>{});
+	REQUIRE_EQ(Query(g, -5, -5, 6, 6), std::vector<int>{1});
+	// no wrap around on non looping maps
+	REQUIRE_EQ(Query(g, 45, 35, 10, 10), std::vector<int>{4});
+}
+
+TEST_CASE("QueryLoop") {
+	SpatialGrid g;
+	g.Reset(20, 20, true, false);
+	g.Insert(1, 0, 5);
+	g.Insert(2, 19, 5);
+	g.Insert(3, 10, 5);
+	g.Build();
+
+	REQUIRE_EQ(Query(g, 18, 0, 4, 10), std::vector<int>{1, 2});
+	REQUIRE_EQ(Query(g, -2, 0, 3, 10), std::vector<int>{1, 2});
+	REQUIRE_EQ(Query(g, -30, 0, 100, 10), std::vector<int>{1, 2, 3});
+	REQUIRE_EQ(Query(g, 18, 5, 4, 1), std::vector<int>{1, 2});
+	REQUIRE_EQ(Query(g, 0, 19, 20, 4), std::vector<int>{});
+}
+
+TEST_CASE("Delta") {
+	REQUIRE_EQ(SpatialGrid::Delta(1, 19, 20, false), 18);
+	REQUIRE_EQ(SpatialGrid::Delta(1, 19, 20, true), -2);
+	REQUIRE_EQ(SpatialGrid::Delta(19, 1, 20, true), 2);
+	REQUIRE_EQ(SpatialGrid::Delta(5, 8, 20, true), 3);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,127 @@
+#include "multiplayer_traffic_monitor.h"
+#include "multiplayer_connection.h"
+#include "doctest.h"
+#include <string>
+
+TEST_SUITE_BEGIN("MultiplayerTrafficMonitor");
+
+namespace {
+
+using Multiplayer::Packet;
+using Multiplayer::ParameterList;
+using Multiplayer::TrafficMonitor;
+using namespace std::chrono_literals;
+
+class TestConnection : public Multiplayer::Connection {
+public:
+	void Open(std::string_view) override {}
+	void Send(std::string_view data) override { NotifySent(data.size()); }
+};
+
+struct TestPacket : public Multiplayer::S2CPacket {
+	TestPacket(const ParameterList& v) : id(Decode<int>(v.at(0))) {}
+	int id;
+};
+
+struct EventPacket : public Multiplayer::C2SPacket {
+	EventPacket(int _v) : C2SPacket("ev"), v(_v) {}
+	std::string ToBytes() const override { return Build(v); }
+	int v;
+};
+
+class DropMonitor : public ConnectionMonitor {
+public:
+	Action OnReceive(std::string_view name, const Multiplayer::S2CPacket&) override {
+		return name == "b" ? Action::DROP : Action::NONE;
+	}
+};
+
+std::string Msg(std::string_view name, std::string_view id) {
+	std::string r(name);
+	r += Packet::PARAM_DELIM;
+	r += id;
+	return r;
+}
+
+}
+
+TEST_CASE("Counters") {
+	DropMonitor drop;
+	TrafficMonitor traffic(&drop);
+	TestConnection conn;
+	conn.SetMonitor(&traffic);
+
+	int handled = 0;
+	conn.RegisterHandler<TestPacket>("a", [&] (TestPacket&) { ++handled; });
+	conn.RegisterHandler<TestPacket>("b", [&] (TestPacket&) { ++handled; });
+
+	Game_Clock::time_point t;
+	traffic.Update(t);
+
+	conn.DispatchMessage(Msg("a", "1"));
+	conn.DispatchMessage(Msg("a", "2"));
+	conn.DispatchMessage(Msg("b", "3"));
+	REQUIRE_EQ(handled, 2);
+
+	conn.SendPacketAsync<EventPacket>(1);
+	conn.SendPacketAsync<EventPacket>(2);
+	conn.FlushQueue();
+	// empty flushes are not counted
+	conn.FlushQueue();
+
+	// the interval is not complete yet
+	REQUIRE_FALSE(traffic.Update(t + 500ms));
+	REQUIRE_EQ(traffic.GetLastInterval().messages_in, 0);
+
+	REQUIRE(traffic.Update(t + 1s));
+	auto& s = traffic.GetLastInterval();
+	REQUIRE_EQ(s.messages_in, 3);
+	REQUIRE_EQ(s.bytes_in, 3 * Msg("a", "1").size());
+	REQUIRE_EQ(s.messages_out, 2);
+	REQUIRE_EQ(s.bytes_out, 2 * Msg("ev", "1").size());
+	REQUIRE_EQ(s.flushes, 1);
+	REQUIRE_EQ(s.max_queue, 2);
+
+	REQUIRE_EQ(s.packets.size(), 2);
+	REQUIRE_EQ(s.packets[0].first, "a");
+	REQUIRE_EQ(s.packets[0].second.count, 2);
+	REQUIRE_EQ(s.packets[0].second.dropped, 0);
+	REQUIRE_EQ(s.packets[1].first, "b");
+	REQUIRE_EQ(s.packets[1].second.count, 1);
+	REQUIRE_EQ(s.packets[1].second.dropped, 1);
+
+	// nothing happened in the next interval
+	REQUIRE(traffic.Update(t + 2s));
+	REQUIRE_EQ(traffic.GetLastInterval().messages_in, 0);
+}
+
+TEST_CASE("Reconnects") {
+	TrafficMonitor traffic;
+	traffic.OnOpen();
+	traffic.OnClose();
+	traffic.OnOpen();
+	traffic.OnOpen();
+
+	Game_Clock::time_point t;
+	traffic.Update(t);
+	traffic.Update(t + 1s);
+	auto& s = traffic.GetLastInterval();
+	REQUIRE_EQ(s.opens, 3);
+	REQUIRE_EQ(s.closes, 1);
+	REQUIRE_EQ(s.reconnects, 1);
+}
+
+TEST_CASE("Json") {
+	TrafficMonitor::Stats s;
+	s.bytes_in = 100;
+	s.Packet("m").count = 4;
+	s.Packet("m").dropped = 1;
+	s.Packet("x");
+
+	REQUIRE_EQ(TrafficMonitor::ToJson(s, 2),
+		"{\"seconds\":2,\"bytes_in\":100,\"bytes_out\":0,\"messages_in\":0,\"messages_out\":0,"
+		"\"flushes\":0,\"queued\":0,\"max_queue\":0,\"opens\":0,\"reconnects\":0,\"closes\":0,"
+		"\"packets\":{\"m\":{\"count\":4,\"dropped\":1,\"decode_us\":0,\"handle_us\":0}}}");
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,404 @@
+#ifndef EMSCRIPTEN
+
+#include "multiplayer_websocket.h"
+#include "doctest.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+TEST_SUITE_BEGIN("MultiplayerWebSocket");
+
+namespace {
+
+using Multiplayer::WebSocketClient;
+
+constexpr uint8_t OP_CONTINUATION = 0x0;
+constexpr uint8_t OP_TEXT = 0x1;
+constexpr uint8_t OP_BINARY = 0x2;
+constexpr uint8_t OP_PING = 0x9;
+constexpr uint8_t OP_PONG = 0xA;
+
+std::string Base64(std::string_view s) {
+	return WebSocketClient::Base64Encode(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+}
+
+struct Message {
+	std::string data;
+	bool is_text;
+};
+
+struct Frame {
+	bool fin = false;
+	uint8_t opcode = 0;
+	bool masked = false;
+	/** length field of the second header byte, 126 and 127 select the extended forms */
+	int len_field = 0;
+	std::string payload;
+};
+
+// Unmasked server side frame
+std::string MakeFrame(uint8_t opcode, bool fin, std::string_view payload) {
+	std::string f;
+	f += static_cast<char>((fin ? 0x80 : 0) | opcode);
+	const uint64_t len = payload.size();
+	if (len < 126) {
+		f += static_cast<char>(len);
+	} else if (len <= 0xFFFF) {
+		f += static_cast<char>(126);
+		f += static_cast<char>(len >> 8);
+		f += static_cast<char>(len & 0xFF);
+	} else {
+		f += static_cast<char>(127);
+		for (int i = 7; i >= 0; --i) {
+			f += static_cast<char>((len >> (i * 8)) & 0xFF);
+		}
+	}
+	f.append(payload.data(), payload.size());
+	return f;
+}
+
+// A server on the loopback interface, driven from the test thread
+class TestServer {
+public:
+	TestServer() {
+		listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+		listen(listen_fd, 1);
+		socklen_t len = sizeof(addr);
+		getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+		port = ntohs(addr.sin_port);
+	}
+
+	~TestServer() {
+		if (fd >= 0) {
+			close(fd);
+		}
+		close(listen_fd);
+	}
+
+	std::string Uri() const {
+		return "ws://127.0.0.1:" + std::to_string(port) + "/1";
+	}
+
+	/** Accepts the client and reads its upgrade request. */
+	std::string Accept(WebSocketClient& client) {
+		client.Connect(Uri());
+		fd = accept(listen_fd, nullptr, nullptr);
+		timeval tv{ 2, 0 };
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+		std::string request;
+		for (int i = 0; i < 1000 && request.find("\r\n\r\n") == std::string::npos; ++i) {
+			client.Poll();
+			char buf[1024];
+			ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+			if (n > 0) {
+				request.append(buf, n);
+			} else {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		return request;
+	}
+
+	/** Accepts the client and completes the handshake. */
+	void Open(WebSocketClient& client) {
+		auto request = Accept(client);
+		constexpr std::string_view key_hdr = "Sec-WebSocket-Key: ";
+		auto pos = request.find(key_hdr);
+		REQUIRE_NE(pos, std::string::npos);
+		pos += key_hdr.size();
+		auto key = request.substr(pos, request.find("\r\n", pos) - pos);
+		Write("HTTP/1.1 101 Switching Protocols\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Accept: " + WebSocketClient::ComputeAccept(key) + "\r\n\r\n");
+	}
+
+	void Write(std::string_view data) {
+		send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+	}
+
+	void WriteFrame(uint8_t opcode, bool fin, std::string_view payload) {
+		Write(MakeFrame(opcode, fin, payload));
+	}
+
+	/** Reads and unmasks a client frame. */
+	Frame ReadFrame() {
+		Frame frame;
+		auto hdr = Read(2);
+		frame.fin = hdr[0] & 0x80;
+		frame.opcode = hdr[0] & 0x0F;
+		frame.masked = hdr[1] & 0x80;
+		frame.len_field = hdr[1] & 0x7F;
+		uint64_t len = frame.len_field;
+		if (len == 126 || len == 127) {
+			auto ext = Read(len == 126 ? 2 : 8);
+			len = 0;
+			for (auto c: ext) {
+				len = (len << 8) | static_cast<uint8_t>(c);
+			}
+		}
+		std::string mask = frame.masked ? Read(4) : std::string(4, '\0');
+		frame.payload = Read(len);
+		for (size_t i = 0; i < frame.payload.size(); ++i) {
+			frame.payload[i] ^= mask[i & 3];
+		}
+		return frame;
+	}
+
+private:
+	std::string Read(size_t len) {
+		std::string r;
+		while (r.size() < len) {
+			char buf[4096];
+			ssize_t n = recv(fd, buf, std::min(sizeof(buf), len - r.size()), 0);
+			if (n <= 0) {
+				break;
+			}
+			r.append(buf, n);
+		}
+		return r;
+	}
+
+	int listen_fd = -1;
+	int fd = -1;
+	int port = 0;
+};
+
+struct TestClient {
+	WebSocketClient ws;
+	std::vector<Message> messages;
+	bool opened = false;
+	bool closed = false;
+
+	TestClient() {
+		ws.SetOpenHandler([this]() { opened = true; });
+		ws.SetCloseHandler([this]() { closed = true; });
+		ws.SetMessageHandler([this](std::string_view data, bool is_text) {
+			messages.push_back({ std::string(data), is_text });
+		});
+	}
+
+	/** Polls until the predicate holds or a second passed. */
+	template <typename F>
+	bool PollUntil(F&& done) {
+		for (int i = 0; i < 1000; ++i) {
+			ws.Poll();
+			if (done()) {
+				return true;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return false;
+	}
+
+	bool PollMessages(size_t count) {
+		return PollUntil([&]() { return messages.size() >= count || closed; }) && messages.size() >= count;
+	}
+
+	bool PollClosed() {
+		return PollUntil([&]() { return closed; });
+	}
+};
+
+}
+
+TEST_CASE("Base64") {
+	// RFC 4648 test vectors, covering both padding forms
+	REQUIRE_EQ(Base64(""), "");
+	REQUIRE_EQ(Base64("f"), "Zg==");
+	REQUIRE_EQ(Base64("fo"), "Zm8=");
+	REQUIRE_EQ(Base64("foo"), "Zm9v");
+	REQUIRE_EQ(Base64("foob"), "Zm9vYg==");
+	REQUIRE_EQ(Base64("fooba"), "Zm9vYmE=");
+	REQUIRE_EQ(Base64("foobar"), "Zm9vYmFy");
+	REQUIRE_EQ(Base64("\xff\xfe\xfd"), "//79");
+}
+
+TEST_CASE("AcceptKey") {
+	// Example of RFC 6455 section 1.3
+	REQUIRE_EQ(WebSocketClient::ComputeAccept("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST_CASE("Handshake") {
+	TestServer server;
+	TestClient client;
+
+	auto request = server.Accept(client.ws);
+	REQUIRE_EQ(request.rfind("GET /1 HTTP/1.1\r\n", 0), 0);
+	REQUIRE_NE(request.find("Upgrade: websocket\r\n"), std::string::npos);
+	REQUIRE_NE(request.find("Sec-WebSocket-Version: 13\r\n"), std::string::npos);
+	REQUIRE_EQ(client.ws.GetState(), WebSocketClient::State::HANDSHAKE);
+
+	// The key is a base64 encoded 16 byte nonce
+	auto pos = request.find("Sec-WebSocket-Key: ");
+	REQUIRE_NE(pos, std::string::npos);
+	auto key = request.substr(pos + 19, request.find("\r\n", pos) - pos - 19);
+	REQUIRE_EQ(key.size(), 24);
+	REQUIRE_EQ(key.substr(22), "==");
+
+	server.Write("HTTP/1.1 101 Switching Protocols\r\n"
+		"sec-websocket-accept: " + WebSocketClient::ComputeAccept(key) + "\r\n\r\n");
+	REQUIRE(client.PollUntil([&]() { return client.opened; }));
+	REQUIRE(client.ws.IsOpen());
+	REQUIRE_FALSE(client.closed);
+}
+
+TEST_CASE("HandshakeBadAccept") {
+	TestServer server;
+	TestClient client;
+
+	server.Accept(client.ws);
+	server.Write("HTTP/1.1 101 Switching Protocols\r\n"
+		"Sec-WebSocket-Accept: " + WebSocketClient::ComputeAccept("wrong") + "\r\n\r\n");
+	REQUIRE(client.PollClosed());
+	REQUIRE_FALSE(client.opened);
+	REQUIRE_EQ(client.ws.GetState(), WebSocketClient::State::CLOSED);
+}
+
+TEST_CASE("ClientFrames") {
+	TestServer server;
+	TestClient client;
+	server.Open(client.ws);
+	REQUIRE(client.PollUntil([&]() { return client.opened; }));
+
+	// Every length form, client frames are always masked
+	const std::vector<std::pair<size_t, int>> sizes = { { 0, 0 }, { 125, 125 }, { 126, 126 }, { 65535, 126 }, { 65536, 127 } };
+	for (auto& size: sizes) {
+		std::string payload(size.first, '\0');
+		for (size_t i = 0; i < payload.size(); ++i) {
+			payload[i] = static_cast<char>(i * 7);
+		}
+		const bool is_text = size.first % 2 == 1;
+		client.ws.Send(payload, is_text);
+		// Large frames may need more than one flush
+		client.PollUntil([&]() { return client.ws.GetPendingBytes() == 0; });
+
+		auto frame = server.ReadFrame();
+		INFO("size ", size.first);
+		REQUIRE(frame.fin);
+		REQUIRE(frame.masked);
+		REQUIRE_EQ(frame.opcode, is_text ? OP_TEXT : OP_BINARY);
+		REQUIRE_EQ(frame.len_field, size.second);
+		REQUIRE_EQ(frame.payload, payload);
+	}
+}
+
+TEST_CASE("ServerFrames") {
+	TestServer server;
+	TestClient client;
+	server.Open(client.ws);
+
+	server.WriteFrame(OP_TEXT, true, "hello");
+	server.WriteFrame(OP_BINARY, true, std::string(300, 'b'));
+	server.WriteFrame(OP_BINARY, true, std::string(70000, 'c'));
+	REQUIRE(client.PollMessages(3));
+	REQUIRE_EQ(client.messages[0].data, "hello");
+	REQUIRE(client.messages[0].is_text);
+	REQUIRE_EQ(client.messages[1].data, std::string(300, 'b'));
+	REQUIRE_FALSE(client.messages[1].is_text);
+	REQUIRE_EQ(client.messages[2].data, std::string(70000, 'c'));
+}
+
+TEST_CASE("PartialFrame") {
+	TestServer server;
+	TestClient client;
+	server.Open(client.ws);
+	REQUIRE(client.PollUntil([&]() { return client.opened; }));
+
+	// A frame split inside the extended length and inside the payload
+	auto frame = MakeFrame(OP_BINARY, true, std::string(200, 'x'));
+	for (size_t split: { size_t(1), size_t(3), size_t(100) }) {
+		server.Write(std::string_view(frame).substr(0, split));
+		for (int i = 0; i < 5; ++i) {
+			client.ws.Poll();
+		}
+		REQUIRE(client.messages.empty());
+		server.Write(std::string_view(frame).substr(split));
+		REQUIRE(client.PollMessages(1));
+		REQUIRE_EQ(client.messages[0].data, std::string(200, 'x'));
+		client.messages.clear();
+	}
+}
+
+TEST_CASE("Fragmented") {
+	TestServer server;
+	TestClient client;
+	server.Open(client.ws);
+
+	// Control frames may be interleaved with the fragments
+	server.WriteFrame(OP_TEXT, false, "ab");
+	server.WriteFrame(OP_PING, true, "p");
+	server.WriteFrame(OP_CONTINUATION, false, "cd");
+	server.WriteFrame(OP_CONTINUATION, true, "ef");
+	server.WriteFrame(OP_BINARY, false, "gh");
+	server.WriteFrame(OP_CONTINUATION, true, "ij");
+	REQUIRE(client.PollMessages(2));
+	REQUIRE_FALSE(client.closed);
+	REQUIRE_EQ(client.messages.size(), 2);
+	REQUIRE_EQ(client.messages[0].data, "abcdef");
+	REQUIRE(client.messages[0].is_text);
+	REQUIRE_EQ(client.messages[1].data, "ghij");
+	REQUIRE_FALSE(client.messages[1].is_text);
+
+	auto pong = server.ReadFrame();
+	REQUIRE(pong.fin);
+	REQUIRE(pong.masked);
+	REQUIRE_EQ(pong.opcode, OP_PONG);
+	REQUIRE_EQ(pong.payload, "p");
+}
+
+TEST_CASE("ContinuationWithoutMessage") {
+	TestServer server;
+	TestClient client;
+	server.Open(client.ws);
+
+	server.WriteFrame(OP_CONTINUATION, true, "xx");
+	server.WriteFrame(OP_TEXT, true, "after");
+	REQUIRE(client.PollClosed());
+	REQUIRE(client.messages.empty());
+}
+
+TEST_CASE("ContinuationAfterMessage") {
+	TestServer server;
+	TestClient client;
+	server.Open(client.ws);
+
+	server.WriteFrame(OP_TEXT, false, "ab");
+	server.WriteFrame(OP_CONTINUATION, true, "cd");
+	server.WriteFrame(OP_CONTINUATION, true, "xx");
+	REQUIRE(client.PollClosed());
+	REQUIRE_EQ(client.messages.size(), 1);
+	REQUIRE_EQ(client.messages[0].data, "abcd");
+}
+
+TEST_CASE("DataInsideFragmentedMessage") {
+	for (bool fin: { false, true }) {
+		TestServer server;
+		TestClient client;
+		server.Open(client.ws);
+
+		server.WriteFrame(OP_TEXT, false, "ab");
+		server.WriteFrame(OP_BINARY, fin, "cd");
+		server.WriteFrame(OP_CONTINUATION, true, "ef");
+		INFO("fin ", fin);
+		REQUIRE(client.PollClosed());
+		REQUIRE(client.messages.empty());
+	}
+}
+
+TEST_SUITE_END();
+
+#endif
@@ -0,0 +1,118 @@
+#include "open_hash_map.h"
+#include "doctest.h"
+#include <map>
+#include <random>
+
+using IntMap = OpenHashMap<int, int>;
+
+namespace {
+// Puts every key into the same probe run
+struct CollideHash {
+	size_t operator()(int) const { return 0; }
+};
+}
+
+TEST_SUITE_BEGIN("OpenHashMap");
+
+TEST_CASE("Empty") {
+	IntMap mp;
+	REQUIRE(mp.empty());
+	REQUIRE_EQ(mp.size(), 0);
+	REQUIRE_EQ(mp.Find(1), nullptr);
+	REQUIRE_FALSE(mp.Erase(1));
+	REQUIRE_EQ(mp.EraseIf([](int, int) { return true; }), 0);
+}
+
+TEST_CASE("InsertFind") {
+	IntMap mp;
+	for (int i = 0; i < 100; ++i) {
+		mp[i] = i * 2;
+	}
+	REQUIRE_EQ(mp.size(), 100);
+	REQUIRE_GE(mp.capacity() * 3, mp.size() * 4);
+	for (int i = 0; i < 100; ++i) {
+		REQUIRE_NE(mp.Find(i), nullptr);
+		REQUIRE_EQ(*mp.Find(i), i * 2);
+	}
+	REQUIRE_EQ(mp.Find(100), nullptr);
+
+	mp[5] = 7;
+	REQUIRE_EQ(mp.size(), 100);
+	REQUIRE_EQ(*mp.Find(5), 7);
+}
+
+TEST_CASE("EraseKeepsProbeRun") {
+	OpenHashMap<int, int, CollideHash> mp;
+	for (int i = 0; i < 10; ++i) {
+		mp[i] = i;
+	}
+	REQUIRE(mp.Erase(3));
+	REQUIRE_FALSE(mp.Erase(3));
+	REQUIRE(mp.Erase(0));
+	REQUIRE_EQ(mp.size(), 8);
+	for (int i = 0; i < 10; ++i) {
+		if (i == 0 || i == 3) {
+			REQUIRE_EQ(mp.Find(i), nullptr);
+		} else {
+			REQUIRE_EQ(*mp.Find(i), i);
+		}
+	}
+}
+
+TEST_CASE("EraseIf") {
+	IntMap mp;
+	for (int i = 0; i < 50; ++i) {
+		mp[i] = i;
+	}
+	size_t cap = mp.capacity();
+	REQUIRE_EQ(mp.EraseIf([](int k, int) { return k % 2 == 0; }), 25);
+	REQUIRE_EQ(mp.size(), 25);
+	REQUIRE_EQ(mp.capacity(), cap);
+	for (int i = 0; i < 50; ++i) {
+		REQUIRE_EQ(mp.Find(i) != nullptr, i % 2 == 1);
+	}
+
+	int sum = 0;
+	mp.ForEach([&](int k, int v) { REQUIRE_EQ(k, v); sum += v; });
+	REQUIRE_EQ(sum, 625);
+}
+
+TEST_CASE("RandomAgainstStdMap") {
+	IntMap mp;
+	std::map<int, int> ref;
+	std::mt19937 rng(1234);
+	for (int n = 0; n < 20000; ++n) {
+		int key = rng() % 512;
+		switch (rng() % 3) {
+			case 0:
+				mp[key] = n;
+				ref[key] = n;
+				break;
+			case 1:
+				REQUIRE_EQ(mp.Erase(key), ref.erase(key) == 1);
+				break;
+			default: {
+				auto it = ref.find(key);
+				auto* v = mp.Find(key);
+				REQUIRE_EQ(v != nullptr, it != ref.end());
+				if (v) {
+					REQUIRE_EQ(*v, it->second);
+				}
+			}
+		}
+		REQUIRE_EQ(mp.size(), ref.size());
+	}
+}
+
+TEST_CASE("Clear") {
+	IntMap mp;
+	mp[1] = 1;
+	mp.clear();
+	REQUIRE(mp.empty());
+	REQUIRE_EQ(mp.capacity(), 0);
+	REQUIRE_EQ(mp.Find(1), nullptr);
+	mp[2] = 2;
+	REQUIRE_EQ(*mp.Find(2), 2);
+}
+
+TEST_SUITE_END();
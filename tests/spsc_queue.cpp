@@ -0,0 +1,85 @@
+#include <memory>
+#include <thread>
+#include "spsc_queue.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("SpscQueue");
+
+TEST_CASE("Capacity") {
+	REQUIRE_EQ(SpscQueue<int>(1).GetCapacity(), 1);
+	REQUIRE_EQ(SpscQueue<int>(5).GetCapacity(), 8);
+	REQUIRE_EQ(SpscQueue<int>(16).GetCapacity(), 16);
+}
+
+TEST_CASE("PushPop") {
+	SpscQueue<int> queue(4);
+	int value = 0;
+
+	REQUIRE(queue.IsEmpty());
+	REQUIRE_FALSE(queue.Pop(value));
+
+	// several rounds so that the positions wrap around the slots
+	for (int round = 0; round < 3; ++round) {
+		for (int i = 0; i < 4; ++i) {
+			REQUIRE(queue.Push(round * 10 + i));
+		}
+		REQUIRE_FALSE(queue.Push(99));
+		REQUIRE_FALSE(queue.IsEmpty());
+
+		for (int i = 0; i < 4; ++i) {
+			REQUIRE(queue.Pop(value));
+			REQUIRE_EQ(value, round * 10 + i);
+		}
+		REQUIRE_FALSE(queue.Pop(value));
+		REQUIRE(queue.IsEmpty());
+	}
+}
+
+TEST_CASE("FullLeavesValue") {
+	SpscQueue<std::unique_ptr<int>> queue(1);
+
+	auto first = std::make_unique<int>(1);
+	auto second = std::make_unique<int>(2);
+	REQUIRE(queue.Push(std::move(first)));
+	REQUIRE_FALSE(first);
+
+	REQUIRE_FALSE(queue.Push(std::move(second)));
+	REQUIRE(second);
+	REQUIRE_EQ(*second, 2);
+
+	std::unique_ptr<int> out;
+	REQUIRE(queue.Pop(out));
+	REQUIRE_EQ(*out, 1);
+	REQUIRE(queue.Push(std::move(second)));
+}
+
+TEST_CASE("Threads") {
+	constexpr int count = 100000;
+	SpscQueue<int> queue(64);
+
+	std::thread producer([&]() {
+		for (int i = 0; i < count; ++i) {
+			while (!queue.Push(int(i))) {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	int expected = 0;
+	bool in_order = true;
+	while (expected < count) {
+		int value;
+		if (queue.Pop(value)) {
+			in_order = in_order && value == expected;
+			++expected;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+
+	REQUIRE(in_order);
+	REQUIRE(queue.IsEmpty());
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,217 @@
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include "tilemap_layer.h"
+#include "bitmap.h"
+#include "drawable_list.h"
+#include "drawable_mgr.h"
+#include "game_map.h"
+#include "game_system.h"
+#include "main_data.h"
+#include "map_data.h"
+#include "mock_game.h"
+#include "pixel_format.h"
+#include "doctest.h"
+
+TEST_SUITE_BEGIN("TilemapLayer");
+
+namespace {
+
+constexpr int map_w = 40;
+constexpr int map_h = 30;
+
+// Every tile is opaque, transparent or partially transparent, so all
+// opacity classes of the chipset are drawn
+BitmapRef MakeChipset(std::mt19937& rng) {
+	auto chipset = Bitmap::Create(480, 256, true);
+	chipset->Clear();
+	for (int ty = 0; ty < 16; ++ty) {
+		for (int tx = 0; tx < 30; ++tx) {
+			const int kind = rng() % 3;
+			const Color color(rng() % 256, rng() % 256, rng() % 256, 255);
+			if (kind == 0) {
+				chipset->FillRect(Rect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE), color);
+			} else if (kind == 1) {
+				for (int j = 0; j < TILE_SIZE; j += 4) {
+					chipset->FillRect(Rect(tx * TILE_SIZE + (j / 4 % 2) * 4, ty * TILE_SIZE + j, 8, 4), color);
+				}
+			}
+		}
+	}
+	chipset->CheckPixels(Bitmap::Flag_Chipset);
+	return chipset;
+}
+
+std::vector<short> MakeLower(std::mt19937& rng) {
+	std::vector<short> data(map_w * map_h);
+	for (auto& id: data) {
+		switch (rng() % 4) {
+			case 0: id = (rng() % 3) * 1000 + (rng() % 16) * 50 + rng() % 47; break;
+			case 1: id = BLOCK_C + (rng() % 3) * 50 + rng() % 50; break;
+			case 2: id = BLOCK_D + (rng() % 12) * 50 + rng() % 50; break;
+			default: id = BLOCK_E + rng() % BLOCK_E_TILES; break;
+		}
+	}
+	return data;
+}
+
+std::vector<short> MakeUpper(std::mt19937& rng) {
+	std::vector<short> data(map_w * map_h);
+	for (auto& id: data) {
+		id = rng() % 2 ? BLOCK_F + rng() % BLOCK_F_TILES : 0;
+	}
+	return data;
+}
+
+// Draws the same map through the retained surfaces and tile by tile
+struct Layers {
+	std::unique_ptr<TilemapLayer> lower;
+	std::unique_ptr<TilemapLayer> upper;
+	BitmapRef screen;
+
+	Layers(bool retained, BitmapRef chipset, const std::vector<short>& lower_data, const std::vector<short>& upper_data,
+			const std::vector<unsigned char>& pass_lower, const std::vector<unsigned char>& pass_upper, bool loop_h, bool loop_v, bool fast_blit) {
+		lower = std::make_unique<TilemapLayer>(0);
+		upper = std::make_unique<TilemapLayer>(1);
+		for (auto* layer: { lower.get(), upper.get() }) {
+			layer->SetWidth(map_w);
+			layer->SetHeight(map_h);
+			layer->SetChipset(chipset);
+			layer->SetLoop(loop_h, loop_v);
+			layer->SetRetained(retained);
+		}
+		lower->SetMapData(lower_data);
+		upper->SetMapData(upper_data);
+		lower->SetPassable(pass_lower);
+		upper->SetPassable(pass_upper);
+		lower->SetFastBlit(fast_blit);
+		screen = Bitmap::Create(320, 240, false);
+	}
+
+	void Draw() {
+		screen->Clear();
+		lower->Draw(*screen, Priority_TilesetBelow);
+		upper->Draw(*screen, Priority_TilesetBelow + 1);
+		lower->Draw(*screen, Priority_TilesetAbove);
+		upper->Draw(*screen, Priority_TilesetAbove + 1);
+	}
+
+	template <typename F>
+	void Apply(F&& f) {
+		f(*lower);
+		f(*upper);
+	}
+};
+
+bool SamePixels(const Bitmap& a, const Bitmap& b) {
+	return std::memcmp(a.pixels(), b.pixels(), a.pitch() * a.height()) == 0;
+}
+
+// With fast blit the screen is cleared and nothing is drawn below the tilemap
+void testIdentical(bool loop_h, bool loop_v, bool fast_blit = false) {
+	DrawableList list;
+	DrawableMgr::SetLocalList(&list);
+	const MockGame mg(MockMap::ePass40x30);
+	Bitmap::SetFormat(format_R8G8B8A8_a().format());
+
+	std::mt19937 rng(42);
+	auto chipset = MakeChipset(rng);
+	auto lower_data = MakeLower(rng);
+	auto upper_data = MakeUpper(rng);
+	std::vector<unsigned char> pass_lower(200), pass_upper(200);
+	for (auto& p: pass_lower) {
+		p = rng() % 2 ? 0x30 : 0x0F;
+	}
+	for (auto& p: pass_upper) {
+		p = rng() % 2 ? 0x20 : 0x0F;
+	}
+
+	Layers retained(true, chipset, lower_data, upper_data, pass_lower, pass_upper, loop_h, loop_v, fast_blit);
+	Layers immediate(false, chipset, lower_data, upper_data, pass_lower, pass_upper, loop_h, loop_v, fast_blit);
+	retained.lower->SetAnimationSpeed(3);
+	immediate.lower->SetAnimationSpeed(3);
+
+	int ox = 0;
+	int oy = 0;
+	for (int frame = 0; frame < 160; ++frame) {
+		Main_Data::game_system->IncFrameCounter();
+
+		const int r = rng() % 10;
+		if (r < 6) {
+			ox += int(rng() % 9) - 4;
+			oy += int(rng() % 9) - 4;
+		} else if (r == 6) {
+			ox = int(rng() % 1200) - 300;
+			oy = int(rng() % 900) - 200;
+		}
+
+		if (frame == 60) {
+			retained.lower->SetAnimationType(1);
+			immediate.lower->SetAnimationType(1);
+		}
+		if (frame == 80) {
+			for (int i = 0; i < 10; ++i) {
+				Game_Map::SubstituteDown(rng() % BLOCK_E_TILES, rng() % BLOCK_E_TILES);
+			}
+			retained.lower->OnSubstitute();
+			immediate.lower->OnSubstitute();
+		}
+		if (frame == 100) {
+			for (int i = 0; i < 10; ++i) {
+				Game_Map::SubstituteUp(rng() % BLOCK_F_TILES, rng() % BLOCK_F_TILES);
+			}
+			retained.upper->OnSubstitute();
+			immediate.upper->OnSubstitute();
+		}
+		if (frame == 120) {
+			lower_data[5] = BLOCK_D + 3;
+			retained.lower->SetMapData(lower_data);
+			immediate.lower->SetMapData(lower_data);
+		}
+		if (frame == 140) {
+			for (auto* layers: { &retained, &immediate }) {
+				layers->Apply([](TilemapLayer& layer) { layer.SetTone(Tone(200, 128, 128, 128)); });
+			}
+		}
+
+		for (auto* layers: { &retained, &immediate }) {
+			layers->Apply([&](TilemapLayer& layer) {
+				layer.SetOx(ox);
+				layer.SetOy(oy);
+			});
+			layers->Draw();
+		}
+
+		INFO("frame ", frame, " ox ", ox, " oy ", oy);
+		REQUIRE(SamePixels(*retained.screen, *immediate.screen));
+	}
+}
+
+}
+
+TEST_CASE("RetainedIdentical") {
+	testIdentical(false, false);
+}
+
+TEST_CASE("RetainedIdenticalLoop") {
+	testIdentical(true, true);
+}
+
+TEST_CASE("RetainedIdenticalLoopHorizontal") {
+	testIdentical(true, false);
+}
+
+TEST_CASE("RetainedIdenticalLoopVertical") {
+	testIdentical(false, true);
+}
+
+TEST_CASE("RetainedIdenticalFastBlit") {
+	testIdentical(false, false, true);
+}
+
+TEST_CASE("RetainedIdenticalFastBlitLoop") {
+	testIdentical(true, true, true);
+}
+
+TEST_SUITE_END();